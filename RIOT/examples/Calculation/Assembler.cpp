@@ -0,0 +1,1232 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Implementation of Assembler
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+#include "Assembler.h"
+
+#ifdef VM_TOOLCHAIN
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Mnemonic of an instruction.
+ */
+typedef struct {
+	const char* name;
+	uint8_t opcode;
+} asm_mnemonic_t;
+
+static const asm_mnemonic_t mnemonics[] = {
+		{"ADD", VM_INSTRUCTION_ADD}, {"SUB", VM_INSTRUCTION_SUB}, {"MUL", VM_INSTRUCTION_MUL},
+		{"DIV", VM_INSTRUCTION_DIV}, {"MOD", VM_INSTRUCTION_MOD},
+		{"SADD", VM_INSTRUCTION_SADD}, {"SSUB", VM_INSTRUCTION_SSUB}, {"SMUL", VM_INSTRUCTION_SMUL},
+		{"SDIV", VM_INSTRUCTION_SDIV},
+		{"AND", VM_INSTRUCTION_AND}, {"OR", VM_INSTRUCTION_OR}, {"NOT", VM_INSTRUCTION_NOT},
+		{"XOR", VM_INSTRUCTION_XOR}, {"LSHIFT", VM_INSTRUCTION_LSHIFT}, {"RSHIFT", VM_INSTRUCTION_RSHIFT},
+		{"LOAD", VM_INSTRUCTION_LOAD}, {"MULTILOAD", VM_INSTRUCTION_MULTILOAD},
+		{"PUSH", VM_INSTRUCTION_PUSH}, {"POP", VM_INSTRUCTION_POP}, {"COPY", VM_INSTRUCTION_COPY},
+		{"JUMP", VM_INSTRUCTION_JUMP}, {"COMPARE", VM_INSTRUCTION_COMPARE}, {"CALL", VM_INSTRUCTION_CALL},
+		{"RETURN", VM_INSTRUCTION_RETURN}, {"SCOMPARE", VM_INSTRUCTION_SCOMPARE},
+		{"ADDCOMPARE", VM_INSTRUCTION_ADDCOMPARE},
+		{"TIME", VM_INSTRUCTION_TIME}, {"COMPARETIME", VM_INSTRUCTION_COMPARETIME},
+		{"SLEEPUNTIL", VM_INSTRUCTION_SLEEPUNTIL}, {"TIMECOMPARE", VM_INSTRUCTION_TIMECOMPARE},
+		{"URLMAP", VM_INSTRUCTION_URLMAP}, {"URLMAPCHECK", VM_INSTRUCTION_URLMAPCHECK},
+		{"URLMAPDELETE", VM_INSTRUCTION_URLMAPDELETE}, {"URLMAPWAIT", VM_INSTRUCTION_URLMAPWAIT},
+		{"URLMAPCOMPARE", VM_INSTRUCTION_URLMAPCOMPARE},
+		{"PIDINIT", VM_INSTRUCTION_PIDINIT}, {"PIDCLEAR", VM_INSTRUCTION_PIDCLEAR},
+		{"PIDSTOP", VM_INSTRUCTION_PIDSTOP}, {"PIDRUN", VM_INSTRUCTION_PIDRUN}, {"PIDWAIT", VM_INSTRUCTION_PIDWAIT},
+		{"HALT", VM_INSTRUCTION_HALT}, {"RESET", VM_INSTRUCTION_RESET}
+};
+
+/**
+ * Words of the map options operand of URLMAP.
+ */
+typedef struct {
+	const char* name;
+	uint8_t option;
+} asm_option_t;
+
+static const asm_option_t options[] = {
+		{"client", VM_MAP_OPTION_DIRECTION_CLIENT}, {"server", VM_MAP_OPTION_DIRECTION_SERVER},
+		{"get", VM_MAP_OPTION_METHOD_GET}, {"post", VM_MAP_OPTION_METHOD_POST}, {"put", VM_MAP_OPTION_METHOD_PUT},
+		{"once", VM_MAP_OPTION_LIFETIME_ONCE}, {"ever", VM_MAP_OPTION_LIFETIME_EVER}
+};
+
+/**
+ * Compares two names ignoring the case (the strings.h of RIOT's posix module has no case-insensitive compare).
+ * @param a First name.
+ * @param b Second name.
+ * @param length Number of characters to compare.
+ * @return True if the first length characters are equal.
+ */
+static bool equalsname(const char* a, const char* b, uint8_t length)
+{
+	for(uint8_t i = 0; i < length; i++)
+	{
+		if(tolower((unsigned char) a[i]) != tolower((unsigned char) b[i]))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @param name Name of the option.
+ * @param length Length of the name.
+ * @return Option bits, 0xff if the name is no option.
+ */
+static uint8_t findoption(const char* name, uint8_t length)
+{
+	for(uint8_t i = 0; i < sizeof(options) / sizeof(options[0]); i++)
+	{
+		if(strlen(options[i].name) == length && equalsname(options[i].name, name, length))
+		{
+			return options[i].option;
+		}
+	}
+	return 0xff;
+}
+
+/**
+ * @param name Name of the type (u8, u16, u32, dec).
+ * @param length Length of the name.
+ * @param type Type (VM_OPERAND_TYPE_*).
+ * @return True if the name is a type.
+ */
+static bool findtype(const char* name, uint8_t length, uint8_t* type)
+{
+	if(length == 2 && equalsname(name, "u8", 2))		*type = VM_OPERAND_TYPE_UINT8;
+	else if(length == 3 && equalsname(name, "u16", 3))	*type = VM_OPERAND_TYPE_UINT16;
+	else if(length == 3 && equalsname(name, "u32", 3))	*type = VM_OPERAND_TYPE_UINT32;
+	else if(length == 3 && equalsname(name, "dec", 3))	*type = VM_OPERAND_TYPE_DEC;
+	else return false;
+	return true;
+}
+
+/**
+ * @param operand Operand.
+ * @return True if the operand is a number without symbol (plain or literal).
+ */
+static bool numeric(const asm_operand_t& operand)
+{
+	return (operand.kind == ASSEMBLER_OPERAND_NUMBER || operand.kind == ASSEMBLER_OPERAND_LITERAL)
+			&& operand.symbol == ASSEMBLER_NO_SYMBOL;
+}
+
+/**
+ * @param operand Operand.
+ * @return Register and literal bits of a source operand in the OPTYPE.
+ */
+static uint8_t sourcebits(const asm_operand_t& operand)
+{
+	switch(operand.kind)
+	{
+	case ASSEMBLER_OPERAND_LITERAL:		return VM_LITERAL;
+	case ASSEMBLER_OPERAND_REGISTER:	return VM_REGISTER_OPERAND;
+	default:							return VM_ADDRESS;
+	}
+}
+
+/**
+ * @param operand Operand.
+ * @return Register bit of a destination operand in the OPTYPE.
+ */
+static uint8_t destinationbits(const asm_operand_t& operand)
+{
+	return operand.kind == ASSEMBLER_OPERAND_REGISTER ? VM_REGISTER_DESTINATION : 0;
+}
+
+/**
+ * @param code Buffer for the bytecode.
+ * @param size Size of the buffer in Bytes.
+ */
+Assembler::Assembler(uint8_t* code, uint16_t size)
+{
+	this->code = code;
+	this->size = size;
+	position = 0;
+	dataend = 0;
+	symbolcount = 0;
+	fixupcount = 0;
+	line = 0;
+	errorline = 0;
+	error[0] = '\0';
+	cursor = 0;
+	lineend = 0;
+}
+
+/**
+ * @param type Type of an operand (VM_OPERAND_TYPE_*).
+ * @return Size of the type in Bytes.
+ */
+uint8_t Assembler::typesize(uint8_t type)
+{
+	switch(type & VM_OPTYPE_MASK)
+	{
+	case VM_OPERAND_TYPE_UINT8:		return sizeof(uint8_t);
+	case VM_OPERAND_TYPE_UINT16:	return sizeof(uint16_t);
+	case VM_OPERAND_TYPE_DEC:		return sizeof(rational_t);
+	default:						return sizeof(uint32_t);
+	}
+}
+
+/**
+ * @param opcode Opcode of an instruction.
+ * @return Mnemonic of the instruction, "?" if the opcode is not defined.
+ */
+const char* Assembler::mnemonic(uint8_t opcode)
+{
+	for(uint8_t i = 0; i < sizeof(mnemonics) / sizeof(mnemonics[0]); i++)
+	{
+		if(mnemonics[i].opcode == opcode)
+		{
+			return mnemonics[i].name;
+		}
+	}
+	return "?";
+}
+
+/**
+ * Assembles a program. Symbols may be used before they are defined.
+ * @param source Assembly language, lines separated by '\n', terminated with 0.
+ * @return Size of the program in Bytes, 0 on errors (see getError() and getLine()).
+ */
+uint16_t Assembler::assemble(const char* source)
+{
+	const char* next = source;
+	line = 0;
+	while(*next && !error[0])
+	{
+		line++;
+		cursor = next;
+		lineend = strchr(next, '\n');
+		if(!lineend)
+		{
+			lineend = next + strlen(next);
+		}
+		next = *lineend ? lineend + 1 : lineend;
+		parseline();
+	}
+	return error[0] ? 0 : finish();
+}
+
+/**
+ * Records the first error.
+ * @param message Error message.
+ * @param name Name appended to the message (symbol), may be 0.
+ * @param length Length of the name.
+ * @return False.
+ */
+bool Assembler::fail(const char* message, const char* name, uint8_t length)
+{
+	if(!error[0])
+	{
+		if(name)
+		{
+			snprintf(error, sizeof(error), "%s %.*s", message, length, name);
+		}
+		else
+		{
+			snprintf(error, sizeof(error), "%s", message);
+		}
+		errorline = line;
+	}
+	return false;
+}
+
+/**
+ * Finds a symbol, unknown symbols are created as labels which are not yet defined.
+ * @param name Name of the symbol.
+ * @param length Length of the name.
+ * @return Index of the symbol, ASSEMBLER_NO_SYMBOL if the symbol table is full or the name is too long.
+ */
+uint16_t Assembler::symbol(const char* name, uint8_t length)
+{
+	if(length == 0 || length > ASSEMBLER_SYMBOL_LENGTH)
+	{
+		fail("invalid symbol name", name, length);
+		return ASSEMBLER_NO_SYMBOL;
+	}
+	for(uint16_t i = 0; i < symbolcount; i++)
+	{
+		if(strncmp(symbols[i].name, name, length) == 0 && symbols[i].name[length] == '\0')
+		{
+			return i;
+		}
+	}
+	if(symbolcount >= ASSEMBLER_SYMBOLS)
+	{
+		fail("too many symbols");
+		return ASSEMBLER_NO_SYMBOL;
+	}
+	asm_symbol_t* s = &symbols[symbolcount];
+	memcpy(s->name, name, length);
+	s->name[length] = '\0';
+	s->kind = ASSEMBLER_SYMBOL_LABEL;
+	s->defined = false;
+	s->fixed = false;
+	s->size = 0;
+	s->value = 0;
+	return symbolcount++;
+}
+
+/**
+ * Defines a label at the current position.
+ * @param symbol Index of the symbol.
+ * @return True if the label was not defined before.
+ */
+bool Assembler::label(uint16_t symbol)
+{
+	if(symbol >= symbolcount)
+	{
+		return false;
+	}
+	asm_symbol_t* s = &symbols[symbol];
+	if(s->defined || s->kind != ASSEMBLER_SYMBOL_LABEL)
+	{
+		return fail("symbol defined twice:", s->name, strlen(s->name));
+	}
+	s->defined = true;
+	s->value = position;
+	return true;
+}
+
+/**
+ * Defines a variable, variables without fixed address are placed by finish().
+ * @param symbol Index of the symbol.
+ * @param type Type of the variable (VM_OPERAND_TYPE_*).
+ * @param fixed True if the variable is stored at the address.
+ * @param address Address of the variable.
+ * @return True if the symbol was not defined before.
+ */
+bool Assembler::variable(uint16_t symbol, uint8_t type, bool fixed, uint16_t address)
+{
+	if(symbol >= symbolcount)
+	{
+		return false;
+	}
+	asm_symbol_t* s = &symbols[symbol];
+	if(s->defined || s->kind != ASSEMBLER_SYMBOL_LABEL)
+	{
+		return fail("symbol defined twice:", s->name, strlen(s->name));
+	}
+	s->kind = ASSEMBLER_SYMBOL_VARIABLE;
+	s->size = typesize(type);
+	s->fixed = fixed;
+	s->defined = fixed;
+	s->value = address;
+	if(fixed && (uint32_t) address + s->size > VM_MEMORY_SIZE)
+	{
+		return fail("address out of memory:", s->name, strlen(s->name));
+	}
+	return true;
+}
+
+/**
+ * Defines a constant.
+ * @param symbol Index of the symbol.
+ * @param value Value of the constant.
+ * @return True if the symbol was not defined before.
+ */
+bool Assembler::constant(uint16_t symbol, double value)
+{
+	if(symbol >= symbolcount)
+	{
+		return false;
+	}
+	asm_symbol_t* s = &symbols[symbol];
+	if(s->defined || s->kind != ASSEMBLER_SYMBOL_LABEL)
+	{
+		return fail("symbol defined twice:", s->name, strlen(s->name));
+	}
+	s->kind = ASSEMBLER_SYMBOL_CONSTANT;
+	s->defined = true;
+	s->value = value;
+	return true;
+}
+
+/**
+ * @param name Name of a label, variable or constant.
+ * @return Value of the symbol after finish(), NO_MAPPING for unknown symbols.
+ */
+uint16_t Assembler::getAddress(const char* name)
+{
+	for(uint16_t i = 0; i < symbolcount; i++)
+	{
+		if(strcmp(symbols[i].name, name) == 0 && symbols[i].defined)
+		{
+			return (uint16_t) symbols[i].value;
+		}
+	}
+	return NO_MAPPING;
+}
+
+/**
+ * Places the variables without fixed address behind the code (at address 0 in Harvard mode) and skips fixed variables.
+ * @return True if all variables fit into the memory.
+ */
+bool Assembler::placevariables(void)
+{
+#ifdef VM_HARVARD
+	uint32_t next = 0;
+#else
+	uint32_t next = position;
+#endif
+	dataend = next;
+	for(uint16_t i = 0; i < symbolcount; i++)
+	{
+		asm_symbol_t* s = &symbols[i];
+		if(s->kind != ASSEMBLER_SYMBOL_VARIABLE)
+		{
+			continue;
+		}
+		if(!s->fixed)
+		{
+			bool moved = true;
+			while(moved)
+			{
+				moved = false;
+				for(uint16_t j = 0; j < symbolcount; j++)
+				{
+					asm_symbol_t* f = &symbols[j];
+					if(f->kind == ASSEMBLER_SYMBOL_VARIABLE && f->fixed
+							&& next < f->value + f->size && f->value < next + s->size)
+					{
+						next = (uint32_t) f->value + f->size;
+						moved = true;
+					}
+				}
+			}
+			s->value = next;
+			s->defined = true;
+			next += s->size;
+		}
+		if(s->value + s->size > VM_MEMORY_SIZE)
+		{
+			return fail("variables exceed the memory:", s->name, strlen(s->name));
+		}
+#ifndef VM_HARVARD
+		if(s->value < position)
+		{
+			return fail("variable overlaps the code:", s->name, strlen(s->name));
+		}
+#endif
+		if(s->value + s->size > dataend)
+		{
+			dataend = (uint16_t) (s->value + s->size);
+		}
+	}
+	return true;
+}
+
+/**
+ * Places the variables and resolves all symbol references.
+ * @return Size of the program in Bytes, 0 on errors.
+ */
+uint16_t Assembler::finish(void)
+{
+	if(error[0] || !placevariables())
+	{
+		return 0;
+	}
+	for(uint16_t i = 0; i < fixupcount; i++)
+	{
+		const asm_fixup_t& f = fixups[i];
+		const asm_symbol_t& s = symbols[f.symbol];
+		if(!s.defined)
+		{
+			line = f.line;
+			fail("undefined symbol", s.name, strlen(s.name));
+			return 0;
+		}
+		uint16_t value = (uint16_t) (s.value + f.offset);
+		code[f.position] = value & 0xff;
+		code[f.position + 1] = value >> 8;
+	}
+	return position;
+}
+
+/**
+ * Skips blanks.
+ */
+void Assembler::skipspace(void)
+{
+	while(cursor < lineend && isspace((unsigned char) *cursor))
+	{
+		cursor++;
+	}
+}
+
+/**
+ * @return True if only blanks or a comment follow in the current line.
+ */
+bool Assembler::lineended(void)
+{
+	skipspace();
+	return cursor >= lineend || *cursor == ';';
+}
+
+/**
+ * Reads a name (letters, digits, '_' and '.').
+ * @param name Start of the name.
+ * @return Length of the name, 0 if there is none.
+ */
+uint8_t Assembler::identifier(const char** name)
+{
+	skipspace();
+	*name = cursor;
+	if(cursor >= lineend || !(isalpha((unsigned char) *cursor) || *cursor == '_' || *cursor == '.'))
+	{
+		return 0;
+	}
+	while(cursor < lineend && (isalnum((unsigned char) *cursor) || *cursor == '_' || *cursor == '.'))
+	{
+		cursor++;
+	}
+	return (uint8_t) (cursor - *name);
+}
+
+/**
+ * Reads a decimal or hexadecimal (0x) number with optional sign.
+ * @param value Number.
+ * @return True if a number was read.
+ */
+bool Assembler::parsenumber(double* value)
+{
+	skipspace();
+	const char* start = cursor;
+	char* end = 0;
+	bool negative = false;
+	if(cursor < lineend && (*cursor == '-' || *cursor == '+'))
+	{
+		negative = *cursor == '-';
+		cursor++;
+	}
+	if(cursor + 1 < lineend && cursor[0] == '0' && (cursor[1] == 'x' || cursor[1] == 'X'))
+	{
+		*value = (double) strtoul(cursor, &end, 16);
+	}
+	else
+	{
+		*value = strtod(cursor, &end);
+	}
+	if(end == cursor || end > lineend || isalpha((unsigned char) *end) || *end == '_')
+	{
+		cursor = start;
+		return fail("invalid number");
+	}
+	cursor = end;
+	if(negative)
+	{
+		*value = -*value;
+	}
+	return true;
+}
+
+/**
+ * Reads a number, a constant or a symbol with optional offset (@name+4).
+ * @param operand Operand, value and symbol are set.
+ * @param literal True if only numbers and constants are allowed.
+ * @return True if a value was read.
+ */
+bool Assembler::parsevalue(asm_operand_t* operand, bool literal)
+{
+	const char* name;
+	uint8_t length = identifier(&name);
+	if(length == 0)
+	{
+		return parsenumber(&operand->value);
+	}
+	uint16_t s = symbol(name, length);
+	if(s == ASSEMBLER_NO_SYMBOL)
+	{
+		return false;
+	}
+	if(symbols[s].kind == ASSEMBLER_SYMBOL_CONSTANT)
+	{
+		operand->value = symbols[s].value;
+		return true;
+	}
+	if(literal)
+	{
+		return fail("constant expected:", name, length);
+	}
+	operand->symbol = s;
+	skipspace();
+	if(cursor < lineend && (*cursor == '+' || *cursor == '-'))
+	{
+		return parsenumber(&operand->value);
+	}
+	return true;
+}
+
+/**
+ * Reads one operand.
+ * @param operand Operand.
+ * @return True if an operand was read.
+ */
+bool Assembler::parseoperand(asm_operand_t* operand)
+{
+	operand->kind = ASSEMBLER_OPERAND_NUMBER;
+	operand->symbol = ASSEMBLER_NO_SYMBOL;
+	operand->value = 0;
+	operand->string = 0;
+	operand->length = 0;
+	skipspace();
+	if(cursor >= lineend)
+	{
+		return fail("operand expected");
+	}
+	char c = *cursor;
+	if(c == '#')
+	{
+		cursor++;
+		operand->kind = ASSEMBLER_OPERAND_LITERAL;
+		return parsevalue(operand, true);
+	}
+	if(c == '@')
+	{
+		cursor++;
+		operand->kind = ASSEMBLER_OPERAND_ADDRESS;
+		return parsevalue(operand, false);
+	}
+	if(c == '"')
+	{
+		const char* start = ++cursor;
+		while(cursor < lineend && *cursor != '"')
+		{
+			cursor++;
+		}
+		if(cursor >= lineend || cursor - start > UINT8_MAX)
+		{
+			return fail("invalid string");
+		}
+		operand->kind = ASSEMBLER_OPERAND_STRING;
+		operand->string = start;
+		operand->length = (uint8_t) (cursor - start);
+		cursor++;
+		return true;
+	}
+	if((c == 'r' || c == 'R') && cursor + 1 < lineend && isdigit((unsigned char) cursor[1]))
+	{
+		const char* start = cursor++;
+		while(cursor < lineend && isdigit((unsigned char) *cursor))
+		{
+			cursor++;
+		}
+		if(cursor >= lineend || !(isalnum((unsigned char) *cursor) || *cursor == '_' || *cursor == '.'))
+		{
+			operand->kind = ASSEMBLER_OPERAND_REGISTER;
+			operand->value = atoi(start + 1);
+			return true;
+		}
+		cursor = start;
+	}
+	if(!(isalpha((unsigned char) c) || c == '_' || c == '.'))
+	{
+		return parsenumber(&operand->value);
+	}
+	//map options joined by '|' or a label or constant
+	const char* start = cursor;
+	const char* name;
+	uint8_t length = identifier(&name);
+	uint8_t option = findoption(name, length);
+	skipspace();
+	if(option != 0xff || (cursor < lineend && *cursor == '|'))
+	{
+		uint8_t bits = 0;
+		while(option != 0xff)
+		{
+			bits |= option;
+			skipspace();
+			if(cursor >= lineend || *cursor != '|')
+			{
+				operand->value = bits;
+				return true;
+			}
+			cursor++;
+			length = identifier(&name);
+			option = findoption(name, length);
+		}
+		return fail("invalid map option", name, length);
+	}
+	cursor = start;
+	if(!parsevalue(operand, false))
+	{
+		return false;
+	}
+	if(operand->symbol != ASSEMBLER_NO_SYMBOL)
+	{
+		operand->kind = ASSEMBLER_OPERAND_LABEL;
+	}
+	return true;
+}
+
+/**
+ * Handles .equ and .var.
+ * @param name Name of the directive.
+ * @param length Length of the name.
+ * @return True if the directive was valid.
+ */
+bool Assembler::parsedirective(const char* name, uint8_t length)
+{
+	const char* symbolname;
+	uint8_t symbollength;
+	if(length == 4 && equalsname(name, ".equ", 4))
+	{
+		double value;
+		symbollength = identifier(&symbolname);
+		uint16_t s = symbol(symbolname, symbollength);
+		if(s == ASSEMBLER_NO_SYMBOL || !parsenumber(&value))
+		{
+			return false;
+		}
+		return constant(s, value);
+	}
+	if(length == 4 && equalsname(name, ".var", 4))
+	{
+		uint8_t type;
+		const char* typename_;
+		symbollength = identifier(&symbolname);
+		uint16_t s = symbol(symbolname, symbollength);
+		if(s == ASSEMBLER_NO_SYMBOL)
+		{
+			return false;
+		}
+		uint8_t typelength = identifier(&typename_);
+		if(!findtype(typename_, typelength, &type))
+		{
+			return fail("invalid type", typename_, typelength);
+		}
+		skipspace();
+		if(cursor < lineend && *cursor == '@')
+		{
+			double address;
+			cursor++;
+			if(!parsenumber(&address))
+			{
+				return false;
+			}
+			if(address < 0 || address > UINT16_MAX)
+			{
+				return fail("invalid address");
+			}
+			return variable(s, type, true, (uint16_t) address);
+		}
+		return variable(s, type, false, 0);
+	}
+	return fail("unknown directive", name, length);
+}
+
+/**
+ * Parses and emits the current line.
+ * @return True if the line was valid.
+ */
+bool Assembler::parseline(void)
+{
+	if(lineended())
+	{
+		return true;
+	}
+	const char* name;
+	uint8_t length = identifier(&name);
+	if(length == 0)
+	{
+		return fail("label or instruction expected");
+	}
+	skipspace();
+	if(cursor < lineend && *cursor == ':')
+	{
+		cursor++;
+		uint16_t s = symbol(name, length);
+		if(s == ASSEMBLER_NO_SYMBOL || !label(s))
+		{
+			return false;
+		}
+		if(lineended())
+		{
+			return true;
+		}
+		length = identifier(&name);
+		if(length == 0)
+		{
+			return fail("instruction expected");
+		}
+	}
+	if(name[0] == '.')
+	{
+		if(!parsedirective(name, length))
+		{
+			return false;
+		}
+		return lineended() || fail("unexpected characters");
+	}
+
+	uint8_t type = VM_OPERAND_TYPE_UINT32;
+	uint8_t mnemoniclength = length;
+	const char* suffix = (const char*) memchr(name, '.', length);
+	if(suffix)
+	{
+		mnemoniclength = (uint8_t) (suffix - name);
+		if(!findtype(suffix + 1, length - mnemoniclength - 1, &type))
+		{
+			return fail("invalid type", suffix + 1, length - mnemoniclength - 1);
+		}
+	}
+	int16_t opcode = -1;
+	for(uint8_t i = 0; i < sizeof(mnemonics) / sizeof(mnemonics[0]); i++)
+	{
+		if(strlen(mnemonics[i].name) == mnemoniclength && equalsname(mnemonics[i].name, name, mnemoniclength))
+		{
+			opcode = mnemonics[i].opcode;
+		}
+	}
+	if(opcode < 0)
+	{
+		return fail("unknown instruction", name, mnemoniclength);
+	}
+
+	asm_operand_t operands[ASSEMBLER_OPERANDS];
+	uint8_t count = 0;
+	if(!lineended())
+	{
+		while(true)
+		{
+			if(count >= ASSEMBLER_OPERANDS)
+			{
+				return fail("too many operands");
+			}
+			if(!parseoperand(&operands[count++]))
+			{
+				return false;
+			}
+			if(lineended())
+			{
+				break;
+			}
+			if(*cursor != ',')
+			{
+				return fail("',' expected");
+			}
+			cursor++;
+		}
+	}
+	return instruction((uint8_t) opcode, type, operands, count);
+}
+
+/**
+ * @param value Byte appended to the program.
+ * @return True if the program fits into the buffer.
+ */
+bool Assembler::emit(uint8_t value)
+{
+	if(position >= size)
+	{
+		return fail("program exceeds the code buffer");
+	}
+	code[position++] = value;
+	return true;
+}
+
+/**
+ * Emits a 16Bit address, references to symbols are resolved by finish().
+ * @param operand Address or label.
+ * @return True if the address is valid.
+ */
+bool Assembler::emitaddress(const asm_operand_t& operand)
+{
+	uint16_t value = 0;
+	if(operand.symbol != ASSEMBLER_NO_SYMBOL)
+	{
+		if(fixupcount >= ASSEMBLER_FIXUPS)
+		{
+			return fail("too many symbol references");
+		}
+		asm_fixup_t* f = &fixups[fixupcount++];
+		f->position = position;
+		f->symbol = operand.symbol;
+		f->offset = (uint16_t) (int16_t) operand.value;
+		f->line = line;
+	}
+	else if(operand.value < 0 || operand.value > UINT16_MAX || operand.value != floor(operand.value))
+	{
+		return fail("invalid address");
+	}
+	else
+	{
+		value = (uint16_t) operand.value;
+	}
+	return emit(value & 0xff) && emit(value >> 8);
+}
+
+/**
+ * @param operand Label or code address.
+ * @return True if the operand is a valid jump target.
+ */
+bool Assembler::emittarget(const asm_operand_t& operand)
+{
+	if(operand.kind != ASSEMBLER_OPERAND_LABEL && !(operand.kind == ASSEMBLER_OPERAND_NUMBER && numeric(operand)))
+	{
+		return fail("jump target expected");
+	}
+	if(operand.symbol != ASSEMBLER_NO_SYMBOL && symbols[operand.symbol].kind != ASSEMBLER_SYMBOL_LABEL)
+	{
+		return fail("label expected:", symbols[operand.symbol].name, strlen(symbols[operand.symbol].name));
+	}
+	return emitaddress(operand);
+}
+
+/**
+ * Emits a literal with the size of the type, decimals are stored as rational_t.
+ * @param operand Number or literal.
+ * @param type Type of the literal.
+ * @return True if the value fits into the type.
+ */
+bool Assembler::emitliteral(const asm_operand_t& operand, uint8_t type)
+{
+	if(!numeric(operand))
+	{
+		return fail("literal expected");
+	}
+	double value = operand.value;
+	uint32_t raw;
+	uint8_t width = typesize(type);
+	if((type & VM_OPTYPE_MASK) == VM_OPERAND_TYPE_DEC)
+	{
+		rational_t decimal = static_cast<rational_t>(value);
+		memcpy(&raw, &decimal, sizeof(raw));
+	}
+	else
+	{
+		double max = width == sizeof(uint32_t) ? (double) UINT32_MAX : (double) ((1ul << (8 * width)) - 1);
+		if(value < 0 || value > max || value != floor(value))
+		{
+			return fail("literal out of range");
+		}
+		raw = (uint32_t) value;
+	}
+	for(uint8_t i = 0; i < width; i++)
+	{
+		if(!emit((raw >> (8 * i)) & 0xff))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @param operand Register.
+ * @return True if the register exists.
+ */
+bool Assembler::emitregister(const asm_operand_t& operand)
+{
+	if(operand.value < 0 || operand.value >= VM_REGISTERS)
+	{
+		return fail("invalid register");
+	}
+	return emit((uint8_t) operand.value);
+}
+
+/**
+ * @param operand Address or register.
+ * @return True if the operand is a valid destination.
+ */
+bool Assembler::emitdestination(const asm_operand_t& operand)
+{
+	switch(operand.kind)
+	{
+	case ASSEMBLER_OPERAND_ADDRESS:		return emitaddress(operand);
+	case ASSEMBLER_OPERAND_REGISTER:	return emitregister(operand);
+	default:							return fail("address or register expected");
+	}
+}
+
+/**
+ * @param operand Literal, address or register.
+ * @param type Type of a literal.
+ * @return True if the operand is a valid source.
+ */
+bool Assembler::emitsource(const asm_operand_t& operand, uint8_t type)
+{
+	switch(operand.kind)
+	{
+	case ASSEMBLER_OPERAND_LITERAL:		return emitliteral(operand, type);
+	case ASSEMBLER_OPERAND_ADDRESS:		return emitaddress(operand);
+	case ASSEMBLER_OPERAND_REGISTER:	return emitregister(operand);
+	default:							return fail("literal, address or register expected");
+	}
+}
+
+/**
+ * Emits the OPTYPE with a map or PID ID, IDs which do not fit into the OPTYPE follow it as 16Bit operand (VM_OPTYPE_WIDE_ID).
+ * @param operand ID.
+ * @param type Type stored with the ID.
+ * @param ids Number of valid IDs (VM_MEMORY_MAP_SIZE for URL-Maps, VM_OPTYPE_IDS for PIDs).
+ * @param narrow Number of IDs coded in the OPTYPE (VM_OPTYPE_MAP_IDS for URL-Maps, VM_OPTYPE_IDS for PIDs).
+ * @return True if the ID is valid.
+ */
+bool Assembler::emitid(const asm_operand_t& operand, uint8_t type, uint16_t ids, uint16_t narrow)
+{
+	if(!numeric(operand) || operand.value < 0 || operand.value >= ids
+			|| operand.value != floor(operand.value))
+	{
+		return fail("invalid ID");
+	}
+	uint16_t id = (uint16_t) operand.value;
+	if(id >= narrow)
+	{
+		return emit(type | VM_OPTYPE_WIDE_ID) && emit(id & 0xff) && emit(id >> 8);
+	}
+	return emit((id << 4) | type);
+}
+
+/**
+ * Emits a string terminated with 0 or the address of a string.
+ * @param operand String or address.
+ * @return True if the operand is valid.
+ */
+bool Assembler::emitstring(const asm_operand_t& operand)
+{
+	if(operand.kind == ASSEMBLER_OPERAND_ADDRESS)
+	{
+		return emitaddress(operand);
+	}
+	if(operand.kind != ASSEMBLER_OPERAND_STRING)
+	{
+		return fail("string or address expected");
+	}
+	for(uint8_t i = 0; i < operand.length; i++)
+	{
+		if(!emit(operand.string[i]))
+		{
+			return false;
+		}
+	}
+	return emit(0);
+}
+
+/**
+ * Emits one instruction.
+ * @param opcode Opcode (VM_INSTRUCTION_*).
+ * @param type Type of the operands (VM_OPERAND_TYPE_*).
+ * @param operands Operands in the order of the bytecode.
+ * @param count Number of operands.
+ * @return True if the operands are valid for the instruction.
+ */
+bool Assembler::instruction(uint8_t opcode, uint8_t type, const asm_operand_t* operands, uint8_t count)
+{
+	if(error[0])
+	{
+		return false;
+	}
+	type &= VM_OPTYPE_MASK;
+	uint8_t expected;
+	switch(opcode)
+	{
+	case VM_INSTRUCTION_ADD: case VM_INSTRUCTION_SUB: case VM_INSTRUCTION_MUL:
+	case VM_INSTRUCTION_DIV: case VM_INSTRUCTION_MOD: case VM_INSTRUCTION_AND:
+	case VM_INSTRUCTION_OR: case VM_INSTRUCTION_XOR: case VM_INSTRUCTION_LSHIFT:
+	case VM_INSTRUCTION_RSHIFT: case VM_INSTRUCTION_LOAD:
+		expected = 2;
+		break;
+	case VM_INSTRUCTION_COMPARE:
+		expected = 5;
+		break;
+	case VM_INSTRUCTION_SCOMPARE: case VM_INSTRUCTION_COPY:
+		expected = 3;
+		break;
+	case VM_INSTRUCTION_COMPARETIME:
+		expected = 4;
+		break;
+	case VM_INSTRUCTION_SLEEPUNTIL: case VM_INSTRUCTION_URLMAPCHECK:
+		expected = 2;
+		break;
+	case VM_INSTRUCTION_URLMAP:
+		expected = 6;
+		break;
+	case VM_INSTRUCTION_PIDINIT:
+		expected = 11;
+		break;
+	case VM_INSTRUCTION_SADD: case VM_INSTRUCTION_SSUB: case VM_INSTRUCTION_SMUL:
+	case VM_INSTRUCTION_SDIV: case VM_INSTRUCTION_RETURN: case VM_INSTRUCTION_HALT:
+	case VM_INSTRUCTION_RESET:
+		expected = 0;
+		break;
+	case VM_INSTRUCTION_MULTILOAD:
+		if(count < 2 || count - 1 > UINT8_MAX)
+		{
+			return fail("wrong number of operands");
+		}
+		expected = count;
+		break;
+	case VM_INSTRUCTION_ADDCOMPARE: case VM_INSTRUCTION_TIMECOMPARE: case VM_INSTRUCTION_URLMAPCOMPARE:
+		return fail("superinstructions are created by the optimizer");
+	default:
+		expected = 1;
+		break;
+	}
+	if(count != expected)
+	{
+		return fail("wrong number of operands");
+	}
+
+	switch(opcode)
+	{
+	case VM_INSTRUCTION_ADD: case VM_INSTRUCTION_SUB: case VM_INSTRUCTION_MUL:
+	case VM_INSTRUCTION_DIV: case VM_INSTRUCTION_MOD: case VM_INSTRUCTION_AND:
+	case VM_INSTRUCTION_OR: case VM_INSTRUCTION_XOR: case VM_INSTRUCTION_LSHIFT:
+	case VM_INSTRUCTION_RSHIFT: case VM_INSTRUCTION_LOAD:
+		return emit(opcode) && emit(type | destinationbits(operands[0]) | sourcebits(operands[1]))
+				&& emitdestination(operands[0]) && emitsource(operands[1], type);
+	case VM_INSTRUCTION_NOT:
+		return emit(opcode) && emit(type | destinationbits(operands[0])) && emitdestination(operands[0]);
+	case VM_INSTRUCTION_COMPARE:
+		return emit(opcode) && emit(type | destinationbits(operands[0]) | sourcebits(operands[1]))
+				&& emitdestination(operands[0]) && emitsource(operands[1], type)
+				&& emittarget(operands[2]) && emittarget(operands[3]) && emittarget(operands[4]);
+	case VM_INSTRUCTION_SADD: case VM_INSTRUCTION_SSUB: case VM_INSTRUCTION_SMUL:
+	case VM_INSTRUCTION_SDIV:
+		return emit(opcode) && emit(type);
+	case VM_INSTRUCTION_SCOMPARE:
+		return emit(opcode) && emit(type)
+				&& emittarget(operands[0]) && emittarget(operands[1]) && emittarget(operands[2]);
+	case VM_INSTRUCTION_PUSH:
+		if(operands[0].kind != ASSEMBLER_OPERAND_LITERAL && operands[0].kind != ASSEMBLER_OPERAND_ADDRESS)
+		{
+			return fail("literal or address expected");
+		}
+		return emit(opcode) && emit(type | sourcebits(operands[0])) && emitsource(operands[0], type);
+	case VM_INSTRUCTION_POP:
+		if(operands[0].kind != ASSEMBLER_OPERAND_ADDRESS)
+		{
+			return fail("address expected");
+		}
+		return emit(opcode) && emit(type) && emitaddress(operands[0]);
+	case VM_INSTRUCTION_COPY:
+		if(operands[0].kind != ASSEMBLER_OPERAND_ADDRESS || operands[2].kind != ASSEMBLER_OPERAND_ADDRESS)
+		{
+			return fail("address expected");
+		}
+		return emit(opcode) && emitaddress(operands[0]) && emitliteral(operands[1], VM_OPERAND_TYPE_UINT8)
+				&& emitaddress(operands[2]);
+	case VM_INSTRUCTION_JUMP:
+		if(operands[0].kind == ASSEMBLER_OPERAND_ADDRESS)
+		{
+			return emit(opcode) && emit(VM_ADDRESS) && emitaddress(operands[0]);
+		}
+		return emit(opcode) && emit(VM_LITERAL) && emittarget(operands[0]);
+	case VM_INSTRUCTION_CALL:
+		return emit(opcode) && emittarget(operands[0]);
+	case VM_INSTRUCTION_RETURN: case VM_INSTRUCTION_HALT: case VM_INSTRUCTION_RESET:
+		return emit(opcode);
+	case VM_INSTRUCTION_TIME:
+		if(operands[0].kind != ASSEMBLER_OPERAND_ADDRESS)
+		{
+			return fail("address expected");
+		}
+		return emit(opcode) && emitaddress(operands[0]);
+	case VM_INSTRUCTION_COMPARETIME:
+	case VM_INSTRUCTION_SLEEPUNTIL:
+		if(operands[0].kind != ASSEMBLER_OPERAND_ADDRESS)
+		{
+			return fail("address expected");
+		}
+		if(!(emit(opcode) && emitaddress(operands[0]) && emitliteral(operands[1], VM_OPERAND_TYPE_UINT32)))
+		{
+			return false;
+		}
+		return opcode == VM_INSTRUCTION_SLEEPUNTIL || (emittarget(operands[2]) && emittarget(operands[3]));
+	case VM_INSTRUCTION_URLMAP:
+	{
+		if(operands[2].kind != ASSEMBLER_OPERAND_ADDRESS)
+		{
+			return fail("address expected");
+		}
+		if(!numeric(operands[1]) || !numeric(operands[3]) || operands[3].value < 0 || operands[3].value > UINT16_MAX)
+		{
+			return fail("invalid map options or port");
+		}
+		uint8_t mapoptions = (uint8_t) operands[1].value
+				& (VM_MAP_OPTION_METHOD | VM_MAP_OPTION_DIRECTION_MASK | VM_MAP_OPTION_LIFETIME_MASK);
+		if(operands[4].kind == ASSEMBLER_OPERAND_STRING)
+		{
+			mapoptions |= VM_MAP_OPTION_URL_LITERAL;
+		}
+		if(operands[5].kind == ASSEMBLER_OPERAND_STRING)
+		{
+			mapoptions |= VM_MAP_OPTION_RESOURCE_LITERAL;
+		}
+		uint16_t port = (uint16_t) operands[3].value;
+		return emit(opcode) && emitid(operands[0], type, VM_MEMORY_MAP_SIZE, VM_OPTYPE_MAP_IDS) && emit(mapoptions) && emitaddress(operands[2])
+				&& emit(port & 0xff) && emit(port >> 8) && emitstring(operands[4]) && emitstring(operands[5]);
+	}
+	case VM_INSTRUCTION_URLMAPCHECK:
+		if(operands[1].kind != ASSEMBLER_OPERAND_ADDRESS)
+		{
+			return fail("address expected");
+		}
+		return emit(opcode) && emitid(operands[0], 0, VM_MEMORY_MAP_SIZE, VM_OPTYPE_MAP_IDS) && emitaddress(operands[1]);
+	case VM_INSTRUCTION_PIDINIT:
+		for(uint8_t i = 1; i <= 3; i++)
+		{
+			if(operands[i].kind != ASSEMBLER_OPERAND_ADDRESS)
+			{
+				return fail("address expected");
+			}
+		}
+		return emit(opcode) && emitid(operands[0], 0, VM_OPTYPE_IDS, VM_OPTYPE_IDS)
+				&& emitaddress(operands[1]) && emitaddress(operands[2]) && emitaddress(operands[3])
+				&& emitliteral(operands[4], VM_OPERAND_TYPE_DEC) && emitliteral(operands[5], VM_OPERAND_TYPE_DEC)
+				&& emitliteral(operands[6], VM_OPERAND_TYPE_DEC) && emitliteral(operands[7], VM_OPERAND_TYPE_UINT32)
+				&& emitliteral(operands[8], VM_OPERAND_TYPE_DEC) && emitliteral(operands[9], VM_OPERAND_TYPE_DEC)
+				&& emitliteral(operands[10], VM_OPERAND_TYPE_UINT8);
+	case VM_INSTRUCTION_URLMAPDELETE: case VM_INSTRUCTION_URLMAPWAIT:
+		return emit(opcode) && emitid(operands[0], 0, VM_MEMORY_MAP_SIZE, VM_OPTYPE_MAP_IDS);
+	case VM_INSTRUCTION_PIDCLEAR: case VM_INSTRUCTION_PIDSTOP: case VM_INSTRUCTION_PIDRUN: case VM_INSTRUCTION_PIDWAIT:
+		return emit(opcode) && emitid(operands[0], 0, VM_OPTYPE_IDS, VM_OPTYPE_IDS);
+	case VM_INSTRUCTION_MULTILOAD:
+	{
+		uint8_t kind = operands[1].kind;
+		if(operands[0].kind != ASSEMBLER_OPERAND_ADDRESS
+				|| (kind != ASSEMBLER_OPERAND_LITERAL && kind != ASSEMBLER_OPERAND_ADDRESS))
+		{
+			return fail("address and literals or addresses expected");
+		}
+		if(!(emit(opcode) && emit(type | sourcebits(operands[1])) && emitaddress(operands[0]) && emit(count - 1)))
+		{
+			return false;
+		}
+		for(uint8_t i = 1; i < count; i++)
+		{
+			if(operands[i].kind != kind)
+			{
+				return fail("operands of MULTILOAD must be all literals or all addresses");
+			}
+			if(!emitsource(operands[i], type))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+	default:
+		return fail("unknown instruction");
+	}
+}
+
+#endif /* VM_TOOLCHAIN */
@@ -19,6 +19,11 @@ extern "C" {
 }
 #include "CalculationVM.h"
 
+///Instruction starts found by the first verification pass (shared by all VMs, verification is not reentrant)
+static uint8_t instructionstarts[(MEMORY_CODE_REGION + 7) / 8];
+///Words the verified program shares with other threads (URL-Map values, PID values), see Memory::share()
+static uint8_t verifiedshared[MEMORY_SHARED_MAP_SIZE];
+
 
 /**
  * @brief Implementation of a calculation VM which processes a bytecode program in the memory.
@@ -35,21 +40,62 @@ VM::VM(Memory* memory, PID* pids)
 	debugmode = VM_DEBUG_OFF;
 	statuscode = 0;
 	execution_error = false;
+	codeverified = false;
+	verifiedversion = 0;//never a code version of a constructed memory, Memory::clear() changes the version
+	waitevent = 0;
+	waitid = 0;
+	waitvalue = 0;
+	waittimeout = 0;
+	memset(registers, 0, sizeof(registers));
+#ifdef VM_TRANSLATIONS
+	translation = 0;
+	verifiedtranslation = 0;
+	translationversion = 0;
+	translationenabled = true;
+#endif
+
+	if(!kernels[0][VM_OPERAND_TYPE_INDEX(VM_OPERAND_TYPE_UINT32)][VM_ADDRESS][VM_ACCESS_CHECKED])
+	{//static tables are shared by all VMs
+		initKernels();
+#if VM_DISPATCH == VM_DISPATCH_TABLE
+		initDispatchtable();
+#endif
+	}
 }
 
 /**
- * Stores Bytecode in Memory and cleares VM.
+ * Stores Bytecode in Memory (in the code segment in Harvard mode) and cleares VM. A program larger than the code region is
+ * not stored, the code size is kept and the VM is halted with VM_ERROR_MEMORY_EXCEPTION.
  * @param _program Bytecode program.
  * @param _size	Size of the program.
+ * @return False if the program does not fit into the code region.
  */
-void VM::setProgram(uint8_t* _program, uint16_t _size)
+bool VM::setProgram(uint8_t* _program, uint16_t _size)
 {
-	if(_program)
+	bool stored = !_program || memory->storeCode(0, _program, _size);
+	if(_program && stored)
 	{
-		for(uint16_t i = 0; i < _size; i++) {
-			memory->store(i, _program[i]);
-		}
+		memory->setCodeSize(_size);
+	}
+	VM::clear();
+	if(!stored)
+	{
+		execution_error = true;
+		statuscode |= VM_ERROR_MEMORY_EXCEPTION;
+		flags |= (VM_FLAG_ERROR | VM_FLAG_HALTED);
 	}
+	return stored;
+}
+
+/**
+ * Executes a read-only program image (e.g. a const array in flash) without copying it into the memory.
+ * Data of the program stays in the memory, see Memory::setCodeImage().
+ * @param image Program image, must stay valid while the VM executes it.
+ * @param size Size of the program image.
+ */
+void VM::setProgramImage(const uint8_t* image, uint16_t size)
+{
+	memory->setCodeImage(image, size);
 	VM::clear();
 }
 
@@ -59,58 +105,7 @@ void VM::setProgram(uint8_t* _program, uint16_t _size)
 void VM::executeStep()
 {
 	//one step per execution
-	if(halted())
-	{
-		return;
-	}
-	try {
-		uint8_t currentop = memory->load(programcounter);
-		statuscode = 0 | (programcounter << 16);//code programcounter in statuscode
-		statuscode |= (currentop << 8);//code currentop in statuscode
-		switch(currentop)
-		{
-		case VM_INSTRUCTION_ADD:			execution_error = !this->handleADD();			programcounter++;	break;
-		case VM_INSTRUCTION_SUB:			execution_error = !this->handleSUB();			programcounter++;	break;
-		case VM_INSTRUCTION_MUL:			execution_error = !this->handleMUL();			programcounter++;	break;
-		case VM_INSTRUCTION_DIV:			execution_error = !this->handleDIV();			programcounter++;	break;
-		case VM_INSTRUCTION_MOD:			execution_error = !this->handleMOD();			programcounter++;	break;
-		case VM_INSTRUCTION_AND:			execution_error = !this->handleAND();			programcounter++;	break;
-		case VM_INSTRUCTION_OR:				execution_error = !this->handleOR();			programcounter++;	break;
-		case VM_INSTRUCTION_NOT:			execution_error = !this->handleNOT();			programcounter++;	break;
-		case VM_INSTRUCTION_XOR:			execution_error = !this->handleXOR();			programcounter++;	break;
-		case VM_INSTRUCTION_LSHIFT:			execution_error = !this->handleLSHIFT();		programcounter++;	break;
-		case VM_INSTRUCTION_RSHIFT:			execution_error = !this->handleRSHIFT();		programcounter++;	break;
-		case VM_INSTRUCTION_LOAD:			execution_error = !this->handleLOAD();			programcounter++;	break;
-		case VM_INSTRUCTION_MULTILOAD:		execution_error = !this->handleMULTILOAD();		programcounter++;	break;
-		case VM_INSTRUCTION_PUSH:			execution_error = !this->handlePUSH();			programcounter++;	break;
-		case VM_INSTRUCTION_POP:			execution_error = !this->handlePOP();			programcounter++;	break;
-		case VM_INSTRUCTION_COPY:			execution_error = !this->handleCOPY();			programcounter++;	break;
-		case VM_INSTRUCTION_JUMP:			execution_error = !this->handleJUMP();			break;
-		case VM_INSTRUCTION_COMPARE:		execution_error = !this->handleCOMPARE();		break;
-		case VM_INSTRUCTION_CALL:			execution_error = !this->handleCALL();			break;
-		case VM_INSTRUCTION_RETURN:			execution_error = !this->handleRETURN();		break;
-		case VM_INSTRUCTION_TIME:			execution_error = !this->handleTIME();			programcounter++;	break;
-		case VM_INSTRUCTION_COMPARETIME:	execution_error = !this->handleCOMPARETIME();	break;
-		case VM_INSTRUCTION_URLMAP:			execution_error = !this->handleURLMAP();		programcounter++;	break;
-		case VM_INSTRUCTION_URLMAPCHECK:	execution_error = !this->handleURLMAPCHECK();	programcounter++;	break;
-		case VM_INSTRUCTION_URLMAPDELETE:	execution_error = !this->handleURLMAPDELETE();	programcounter++;	break;
-		case VM_INSTRUCTION_PIDINIT:		execution_error = !this->handlePIDINIT();		programcounter++;	break;
-		case VM_INSTRUCTION_PIDCLEAR:		execution_error = !this->handlePIDCLEAR();		programcounter++;	break;
-		case VM_INSTRUCTION_PIDSTOP:		execution_error = !this->handlePIDSTOP();		programcounter++;	break;
-		case VM_INSTRUCTION_PIDRUN:			execution_error = !this->handlePIDRUN();		programcounter++;	break;
-		case VM_INSTRUCTION_HALT:			execution_error = !this->handleHALT();			break;
-		case VM_INSTRUCTION_RESET:		execution_error = !this->handleRESET();		break;
-		default: execution_error = true; statuscode |= VM_ERROR_UNSUPPORTED_OPERATION; break;
-		}
-	}
-	catch (std::range_error& e) {
-		execution_error = true;
-		statuscode |= VM_ERROR_MEMORY_EXCEPTION;
-	}
-	if(execution_error)
-	{
-		flags |= (VM_FLAG_ERROR | VM_FLAG_HALTED);
-	}
+	run(1, 0);
 
 //	if(debugmode)
 //	{
@@ -127,6 +122,302 @@ void VM::executeStep()
 //	}
 }
 
+/**
+ * @brief Executes instructions until the VM halts, a budget is used up or a yield point instruction was executed.
+ * Halts the machine if an error occurs. The time budget is only checked every VM_RUN_TIME_CHECK_INTERVAL instructions.
+ * A waiting VM executes nothing until the awaited event occurred. A translation of the program (see Translation.h) is executed
+ * instead of interpreting the program while the code is unchanged.
+ * @param max_steps Maximum number of instructions to execute.
+ * @param max_us Maximum execution time in µs (0 for no time limit).
+ * @return Number of executed instructions.
+ */
+uint32_t VM::run(uint32_t max_steps, uint32_t max_us)
+{
+	if(waiting())
+	{
+		if(!wakeable())
+		{
+			return 0;
+		}
+		flags &= ~VM_FLAG_WAITING;
+	}
+	uint32_t start = max_us ? xtimer_now() : 0;
+#ifdef VM_TRANSLATIONS
+	if(translation && translationversion == memory->getCodeVersion())
+	{
+		return runTranslation(max_steps, max_us, start);
+	}
+#endif
+	return interpret(max_steps, max_us, start);
+}
+
+/**
+ * @brief Interpreter of run(). Executes instructions until the VM halts, a budget is used up or a yield point instruction was executed.
+ * @param max_steps Maximum number of instructions to execute.
+ * @param max_us Maximum execution time in µs (0 for no time limit).
+ * @param start Start time of the time budget.
+ * @return Number of executed instructions.
+ */
+#if VM_DISPATCH == VM_DISPATCH_THREADED
+//labels as values and computed gotos are GNU extensions, RIOT compiles with -pedantic -Werror
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#endif
+uint32_t VM::interpret(uint32_t max_steps, uint32_t max_us, uint32_t start)
+{
+	uint32_t steps = 0;
+#if VM_DISPATCH == VM_DISPATCH_THREADED
+	static void* dispatch[256];
+	static bool dispatch_init = false;
+	if(!dispatch_init)
+	{
+		for(uint16_t i = 0; i < 256; i++)
+		{
+			dispatch[i] = &&op_UNSUPPORTED;
+		}
+		dispatch[VM_INSTRUCTION_ADD] = &&op_KERNEL;
+		dispatch[VM_INSTRUCTION_SUB] = &&op_KERNEL;
+		dispatch[VM_INSTRUCTION_MUL] = &&op_KERNEL;
+		dispatch[VM_INSTRUCTION_DIV] = &&op_KERNEL;
+		dispatch[VM_INSTRUCTION_MOD] = &&op_KERNEL;
+		dispatch[VM_INSTRUCTION_SADD] = &&op_KERNEL;
+		dispatch[VM_INSTRUCTION_SSUB] = &&op_KERNEL;
+		dispatch[VM_INSTRUCTION_SMUL] = &&op_KERNEL;
+		dispatch[VM_INSTRUCTION_SDIV] = &&op_KERNEL;
+		dispatch[VM_INSTRUCTION_AND] = &&op_KERNEL;
+		dispatch[VM_INSTRUCTION_OR] = &&op_KERNEL;
+		dispatch[VM_INSTRUCTION_NOT] = &&op_KERNEL;
+		dispatch[VM_INSTRUCTION_XOR] = &&op_KERNEL;
+		dispatch[VM_INSTRUCTION_LSHIFT] = &&op_KERNEL;
+		dispatch[VM_INSTRUCTION_RSHIFT] = &&op_KERNEL;
+		dispatch[VM_INSTRUCTION_LOAD] = &&op_KERNEL;
+		dispatch[VM_INSTRUCTION_MULTILOAD] = &&op_MULTILOAD;
+		dispatch[VM_INSTRUCTION_PUSH] = &&op_PUSH;
+		dispatch[VM_INSTRUCTION_POP] = &&op_POP;
+		dispatch[VM_INSTRUCTION_COPY] = &&op_COPY;
+		dispatch[VM_INSTRUCTION_JUMP] = &&op_JUMP;
+		dispatch[VM_INSTRUCTION_COMPARE] = &&op_COMPARE;
+		dispatch[VM_INSTRUCTION_SCOMPARE] = &&op_COMPARE;
+		dispatch[VM_INSTRUCTION_ADDCOMPARE] = &&op_COMPARE;
+		dispatch[VM_INSTRUCTION_CALL] = &&op_CALL;
+		dispatch[VM_INSTRUCTION_RETURN] = &&op_RETURN;
+		dispatch[VM_INSTRUCTION_TIME] = &&op_TIME;
+		dispatch[VM_INSTRUCTION_COMPARETIME] = &&op_COMPARETIME;
+		dispatch[VM_INSTRUCTION_SLEEPUNTIL] = &&op_SLEEPUNTIL;
+		dispatch[VM_INSTRUCTION_TIMECOMPARE] = &&op_TIMECOMPARE;
+		dispatch[VM_INSTRUCTION_URLMAP] = &&op_URLMAP;
+		dispatch[VM_INSTRUCTION_URLMAPCHECK] = &&op_URLMAPCHECK;
+		dispatch[VM_INSTRUCTION_URLMAPDELETE] = &&op_URLMAPDELETE;
+		dispatch[VM_INSTRUCTION_URLMAPWAIT] = &&op_URLMAPWAIT;
+		dispatch[VM_INSTRUCTION_URLMAPCOMPARE] = &&op_URLMAPCOMPARE;
+		dispatch[VM_INSTRUCTION_PIDINIT] = &&op_PIDINIT;
+		dispatch[VM_INSTRUCTION_PIDCLEAR] = &&op_PIDCLEAR;
+		dispatch[VM_INSTRUCTION_PIDSTOP] = &&op_PIDSTOP;
+		dispatch[VM_INSTRUCTION_PIDRUN] = &&op_PIDRUN;
+		dispatch[VM_INSTRUCTION_PIDWAIT] = &&op_PIDWAIT;
+		dispatch[VM_INSTRUCTION_HALT] = &&op_HALT;
+		dispatch[VM_INSTRUCTION_RESET] = &&op_RESET;
+		dispatch_init = true;
+	}
+	const vm_instruction_t* in;
+	bool success;
+
+	///Fetches the next instruction and jumps to its handler, leaves if the VM halted or the step budget is used up
+	#define VM_DISPATCH_NEXT()	\
+		if(steps >= max_steps || halted()) goto done;	\
+		in = fetch();	\
+		steps++;	\
+		goto *dispatch[in->opcode]
+	///Ends an instruction, checks the time budget every VM_RUN_TIME_CHECK_INTERVAL instructions
+	#define VM_DISPATCH_END()	\
+		if(max_us && (steps & (VM_RUN_TIME_CHECK_INTERVAL - 1)) == 0 && xtimer_now() - start >= max_us) goto done;	\
+		VM_DISPATCH_NEXT()
+	///Instruction which continues with the following instruction
+	#define VM_OP_NEXT(handler)		success = checkerrors(handler(*in)); programcounter = in->next; if(!success) goto error; VM_DISPATCH_END()
+	///Instruction which decodes its operands itself
+	#define VM_OP_INC(handler)		success = checkerrors(handler(*in)); programcounter++; if(!success) goto error; VM_DISPATCH_END()
+	///Instruction which sets the programcounter
+	#define VM_OP_BRANCH(handler)	if(!checkerrors(handler(*in))) goto error; VM_DISPATCH_END()
+	///Instruction which ends the batch (yield point)
+	#define VM_OP_YIELD(handler, advance)	success = checkerrors(handler(*in)); advance; if(!success) goto error; goto done
+#endif
+#ifndef VM_NO_EXCEPTIONS
+	try {
+#endif
+#if VM_DISPATCH == VM_DISPATCH_THREADED
+		VM_DISPATCH_NEXT();
+	op_KERNEL:			VM_OP_NEXT(handleKERNEL);
+	op_MULTILOAD:		VM_OP_INC(handleMULTILOAD);
+	op_PUSH:			VM_OP_NEXT(handlePUSH);
+	op_POP:				VM_OP_NEXT(handlePOP);
+	op_COPY:			VM_OP_NEXT(handleCOPY);
+	op_JUMP:			VM_OP_BRANCH(handleJUMP);
+	op_COMPARE:			VM_OP_BRANCH(handleCOMPARE);
+	op_CALL:			VM_OP_BRANCH(handleCALL);
+	op_RETURN:			VM_OP_BRANCH(handleRETURN);
+	op_TIME:			VM_OP_YIELD(handleTIME, programcounter = in->next);
+	op_COMPARETIME:		VM_OP_YIELD(handleCOMPARETIME, (void) 0);
+	op_SLEEPUNTIL:		VM_OP_YIELD(handleSLEEPUNTIL, programcounter = in->next);
+	op_TIMECOMPARE:		VM_OP_YIELD(handleTIMECOMPARE, (void) 0);
+	op_URLMAP:			VM_OP_YIELD(handleURLMAP, programcounter++);
+	op_URLMAPCHECK:		VM_OP_NEXT(handleURLMAPCHECK);
+	op_URLMAPDELETE:	VM_OP_YIELD(handleURLMAPDELETE, programcounter = in->next);
+	op_URLMAPWAIT:		VM_OP_YIELD(handleURLMAPWAIT, programcounter = in->next);
+	op_URLMAPCOMPARE:	VM_OP_BRANCH(handleURLMAPCOMPARE);
+	op_PIDINIT:			VM_OP_YIELD(handlePIDINIT, programcounter++);
+	op_PIDCLEAR:		VM_OP_YIELD(handlePIDCLEAR, programcounter = in->next);
+	op_PIDSTOP:			VM_OP_YIELD(handlePIDSTOP, programcounter = in->next);
+	op_PIDRUN:			VM_OP_YIELD(handlePIDRUN, programcounter = in->next);
+	op_PIDWAIT:			VM_OP_YIELD(handlePIDWAIT, programcounter = in->next);
+	op_HALT:			VM_OP_BRANCH(handleHALT);
+	op_RESET:			VM_OP_BRANCH(handleRESET);
+	op_UNSUPPORTED:		handleUNSUPPORTED(*in);
+	error:
+		execution_error = true;
+		flags |= (VM_FLAG_ERROR | VM_FLAG_HALTED);
+	done:
+		;
+#else
+		while(steps < max_steps && !halted())
+		{
+			const vm_instruction_t* in = fetch();
+			uint8_t opcode = in->opcode;
+			steps++;
+			execution_error = !checkerrors(execute(in));
+			if(execution_error)
+			{
+				flags |= (VM_FLAG_ERROR | VM_FLAG_HALTED);
+				break;
+			}
+			if(yieldpoint(opcode))
+			{
+				break;
+			}
+			if(max_us && (steps & (VM_RUN_TIME_CHECK_INTERVAL - 1)) == 0 && xtimer_now() - start >= max_us)
+			{
+				break;
+			}
+		}
+#endif
+#ifndef VM_NO_EXCEPTIONS
+	}
+	catch (std::range_error& e) {
+		execution_error = true;
+		statuscode |= VM_ERROR_MEMORY_EXCEPTION;
+		flags |= (VM_FLAG_ERROR | VM_FLAG_HALTED);
+	}
+#endif
+	return steps;
+}
+#if VM_DISPATCH == VM_DISPATCH_THREADED
+#pragma GCC diagnostic pop
+#endif
+
+#ifdef VM_TRANSLATIONS
+/**
+ * @brief Executes the translation of the program. Instructions which are not translated are executed by the interpreter one
+ * at a time, the translation is left for good if the code was changed. With a time budget the translation is entered for
+ * VM_RUN_TIME_CHECK_INTERVAL instructions at a time.
+ * @param max_steps Maximum number of instructions to execute.
+ * @param max_us Maximum execution time in µs (0 for no time limit).
+ * @param start Start time of the time budget.
+ * @return Number of executed instructions.
+ */
+uint32_t VM::runTranslation(uint32_t max_steps, uint32_t max_us, uint32_t start)
+{
+	vm_translation_state_t state;
+	state.memory = memory;
+	state.registers = registers;
+	uint32_t steps = 0;
+	while(steps < max_steps && !halted())
+	{
+		if(translationversion != memory->getCodeVersion())
+		{
+			return steps + interpret(max_steps - steps, max_us, start);
+		}
+		uint32_t budget = max_steps - steps;
+		if(max_us && budget > VM_RUN_TIME_CHECK_INTERVAL)
+		{
+			budget = VM_RUN_TIME_CHECK_INTERVAL;
+		}
+		else if(budget > VM_TRANSLATION_BATCH)
+		{
+			budget = VM_TRANSLATION_BATCH;
+		}
+		state.programcounter = programcounter;
+		state.flags = flags;
+		state.statuscode = statuscode;
+		memory->beginBatch();
+		uint32_t executed = translation->run(&state, budget);
+		memory->endBatch();
+		programcounter = state.programcounter;
+		flags = state.flags;
+		statuscode = state.statuscode;
+		steps += executed;
+		if(flags & VM_FLAG_ERROR)
+		{
+			execution_error = true;
+			break;
+		}
+		if(executed > 0 && yieldpoint(VM_STATUS_OPCODE(statuscode)))
+		{//translated TIME
+			break;
+		}
+		if(executed < budget && !halted())
+		{//the instruction at the programcounter is not translated
+			uint8_t opcode = memory->loadcode(programcounter);
+			steps += interpret(1, 0, 0);
+			if(halted() || yieldpoint(opcode))
+			{
+				break;
+			}
+		}
+		if(max_us && xtimer_now() - start >= max_us)
+		{
+			break;
+		}
+	}
+	return steps;
+}
+
+/**
+ * @return Translation of the program in the code region, NULL if no translation was compiled into the build.
+ */
+const vm_translation_t* VM::findTranslation()
+{
+	uint16_t codesize = memory->getCodeSize();
+	for(uint8_t i = 0; i < vm_translationcount; i++)
+	{
+		const vm_translation_t* candidate = &vm_translations[i];
+		uint16_t address = 0;
+		while(candidate->size == codesize && address < codesize && memory->loadcode(address) == candidate->code[address])
+		{
+			address++;
+		}
+		if(candidate->size == codesize && address == codesize)
+		{
+			return candidate;
+		}
+	}
+	return 0;
+}
+#endif
+
+/**
+ *
+ * @return Name of the dispatch engine the VM was compiled with.
+ */
+const char* VM::getDispatchEngine()
+{
+#if VM_DISPATCH == VM_DISPATCH_THREADED
+	return "threaded";
+#elif VM_DISPATCH == VM_DISPATCH_TABLE
+	return "table";
+#else
+	return "switch";
+#endif
+}
+
 /**
  *
  * @return The programcounter value.
@@ -163,6 +454,38 @@ Stack* VM::getStack()
 	return &stack;
 }
 
+/**
+ *
+ * @return Pointer to the operand stack.
+ */
+OperandStack* VM::getOperandStack()
+{
+	return &operands;
+}
+
+/**
+ *
+ * @param index Register number.
+ * @return Raw bits of the register, 0 if the register does not exist.
+ */
+uint32_t VM::getRegister(uint8_t index)
+{
+	return index < VM_REGISTERS ? registers[index] : 0;
+}
+
+/**
+ *
+ * @param index Register number.
+ * @param value Raw bits of the value (see operand_type<T>::toliteral).
+ */
+void VM::setRegister(uint8_t index, uint32_t value)
+{
+	if(index < VM_REGISTERS)
+	{
+		registers[index] = value;
+	}
+}
+
 /**
  *
  * @param mode Debug mode to use (VM_DEBUG_ON or VM_DEBUG_OFF).
@@ -192,425 +515,1409 @@ bool VM::errorFlag()
 
 /**
  *
- * @return Errorcode of the VM.
+ * @return True if the program passed the verification and was not changed since.
  */
-uint32_t VM::getStatuscode()
+bool VM::verified()
 {
-	return statuscode;
+	return codeverified && verifiedversion == memory->getCodeVersion();
 }
 
 /**
- * @brief Clears the VM state.
+ *
+ * @return True if a translation of the program is executed instead of interpreting it (see Translation.h).
  */
-void VM::clear()
+bool VM::translated()
 {
-	flags = 0;
-	programcounter = 0;
+#ifdef VM_TRANSLATIONS
+	return translation && translationversion == memory->getCodeVersion();
+#else
+	return false;
+#endif
+}
 
-	statuscode = 0;
-	execution_error = false;
+/**
+ * Enables or disables the translations of programs (enabled by default), takes effect with the next clear().
+ * @param enabled False to interpret every program.
+ */
+void VM::setTranslation(bool enabled)
+{
+#ifdef VM_TRANSLATIONS
+	translationenabled = enabled;
+#else
+	(void) enabled;
+#endif
 }
 
 /**
- * @return True if the instruction was successful.
+ *
+ * @return True if the VM waits for an event (SLEEPUNTIL, URLMAPWAIT, PIDWAIT).
  */
-bool VM::handleADD()//opcode optype/addresstype address operand
+bool VM::waiting()
 {
-	uint8_t optype = get_optype();
-	uint16_t address = get_address();
-	uint16_t operandaddress = get_operandaddress(optype);
-	if(debugmode)
+	return flags & VM_FLAG_WAITING;
+}
+
+/**
+ * Checks the event the VM waits for. Called by the scheduler of the instances, the event itself is signaled
+ * by the thread handling it (xtimer, gcoap client, PID thread).
+ * @return True if the VM does not wait or the awaited event occurred.
+ */
+bool VM::wakeable()
+{
+	if(!waiting())
 	{
-		printf("optype: %02x address: %04x operandaddress: %04x\n", optype, address, operandaddress);
+		return true;
 	}
-	switch(optype & VM_OPTYPE_MASK)
+	switch(waitevent)
 	{
-	case VM_OPERAND_TYPE_UINT8:
-		memory->store(address, memory->load(address) + memory->load(operandaddress));
-		return true;
-	case VM_OPERAND_TYPE_UINT16:
-		memory->storeaddress(address, memory->loadaddress(address) + memory->loadaddress(operandaddress));
-		return true;
-	case VM_OPERAND_TYPE_UINT32:
-		memory->storeunsigned(address, memory->loadunsigned(address) + memory->loadunsigned(operandaddress));
-		return true;
-	case VM_OPERAND_TYPE_DEC:
-		memory->storerational(address, memory->loadrational(address) + memory->loadrational(operandaddress));
-		return true;
+	case VM_WAIT_TIME:
+		return xtimer_now() - waitvalue >= waittimeout;
+	case VM_WAIT_MAP:
+		return !memory->mapPending(waitid);
+	case VM_WAIT_PID:
+		return pids[waitid].getComputations() != waitvalue || pids[waitid].getMode() != PID_AUTOMATIC;
 	default:
-		statuscode |= VM_ERROR_UNSUPPORTED_OPERAND;
-		break;
+		return true;
 	}
-	return false;
 }
 
 /**
- * @return True if the instruction was successful.
+ * Sets the VM waiting for an event, the event parameters (waitid, waitvalue, waittimeout) have to be set before.
+ * The VM does not wait if the event already occurred.
+ * @param event Wait event (VM_WAIT_*).
  */
-bool VM::handleSUB()
+void VM::wait(uint8_t event)
 {
-	uint8_t optype = get_optype();
-	uint16_t address = get_address();
-	uint16_t operandaddress = get_operandaddress(optype);
-	switch(optype & VM_OPTYPE_MASK)
+	waitevent = event;
+	flags |= VM_FLAG_WAITING;
+	if(wakeable())
 	{
-	case VM_OPERAND_TYPE_UINT8:
-		memory->store(address, memory->load(address) - memory->load(operandaddress));
-		return true;
-	case VM_OPERAND_TYPE_UINT16:
-		memory->storeaddress(address, memory->loadaddress(address) - memory->loadaddress(operandaddress));
-		return true;
-	case VM_OPERAND_TYPE_UINT32:
-		memory->storeunsigned(address, memory->loadunsigned(address) - memory->loadunsigned(operandaddress));
-		return true;
-	case VM_OPERAND_TYPE_DEC:
-		memory->storerational(address, memory->loadrational(address) - memory->loadrational(operandaddress));
-		return true;
-	default:
-		statuscode |= VM_ERROR_UNSUPPORTED_OPERAND;
-		break;
+		flags &= ~VM_FLAG_WAITING;
 	}
-	return false;
 }
 
 /**
- * @return True if the instruction was successful.
+ * @param remaining Time in µs until the VM can continue.
+ * @return True if the VM waits for time (SLEEPUNTIL), false if it does not wait or waits for another event.
  */
-bool VM::handleMUL()
+bool VM::getWakeupTime(uint32_t* remaining)
 {
-	uint8_t optype = get_optype();
-	uint16_t address = get_address();
-	uint16_t operandaddress = get_operandaddress(optype);
-	switch(optype & VM_OPTYPE_MASK)
+	if(!waiting() || waitevent != VM_WAIT_TIME)
 	{
-	case VM_OPERAND_TYPE_UINT8:
-		memory->store(address, memory->load(address) * memory->load(operandaddress));
-		return true;
-	case VM_OPERAND_TYPE_UINT16:
-		memory->storeaddress(address, memory->loadaddress(address) * memory->loadaddress(operandaddress));
-		return true;
-	case VM_OPERAND_TYPE_UINT32:
-		memory->storeunsigned(address, memory->loadunsigned(address) * memory->loadunsigned(operandaddress));
-		return true;
-	case VM_OPERAND_TYPE_DEC:
-		memory->storerational(address, memory->loadrational(address) * memory->loadrational(operandaddress));
-		return true;
-	default:
-		statuscode |= VM_ERROR_UNSUPPORTED_OPERAND;
-		break;
+		return false;
 	}
-	return false;
+	uint32_t passed = xtimer_now() - waitvalue;
+	*remaining = passed >= waittimeout ? 0 : waittimeout - passed;
+	return true;
 }
 
 /**
- * @return True if the instruction was successful.
+ *
+ * @return Errorcode of the VM.
  */
-bool VM::handleDIV()
+uint32_t VM::getStatuscode()
 {
-	uint8_t optype = get_optype();
-	uint16_t address = get_address();
-	uint16_t operandaddress = get_operandaddress(optype);
-	switch(optype & VM_OPTYPE_MASK)
-	{
-	case VM_OPERAND_TYPE_UINT8:
+	return statuscode;
+}
+
+/**
+ * @brief Clears the VM state. The program is verified again (and its translation selected) only if the code changed
+ * since the last verification, the result of verify() depends on the code only.
+ */
+void VM::clear()
+{
+	flags = 0;
+	programcounter = 0;
+
+	statuscode = 0;
+	execution_error = false;
+	stack.clear();//return addresses of the last run are not verified
+	operands.clear();
+	memset(registers, 0, sizeof(registers));
+	if(verifiedversion != memory->getCodeVersion())
 	{
-		uint8_t op1 = memory->load(address);
-		uint8_t op2 = memory->load(operandaddress);
-		if(op2 == 0)
-		{
-			flags |= VM_FLAG_DIVIDEZERO;
-			statuscode |= VM_ERROR_DIVIDEZERO;
-			break;
-		}
-		memory->store(address, op1 / op2);
-		return true;
+		codeverified = verify();
+		verifiedversion = memory->getCodeVersion();
+#ifdef VM_DECODE_CACHE
+		cache.invalidate(verifiedversion);
+#endif
+#ifdef VM_TRANSLATIONS
+		//the translation accesses values the verifier proved unshared without sequence lock, values shared before the
+		//program was loaded (Memory::share() marks are kept until the memory is cleared) must be shared by the program too
+		verifiedtranslation = codeverified && memory->sharedwithin(verifiedshared) ? findTranslation() : 0;
+#endif
 	}
-	case VM_OPERAND_TYPE_UINT16:
+#ifdef VM_TRANSLATIONS
+	translation = translationenabled ? verifiedtranslation : 0;
+	translationversion = verifiedversion;
+#endif
+}
+
+/**
+ * Returns the decoded instruction at the programcounter. Sets the programcounter and opcode in the statuscode.
+ * Decoded instructions are taken from the cache if VM_DECODE_CACHE is defined and the code was not changed since decoding.
+ * @return Decoded instruction.
+ */
+const vm_instruction_t* VM::fetch()
+{
+#ifdef VM_DECODE_CACHE
+	uint32_t codeversion = memory->getCodeVersion();
+	if(!cache.isValid(codeversion))
 	{
-		uint16_t op1 = memory->loadaddress(address);
-		uint16_t op2 = memory->loadaddress(operandaddress);
-		if(op2 == 0)
-		{
-			flags |= VM_FLAG_DIVIDEZERO;
-			statuscode |= VM_ERROR_DIVIDEZERO;
-			break;
-		}
-		memory->storeaddress(address, op1 / op2);
-		return true;
+		cache.invalidate(codeversion);
 	}
-	case VM_OPERAND_TYPE_UINT32:
+	const vm_instruction_t* in = cache.lookup(programcounter);
+	if(in)
 	{
-		uint32_t op1 = memory->loadunsigned(address);
-		uint32_t op2 = memory->loadunsigned(operandaddress);
-		if(op2 == 0)
+		statuscode = 0 | (programcounter << 16);//code programcounter in statuscode
+		statuscode |= (in->opcode << 8);//code currentop in statuscode
+		return in;
+	}
+	if(decode(&current) && current.next <= memory->getCodeSize())
+	{//only instructions completely inside the code region are cached, other writes do not invalidate the cache
+		cache.insert(&current);
+	}
+#else
+	decode(&current);
+#endif
+	return &current;
+}
+
+/**
+ * Decodes the instruction at the programcounter. The programcounter is the same before and after decoding.
+ * MULTILOAD, URLMAP and PIDINIT have variable or long operand lists, they are decoded by their handlers and never cached.
+ * @param in Record to write the decoded instruction into.
+ * @return True if the decoded instruction can be cached.
+ */
+bool VM::decode(vm_instruction_t* in)
+{
+	bool cacheable = true;
+	in->pc = programcounter;
+	in->opcode = memory->loadcode(programcounter);
+	in->optype = 0;
+	statuscode = 0 | (programcounter << 16);//code programcounter in statuscode
+	statuscode |= (in->opcode << 8);//code currentop in statuscode
+	switch(in->opcode)
+	{
+	case VM_INSTRUCTION_ADD:
+	case VM_INSTRUCTION_SUB:
+	case VM_INSTRUCTION_MUL:
+	case VM_INSTRUCTION_DIV:
+	case VM_INSTRUCTION_MOD:
+	case VM_INSTRUCTION_AND:
+	case VM_INSTRUCTION_OR:
+	case VM_INSTRUCTION_XOR:
+	case VM_INSTRUCTION_LSHIFT:
+	case VM_INSTRUCTION_RSHIFT:
+	case VM_INSTRUCTION_LOAD:
+		in->optype = get_optype();
+		in->address = get_destination(in->optype);
+		in->operand = get_source(in->optype);
+		selectKernel(in, (in->optype & VM_ADDRESS_MASK) == VM_LITERAL);
+		break;
+	case VM_INSTRUCTION_NOT:
+		in->optype = get_optype();
+		in->address = get_destination(in->optype);
+		in->operand = 0;
+		selectKernel(in, false);
+		break;
+	case VM_INSTRUCTION_SADD:
+	case VM_INSTRUCTION_SSUB:
+	case VM_INSTRUCTION_SMUL:
+	case VM_INSTRUCTION_SDIV:
+		in->optype = get_optype();
+		selectStackKernel(in);
+		break;
+	case VM_INSTRUCTION_SCOMPARE:
+		in->optype = get_optype();
+		for(uint8_t i = 0; i < 3; i++)
 		{
-			flags |= VM_FLAG_DIVIDEZERO;
-			statuscode |= VM_ERROR_DIVIDEZERO;
-			break;
+			in->jump[i] = memory->loadcodeaddress(get_operandaddress(VM_LITERAL | VM_OPERAND_TYPE_UINT16));
 		}
-		memory->storeunsigned(address, op1 / op2);
-		return true;
-	}
-	case VM_OPERAND_TYPE_DEC:
+		selectStackKernel(in);
+		break;
+	case VM_INSTRUCTION_PUSH:
+		in->optype = get_optype();
+		in->operand = get_operandaddress(in->optype);
+		selectStackKernel(in);
+		break;
+	case VM_INSTRUCTION_POP:
+		in->optype = get_optype();
+		in->address = get_address();
+		selectStackKernel(in);
+		break;
+	case VM_INSTRUCTION_COPY:
+		in->address = get_address();
+		in->literal = get_number();
+		in->operand = get_address();
+		break;
+	case VM_INSTRUCTION_JUMP:
+		in->optype = get_optype();//nur für addresse oder literal, immer 16bit adresse
+		in->operand = get_operandaddress(in->optype | VM_OPERAND_TYPE_UINT16);
+		if((in->optype & VM_ADDRESS_MASK) == VM_LITERAL)
+		{
+			in->literal = memory->loadcodeaddress(in->operand);
+		}
+		break;
+	case VM_INSTRUCTION_COMPARE:
+		in->optype = get_optype();
+		in->address = get_destination(in->optype);
+		in->operand = get_source(in->optype);
+		//jumpaddressen immer als OPERAND_TYPE_UINT16, nur literal od address interassant
+		for(uint8_t i = 0; i < 3; i++)
+		{
+			in->jump[i] = memory->loadcodeaddress(get_operandaddress(in->optype | VM_LITERAL | VM_OPERAND_TYPE_UINT16));
+		}
+		selectKernel(in, (in->optype & VM_ADDRESS_MASK) == VM_LITERAL);
+		break;
+	case VM_INSTRUCTION_ADDCOMPARE:
 	{
-		rational_t op1 = memory->loadrational(address);
-		rational_t op2 = memory->loadrational(operandaddress);
-		if(op2 == 0)
+		in->optype = get_optype();
+		in->address = get_address();
+		uint16_t increment = get_operandaddress((in->optype & VM_OPTYPE_MASK) | VM_LITERAL);
+		in->operand = get_operandaddress(in->optype);
+		for(uint8_t i = 0; i < 3; i++)
 		{
-			flags |= VM_FLAG_DIVIDEZERO;
-			statuscode |= VM_ERROR_DIVIDEZERO;
-			break;
+			in->jump[i] = memory->loadcodeaddress(get_operandaddress(VM_LITERAL | VM_OPERAND_TYPE_UINT16));
 		}
-		memory->storerational(address, op1 / op2);
-		return true;
+		selectKernel(in, (in->optype & VM_ADDRESS_MASK) == VM_LITERAL);
+		if(in->kernel)
+		{
+			in->increment = literals[VM_OPERAND_TYPE_INDEX(in->optype)](memory, increment);
+		}
+		break;
 	}
+	case VM_INSTRUCTION_CALL:
+	case VM_INSTRUCTION_TIME:
+		in->address = get_address();
+		break;
+	case VM_INSTRUCTION_COMPARETIME:
+		in->address = get_address();
+		in->operand = get_operandaddress(VM_OPERAND_TYPE_UINT32 | VM_LITERAL);
+		in->literal = memory->loadcodeunsigned(in->operand);
+		in->jump[0] = get_address();
+		in->jump[1] = get_address();
+		break;
+	case VM_INSTRUCTION_SLEEPUNTIL:
+		in->address = get_address();
+		in->operand = get_operandaddress(VM_OPERAND_TYPE_UINT32 | VM_LITERAL);
+		in->literal = memory->loadcodeunsigned(in->operand);
+		break;
+	case VM_INSTRUCTION_TIMECOMPARE:
+		in->address = get_address();
+		in->operand = get_address();//address of the compared time
+		in->literal = memory->loadcodeunsigned(get_operandaddress(VM_OPERAND_TYPE_UINT32 | VM_LITERAL));
+		in->jump[0] = get_address();
+		in->jump[1] = get_address();
+		break;
+	case VM_INSTRUCTION_URLMAPCHECK:
+		in->optype = get_optype();
+		in->id = get_mapid(in->optype);
+		in->address = get_address();
+		break;
+	case VM_INSTRUCTION_URLMAPCOMPARE:
+	{//the ID bits of the OPTYPE are no register bits, the COMPARE kernel is selected directly
+		in->optype = get_optype();
+		in->id = get_mapid(in->optype);
+		in->address = get_address();
+		bool literal = (in->optype & VM_ADDRESS_MASK) == VM_LITERAL;
+		in->operand = get_operandaddress((in->optype & VM_ADDRESS_MASK) | VM_OPERAND_TYPE_UINT8);
+		for(uint8_t i = 0; i < 3; i++)
+		{
+			in->jump[i] = memory->loadcodeaddress(get_operandaddress(VM_LITERAL | VM_OPERAND_TYPE_UINT16));
+		}
+		in->kernel = kernels[VM_KERNEL_COMPARE][VM_OPERAND_TYPE_INDEX(VM_OPERAND_TYPE_UINT8)][literal ? VM_LITERAL : VM_ADDRESS][verified() ? VM_ACCESS_UNCHECKED : VM_ACCESS_CHECKED];
+		if(literal)
+		{
+			in->literal = memory->loadcode(in->operand);
+		}
+		break;
+	}
+	case VM_INSTRUCTION_URLMAPDELETE:
+	case VM_INSTRUCTION_URLMAPWAIT:
+		in->optype = get_optype();
+		in->id = get_mapid(in->optype);
+		break;
+	case VM_INSTRUCTION_PIDCLEAR:
+	case VM_INSTRUCTION_PIDSTOP:
+	case VM_INSTRUCTION_PIDRUN:
+	case VM_INSTRUCTION_PIDWAIT:
+		in->optype = get_optype();
+		break;
+	case VM_INSTRUCTION_RETURN:
+	case VM_INSTRUCTION_HALT:
+	case VM_INSTRUCTION_RESET:
+		break;
+	case VM_INSTRUCTION_MULTILOAD:
+	case VM_INSTRUCTION_URLMAP:
+	case VM_INSTRUCTION_PIDINIT:
 	default:
-		statuscode |= VM_ERROR_UNSUPPORTED_OPERAND;
+		cacheable = false;
 		break;
 	}
-	return false;
+	in->next = programcounter + 1;
+	programcounter = in->pc;
+	return cacheable && (statuscode & VM_ERROR_MASK) == 0;
 }
 
 /**
+ * Executes a decoded instruction and moves the programcounter to the next instruction.
+ * @param in Decoded instruction.
  * @return True if the instruction was successful.
  */
-bool VM::handleMOD()//imperformant, da kein mod auf fixed -> convert to float modulo konvert back
+bool VM::execute(const vm_instruction_t* in)
 {
-	uint8_t optype = get_optype();
-	uint16_t address = get_address();
-	uint16_t operandaddress = get_operandaddress(optype);
-	switch(optype & VM_OPTYPE_MASK)
+#if VM_DISPATCH == VM_DISPATCH_TABLE
+	const vm_dispatch_t& entry = dispatchtable[in->opcode];
+	bool success = (this->*entry.handler)(*in);
+	switch(entry.advance)
 	{
-	case VM_OPERAND_TYPE_UINT8:
-		memory->store(address, memory->load(address) % memory->load(operandaddress));
-		return true;
-	case VM_OPERAND_TYPE_UINT16:
-		memory->storeaddress(address, memory->loadaddress(address) % memory->loadaddress(operandaddress));
-		return true;
-	case VM_OPERAND_TYPE_UINT32:
-		memory->storeunsigned(address, memory->loadunsigned(address) % memory->loadunsigned(operandaddress));
-		return true;
-	case VM_OPERAND_TYPE_DEC:
-#ifdef FIXEDTYPE
-		memory->storerational(address, static_cast<rational_t>(fmod(static_cast<float>(memory->loadrational(address)), static_cast<float>(memory->loadrational(operandaddress)))));
+	case VM_ADVANCE_NEXT:	programcounter = in->next;	break;
+	case VM_ADVANCE_INC:	programcounter++;			break;
+	default: break;
+	}
+	return success;
 #else
-		memory->storerational(address, fmod(memory->loadrational(address), memory->loadrational(operandaddress)));
+	bool success = false;
+	switch(in->opcode)
+	{
+	case VM_INSTRUCTION_ADD:
+	case VM_INSTRUCTION_SUB:
+	case VM_INSTRUCTION_MUL:
+	case VM_INSTRUCTION_DIV:
+	case VM_INSTRUCTION_MOD:
+	case VM_INSTRUCTION_AND:
+	case VM_INSTRUCTION_OR:
+	case VM_INSTRUCTION_NOT:
+	case VM_INSTRUCTION_XOR:
+	case VM_INSTRUCTION_LSHIFT:
+	case VM_INSTRUCTION_RSHIFT:
+	case VM_INSTRUCTION_LOAD:
+	case VM_INSTRUCTION_SADD:
+	case VM_INSTRUCTION_SSUB:
+	case VM_INSTRUCTION_SMUL:
+	case VM_INSTRUCTION_SDIV:			success = this->handleKERNEL(*in);		programcounter = in->next;	break;
+	case VM_INSTRUCTION_MULTILOAD:		success = this->handleMULTILOAD(*in);	programcounter++;	break;
+	case VM_INSTRUCTION_PUSH:			success = this->handlePUSH(*in);			programcounter = in->next;	break;
+	case VM_INSTRUCTION_POP:			success = this->handlePOP(*in);			programcounter = in->next;	break;
+	case VM_INSTRUCTION_COPY:			success = this->handleCOPY(*in);			programcounter = in->next;	break;
+	case VM_INSTRUCTION_JUMP:			success = this->handleJUMP(*in);			break;
+	case VM_INSTRUCTION_COMPARE:
+	case VM_INSTRUCTION_SCOMPARE:
+	case VM_INSTRUCTION_ADDCOMPARE:		success = this->handleCOMPARE(*in);		break;
+	case VM_INSTRUCTION_CALL:			success = this->handleCALL(*in);			break;
+	case VM_INSTRUCTION_RETURN:			success = this->handleRETURN(*in);		break;
+	case VM_INSTRUCTION_TIME:			success = this->handleTIME(*in);			programcounter = in->next;	break;
+	case VM_INSTRUCTION_COMPARETIME:	success = this->handleCOMPARETIME(*in);	break;
+	case VM_INSTRUCTION_SLEEPUNTIL:		success = this->handleSLEEPUNTIL(*in);	programcounter = in->next;	break;
+	case VM_INSTRUCTION_TIMECOMPARE:	success = this->handleTIMECOMPARE(*in);	break;
+	case VM_INSTRUCTION_URLMAP:			success = this->handleURLMAP(*in);		programcounter++;	break;
+	case VM_INSTRUCTION_URLMAPCHECK:	success = this->handleURLMAPCHECK(*in);	programcounter = in->next;	break;
+	case VM_INSTRUCTION_URLMAPDELETE:	success = this->handleURLMAPDELETE(*in);	programcounter = in->next;	break;
+	case VM_INSTRUCTION_URLMAPWAIT:		success = this->handleURLMAPWAIT(*in);	programcounter = in->next;	break;
+	case VM_INSTRUCTION_URLMAPCOMPARE:	success = this->handleURLMAPCOMPARE(*in);	break;
+	case VM_INSTRUCTION_PIDINIT:		success = this->handlePIDINIT(*in);		programcounter++;	break;
+	case VM_INSTRUCTION_PIDCLEAR:		success = this->handlePIDCLEAR(*in);		programcounter = in->next;	break;
+	case VM_INSTRUCTION_PIDSTOP:		success = this->handlePIDSTOP(*in);		programcounter = in->next;	break;
+	case VM_INSTRUCTION_PIDRUN:			success = this->handlePIDRUN(*in);		programcounter = in->next;	break;
+	case VM_INSTRUCTION_PIDWAIT:		success = this->handlePIDWAIT(*in);		programcounter = in->next;	break;
+	case VM_INSTRUCTION_HALT:			success = this->handleHALT(*in);			break;
+	case VM_INSTRUCTION_RESET:			success = this->handleRESET(*in);		break;
+	default:							success = this->handleUNSUPPORTED(*in);	break;
+	}
+	return success;
 #endif
-		return true;
+}
+
+#if VM_DISPATCH == VM_DISPATCH_TABLE
+VM::vm_dispatch_t VM::dispatchtable[256];
+
+/**
+ * @brief Fills the dispatch table. Opcodes not defined in Opcodes.h are handled by handleUNSUPPORTED.
+ */
+void VM::initDispatchtable()
+{
+	for(uint16_t i = 0; i < 256; i++)
+	{
+		dispatchtable[i] = {&VM::handleUNSUPPORTED, VM_ADVANCE_NONE};
+	}
+	dispatchtable[VM_INSTRUCTION_ADD] = {&VM::handleKERNEL, VM_ADVANCE_NEXT};
+	dispatchtable[VM_INSTRUCTION_SUB] = {&VM::handleKERNEL, VM_ADVANCE_NEXT};
+	dispatchtable[VM_INSTRUCTION_MUL] = {&VM::handleKERNEL, VM_ADVANCE_NEXT};
+	dispatchtable[VM_INSTRUCTION_DIV] = {&VM::handleKERNEL, VM_ADVANCE_NEXT};
+	dispatchtable[VM_INSTRUCTION_MOD] = {&VM::handleKERNEL, VM_ADVANCE_NEXT};
+	dispatchtable[VM_INSTRUCTION_AND] = {&VM::handleKERNEL, VM_ADVANCE_NEXT};
+	dispatchtable[VM_INSTRUCTION_OR] = {&VM::handleKERNEL, VM_ADVANCE_NEXT};
+	dispatchtable[VM_INSTRUCTION_NOT] = {&VM::handleKERNEL, VM_ADVANCE_NEXT};
+	dispatchtable[VM_INSTRUCTION_XOR] = {&VM::handleKERNEL, VM_ADVANCE_NEXT};
+	dispatchtable[VM_INSTRUCTION_LSHIFT] = {&VM::handleKERNEL, VM_ADVANCE_NEXT};
+	dispatchtable[VM_INSTRUCTION_RSHIFT] = {&VM::handleKERNEL, VM_ADVANCE_NEXT};
+	dispatchtable[VM_INSTRUCTION_LOAD] = {&VM::handleKERNEL, VM_ADVANCE_NEXT};
+	dispatchtable[VM_INSTRUCTION_SADD] = {&VM::handleKERNEL, VM_ADVANCE_NEXT};
+	dispatchtable[VM_INSTRUCTION_SSUB] = {&VM::handleKERNEL, VM_ADVANCE_NEXT};
+	dispatchtable[VM_INSTRUCTION_SMUL] = {&VM::handleKERNEL, VM_ADVANCE_NEXT};
+	dispatchtable[VM_INSTRUCTION_SDIV] = {&VM::handleKERNEL, VM_ADVANCE_NEXT};
+	dispatchtable[VM_INSTRUCTION_MULTILOAD] = {&VM::handleMULTILOAD, VM_ADVANCE_INC};
+	dispatchtable[VM_INSTRUCTION_PUSH] = {&VM::handlePUSH, VM_ADVANCE_NEXT};
+	dispatchtable[VM_INSTRUCTION_POP] = {&VM::handlePOP, VM_ADVANCE_NEXT};
+	dispatchtable[VM_INSTRUCTION_COPY] = {&VM::handleCOPY, VM_ADVANCE_NEXT};
+	dispatchtable[VM_INSTRUCTION_JUMP] = {&VM::handleJUMP, VM_ADVANCE_NONE};
+	dispatchtable[VM_INSTRUCTION_COMPARE] = {&VM::handleCOMPARE, VM_ADVANCE_NONE};
+	dispatchtable[VM_INSTRUCTION_SCOMPARE] = {&VM::handleCOMPARE, VM_ADVANCE_NONE};
+	dispatchtable[VM_INSTRUCTION_ADDCOMPARE] = {&VM::handleCOMPARE, VM_ADVANCE_NONE};
+	dispatchtable[VM_INSTRUCTION_CALL] = {&VM::handleCALL, VM_ADVANCE_NONE};
+	dispatchtable[VM_INSTRUCTION_RETURN] = {&VM::handleRETURN, VM_ADVANCE_NONE};
+	dispatchtable[VM_INSTRUCTION_TIME] = {&VM::handleTIME, VM_ADVANCE_NEXT};
+	dispatchtable[VM_INSTRUCTION_COMPARETIME] = {&VM::handleCOMPARETIME, VM_ADVANCE_NONE};
+	dispatchtable[VM_INSTRUCTION_SLEEPUNTIL] = {&VM::handleSLEEPUNTIL, VM_ADVANCE_NEXT};
+	dispatchtable[VM_INSTRUCTION_TIMECOMPARE] = {&VM::handleTIMECOMPARE, VM_ADVANCE_NONE};
+	dispatchtable[VM_INSTRUCTION_URLMAP] = {&VM::handleURLMAP, VM_ADVANCE_INC};
+	dispatchtable[VM_INSTRUCTION_URLMAPCHECK] = {&VM::handleURLMAPCHECK, VM_ADVANCE_NEXT};
+	dispatchtable[VM_INSTRUCTION_URLMAPDELETE] = {&VM::handleURLMAPDELETE, VM_ADVANCE_NEXT};
+	dispatchtable[VM_INSTRUCTION_URLMAPWAIT] = {&VM::handleURLMAPWAIT, VM_ADVANCE_NEXT};
+	dispatchtable[VM_INSTRUCTION_URLMAPCOMPARE] = {&VM::handleURLMAPCOMPARE, VM_ADVANCE_NONE};
+	dispatchtable[VM_INSTRUCTION_PIDINIT] = {&VM::handlePIDINIT, VM_ADVANCE_INC};
+	dispatchtable[VM_INSTRUCTION_PIDCLEAR] = {&VM::handlePIDCLEAR, VM_ADVANCE_NEXT};
+	dispatchtable[VM_INSTRUCTION_PIDSTOP] = {&VM::handlePIDSTOP, VM_ADVANCE_NEXT};
+	dispatchtable[VM_INSTRUCTION_PIDRUN] = {&VM::handlePIDRUN, VM_ADVANCE_NEXT};
+	dispatchtable[VM_INSTRUCTION_PIDWAIT] = {&VM::handlePIDWAIT, VM_ADVANCE_NEXT};
+	dispatchtable[VM_INSTRUCTION_HALT] = {&VM::handleHALT, VM_ADVANCE_NONE};
+	dispatchtable[VM_INSTRUCTION_RESET] = {&VM::handleRESET, VM_ADVANCE_NONE};
+}
+#endif
+
+vm_kernel_t VM::kernels[VM_KERNEL_OPS][VM_OPERAND_TYPES][2][2];
+vm_kernel_t VM::stackkernels[VM_STACK_KERNEL_OPS][VM_OPERAND_TYPES];
+vm_kernel_t VM::regkernels[VM_KERNEL_OPS][VM_OPERAND_TYPES][VM_REGISTER_MODES];
+
+/**
+ * Register destination of a register kernel (register number in the address of the instruction).
+ */
+struct VM::RegisterDestination
+{
+	template<typename T> static T load(VM* vm, const vm_instruction_t& in) { return operand_type<T>::fromliteral(vm->registers[in.address]); }
+	template<typename T> static void store(VM* vm, const vm_instruction_t& in, T value) { vm->registers[in.address] = operand_type<T>::toliteral(value); }
+};
+
+/**
+ * Memory destination of a register kernel.
+ */
+struct VM::MemoryDestination
+{
+	template<typename T> static T load(VM* vm, const vm_instruction_t& in) { return CheckedAccess::load<T>(vm->memory, in.address); }
+	template<typename T> static void store(VM* vm, const vm_instruction_t& in, T value) { CheckedAccess::store<T>(vm->memory, in.address, value); }
+};
+
+/**
+ * Register operand of a register kernel (register number in the operand of the instruction).
+ */
+struct VM::RegisterSource
+{
+	template<typename T> static T load(VM* vm, const vm_instruction_t& in) { return operand_type<T>::fromliteral(vm->registers[in.operand]); }
+};
+
+/**
+ * Memory operand of a register kernel.
+ */
+struct VM::MemorySource
+{
+	template<typename T> static T load(VM* vm, const vm_instruction_t& in) { return CheckedAccess::load<T>(vm->memory, in.operand); }
+};
+
+/**
+ * Literal operand of a register kernel (taken from the decoded instruction).
+ */
+struct VM::LiteralSource
+{
+	template<typename T> static T load(VM* vm, const vm_instruction_t& in) { (void) vm; return operand_type<T>::fromliteral(in.literal); }
+};
+uint32_t (*VM::literals[VM_OPERAND_TYPES])(Memory* memory, uint16_t address);
+
+/**
+ * @brief Arithmetic or logic instruction specialized for operand type, operation, literal/address mode and memory access.
+ * Calculates destination = destination (op) operand, literal operands are taken from the decoded instruction.
+ * @param vm VM executing the instruction.
+ * @param in Decoded instruction.
+ * @return True if the instruction was successful.
+ */
+template<typename T, class Op, bool literal, class Access>
+bool VM::kernel(VM* vm, const vm_instruction_t& in)
+{
+	T a = Op::load_destination ? Access::template load<T>(vm->memory, in.address) : T();
+	T b = Op::load_operand ? (literal ? operand_type<T>::fromliteral(in.literal) : Access::template load<T>(vm->memory, in.operand)) : T();
+	if(!Op::apply(a, b))
+	{//only division by zero fails
+		vm->flags |= VM_FLAG_DIVIDEZERO;
+		vm->statuscode |= VM_ERROR_DIVIDEZERO;
+		return false;
+	}
+	Access::template store<T>(vm->memory, in.address, a);
+	return true;
+}
+
+/**
+ * @brief COMPARE specialized for operand type, literal/address mode and memory access. Jumps to the first, second
+ * or third jump address if the value at the address is smaller, equal or greater than the operand.
+ * @param vm VM executing the instruction.
+ * @param in Decoded instruction.
+ * @return True if the instruction was successful.
+ */
+template<typename T, bool literal, class Access>
+bool VM::compare(VM* vm, const vm_instruction_t& in)
+{
+	T value1 = Access::template load<T>(vm->memory, in.address);
+	T value2 = literal ? operand_type<T>::fromliteral(in.literal) : Access::template load<T>(vm->memory, in.operand);
+	if(value1 < value2)
+	{
+		vm->programcounter = in.jump[0];
+	}
+	else if(value1 > value2)
+	{
+		vm->programcounter = in.jump[2];
+	}
+	else
+	{
+		vm->programcounter = in.jump[1];
+	}
+	return true;
+}
+
+/**
+ * @brief Superinstruction ADDCOMPARE specialized for operand type, literal/address mode and memory access. Adds the increment
+ * to the value at the address and compares the sum with the operand like compare().
+ * @param vm VM executing the instruction.
+ * @param in Decoded instruction.
+ * @return True if the instruction was successful.
+ */
+template<typename T, bool literal, class Access>
+bool VM::addcompare(VM* vm, const vm_instruction_t& in)
+{
+	T value1 = Access::template load<T>(vm->memory, in.address);
+	OpAdd::apply(value1, operand_type<T>::fromliteral(in.increment));
+	Access::template store<T>(vm->memory, in.address, value1);
+	T value2 = literal ? operand_type<T>::fromliteral(in.literal) : Access::template load<T>(vm->memory, in.operand);
+	if(value1 < value2)
+	{
+		vm->programcounter = in.jump[0];
+	}
+	else if(value1 > value2)
+	{
+		vm->programcounter = in.jump[2];
+	}
+	else
+	{
+		vm->programcounter = in.jump[1];
+	}
+	return true;
+}
+
+/**
+ * @brief Arithmetic or logic instruction with register operands specialized for operand type, operation, destination and operand.
+ * Calculates destination = destination (op) operand.
+ * @param vm VM executing the instruction.
+ * @param in Decoded instruction.
+ * @return True if the instruction was successful.
+ */
+template<typename T, class Op, class Dst, class Src>
+bool VM::regkernel(VM* vm, const vm_instruction_t& in)
+{
+	T a = Op::load_destination ? Dst::template load<T>(vm, in) : T();
+	T b = Op::load_operand ? Src::template load<T>(vm, in) : T();
+	if(!Op::apply(a, b))
+	{//only division by zero fails
+		vm->flags |= VM_FLAG_DIVIDEZERO;
+		vm->statuscode |= VM_ERROR_DIVIDEZERO;
+		return false;
+	}
+	Dst::template store<T>(vm, in, a);
+	return true;
+}
+
+/**
+ * @brief COMPARE with register operands specialized for operand type, first value and operand.
+ * @param vm VM executing the instruction.
+ * @param in Decoded instruction.
+ * @return True if the instruction was successful.
+ */
+template<typename T, class Dst, class Src>
+bool VM::regcompare(VM* vm, const vm_instruction_t& in)
+{
+	T value1 = Dst::template load<T>(vm, in);
+	T value2 = Src::template load<T>(vm, in);
+	if(value1 < value2)
+	{
+		vm->programcounter = in.jump[0];
+	}
+	else if(value1 > value2)
+	{
+		vm->programcounter = in.jump[2];
+	}
+	else
+	{
+		vm->programcounter = in.jump[1];
+	}
+	return true;
+}
+
+/**
+ * @brief Arithmetic instruction on the operand stack specialized for operand type and operation. Pops b and a, pushes a (op) b.
+ * The depth is checked once, the result replaces a in place so the stack can not overflow.
+ * @param vm VM executing the instruction.
+ * @param in Decoded instruction.
+ * @return True if the instruction was successful.
+ */
+template<typename T, class Op>
+bool VM::stackkernel(VM* vm, const vm_instruction_t& in)
+{
+	(void) in;
+	if(!vm->operands.holds(2))
+	{
+		vm->statuscode |= VM_ERROR_STACK;
+		return false;
+	}
+	T b = operand_type<T>::fromliteral(vm->operands.pop());
+	uint32_t& top = vm->operands.top();
+	T a = operand_type<T>::fromliteral(top);
+	if(!Op::apply(a, b))
+	{//only division by zero fails
+		vm->flags |= VM_FLAG_DIVIDEZERO;
+		vm->statuscode |= VM_ERROR_DIVIDEZERO;
+		return false;
+	}
+	top = operand_type<T>::toliteral(a);
+	return true;
+}
+
+/**
+ * @brief SCOMPARE specialized for operand type. Pops b and a and jumps to the first, second or third jump address
+ * if a is smaller, equal or greater than b.
+ * @param vm VM executing the instruction.
+ * @param in Decoded instruction.
+ * @return True if the instruction was successful.
+ */
+template<typename T>
+bool VM::stackcompare(VM* vm, const vm_instruction_t& in)
+{
+	if(!vm->operands.holds(2))
+	{
+		vm->statuscode |= VM_ERROR_STACK;
+		return false;
+	}
+	T value2 = operand_type<T>::fromliteral(vm->operands.pop());
+	T value1 = operand_type<T>::fromliteral(vm->operands.pop());
+	if(value1 < value2)
+	{
+		vm->programcounter = in.jump[0];
+	}
+	else if(value1 > value2)
+	{
+		vm->programcounter = in.jump[2];
+	}
+	else
+	{
+		vm->programcounter = in.jump[1];
+	}
+	return true;
+}
+
+/**
+ * @brief PUSH specialized for operand type and literal/address mode. Literals are pushed as decoded,
+ * values at an address are loaded with range checks.
+ * @param vm VM executing the instruction.
+ * @param in Decoded instruction.
+ * @return True if the instruction was successful.
+ */
+template<typename T, bool literal>
+bool VM::stackpush(VM* vm, const vm_instruction_t& in)
+{
+	if(!vm->operands.hasSpace(1))
+	{
+		vm->statuscode |= VM_ERROR_STACK;
+		return false;
+	}
+	vm->operands.push(literal ? in.literal : operand_type<T>::toliteral(CheckedAccess::load<T>(vm->memory, in.operand)));
+	return true;
+}
+
+/**
+ * @brief POP specialized for operand type. Stores the value on top of the stack at the address with range checks.
+ * @param vm VM executing the instruction.
+ * @param in Decoded instruction.
+ * @return True if the instruction was successful.
+ */
+template<typename T>
+bool VM::stackpop(VM* vm, const vm_instruction_t& in)
+{
+	if(!vm->operands.holds(1))
+	{
+		vm->statuscode |= VM_ERROR_STACK;
+		return false;
+	}
+	CheckedAccess::store<T>(vm->memory, in.address, operand_type<T>::fromliteral(vm->operands.top()));
+	vm->operands.pop();//popped after the store, a failed store keeps the value
+	return true;
+}
+
+/**
+ * @brief Registers the kernels of an operation for an operand type, if the operation is defined for the type.
+ * @param op Kernel index of the operation.
+ */
+template<class Op, typename T>
+void VM::registerKernel(uint8_t op)
+{
+	registerKernel<Op, T>(op, std::integral_constant<bool, !Op::integer_only || operand_type<T>::integer>());
+}
+
+template<class Op, typename T>
+void VM::registerKernel(uint8_t op, std::true_type supported)
+{
+	(void) supported;
+	vm_kernel_t (&entry)[2][2] = kernels[op][VM_OPERAND_TYPE_INDEX(operand_type<T>::code)];
+	entry[VM_ADDRESS][VM_ACCESS_CHECKED] = &VM::kernel<T, Op, false, CheckedAccess>;
+	entry[VM_LITERAL][VM_ACCESS_CHECKED] = &VM::kernel<T, Op, true, CheckedAccess>;
+	entry[VM_ADDRESS][VM_ACCESS_UNCHECKED] = &VM::kernel<T, Op, false, UncheckedAccess>;
+	entry[VM_LITERAL][VM_ACCESS_UNCHECKED] = &VM::kernel<T, Op, true, UncheckedAccess>;
+	vm_kernel_t (&modes)[VM_REGISTER_MODES] = regkernels[op][VM_OPERAND_TYPE_INDEX(operand_type<T>::code)];
+	modes[0] = &VM::regkernel<T, Op, RegisterDestination, MemorySource>;
+	modes[1] = &VM::regkernel<T, Op, RegisterDestination, LiteralSource>;
+	modes[2] = &VM::regkernel<T, Op, RegisterDestination, RegisterSource>;
+	modes[3] = &VM::regkernel<T, Op, MemoryDestination, RegisterSource>;
+}
+
+template<class Op, typename T>
+void VM::registerKernel(uint8_t op, std::false_type supported)
+{
+	(void) supported;
+	memset(kernels[op][VM_OPERAND_TYPE_INDEX(operand_type<T>::code)], 0, sizeof(kernels[op][0]));
+	memset(regkernels[op][VM_OPERAND_TYPE_INDEX(operand_type<T>::code)], 0, sizeof(regkernels[op][0]));
+}
+
+/**
+ * @brief Registers all kernels of an operand type. Order of the operations is the same as in kernelindex().
+ */
+template<typename T>
+void VM::registerType()
+{
+	registerKernel<OpAdd, T>(0);
+	registerKernel<OpSub, T>(1);
+	registerKernel<OpMul, T>(2);
+	registerKernel<OpDiv, T>(3);
+	registerKernel<OpMod, T>(4);
+	registerKernel<OpAnd, T>(5);
+	registerKernel<OpOr, T>(6);
+	registerKernel<OpNot, T>(7);
+	registerKernel<OpXor, T>(8);
+	registerKernel<OpLshift, T>(9);
+	registerKernel<OpRshift, T>(10);
+	registerKernel<OpLoad, T>(11);
+	vm_kernel_t (&entry)[2][2] = kernels[VM_KERNEL_COMPARE][VM_OPERAND_TYPE_INDEX(operand_type<T>::code)];
+	entry[VM_ADDRESS][VM_ACCESS_CHECKED] = &VM::compare<T, false, CheckedAccess>;
+	entry[VM_LITERAL][VM_ACCESS_CHECKED] = &VM::compare<T, true, CheckedAccess>;
+	entry[VM_ADDRESS][VM_ACCESS_UNCHECKED] = &VM::compare<T, false, UncheckedAccess>;
+	entry[VM_LITERAL][VM_ACCESS_UNCHECKED] = &VM::compare<T, true, UncheckedAccess>;
+	vm_kernel_t (&fused)[2][2] = kernels[VM_KERNEL_ADDCOMPARE][VM_OPERAND_TYPE_INDEX(operand_type<T>::code)];
+	fused[VM_ADDRESS][VM_ACCESS_CHECKED] = &VM::addcompare<T, false, CheckedAccess>;
+	fused[VM_LITERAL][VM_ACCESS_CHECKED] = &VM::addcompare<T, true, CheckedAccess>;
+	fused[VM_ADDRESS][VM_ACCESS_UNCHECKED] = &VM::addcompare<T, false, UncheckedAccess>;
+	fused[VM_LITERAL][VM_ACCESS_UNCHECKED] = &VM::addcompare<T, true, UncheckedAccess>;
+	literals[VM_OPERAND_TYPE_INDEX(operand_type<T>::code)] = &operand_type<T>::loadliteral;
+	vm_kernel_t (&modes)[VM_REGISTER_MODES] = regkernels[VM_KERNEL_COMPARE][VM_OPERAND_TYPE_INDEX(operand_type<T>::code)];
+	modes[0] = &VM::regcompare<T, RegisterDestination, MemorySource>;
+	modes[1] = &VM::regcompare<T, RegisterDestination, LiteralSource>;
+	modes[2] = &VM::regcompare<T, RegisterDestination, RegisterSource>;
+	modes[3] = &VM::regcompare<T, MemoryDestination, RegisterSource>;
+
+	uint8_t type = VM_OPERAND_TYPE_INDEX(operand_type<T>::code);
+	stackkernels[0][type] = &VM::stackkernel<T, OpAdd>;
+	stackkernels[1][type] = &VM::stackkernel<T, OpSub>;
+	stackkernels[2][type] = &VM::stackkernel<T, OpMul>;
+	stackkernels[3][type] = &VM::stackkernel<T, OpDiv>;
+	stackkernels[VM_STACK_KERNEL_COMPARE][type] = &VM::stackcompare<T>;
+	stackkernels[VM_STACK_KERNEL_PUSH][type] = &VM::stackpush<T, false>;
+	stackkernels[VM_STACK_KERNEL_PUSH + 1][type] = &VM::stackpush<T, true>;
+	stackkernels[VM_STACK_KERNEL_POP][type] = &VM::stackpop<T>;
+}
+
+/**
+ * @brief Fills the kernel table with all supported operand types. Unregistered type codes have no kernels.
+ */
+void VM::initKernels()
+{
+	registerType<uint32_t>();
+	registerType<rational_t>();
+	registerType<uint8_t>();
+	registerType<uint16_t>();
+}
+
+/**
+ * @param opcode Opcode of the instruction.
+ * @return Kernel index of the operation, -1 if the instruction is not executed by a kernel.
+ */
+int8_t VM::kernelindex(uint8_t opcode)
+{
+	switch(opcode)
+	{
+	case VM_INSTRUCTION_ADD:	return 0;
+	case VM_INSTRUCTION_SUB:	return 1;
+	case VM_INSTRUCTION_MUL:	return 2;
+	case VM_INSTRUCTION_DIV:	return 3;
+	case VM_INSTRUCTION_MOD:	return 4;
+	case VM_INSTRUCTION_AND:	return 5;
+	case VM_INSTRUCTION_OR:		return 6;
+	case VM_INSTRUCTION_NOT:	return 7;
+	case VM_INSTRUCTION_XOR:	return 8;
+	case VM_INSTRUCTION_LSHIFT:	return 9;
+	case VM_INSTRUCTION_RSHIFT:	return 10;
+	case VM_INSTRUCTION_LOAD:	return 11;
+	case VM_INSTRUCTION_COMPARE:	return VM_KERNEL_COMPARE;
+	case VM_INSTRUCTION_ADDCOMPARE:	return VM_KERNEL_ADDCOMPARE;
+	default:					return -1;
+	}
+}
+
+/**
+ * @param opcode Opcode of the instruction.
+ * @param optype OPTYPE of the instruction (selects PUSH with literal or address).
+ * @return Stack kernel index of the operation, -1 if the instruction is not executed by a stack kernel.
+ */
+int8_t VM::stackkernelindex(uint8_t opcode, uint8_t optype)
+{
+	switch(opcode)
+	{
+	case VM_INSTRUCTION_SADD:		return 0;
+	case VM_INSTRUCTION_SSUB:		return 1;
+	case VM_INSTRUCTION_SMUL:		return 2;
+	case VM_INSTRUCTION_SDIV:		return 3;
+	case VM_INSTRUCTION_SCOMPARE:	return VM_STACK_KERNEL_COMPARE;
+	case VM_INSTRUCTION_PUSH:		return VM_STACK_KERNEL_PUSH + ((optype & VM_ADDRESS_MASK) == VM_LITERAL);
+	case VM_INSTRUCTION_POP:		return VM_STACK_KERNEL_POP;
+	default:						return -1;
+	}
+}
+
+/**
+ * Selects the kernel of an operand stack instruction by OPTYPE and loads a literal operand of PUSH.
+ * @param in Decoded instruction, optype and operand (PUSH) must be set.
+ */
+void VM::selectStackKernel(vm_instruction_t* in)
+{
+	uint8_t type = VM_OPERAND_TYPE_INDEX(in->optype);
+	in->kernel = 0;
+	if(type >= VM_OPERAND_TYPES)
+	{
+		return;
+	}
+	int8_t index = stackkernelindex(in->opcode, in->optype);
+	if(index < 0)
+	{
+		return;
+	}
+	in->kernel = stackkernels[index][type];
+	if(index == VM_STACK_KERNEL_PUSH + 1)
+	{
+		in->literal = literals[type](memory, in->operand);
+	}
+}
+
+/**
+ * @param optype OPTYPE of an arithmetic, logic, LOAD or COMPARE instruction.
+ * @return Register mode (index of the register kernel), -1 if the instruction has no register operand, -2 if the combination is invalid (register operand and literal).
+ */
+int8_t VM::registermode(uint8_t optype)
+{
+	bool literal = (optype & VM_ADDRESS_MASK) == VM_LITERAL;
+	if(optype & VM_REGISTER_OPERAND)
+	{
+		if(literal)
+		{
+			return -2;
+		}
+		return (optype & VM_REGISTER_DESTINATION) ? 2 : 3;
+	}
+	if(optype & VM_REGISTER_DESTINATION)
+	{
+		return literal ? 1 : 0;
+	}
+	return -1;
+}
+
+/**
+ * Selects the kernel of an arithmetic, logic or COMPARE instruction by OPTYPE and loads a literal operand.
+ * Kernels without range checks are used if the program is verified. Instructions with register operands use the register kernels,
+ * register numbers are checked here so the register kernels do not check them.
+ * @param in Decoded instruction, optype, address and operand must be set.
+ * @param literal True if the operand is coded in the instruction.
+ */
+void VM::selectKernel(vm_instruction_t* in, bool literal)
+{
+	uint8_t type = VM_OPERAND_TYPE_INDEX(in->optype);
+	in->kernel = 0;
+	if(type >= VM_OPERAND_TYPES)
+	{
+		return;
+	}
+	int8_t mode = registermode(in->optype);
+	if(mode == -1)
+	{
+		in->kernel = kernels[kernelindex(in->opcode)][type][literal ? VM_LITERAL : VM_ADDRESS][verified() ? VM_ACCESS_UNCHECKED : VM_ACCESS_CHECKED];
+	}
+	else if(mode >= 0
+			&& (!(in->optype & VM_REGISTER_DESTINATION) || in->address < VM_REGISTERS)
+			&& (!(in->optype & VM_REGISTER_OPERAND) || in->operand < VM_REGISTERS))
+	{
+		in->kernel = regkernels[kernelindex(in->opcode)][type][mode];
+	}
+	if(in->kernel && literal)
+	{
+		in->literal = literals[type](memory, in->operand);
+	}
+}
+
+/**
+ * @brief Verifies the program in the code region of the memory. A program is verified if
+ * - every instruction reachable by a linear sweep ends inside the code region,
+ * - every jump, call and return target is the start of an instruction,
+ * - the last instruction does not continue behind the code region,
+ * - every address accessed by a kernel (arithmetic, logic, COMPARE) is in range for its operand width.
+ * The values the program shares with other threads (URLMAP and PIDINIT) are collected, all other addresses are never
+ * shared while the program is unchanged (see verifiedUnshared()).
+ * Programs with indirect jumps (JUMP with address operand) and program images larger than the code region of the memory
+ * (MEMORY_CODE_REGION) can not be verified.
+ * Kernels of verified programs run without range checks until the code is changed.
+ * @return True if the program is verified.
+ */
+bool VM::verify()
+{
+	uint16_t codesize = memory->getCodeSize();
+	if(codesize == 0 || codesize > MEMORY_CODE_REGION)
+	{
+		return false;
+	}
+	uint16_t savedprogramcounter = programcounter;
+	uint32_t savedstatuscode = statuscode;
+	bool valid = true;
+	memset(instructionstarts, 0, (codesize + 7) / 8);
+	memset(verifiedshared, 0, MEMORY_SHARED_MAP_SIZE);
+#ifndef VM_NO_EXCEPTIONS
+	try {
+#endif
+		for(uint8_t pass = 0; pass < 2 && valid; pass++)
+		{//first pass checks instructions and collects instruction starts, second pass checks targets
+			programcounter = 0;
+			while(valid && programcounter < codesize)
+			{
+				valid = verifyInstruction(codesize, pass == 1);
+#ifdef VM_NO_EXCEPTIONS
+				if(memory->accessError())
+				{
+					memory->clearAccessError();
+					valid = false;
+				}
+#endif
+			}
+		}
+#ifndef VM_NO_EXCEPTIONS
+	}
+	catch (std::range_error& e) {
+		valid = false;
+	}
+#endif
+	programcounter = savedprogramcounter;
+	statuscode = savedstatuscode;
+	return valid;
+}
+
+/**
+ * Verifies the instruction at the programcounter and moves the programcounter to the next instruction.
+ * @param codesize Size of the code region.
+ * @param checktargets True to check targets (second pass), false to check the instruction and mark its start (first pass).
+ * @return True if the instruction is valid.
+ */
+bool VM::verifyInstruction(uint16_t codesize, bool checktargets)
+{
+	vm_instruction_t in;
+	uint16_t targets[4];
+	uint8_t targetcount = 0;
+	bool continues = true;
+	decode(&in);
+	if(statuscode & VM_ERROR_MASK)
+	{
+		return false;
+	}
+	switch(in.opcode)
+	{
+	case VM_INSTRUCTION_ADD:
+	case VM_INSTRUCTION_SUB:
+	case VM_INSTRUCTION_MUL:
+	case VM_INSTRUCTION_DIV:
+	case VM_INSTRUCTION_MOD:
+	case VM_INSTRUCTION_AND:
+	case VM_INSTRUCTION_OR:
+	case VM_INSTRUCTION_XOR:
+	case VM_INSTRUCTION_LSHIFT:
+	case VM_INSTRUCTION_RSHIFT:
+	case VM_INSTRUCTION_LOAD:
+		if(!verifyDestination(in) || !verifySource(in))
+		{
+			return false;
+		}
+		break;
+	case VM_INSTRUCTION_NOT:
+		if(!verifyDestination(in))
+		{
+			return false;
+		}
+		break;
+	case VM_INSTRUCTION_COMPARE:
+		if(!verifyDestination(in) || !verifySource(in))
+		{
+			return false;
+		}
+		targets[targetcount++] = in.jump[0];
+		targets[targetcount++] = in.jump[1];
+		targets[targetcount++] = in.jump[2];
+		continues = false;
+		break;
+	case VM_INSTRUCTION_ADDCOMPARE:
+		if(!verifyAddress(in.address, in.optype)
+				|| ((in.optype & VM_ADDRESS_MASK) == VM_ADDRESS && !verifyAddress(in.operand, in.optype)))
+		{
+			return false;
+		}
+		targets[targetcount++] = in.jump[0];
+		targets[targetcount++] = in.jump[1];
+		targets[targetcount++] = in.jump[2];
+		continues = false;
+		break;
+	case VM_INSTRUCTION_URLMAPCOMPARE:
+		if(!verifyAddress(in.address, VM_OPERAND_TYPE_UINT8)
+				|| ((in.optype & VM_ADDRESS_MASK) == VM_ADDRESS && !verifyAddress(in.operand, VM_OPERAND_TYPE_UINT8)))
+		{
+			return false;
+		}
+		targets[targetcount++] = in.jump[0];
+		targets[targetcount++] = in.jump[1];
+		targets[targetcount++] = in.jump[2];
+		continues = false;
+		break;
+	case VM_INSTRUCTION_SCOMPARE:
+		targets[targetcount++] = in.jump[0];
+		targets[targetcount++] = in.jump[1];
+		targets[targetcount++] = in.jump[2];
+		continues = false;
+		break;
+	case VM_INSTRUCTION_JUMP:
+		if((in.optype & VM_ADDRESS_MASK) != VM_LITERAL)
+		{//indirect jump
+			return false;
+		}
+		targets[targetcount++] = in.literal;
+		continues = false;
+		break;
+	case VM_INSTRUCTION_CALL:
+		targets[targetcount++] = in.address;
+		targets[targetcount++] = in.next;//return address
+		continues = false;
+		break;
+	case VM_INSTRUCTION_COMPARETIME:
+	case VM_INSTRUCTION_TIMECOMPARE:
+		targets[targetcount++] = in.jump[0];
+		targets[targetcount++] = in.jump[1];
+		continues = false;
+		break;
+	case VM_INSTRUCTION_URLMAP:
+	case VM_INSTRUCTION_PIDINIT:
+		if(!checktargets)
+		{
+			verifyShared(in);
+		}
+		if(!skipOperands(&in, codesize))
+		{
+			return false;
+		}
+		break;
+	case VM_INSTRUCTION_MULTILOAD:
+		if(!skipOperands(&in, codesize))
+		{
+			return false;
+		}
+		break;
+	case VM_INSTRUCTION_RETURN:
+	case VM_INSTRUCTION_HALT:
+	case VM_INSTRUCTION_RESET:
+		continues = false;
+		break;
 	default:
-		statuscode |= VM_ERROR_UNSUPPORTED_OPERAND;
 		break;
 	}
-	return false;
+	if(in.next > codesize || in.next < in.pc || (continues && in.next == codesize))
+	{
+		return false;
+	}
+	if(checktargets)
+	{
+		for(uint8_t i = 0; i < targetcount; i++)
+		{
+			if(!verifyTarget(targets[i], codesize))
+			{
+				return false;
+			}
+		}
+	}
+	else
+	{
+		instructionstarts[in.pc >> 3] |= (1 << (in.pc & 0x07));
+	}
+	programcounter = in.next;
+	return true;
 }
 
 /**
- * @return True if the instruction was successful.
+ * Moves the programcounter over the operands of MULTILOAD, URLMAP and PIDINIT like their handlers do and sets the next instruction.
+ * @param in Decoded instruction.
+ * @param codesize Size of the code region.
+ * @return True if the operands end inside the code region.
  */
-bool VM::handleAND()
+bool VM::skipOperands(vm_instruction_t* in, uint16_t codesize)
 {
-	uint8_t optype = get_optype();
-	uint16_t address = get_address();
-	uint16_t operandaddress = get_operandaddress(optype);
-	switch(optype & VM_OPTYPE_MASK)
+	programcounter = in->pc;
+	switch(in->opcode)
 	{
-	case VM_OPERAND_TYPE_UINT8:
-		memory->store(address, memory->load(address) & memory->load(operandaddress));
-		return true;
-	case VM_OPERAND_TYPE_UINT16:
-		memory->storeaddress(address, memory->loadaddress(address) & memory->loadaddress(operandaddress));
-		return true;
-	case VM_OPERAND_TYPE_UINT32:
-		memory->storeunsigned(address, memory->loadunsigned(address) & memory->loadunsigned(operandaddress));
-		return true;
-	case VM_OPERAND_TYPE_DEC:
+	case VM_INSTRUCTION_MULTILOAD:
+	{
+		uint8_t optype = get_optype();
+		get_address();
+		uint8_t count = get_number();
+		for(uint8_t i = 0; i < count; i++)
+		{
+			get_operandaddress(optype);
+		}
+		break;
+	}
+	case VM_INSTRUCTION_URLMAP:
+	{
+		get_mapid(get_optype());
+		uint8_t map_options = get_optype();
+		get_address();
+		get_address();
+		uint8_t literal[2] = {(map_options & VM_MAP_OPTION_URL_MASK) == VM_MAP_OPTION_URL_LITERAL,
+				(map_options & VM_MAP_OPTION_RESOURCE_MASK) == VM_MAP_OPTION_RESOURCE_LITERAL};
+		for(uint8_t i = 0; i < 2; i++)
+		{
+			if(literal[i])
+			{
+				get_operandaddress(VM_LITERAL | VM_OPERAND_TYPE_UINT8);
+				while(programcounter < codesize && memory->loadcode(++programcounter) != 0x00);
+			}
+			else
+			{
+				get_operandaddress(VM_ADDRESS);
+			}
+		}
+		break;
+	}
+	case VM_INSTRUCTION_PIDINIT:
+		programcounter += 1 + 3 * sizeof(uint16_t) + 5 * sizeof(rational_t) + sizeof(uint32_t) + sizeof(uint8_t);
+		break;
 	default:
-		statuscode |= VM_ERROR_UNSUPPORTED_OPERAND;
 		break;
 	}
-	return false;
+	in->next = programcounter + 1;
+	return programcounter < codesize && (statuscode & VM_ERROR_MASK) == 0;
 }
 
 /**
- * @return True if the instruction was successful.
+ * Collects the values an URLMAP or PIDINIT shares with other threads, reads the addresses like the handlers do.
+ * @param in Decoded URLMAP or PIDINIT.
+ */
+void VM::verifyShared(const vm_instruction_t& in)
+{
+	programcounter = in.pc;
+	if(in.opcode == VM_INSTRUCTION_URLMAP)
+	{
+		get_mapid(get_optype());
+		get_optype();
+		Memory::markwords(verifiedshared, get_address(), sizeof(uint32_t));//see Memory::map()
+		return;
+	}
+	get_optype();
+	for(uint8_t i = 0; i < 3; i++)
+	{//input, output and setpoint, see PID::init()
+		Memory::markwords(verifiedshared, get_address(), sizeof(rational_t));
+	}
+}
+
+/**
+ * @param address Address of a value.
+ * @param size Size of the value.
+ * @return True if the last verified program never shares the value with other threads.
+ */
+bool VM::verifiedUnshared(uint16_t address, uint16_t size)
+{
+	for(uint32_t word = address / MEMORY_SHARED_WORD_SIZE; word <= (address + size - 1u) / MEMORY_SHARED_WORD_SIZE; word++)
+	{
+		if(verifiedshared[word >> 3] & (1 << (word & 7)))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @param target Jump target.
+ * @param codesize Size of the code region.
+ * @return True if the target is the start of an instruction.
+ */
+bool VM::verifyTarget(uint16_t target, uint16_t codesize)
+{
+	return target < codesize && (instructionstarts[target >> 3] & (1 << (target & 0x07)));
+}
+
+/**
+ * @param address Address accessed by a kernel.
+ * @param optype OPTYPE of the instruction (operand width).
+ * @return True if the operand is inside the memory.
  */
-bool VM::handleOR()
+bool VM::verifyAddress(uint16_t address, uint8_t optype)
 {
-	uint8_t optype = get_optype();
-	uint16_t address = get_address();
-	uint16_t operandaddress = get_operandaddress(optype);
+	uint8_t width;
 	switch(optype & VM_OPTYPE_MASK)
 	{
-	case VM_OPERAND_TYPE_UINT8:
-		memory->store(address, memory->load(address) | memory->load(operandaddress));
-		return true;
-	case VM_OPERAND_TYPE_UINT16:
-		memory->storeaddress(address, memory->loadaddress(address) | memory->loadaddress(operandaddress));
-		return true;
-	case VM_OPERAND_TYPE_UINT32:
-		memory->storeunsigned(address, memory->loadunsigned(address) | memory->loadunsigned(operandaddress));
-		return true;
-	case VM_OPERAND_TYPE_DEC:
-	default:
-		statuscode |= VM_ERROR_UNSUPPORTED_OPERAND;
-		break;
+	case VM_OPERAND_TYPE_UINT8:		width = sizeof(uint8_t);	break;
+	case VM_OPERAND_TYPE_UINT16:	width = sizeof(uint16_t);	break;
+	case VM_OPERAND_TYPE_UINT32:	width = sizeof(uint32_t);	break;
+	case VM_OPERAND_TYPE_DEC:		width = sizeof(rational_t);	break;
+	default:						return true;//no kernel, fails at runtime without memory access
 	}
-	return false;
+	return address <= memory->getMemorySize() - width;
 }
 
 /**
- * @return True if the instruction was successful.
+ * @param in Decoded arithmetic, logic, LOAD or COMPARE instruction.
+ * @return True if the destination (first operand) is an existing register or inside the memory.
  */
-bool VM::handleNOT()
+bool VM::verifyDestination(const vm_instruction_t& in)
 {
-	uint8_t optype = get_optype();
-	uint16_t address = get_address();
-
-	switch(optype & VM_OPTYPE_MASK)
+	if(in.optype & VM_REGISTER_DESTINATION)
 	{
-	case VM_OPERAND_TYPE_UINT8:
-		memory->store(address, memory->load(address) ^ -1);
-		return true;
-	case VM_OPERAND_TYPE_UINT16:
-		memory->storeaddress(address, memory->loadaddress(address) ^ -1);
-		return true;
-	case VM_OPERAND_TYPE_UINT32:
-		memory->storeunsigned(address, memory->loadunsigned(address) ^ -1);
-		return true;
-	case VM_OPERAND_TYPE_DEC:
-	default:
-		statuscode |= VM_ERROR_UNSUPPORTED_OPERAND;
-		break;
+		return in.address < VM_REGISTERS;
 	}
-	return false;
+	return verifyAddress(in.address, in.optype);
 }
 
 /**
- * @return True if the instruction was successful.
+ * @param in Decoded arithmetic, logic, LOAD or COMPARE instruction.
+ * @return True if the operand is a literal, an existing register or inside the memory.
  */
-bool VM::handleXOR()
+bool VM::verifySource(const vm_instruction_t& in)
 {
-	uint8_t optype = get_optype();
-	uint16_t address = get_address();
-	uint16_t operandaddress = get_operandaddress(optype);
-
-	switch(optype & VM_OPTYPE_MASK)
+	if((in.optype & VM_ADDRESS_MASK) == VM_LITERAL)
 	{
-	case VM_OPERAND_TYPE_UINT8:
-		memory->store(address, memory->load(address) ^ memory->load(operandaddress));
-		return true;
-	case VM_OPERAND_TYPE_UINT16:
-		memory->storeaddress(address, memory->loadaddress(address) ^ memory->loadaddress(operandaddress));
-		return true;
-	case VM_OPERAND_TYPE_UINT32:
-		memory->storeunsigned(address, memory->loadunsigned(address) ^ memory->loadunsigned(operandaddress));
-		return true;
-	case VM_OPERAND_TYPE_DEC:
-	default:
-		statuscode |= VM_ERROR_UNSUPPORTED_OPERAND;
-		break;
+		return !(in.optype & VM_REGISTER_OPERAND);
 	}
-	return false;
+	if(in.optype & VM_REGISTER_OPERAND)
+	{
+		return in.operand < VM_REGISTERS;
+	}
+	return verifyAddress(in.operand, in.optype);
 }
 
 /**
- * @return True if the instruction was successful.
+ * Yield points end a batch in run(). These are instructions waiting for time or events and instructions changing
+ * URL mappings or PID controllers, so other threads see their results without waiting for the whole batch.
+ * @param opcode Opcode of the executed instruction.
+ * @return True if the instruction is a yield point.
  */
-bool VM::handleLSHIFT()
+bool VM::yieldpoint(uint8_t opcode)
 {
-	uint8_t optype = get_optype();
-	uint16_t address = get_address();
-	uint16_t operandaddress = get_operandaddress(optype);
-
-	switch(optype & VM_OPTYPE_MASK)
+	switch(opcode)
 	{
-	case VM_OPERAND_TYPE_UINT8:
-		memory->store(address, memory->load(address) << memory->load(operandaddress));
-		return true;
-	case VM_OPERAND_TYPE_UINT16:
-		memory->storeaddress(address, memory->loadaddress(address) << memory->loadaddress(operandaddress));
-		return true;
-	case VM_OPERAND_TYPE_UINT32:
-		memory->storeunsigned(address, memory->loadunsigned(address) << memory->loadunsigned(operandaddress));
+	case VM_INSTRUCTION_TIME:
+	case VM_INSTRUCTION_COMPARETIME:
+	case VM_INSTRUCTION_SLEEPUNTIL:
+	case VM_INSTRUCTION_TIMECOMPARE:
+	case VM_INSTRUCTION_URLMAP:
+	case VM_INSTRUCTION_URLMAPDELETE:
+	case VM_INSTRUCTION_URLMAPWAIT:
+	case VM_INSTRUCTION_PIDINIT:
+	case VM_INSTRUCTION_PIDCLEAR:
+	case VM_INSTRUCTION_PIDSTOP:
+	case VM_INSTRUCTION_PIDRUN:
+	case VM_INSTRUCTION_PIDWAIT:
 		return true;
-	case VM_OPERAND_TYPE_DEC:
 	default:
-		statuscode |= VM_ERROR_UNSUPPORTED_OPERAND;
-		break;
+		return false;
 	}
-	return false;
 }
 
 /**
- * @return True if the instruction was successful.
+ * Collects memory access errors of the executed instruction. With exceptions memory errors are thrown and caught in run(),
+ * without exceptions (VM_NO_EXCEPTIONS) the sticky error flag of the memory is checked once per instruction.
+ * @param success Result of the instruction handler.
+ * @return True if the instruction was successful and did not cause a memory access error.
  */
-bool VM::handleRSHIFT()
+bool VM::checkerrors(bool success)
 {
-	uint8_t optype = get_optype();
-	uint16_t address = get_address();
-	uint16_t operandaddress = get_operandaddress(optype);
-
-	switch(optype & VM_OPTYPE_MASK)
+#ifdef VM_NO_EXCEPTIONS
+	if(memory->accessError())
 	{
-	case VM_OPERAND_TYPE_UINT8:
-		memory->store(address, memory->load(address) >> memory->load(operandaddress));
-		return true;
-	case VM_OPERAND_TYPE_UINT16:
-		memory->storeaddress(address, memory->loadaddress(address) >> memory->loadaddress(operandaddress));
-		return true;
-	case VM_OPERAND_TYPE_UINT32:
-		memory->storeunsigned(address, memory->loadunsigned(address) >> memory->loadunsigned(operandaddress));
-		return true;
-	case VM_OPERAND_TYPE_DEC:
-	default:
-		statuscode |= VM_ERROR_UNSUPPORTED_OPERAND;
-		break;
+		memory->clearAccessError();
+		statuscode |= VM_ERROR_MEMORY_EXCEPTION;
+		return false;
 	}
-	return false;
+#endif
+	return success;
 }
 
 /**
+ * Executes the kernel selected while decoding an arithmetic or logic instruction.
  * @return True if the instruction was successful.
  */
-bool VM::handleLOAD()
+bool VM::handleKERNEL(const vm_instruction_t& in)//opcode optype/addresstype address operand
 {
-	uint8_t optype = get_optype();
-	uint16_t address = get_address();
-	uint16_t operandaddress = get_operandaddress(optype);
-
-	switch(optype & VM_OPTYPE_MASK)
+	if(debugmode)
+	{
+		printf("optype: %02x address: %04x operandaddress: %04x\n", in.optype, in.address, in.operand);
+	}
+	if(!in.kernel)
 	{
-	case VM_OPERAND_TYPE_UINT8:
-		memory->store(address, memory->load(operandaddress));
-		return true;
-	case VM_OPERAND_TYPE_UINT16:
-		memory->storeaddress(address, memory->loadaddress(operandaddress));
-		return true;
-	case VM_OPERAND_TYPE_UINT32:
-		memory->storeunsigned(address, memory->loadunsigned(operandaddress));
-		return true;
-	case VM_OPERAND_TYPE_DEC:
-		memory->storerational(address, memory->loadrational(operandaddress));
-		return true;
-	default:
 		statuscode |= VM_ERROR_UNSUPPORTED_OPERAND;
-		break;
+		return false;
 	}
-	return false;
+	return in.kernel(this, in);
 }
 
 /**
  * @return True if the instruction was successful.
  */
-bool VM::handleMULTILOAD()
+bool VM::handleMULTILOAD(const vm_instruction_t& in)
 {
+	(void) in;
 	uint8_t optype = get_optype();
 	uint16_t address = get_address();
 	uint8_t count = get_number();
 	uint16_t operandaddress = 0;
+	bool literal = (optype & VM_ADDRESS_MASK) == VM_LITERAL;//literal operands are read from the code
+	uint8_t width = 0;
 
 	switch(optype & VM_OPTYPE_MASK)
 	{
+	case VM_OPERAND_TYPE_UINT8:		width = sizeof(uint8_t);	break;
+	case VM_OPERAND_TYPE_UINT16:	width = sizeof(uint16_t);	break;
+	case VM_OPERAND_TYPE_UINT32:	width = sizeof(uint32_t);	break;
+	case VM_OPERAND_TYPE_DEC:		width = sizeof(rational_t);	break;
+	default:						break;
+	}
+	if(literal && width > 0)
+	{//literals are stored like the values in the memory, the operand list is copied as one block
+		memory->copyCode(programcounter + 1, count * width, address);
+		programcounter += count * width;
+		return true;
+	}
+
+	switch(optype & VM_OPTYPE_MASK)
+	{//operands at addresses
 	case VM_OPERAND_TYPE_UINT8:
 		for(uint8_t i = 0; i < count; i++)
 		{
@@ -649,27 +1956,37 @@ bool VM::handleMULTILOAD()
 /**
  * @return True if the instruction was successful.
  */
-bool VM::handlePUSH()
+bool VM::handlePUSH(const vm_instruction_t& in)
 {
-	return false;
+	if(!in.kernel)
+	{
+		statuscode |= VM_ERROR_UNSUPPORTED_OPERAND;
+		return false;
+	}
+	return in.kernel(this, in);
 }
 
 /**
  * @return True if the instruction was successful.
  */
-bool VM::handlePOP()
+bool VM::handlePOP(const vm_instruction_t& in)
 {
-	return false;
+	if(!in.kernel)
+	{
+		statuscode |= VM_ERROR_UNSUPPORTED_OPERAND;
+		return false;
+	}
+	return in.kernel(this, in);
 }
 
 /**
  * @return True if the instruction was successful.
  */
-bool VM::handleCOPY()
+bool VM::handleCOPY(const vm_instruction_t& in)
 {
-	uint16_t srcaddress = get_address();
-	uint8_t len = get_number();
-	uint16_t destaddress = get_address();
+	uint16_t srcaddress = in.address;
+	uint8_t len = in.literal;
+	uint16_t destaddress = in.operand;
 
 	memory->copy(srcaddress, len, destaddress);
 	return true;
@@ -678,113 +1995,59 @@ bool VM::handleCOPY()
 /**
  * @return True if the instruction was successful.
  */
-bool VM::handleJUMP()
+bool VM::handleJUMP(const vm_instruction_t& in)
 {
-	uint8_t optype = get_optype();//nur für addresse oder literal, immer 16bit adresse
-	uint16_t operandaddress = get_operandaddress(optype | VM_OPERAND_TYPE_UINT16);
-	programcounter = memory->load(operandaddress);
+	if((in.optype & VM_ADDRESS_MASK) == VM_LITERAL)
+	{
+		programcounter = in.literal;
+	}
+	else
+	{
+		programcounter = memory->loadaddress(in.operand);
+	}
 	return true;
 }
 
 /**
  * @return True if the instruction was successful.
  */
-bool VM::handleCOMPARE()//überarbeiten
+bool VM::handleCOMPARE(const vm_instruction_t& in)
 {
-	uint8_t optype = get_optype();
-	uint16_t address = get_address();
-	uint16_t operandaddress = get_operandaddress(optype);
-
-	//jumpaddressen immer als OPERAND_TYPE_UINT16, nur literal od address interassant
-	uint16_t jumpsmaller = get_operandaddress(optype | VM_LITERAL | VM_OPERAND_TYPE_UINT16);
-	uint16_t jumpequal = get_operandaddress(optype | VM_LITERAL | VM_OPERAND_TYPE_UINT16);
-	uint16_t jumpgreater = get_operandaddress(optype | VM_LITERAL | VM_OPERAND_TYPE_UINT16);
-	int8_t compare = 0;
-	switch(optype & VM_OPTYPE_MASK)
+	if(!in.kernel)
 	{
-	case VM_OPERAND_TYPE_UINT8:
-		{//scope for initialization
-			uint8_t value1 = memory->load(address);
-			uint8_t value2 = memory->load(operandaddress);
-			if(value1 < value2)
-			{
-				compare = -1;
-			}
-			else if(value1 > value2)
-			{
-				compare = 1;
-			}
-		}
-		break;
-	case VM_OPERAND_TYPE_UINT16:
-		{//scope for initialization
-			uint16_t value1 = memory->loadaddress(address);
-			uint16_t value2 = memory->loadaddress(operandaddress);
-			if(value1 < value2)
-			{
-				compare = -1;
-			}
-			else if(value1 > value2)
-			{
-				compare = 1;
-			}
-		}
-		break;
-	case VM_OPERAND_TYPE_UINT32:
-		{//scope for initialization
-			uint32_t value1 = memory->loadunsigned(address);
-			uint32_t value2 = memory->loadunsigned(operandaddress);
-			if(value1 < value2)
-			{
-				compare = -1;
-			}
-			else if(value1 > value2)
-			{
-				compare = 1;
-			}
-		}
-		break;
-	case VM_OPERAND_TYPE_DEC:
-		{
-			rational_t value1 = memory->loadrational(address);
-			rational_t value2 = memory->loadrational(operandaddress);
-			if(value1 < value2)
-			{
-				compare = -1;
-			}
-			else if(value1 > value2)
-			{
-				compare = 1;
-			}
-		}
-		break;
-	default:
 		statuscode |= VM_ERROR_UNSUPPORTED_OPERAND;
 		return false;
 	}
-	switch(compare)
+	return in.kernel(this, in);
+}
+
+/**
+ * @return True if the instruction was successful.
+ */
+bool VM::handleCALL(const vm_instruction_t& in)
+{
+	if(stack.isFull())
 	{
-	case -1:
-		programcounter = memory->loadaddress(jumpsmaller);
-		return true;
-	case 0:
-		programcounter = memory->loadaddress(jumpequal);
-		return true;
-	case 1:
-		programcounter = memory->loadaddress(jumpgreater);
-		return true;
-	default:
+		statuscode |= VM_ERROR_STACK;
 		return false;
 	}
+	stack.push(in.next);
+	programcounter = in.address;
+	return true;
 }
 
 /**
  * @return True if the instruction was successful.
  */
-bool VM::handleCALL()
+bool VM::handleRETURN(const vm_instruction_t& in)
 {
-	uint16_t address = get_address();
-	stack.push(++programcounter);
+	(void) in;
+	if(stack.isEmpty())
+	{
+		statuscode |= VM_ERROR_STACK;
+		return false;
+	}
+	uint16_t address = stack.pop();
 	programcounter = address;
 	return true;
 }
@@ -792,58 +2055,76 @@ bool VM::handleCALL()
 /**
  * @return True if the instruction was successful.
  */
-bool VM::handleRETURN()
+bool VM::handleTIME(const vm_instruction_t& in)
 {
-	uint16_t address = stack.pop();
-	programcounter = address;
+	memory->storeunsigned(in.address, xtimer_now());//WARNING time is Systemtime in µs
 	return true;
 }
 
 /**
  * @return True if the instruction was successful.
  */
-bool VM::handleTIME()
+bool VM::handleCOMPARETIME(const vm_instruction_t& in)
 {
-	uint16_t address = get_address();
-	memory->storeunsigned(address, xtimer_now());//WARNING time is Systemtime in µs
+	if(xtimer_now() - memory->loadunsigned(in.address) >= (in.literal * 1000))
+	{//compare in ns because xtimer_now is in ns, stored time in ms (ns overflows after 1.19h, only for short timers)
+		programcounter = in.jump[0];
+	}
+	else
+	{
+		programcounter = in.jump[1];
+	}
 	return true;
 }
 
 /**
+ * Stores the CPU time like TIME and compares it like COMPARETIME, both use the same time.
  * @return True if the instruction was successful.
  */
-bool VM::handleCOMPARETIME()
+bool VM::handleTIMECOMPARE(const vm_instruction_t& in)
 {
-	uint16_t address = get_address();
-	uint16_t timeout = get_operandaddress(VM_OPERAND_TYPE_UINT32 | VM_LITERAL);
-	uint16_t jump1 = get_address();
-	uint16_t jump2 = get_address();
-	if(xtimer_now() - memory->loadunsigned(address) >= (memory->loadunsigned(timeout) * 1000))
-	{//compare in ns because xtimer_now is in ns, stored time in ms (ns overflows after 1.19h, only for short timers)
-		programcounter = jump1;
+	uint32_t now = xtimer_now();
+	memory->storeunsigned(in.address, now);
+	if(now - memory->loadunsigned(in.operand) >= (in.literal * 1000))
+	{
+		programcounter = in.jump[0];
 	}
 	else
 	{
-		programcounter = jump2;
+		programcounter = in.jump[1];
 	}
 	return true;
 }
 
+/**
+ * Sets the VM waiting until the time stored at the address plus the timeout (ms) passed. Continues with the
+ * next batch if the time already passed, so the instruction can replace a COMPARETIME polling loop.
+ * @return True if the instruction was successful.
+ */
+bool VM::handleSLEEPUNTIL(const vm_instruction_t& in)
+{
+	waitvalue = memory->loadunsigned(in.address);
+	waittimeout = in.literal * 1000;//stored time in µs, timeout in ms (like COMPARETIME)
+	wait(VM_WAIT_TIME);
+	return true;
+}
+
 /**
  * @return True if the instruction was successful.
  */
-bool VM::handleURLMAP()
+bool VM::handleURLMAP(const vm_instruction_t& in)
 {
+	(void) in;
 	uint8_t optype = get_optype();
+	uint16_t id = get_mapid(optype);
 	uint8_t map_options = get_optype();//also a uint8_t value;
-	uint8_t id = VM_OPTYPE_ID(optype);
 	uint16_t value_address = get_address();//Adresse an der der wert abgerufen, gespeichet werden soll
 	uint16_t port = get_address();//port als uint16_t angegeben
 	uint16_t url_address = NO_MAPPING;
 	if((map_options & VM_MAP_OPTION_URL_MASK) == VM_MAP_OPTION_URL_LITERAL)
 	{
 		url_address = get_operandaddress(VM_LITERAL | VM_OPERAND_TYPE_UINT8);//Anfang des URL strings ist im befehl
-		while(memory->load(++programcounter) != 0x00);
+		while(memory->loadcode(++programcounter) != 0x00);
 	}
 	else
 	{
@@ -854,43 +2135,75 @@ bool VM::handleURLMAP()
 	if((map_options & VM_MAP_OPTION_RESOURCE_MASK) == VM_MAP_OPTION_RESOURCE_LITERAL)
 	{
 		resource_address = get_operandaddress(VM_LITERAL | VM_OPERAND_TYPE_UINT8);//Anfang des resource strings
-		while(memory->load(++programcounter) != 0x00);
+		while(memory->loadcode(++programcounter) != 0x00);
 	}
 	else
 	{
 		resource_address = get_operandaddress(VM_ADDRESS);//Anfang des resource strings
 	}
-	memory->map(id, optype, map_options, value_address, port, url_address, resource_address);
+	if(id >= memory->getMapSize())
+	{
+		statuscode |= VM_ERROR_ID_UNAVAILABLE;
+		return false;
+	}
+	if(!memory->map(id, VM_OPTYPE_IS_WIDE_ID(optype) ? optype & ~VM_OPTYPE_WIDE_ID : optype, map_options, value_address, port, url_address, resource_address))
+	{
+		statuscode |= VM_ERROR_MAP_POOL;
+		return false;
+	}
 	return true;
-//	return false;
 }
 
 /**
  * @return True if the instruction was successful.
  */
-bool VM::handleURLMAPCHECK()
+bool VM::handleURLMAPCHECK(const vm_instruction_t& in)
 {
-	uint8_t id = VM_OPTYPE_ID(get_optype());
-	uint16_t address = get_address();
-	memory->store(address, memory->checkmap(id));
+	memory->store(in.address, memory->checkmap(in.id));
 	return true;
 }
 
 /**
  * @return True if the instruction was successful.
  */
-bool VM::handleURLMAPDELETE()
+bool VM::handleURLMAPDELETE(const vm_instruction_t& in)
 {
-	uint8_t id = VM_OPTYPE_ID(get_optype());
-	memory->unmap(id);
+	memory->unmap(in.id);
+	return true;
+}
+
+/**
+ * Stores the status of the URL-Map like URLMAPCHECK and compares it with the COMPARE kernel selected while decoding.
+ * @return True if the instruction was successful.
+ */
+bool VM::handleURLMAPCOMPARE(const vm_instruction_t& in)
+{
+	memory->store(in.address, memory->checkmap(in.id));
+	return in.kernel(this, in);
+}
+
+/**
+ * Sets the VM waiting until the URL-Map is done or failed (the gcoap client signals the response).
+ * @return True if the instruction was successful.
+ */
+bool VM::handleURLMAPWAIT(const vm_instruction_t& in)
+{
+	if(in.id >= memory->getMapSize())
+	{
+		statuscode |= VM_ERROR_ID_UNAVAILABLE;
+		return false;
+	}
+	waitid = in.id;
+	wait(VM_WAIT_MAP);
 	return true;
 }
 
 /**
  * @return True if the instruction was successful.
  */
-bool VM::handlePIDINIT()
+bool VM::handlePIDINIT(const vm_instruction_t& in)
 {
+	(void) in;
 	uint8_t id = VM_OPTYPE_ID(get_optype());
 	if(id >= VM_PID_NUM_AVAILABLE)
 	{
@@ -908,9 +2221,9 @@ bool VM::handlePIDINIT()
 	uint16_t upperLimit_address = get_operandaddress(VM_LITERAL | VM_OPERAND_TYPE_DEC);
 	uint16_t direction_address = get_operandaddress(VM_LITERAL | VM_OPERAND_TYPE_UINT8);
 	if(!pids[id].init(memory, input_address, output_address, setpoint_address,
-			memory->loadrational(kp_address), memory->loadrational(ki_address), memory->loadrational(kd_address),
-			memory->loadunsigned(sampleTime_address), memory->load(direction_address),
-			memory->loadrational(lowerLimit_address), memory->loadrational(upperLimit_address)))
+			decimalliteral(kp_address), decimalliteral(ki_address), decimalliteral(kd_address),
+			memory->loadcodeunsigned(sampleTime_address), memory->loadcode(direction_address),
+			decimalliteral(lowerLimit_address), decimalliteral(upperLimit_address)))
 	{
 		statuscode |= VM_ERROR_PID_INIT;
 		return false;
@@ -921,9 +2234,9 @@ bool VM::handlePIDINIT()
 /**
  * @return True if the instruction was successful.
  */
-bool VM::handlePIDCLEAR()
+bool VM::handlePIDCLEAR(const vm_instruction_t& in)
 {
-	uint8_t id = VM_OPTYPE_ID(get_optype());
+	uint8_t id = VM_OPTYPE_ID(in.optype);
 	if(id >= VM_PID_NUM_AVAILABLE)
 	{
 		statuscode |= VM_ERROR_ID_UNAVAILABLE;
@@ -936,9 +2249,9 @@ bool VM::handlePIDCLEAR()
 /**
  * @return True if the instruction was successful.
  */
-bool VM::handlePIDSTOP()
+bool VM::handlePIDSTOP(const vm_instruction_t& in)
 {
-	uint8_t id = VM_OPTYPE_ID(get_optype());
+	uint8_t id = VM_OPTYPE_ID(in.optype);
 	if(id >= VM_PID_NUM_AVAILABLE)
 	{
 		statuscode |= VM_ERROR_ID_UNAVAILABLE;
@@ -951,9 +2264,9 @@ bool VM::handlePIDSTOP()
 /**
  * @return True if the instruction was successful.
  */
-bool VM::handlePIDRUN()
+bool VM::handlePIDRUN(const vm_instruction_t& in)
 {
-	uint8_t id = VM_OPTYPE_ID(get_optype());
+	uint8_t id = VM_OPTYPE_ID(in.optype);
 	if(id >= VM_PID_NUM_AVAILABLE)
 	{
 		statuscode |= VM_ERROR_ID_UNAVAILABLE;
@@ -963,11 +2276,30 @@ bool VM::handlePIDRUN()
 	return true;
 }
 
+/**
+ * Sets the VM waiting until the PID computed a new output (the PID thread signals the computation).
+ * @return True if the instruction was successful.
+ */
+bool VM::handlePIDWAIT(const vm_instruction_t& in)
+{
+	uint8_t id = VM_OPTYPE_ID(in.optype);
+	if(id >= VM_PID_NUM_AVAILABLE)
+	{
+		statuscode |= VM_ERROR_ID_UNAVAILABLE;
+		return false;
+	}
+	waitid = id;
+	waitvalue = pids[id].getComputations();
+	wait(VM_WAIT_PID);
+	return true;
+}
+
 /**
  * @return True if the instruction was successful.
  */
-bool VM::handleHALT()
+bool VM::handleHALT(const vm_instruction_t& in)
 {
+	(void) in;
 	flags |= VM_FLAG_HALTED;
 	return true;
 }
@@ -975,11 +2307,14 @@ bool VM::handleHALT()
  * @return always returns false, therefore the halt flag will be set. Clears Memory and Stack.
  */
 
-bool VM::handleRESET()
+bool VM::handleRESET(const vm_instruction_t& in)
 {
+	(void) in;
 	statuscode |= VM_ERROR_RESET;
 	memory->clear();
 	stack.clear();
+	operands.clear();
+	memset(registers, 0, sizeof(registers));
 	for(uint8_t i = 0; i < VM_PID_NUM_AVAILABLE; i++)
 	{
 		pids[i].clear();
@@ -987,12 +2322,22 @@ bool VM::handleRESET()
 	return false;
 }
 
+/**
+ * @return always returns false, the instruction is not defined in Opcodes.h.
+ */
+bool VM::handleUNSUPPORTED(const vm_instruction_t& in)
+{
+	(void) in;
+	statuscode |= VM_ERROR_UNSUPPORTED_OPERATION;
+	return false;
+}
+
 /**
  * @return Optype coded in the instruction bytecode.
  */
 inline uint8_t VM::get_optype()
 {
-	return memory->load(++programcounter);
+	return memory->loadcode(++programcounter);
 }
 
 /**
@@ -1000,7 +2345,7 @@ inline uint8_t VM::get_optype()
  */
 inline uint8_t VM::get_number()
 {
-	return memory->load(++programcounter);
+	return memory->loadcode(++programcounter);
 }
 
 /**
@@ -1008,11 +2353,38 @@ inline uint8_t VM::get_number()
  */
 inline uint16_t VM::get_address()
 {
-	uint16_t temp = memory->loadaddress(++programcounter);
+	uint16_t temp = memory->loadcodeaddress(++programcounter);
 	++programcounter;
 	return temp;
 }
 
+/**
+ * @param optype OPTYPE of the URL-Map instruction.
+ * @return ID of the URL-Map, 16Bit operand if the OPTYPE holds VM_OPTYPE_WIDE_ID, coded inside the OPTYPE otherwise.
+ */
+inline uint16_t VM::get_mapid(uint8_t optype)
+{
+	return VM_OPTYPE_IS_WIDE_ID(optype) ? get_address() : VM_OPTYPE_ID(optype);
+}
+
+/**
+ * @param optype OPTYPE of the instruction.
+ * @return Destination coded in the instruction bytecode, register number (8Bit) if VM_REGISTER_DESTINATION is set, address otherwise.
+ */
+inline uint16_t VM::get_destination(uint8_t optype)
+{
+	return (optype & VM_REGISTER_DESTINATION) ? get_number() : get_address();
+}
+
+/**
+ * @param optype OPTYPE of the instruction.
+ * @return Operand coded in the instruction bytecode, register number (8Bit) if VM_REGISTER_OPERAND is set for an address operand, see get_operandaddress(uint8_t) otherwise.
+ */
+inline uint16_t VM::get_source(uint8_t optype)
+{
+	return ((optype & VM_REGISTER_OPERAND) && (optype & VM_ADDRESS_MASK) == VM_ADDRESS) ? get_number() : get_operandaddress(optype);
+}
+
 /**
  * @return Address of the operand coded in the instruction bytecode. Depends on Optype (literal or address), programcounter will be set to according to the datatype.
  */
@@ -1050,3 +2422,12 @@ inline uint16_t VM::get_operandaddress(uint8_t optype)
 	return operandaddress;
 }
 
+/**
+ * @param address Address of a decimal literal in the code.
+ * @return Decimal literal.
+ */
+inline rational_t VM::decimalliteral(uint16_t address)
+{
+	return operand_type<rational_t>::fromliteral(memory->loadcodeunsigned(address));
+}
+
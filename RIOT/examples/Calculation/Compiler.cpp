@@ -0,0 +1,1696 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Implementation of Compiler
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+#include "Compiler.h"
+
+#ifdef VM_TOOLCHAIN
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+///Weight of the uses of a variable inside a loop relative to the enclosing code
+#define COMPILER_LOOP_WEIGHT		(8)
+///Code address of the URL string in a URLMAP instruction (opcode, optype, map options, value address, port)
+#define COMPILER_MAP_URL_OFFSET		(7)
+///Additional offset of the URL string if the ID of the map follows the OPTYPE (VM_OPTYPE_WIDE_ID)
+#define COMPILER_MAP_WIDE_OFFSET	(2)
+
+/**
+ * Binary operator of an expression.
+ */
+typedef struct {
+	const char* op;
+	///Precedence, 0 binds weakest
+	uint8_t level;
+	uint8_t opcode;
+} compiler_operator_t;
+
+static const compiler_operator_t operators[] = {
+		{"|", 0, VM_INSTRUCTION_OR}, {"^", 1, VM_INSTRUCTION_XOR}, {"&", 2, VM_INSTRUCTION_AND},
+		{"<<", 3, VM_INSTRUCTION_LSHIFT}, {">>", 3, VM_INSTRUCTION_RSHIFT},
+		{"+", 4, VM_INSTRUCTION_ADD}, {"-", 4, VM_INSTRUCTION_SUB},
+		{"*", 5, VM_INSTRUCTION_MUL}, {"/", 5, VM_INSTRUCTION_DIV}, {"%", 5, VM_INSTRUCTION_MOD}
+};
+///Precedence of the operators which bind strongest
+#define COMPILER_LEVELS				(5)
+
+static const compiler_operator_t assignments[] = {
+		{"=", 0, VM_INSTRUCTION_LOAD}, {"+=", 0, VM_INSTRUCTION_ADD}, {"-=", 0, VM_INSTRUCTION_SUB},
+		{"*=", 0, VM_INSTRUCTION_MUL}, {"/=", 0, VM_INSTRUCTION_DIV}, {"%=", 0, VM_INSTRUCTION_MOD},
+		{"&=", 0, VM_INSTRUCTION_AND}, {"|=", 0, VM_INSTRUCTION_OR}, {"^=", 0, VM_INSTRUCTION_XOR},
+		{"<<=", 0, VM_INSTRUCTION_LSHIFT}, {">>=", 0, VM_INSTRUCTION_RSHIFT}
+};
+
+static const compiler_operator_t relations[] = {
+		{"<", 0, COMPILER_LESS}, {"<=", 0, COMPILER_LESS | COMPILER_EQUAL}, {"==", 0, COMPILER_EQUAL},
+		{"!=", 0, COMPILER_LESS | COMPILER_GREATER}, {">=", 0, COMPILER_EQUAL | COMPILER_GREATER},
+		{">", 0, COMPILER_GREATER}
+};
+
+///Operators of the lexer, longest first
+static const char* const symbols[] = {
+		"<<=", ">>=", "<<", ">>", "<=", ">=", "==", "!=", "+=", "-=", "*=", "/=", "%=", "&=", "|=", "^="
+};
+
+static const char* const keywords[] = {
+		"var", "const", "map", "pid", "if", "else", "while", "sleep", "halt", "client", "server",
+		"get", "post", "put", "once", "ever", "port", "u8", "u16", "u32", "dec"
+};
+
+///Ranks of the types, a variable with a higher rank holds all values of a lower rank
+#define COMPILER_RANK_NONE			(0)
+#define COMPILER_RANK_UINT8			(1)
+#define COMPILER_RANK_UINT16		(2)
+#define COMPILER_RANK_UINT32		(3)
+#define COMPILER_RANK_DEC			(4)
+
+/**
+ * @param type Type (VM_OPERAND_TYPE_*) or COMPILER_TYPE_UNKNOWN.
+ * @return Rank of the type.
+ */
+static uint8_t typerank(uint8_t type)
+{
+	switch(type)
+	{
+	case VM_OPERAND_TYPE_UINT8:		return COMPILER_RANK_UINT8;
+	case VM_OPERAND_TYPE_UINT16:	return COMPILER_RANK_UINT16;
+	case VM_OPERAND_TYPE_UINT32:	return COMPILER_RANK_UINT32;
+	case VM_OPERAND_TYPE_DEC:		return COMPILER_RANK_DEC;
+	default:						return COMPILER_RANK_NONE;
+	}
+}
+
+/**
+ * @param rank Rank.
+ * @return Type of the rank, uint8 for COMPILER_RANK_NONE.
+ */
+static uint8_t ranktype(uint8_t rank)
+{
+	switch(rank)
+	{
+	case COMPILER_RANK_UINT16:		return VM_OPERAND_TYPE_UINT16;
+	case COMPILER_RANK_UINT32:		return VM_OPERAND_TYPE_UINT32;
+	case COMPILER_RANK_DEC:			return VM_OPERAND_TYPE_DEC;
+	default:						return VM_OPERAND_TYPE_UINT8;
+	}
+}
+
+/**
+ * @param value Constant.
+ * @return Rank of the smallest type which holds the constant.
+ */
+static uint8_t constantrank(double value)
+{
+	if(value < 0 || value != floor(value))
+	{
+		return COMPILER_RANK_DEC;
+	}
+	if(value <= UINT8_MAX)
+	{
+		return COMPILER_RANK_UINT8;
+	}
+	return value <= UINT16_MAX ? COMPILER_RANK_UINT16 : COMPILER_RANK_UINT32;
+}
+
+/**
+ * @param value Constant.
+ * @return True if the constant is an unsigned 32Bit integer.
+ */
+static bool integer(double value)
+{
+	return value >= 0 && value <= UINT32_MAX && value == floor(value);
+}
+
+/**
+ * @param kind Kind of the operand (ASSEMBLER_OPERAND_*).
+ * @param value Value of the operand.
+ * @param symbol Symbol of the operand.
+ * @return Operand.
+ */
+static asm_operand_t operand(uint8_t kind, double value, uint16_t symbol = ASSEMBLER_NO_SYMBOL)
+{
+	asm_operand_t o;
+	o.kind = kind;
+	o.symbol = symbol;
+	o.value = value;
+	o.string = 0;
+	o.length = 0;
+	return o;
+}
+
+/**
+ * @param string Characters.
+ * @param length Number of characters.
+ * @return String operand.
+ */
+static asm_operand_t string(const char* string, uint8_t length)
+{
+	asm_operand_t o = operand(ASSEMBLER_OPERAND_STRING, 0);
+	o.string = string;
+	o.length = length;
+	return o;
+}
+
+/**
+ * @param code Buffer for the bytecode.
+ * @param size Size of the buffer in Bytes.
+ */
+Compiler::Compiler(uint8_t* code, uint16_t size) : assembler(code, size)
+{
+	registers = VM_REGISTERS;
+	nodecount = 0;
+	variablecount = 0;
+	mapcount = 0;
+	pidcount = 0;
+	depth = 0;
+	temporaries = 0;
+	memorytemporaries = 0;
+	labelcount = 0;
+	timesymbol = ASSEMBLER_NO_SYMBOL;
+	cursor = 0;
+	line = 0;
+	memset(&token, 0, sizeof(token));
+}
+
+/**
+ * Compiles a program, every Compiler translates one program.
+ * @param source Program, terminated with 0.
+ * @return Size of the bytecode in Bytes, 0 on errors (see getError() and getLine()).
+ */
+uint16_t Compiler::compile(const char* source)
+{
+	cursor = source;
+	line = 1;
+	next();
+	uint16_t program = parseblock(false);
+	if(failed())
+	{
+		return 0;
+	}
+
+	bool changed = true;
+	uint32_t weight = 1;
+	while(changed && !failed())
+	{
+		changed = false;
+		infer(program, weight, &changed);
+		weight = 0;
+	}
+	for(uint16_t i = 0; i < variablecount; i++)
+	{
+		if(variables[i].type == COMPILER_TYPE_UNKNOWN)
+		{
+			variables[i].type = VM_OPERAND_TYPE_UINT8;
+		}
+	}
+	if(failed() || !allocate() || !statements(program))
+	{
+		return 0;
+	}
+	uint16_t last = program;
+	while(last != COMPILER_NO_NODE && nodes[last].next != COMPILER_NO_NODE)
+	{
+		last = nodes[last].next;
+	}
+	if(last == COMPILER_NO_NODE || nodes[last].kind != COMPILER_NODE_HALT)
+	{
+		if(!assembler.instruction(VM_INSTRUCTION_HALT, 0, 0, 0))
+		{
+			return 0;
+		}
+	}
+	return assembler.finish();
+}
+
+/**
+ * @param name Name of a variable in memory.
+ * @return Address of the variable after compile(), NO_MAPPING for variables in registers.
+ */
+uint16_t Compiler::getAddress(const char* name)
+{
+	uint16_t variable = find(name, strlen(name));
+	if(variable == COMPILER_NO_NODE || variables[variable].reg != COMPILER_NO_REGISTER)
+	{
+		return NO_MAPPING;
+	}
+	return assembler.getAddress(name);
+}
+
+/**
+ * @param name Name of a variable.
+ * @return Register of the variable, COMPILER_NO_REGISTER for variables in memory.
+ */
+uint8_t Compiler::getRegister(const char* name)
+{
+	uint16_t variable = find(name, strlen(name));
+	return variable == COMPILER_NO_NODE ? COMPILER_NO_REGISTER : variables[variable].reg;
+}
+
+/**
+ * @param name Name of a variable.
+ * @return Type of the variable (VM_OPERAND_TYPE_*), COMPILER_TYPE_UNKNOWN for unknown names.
+ */
+uint8_t Compiler::getType(const char* name)
+{
+	uint16_t variable = find(name, strlen(name));
+	return variable == COMPILER_NO_NODE ? COMPILER_TYPE_UNKNOWN : variables[variable].type;
+}
+
+/**
+ * Records the first error at the current line.
+ * @return False.
+ */
+bool Compiler::fail(const char* message, const char* name, uint8_t length)
+{
+	return assembler.fail(message, name, length);
+}
+
+/**
+ * Reads the next token, skips blanks and comments.
+ */
+void Compiler::next(void)
+{
+	while(true)
+	{
+		while(*cursor && isspace((unsigned char) *cursor))
+		{
+			if(*cursor == '\n')
+			{
+				line++;
+			}
+			cursor++;
+		}
+		if(cursor[0] == '/' && cursor[1] == '/')
+		{
+			while(*cursor && *cursor != '\n')
+			{
+				cursor++;
+			}
+			continue;
+		}
+		break;
+	}
+	assembler.setLine(line);
+	token.start = cursor;
+	token.length = 0;
+	token.op[0] = '\0';
+	token.value = 0;
+	if(!*cursor)
+	{
+		token.kind = 'e';
+		return;
+	}
+	if(isalpha((unsigned char) *cursor) || *cursor == '_')
+	{
+		while(isalnum((unsigned char) *cursor) || *cursor == '_')
+		{
+			cursor++;
+		}
+		token.kind = 'n';
+		token.length = (uint8_t) (cursor - token.start < UINT8_MAX ? cursor - token.start : UINT8_MAX);
+		return;
+	}
+	if(isdigit((unsigned char) *cursor) || (*cursor == '.' && isdigit((unsigned char) cursor[1])))
+	{
+		char* end;
+		if(cursor[0] == '0' && (cursor[1] == 'x' || cursor[1] == 'X'))
+		{
+			token.value = (double) strtoul(cursor, &end, 16);
+		}
+		else
+		{
+			token.value = strtod(cursor, &end);
+		}
+		cursor = end;
+		if(isalnum((unsigned char) *cursor) || *cursor == '_')
+		{
+			fail("invalid number");
+		}
+		token.kind = '0';
+		return;
+	}
+	if(*cursor == '"')
+	{
+		token.start = ++cursor;
+		while(*cursor && *cursor != '"' && *cursor != '\n')
+		{
+			cursor++;
+		}
+		if(*cursor != '"' || cursor - token.start > UINT8_MAX)
+		{
+			fail("invalid string");
+			token.kind = 'e';
+			return;
+		}
+		token.kind = '"';
+		token.length = (uint8_t) (cursor - token.start);
+		cursor++;
+		return;
+	}
+	token.kind = 'o';
+	for(uint8_t i = 0; i < sizeof(symbols) / sizeof(symbols[0]); i++)
+	{
+		size_t length = strlen(symbols[i]);
+		if(strncmp(cursor, symbols[i], length) == 0)
+		{
+			memcpy(token.op, symbols[i], length + 1);
+			token.length = (uint8_t) length;
+			cursor += length;
+			return;
+		}
+	}
+	token.op[0] = *cursor++;
+	token.op[1] = '\0';
+	token.length = 1;
+}
+
+/**
+ * @param op Operator.
+ * @return True if the token is the operator, the next token is read.
+ */
+bool Compiler::accept(const char* op)
+{
+	if(token.kind == 'o' && strcmp(token.op, op) == 0)
+	{
+		next();
+		return true;
+	}
+	return false;
+}
+
+/**
+ * @param word Keyword.
+ * @return True if the token is the keyword, the next token is read.
+ */
+bool Compiler::keyword(const char* word)
+{
+	if(token.kind == 'n' && strlen(word) == token.length && strncmp(token.start, word, token.length) == 0)
+	{
+		next();
+		return true;
+	}
+	return false;
+}
+
+/**
+ * @param op Operator.
+ * @return True if the token is the operator, records an error otherwise.
+ */
+bool Compiler::expect(const char* op)
+{
+	return accept(op) || fail("expected", op, strlen(op));
+}
+
+/**
+ * Reads a name.
+ * @param start Start of the name.
+ * @param length Length of the name.
+ * @return True if the token is a name.
+ */
+bool Compiler::name(const char** start, uint8_t* length)
+{
+	if(token.kind != 'n')
+	{
+		return fail("name expected");
+	}
+	*start = token.start;
+	*length = token.length;
+	next();
+	return true;
+}
+
+/**
+ * Reads an expression which is folded to a number.
+ * @param value Number.
+ * @return True if the expression is constant.
+ */
+bool Compiler::constantexpression(double* value)
+{
+	uint16_t expression = parseexpression(0);
+	if(expression == COMPILER_NO_NODE)
+	{
+		return false;
+	}
+	if(nodes[expression].kind != COMPILER_NODE_NUMBER)
+	{
+		return fail("constant expected");
+	}
+	*value = nodes[expression].value;
+	return true;
+}
+
+/**
+ * @param kind Kind of the node.
+ * @return New node at the current line, COMPILER_NO_NODE if the program is too large.
+ */
+uint16_t Compiler::node(uint8_t kind)
+{
+	if(nodecount >= COMPILER_NODES)
+	{
+		fail("program too large");
+		return COMPILER_NO_NODE;
+	}
+	compiler_node_t* n = &nodes[nodecount];
+	n->kind = kind;
+	n->op = 0;
+	n->left = COMPILER_NO_NODE;
+	n->right = COMPILER_NO_NODE;
+	n->extra = COMPILER_NO_NODE;
+	n->next = COMPILER_NO_NODE;
+	n->variable = COMPILER_NO_NODE;
+	n->line = line;
+	n->value = 0;
+	return nodecount++;
+}
+
+/**
+ * @param name Name of a variable or constant.
+ * @param length Length of the name.
+ * @return Index of the variable, COMPILER_NO_NODE if it is not declared.
+ */
+uint16_t Compiler::find(const char* name, uint8_t length)
+{
+	for(uint16_t i = 0; i < variablecount; i++)
+	{
+		if(strncmp(variables[i].name, name, length) == 0 && variables[i].name[length] == '\0')
+		{
+			return i;
+		}
+	}
+	return COMPILER_NO_NODE;
+}
+
+/**
+ * Declares a variable of unknown type.
+ * @param name Name of the variable.
+ * @param length Length of the name.
+ * @return Index of the variable, COMPILER_NO_NODE on errors.
+ */
+uint16_t Compiler::declare(const char* name, uint8_t length)
+{
+	if(length > ASSEMBLER_SYMBOL_LENGTH)
+	{
+		fail("name too long:", name, length);
+		return COMPILER_NO_NODE;
+	}
+	for(uint8_t i = 0; i < sizeof(keywords) / sizeof(keywords[0]); i++)
+	{
+		if(strlen(keywords[i]) == length && strncmp(keywords[i], name, length) == 0)
+		{
+			fail("keyword used as name:", name, length);
+			return COMPILER_NO_NODE;
+		}
+	}
+	if(find(name, length) != COMPILER_NO_NODE)
+	{
+		fail("declared twice:", name, length);
+		return COMPILER_NO_NODE;
+	}
+	if(variablecount >= COMPILER_VARIABLES)
+	{
+		fail("too many variables");
+		return COMPILER_NO_NODE;
+	}
+	compiler_variable_t* v = &variables[variablecount];
+	memcpy(v->name, name, length);
+	v->name[length] = '\0';
+	v->constant = false;
+	v->value = 0;
+	v->type = COMPILER_TYPE_UNKNOWN;
+	v->typed = false;
+	v->fixed = false;
+	v->address = 0;
+	v->memory = false;
+	v->reg = COMPILER_NO_REGISTER;
+	v->uses = 0;
+	v->symbol = ASSEMBLER_NO_SYMBOL;
+	return variablecount++;
+}
+
+/**
+ * Reads statements.
+ * @param braces True for a block in braces or a single statement, false for the program.
+ * @return First statement, COMPILER_NO_NODE for empty blocks.
+ */
+uint16_t Compiler::parseblock(bool braces)
+{
+	if(braces && !accept("{"))
+	{
+		return parsestatement();
+	}
+	uint16_t first = COMPILER_NO_NODE;
+	uint16_t last = COMPILER_NO_NODE;
+	while(!failed())
+	{
+		if(braces && accept("}"))
+		{
+			break;
+		}
+		if(token.kind == 'e')
+		{
+			if(braces)
+			{
+				fail("'}' expected");
+			}
+			break;
+		}
+		uint16_t statement = parsestatement();
+		if(statement != COMPILER_NO_NODE)
+		{
+			if(last == COMPILER_NO_NODE)
+			{
+				first = statement;
+			}
+			else
+			{
+				nodes[last].next = statement;
+			}
+			last = statement;
+		}
+	}
+	return first;
+}
+
+/**
+ * @return Statement, COMPILER_NO_NODE for declarations without code and on errors.
+ */
+uint16_t Compiler::parsestatement(void)
+{
+	if(keyword("var"))
+	{
+		return parsevar();
+	}
+	if(keyword("const"))
+	{
+		return parseconst();
+	}
+	if(keyword("map"))
+	{
+		return parsemap();
+	}
+	if(keyword("pid"))
+	{
+		return parsepid();
+	}
+	if(keyword("if"))
+	{
+		uint16_t n = node(COMPILER_NODE_IF);
+		if(n == COMPILER_NO_NODE || !expect("("))
+		{
+			return COMPILER_NO_NODE;
+		}
+		nodes[n].left = parsecondition();
+		if(!expect(")"))
+		{
+			return COMPILER_NO_NODE;
+		}
+		nodes[n].right = parseblock(true);
+		if(keyword("else"))
+		{
+			nodes[n].extra = parseblock(true);
+		}
+		return n;
+	}
+	if(keyword("while"))
+	{
+		uint16_t n = node(COMPILER_NODE_WHILE);
+		if(n == COMPILER_NO_NODE || !expect("("))
+		{
+			return COMPILER_NO_NODE;
+		}
+		nodes[n].left = parsecondition();
+		if(!expect(")"))
+		{
+			return COMPILER_NO_NODE;
+		}
+		nodes[n].right = parseblock(true);
+		return n;
+	}
+	if(keyword("sleep"))
+	{
+		uint16_t n = node(COMPILER_NODE_SLEEP);
+		if(n == COMPILER_NO_NODE || !expect("("))
+		{
+			return COMPILER_NO_NODE;
+		}
+		nodes[n].left = parseexpression(0);
+		if(!expect(")") || !expect(";"))
+		{
+			return COMPILER_NO_NODE;
+		}
+		return n;
+	}
+	if(keyword("halt"))
+	{
+		uint16_t n = node(COMPILER_NODE_HALT);
+		return expect(";") ? n : COMPILER_NO_NODE;
+	}
+	if(accept(";"))
+	{
+		return COMPILER_NO_NODE;
+	}
+	return parseassign();
+}
+
+/**
+ * var name [: type] [@ address] [= expression];
+ * @return Assignment of the initial value, COMPILER_NO_NODE without initial value.
+ */
+uint16_t Compiler::parsevar(void)
+{
+	const char* start = 0;
+	uint8_t length = 0;
+	if(!name(&start, &length))
+	{
+		return COMPILER_NO_NODE;
+	}
+	uint16_t variable = declare(start, length);
+	if(variable == COMPILER_NO_NODE)
+	{
+		return COMPILER_NO_NODE;
+	}
+	compiler_variable_t* v = &variables[variable];
+	if(accept(":"))
+	{
+		v->typed = true;
+		if(keyword("u8"))			v->type = VM_OPERAND_TYPE_UINT8;
+		else if(keyword("u16"))		v->type = VM_OPERAND_TYPE_UINT16;
+		else if(keyword("u32"))		v->type = VM_OPERAND_TYPE_UINT32;
+		else if(keyword("dec"))		v->type = VM_OPERAND_TYPE_DEC;
+		else
+		{
+			fail("type expected");
+			return COMPILER_NO_NODE;
+		}
+	}
+	if(accept("@"))
+	{
+		double address;
+		if(!constantexpression(&address))
+		{
+			return COMPILER_NO_NODE;
+		}
+		if(!integer(address) || address > UINT16_MAX)
+		{
+			fail("invalid address");
+			return COMPILER_NO_NODE;
+		}
+		v->fixed = true;
+		v->memory = true;
+		v->address = (uint16_t) address;
+	}
+	uint16_t n = COMPILER_NO_NODE;
+	if(accept("="))
+	{
+		n = node(COMPILER_NODE_ASSIGN);
+		if(n == COMPILER_NO_NODE)
+		{
+			return COMPILER_NO_NODE;
+		}
+		nodes[n].variable = variable;
+		nodes[n].left = parseexpression(0);
+	}
+	return expect(";") ? n : COMPILER_NO_NODE;
+}
+
+/**
+ * const name = expression;
+ * @return COMPILER_NO_NODE.
+ */
+uint16_t Compiler::parseconst(void)
+{
+	const char* start = 0;
+	uint8_t length = 0;
+	double value;
+	if(!name(&start, &length))
+	{
+		return COMPILER_NO_NODE;
+	}
+	uint16_t variable = declare(start, length);
+	if(variable != COMPILER_NO_NODE && expect("=") && constantexpression(&value) && expect(";"))
+	{
+		variables[variable].constant = true;
+		variables[variable].value = value;
+	}
+	return COMPILER_NO_NODE;
+}
+
+/**
+ * map name client|server get|post|put [once|ever] [host] resource [port number];
+ * @return URLMAP statement.
+ */
+uint16_t Compiler::parsemap(void)
+{
+	const char* start = 0;
+	uint8_t length = 0;
+	if(!name(&start, &length))
+	{
+		return COMPILER_NO_NODE;
+	}
+	uint16_t variable = find(start, length);
+	if(variable == COMPILER_NO_NODE || variables[variable].constant)
+	{
+		fail("variable expected:", start, length);
+		return COMPILER_NO_NODE;
+	}
+	if(mapcount >= VM_MEMORY_MAP_SIZE)
+	{
+		fail("too many maps");
+		return COMPILER_NO_NODE;
+	}
+	compiler_map_t* map = &maps[mapcount];
+	map->variable = variable;
+	map->port = 0;
+	map->url = 0;
+	map->urllength = 0;
+	if(keyword("client"))			map->options = VM_MAP_OPTION_DIRECTION_CLIENT;
+	else if(keyword("server"))		map->options = VM_MAP_OPTION_DIRECTION_SERVER;
+	else
+	{
+		fail("client or server expected");
+		return COMPILER_NO_NODE;
+	}
+	if(keyword("get"))				map->options |= VM_MAP_OPTION_METHOD_GET;
+	else if(keyword("post"))		map->options |= VM_MAP_OPTION_METHOD_POST;
+	else if(keyword("put"))			map->options |= VM_MAP_OPTION_METHOD_PUT;
+	else
+	{
+		fail("get, post or put expected");
+		return COMPILER_NO_NODE;
+	}
+	if(!keyword("once"))
+	{
+		keyword("ever");
+		map->options |= VM_MAP_OPTION_LIFETIME_EVER;
+	}
+	if(token.kind != '"')
+	{
+		fail("resource expected");
+		return COMPILER_NO_NODE;
+	}
+	map->resource = token.start;
+	map->resourcelength = token.length;
+	next();
+	if(token.kind == '"')
+	{
+		map->url = map->resource;
+		map->urllength = map->resourcelength;
+		map->resource = token.start;
+		map->resourcelength = token.length;
+		next();
+	}
+	if((map->options & VM_MAP_OPTION_DIRECTION_MASK) == VM_MAP_OPTION_DIRECTION_CLIENT && !map->url)
+	{
+		fail("client maps need a host");
+		return COMPILER_NO_NODE;
+	}
+	if(keyword("port"))
+	{
+		double port;
+		if(!constantexpression(&port))
+		{
+			return COMPILER_NO_NODE;
+		}
+		if(!integer(port) || port > UINT16_MAX)
+		{
+			fail("invalid port");
+			return COMPILER_NO_NODE;
+		}
+		map->port = (uint16_t) port;
+	}
+	uint16_t n = node(COMPILER_NODE_MAP);
+	if(n == COMPILER_NO_NODE || !expect(";"))
+	{
+		return COMPILER_NO_NODE;
+	}
+	variables[variable].memory = true;
+	nodes[n].variable = mapcount++;
+	return n;
+}
+
+/**
+ * pid(input, output, setpoint, kp, ki, kd, sampletime, lower, upper [, direction]);
+ * @return PIDINIT and PIDRUN statement.
+ */
+uint16_t Compiler::parsepid(void)
+{
+	if(pidcount >= VM_PID_NUM_AVAILABLE)
+	{
+		fail("too many PID controllers");
+		return COMPILER_NO_NODE;
+	}
+	compiler_pid_t* pid = &pids[pidcount];
+	uint16_t* io[3] = {&pid->input, &pid->output, &pid->setpoint};
+	if(!expect("("))
+	{
+		return COMPILER_NO_NODE;
+	}
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		const char* start = 0;
+		uint8_t length = 0;
+		if((i > 0 && !expect(",")) || !name(&start, &length))
+		{
+			return COMPILER_NO_NODE;
+		}
+		uint16_t variable = find(start, length);
+		if(variable == COMPILER_NO_NODE || variables[variable].constant)
+		{
+			fail("variable expected:", start, length);
+			return COMPILER_NO_NODE;
+		}
+		compiler_variable_t* v = &variables[variable];
+		if(v->typed && v->type != VM_OPERAND_TYPE_DEC)
+		{
+			fail("PID variables must be dec:", start, length);
+			return COMPILER_NO_NODE;
+		}
+		v->typed = true;
+		v->type = VM_OPERAND_TYPE_DEC;
+		v->memory = true;
+		*io[i] = variable;
+	}
+	pid->parameters[6] = 0;
+	for(uint8_t i = 0; i < 7; i++)
+	{
+		if(i == 6 && !accept(","))
+		{
+			break;
+		}
+		if((i < 6 && !expect(",")) || !constantexpression(&pid->parameters[i]))
+		{
+			return COMPILER_NO_NODE;
+		}
+	}
+	uint16_t n = node(COMPILER_NODE_PID);
+	if(n == COMPILER_NO_NODE || !expect(")") || !expect(";"))
+	{
+		return COMPILER_NO_NODE;
+	}
+	nodes[n].variable = pidcount++;
+	return n;
+}
+
+/**
+ * name op= expression;
+ * @return Assignment.
+ */
+uint16_t Compiler::parseassign(void)
+{
+	const char* start = 0;
+	uint8_t length = 0;
+	if(!name(&start, &length))
+	{
+		return COMPILER_NO_NODE;
+	}
+	uint16_t variable = find(start, length);
+	if(variable == COMPILER_NO_NODE)
+	{
+		fail("undeclared variable:", start, length);
+		return COMPILER_NO_NODE;
+	}
+	if(variables[variable].constant)
+	{
+		fail("constant assigned:", start, length);
+		return COMPILER_NO_NODE;
+	}
+	int16_t opcode = -1;
+	for(uint8_t i = 0; i < sizeof(assignments) / sizeof(assignments[0]) && opcode < 0; i++)
+	{
+		if(accept(assignments[i].op))
+		{
+			opcode = assignments[i].opcode;
+		}
+	}
+	if(opcode < 0)
+	{
+		fail("assignment expected");
+		return COMPILER_NO_NODE;
+	}
+	uint16_t n = node(COMPILER_NODE_ASSIGN);
+	uint16_t expression = parseexpression(0);
+	if(n == COMPILER_NO_NODE || expression == COMPILER_NO_NODE || !expect(";"))
+	{
+		return COMPILER_NO_NODE;
+	}
+	if(opcode != VM_INSTRUCTION_LOAD)
+	{
+		uint16_t self = node(COMPILER_NODE_VARIABLE);
+		if(self == COMPILER_NO_NODE)
+		{
+			return COMPILER_NO_NODE;
+		}
+		nodes[self].variable = variable;
+		expression = binary((uint8_t) opcode, self, expression);
+	}
+	nodes[n].variable = variable;
+	nodes[n].left = expression;
+	return n;
+}
+
+/**
+ * expression relation expression
+ * @return Condition.
+ */
+uint16_t Compiler::parsecondition(void)
+{
+	uint16_t n = node(COMPILER_NODE_CONDITION);
+	if(n == COMPILER_NO_NODE)
+	{
+		return COMPILER_NO_NODE;
+	}
+	nodes[n].left = parseexpression(0);
+	for(uint8_t i = 0; i < sizeof(relations) / sizeof(relations[0]) && !nodes[n].op; i++)
+	{
+		if(accept(relations[i].op))
+		{
+			nodes[n].op = relations[i].opcode;
+		}
+	}
+	if(!nodes[n].op)
+	{
+		fail("comparison expected");
+		return COMPILER_NO_NODE;
+	}
+	nodes[n].right = parseexpression(0);
+	return failed() ? COMPILER_NO_NODE : n;
+}
+
+/**
+ * Reads the binary operators of a precedence and all which bind stronger.
+ * @param level Precedence.
+ * @return Expression.
+ */
+uint16_t Compiler::parseexpression(uint8_t level)
+{
+	if(level > COMPILER_LEVELS)
+	{
+		return parseunary();
+	}
+	uint16_t left = parseexpression(level + 1);
+	while(!failed() && token.kind == 'o')
+	{
+		int16_t opcode = -1;
+		for(uint8_t i = 0; i < sizeof(operators) / sizeof(operators[0]); i++)
+		{
+			if(operators[i].level == level && strcmp(operators[i].op, token.op) == 0)
+			{
+				opcode = operators[i].opcode;
+			}
+		}
+		if(opcode < 0)
+		{
+			break;
+		}
+		next();
+		left = binary((uint8_t) opcode, left, parseexpression(level + 1));
+	}
+	return failed() ? COMPILER_NO_NODE : left;
+}
+
+/**
+ * Reads -x, ~x, (expression), numbers, constants and variables.
+ * @return Expression.
+ */
+uint16_t Compiler::parseunary(void)
+{
+	if(accept("-"))
+	{
+		uint16_t zero = node(COMPILER_NODE_NUMBER);
+		return binary(VM_INSTRUCTION_SUB, zero, parseunary());
+	}
+	if(accept("~"))
+	{
+		uint16_t n = node(COMPILER_NODE_NOT);
+		if(n != COMPILER_NO_NODE)
+		{
+			nodes[n].left = parseunary();
+		}
+		return failed() ? COMPILER_NO_NODE : n;
+	}
+	if(accept("("))
+	{
+		uint16_t expression = parseexpression(0);
+		return expect(")") ? expression : COMPILER_NO_NODE;
+	}
+	if(token.kind == '0')
+	{
+		uint16_t n = node(COMPILER_NODE_NUMBER);
+		if(n != COMPILER_NO_NODE)
+		{
+			nodes[n].value = token.value;
+		}
+		next();
+		return n;
+	}
+	const char* start = 0;
+	uint8_t length = 0;
+	if(!name(&start, &length))
+	{
+		return COMPILER_NO_NODE;
+	}
+	uint16_t variable = find(start, length);
+	if(variable == COMPILER_NO_NODE)
+	{
+		fail("undeclared variable:", start, length);
+		return COMPILER_NO_NODE;
+	}
+	uint16_t n = node(variables[variable].constant ? COMPILER_NODE_NUMBER : COMPILER_NODE_VARIABLE);
+	if(n != COMPILER_NO_NODE)
+	{
+		nodes[n].variable = variable;
+		nodes[n].value = variables[variable].value;
+	}
+	return n;
+}
+
+/**
+ * Creates left op right, folds numbers.
+ * @param opcode Opcode of the operation.
+ * @param left Left operand.
+ * @param right Right operand.
+ * @return Expression.
+ */
+uint16_t Compiler::binary(uint8_t opcode, uint16_t left, uint16_t right)
+{
+	if(left == COMPILER_NO_NODE || right == COMPILER_NO_NODE || failed())
+	{
+		return COMPILER_NO_NODE;
+	}
+	if(nodes[left].kind != COMPILER_NODE_NUMBER || nodes[right].kind != COMPILER_NODE_NUMBER)
+	{
+		uint16_t n = node(COMPILER_NODE_BINARY);
+		if(n != COMPILER_NO_NODE)
+		{
+			nodes[n].op = opcode;
+			nodes[n].left = left;
+			nodes[n].right = right;
+		}
+		return n;
+	}
+	double a = nodes[left].value;
+	double b = nodes[right].value;
+	bool integers = integer(a) && integer(b);
+	double result;
+	switch(opcode)
+	{
+	case VM_INSTRUCTION_ADD:	result = a + b;		break;
+	case VM_INSTRUCTION_SUB:	result = a - b;		break;
+	case VM_INSTRUCTION_MUL:	result = a * b;		break;
+	case VM_INSTRUCTION_DIV:
+		if(b == 0)
+		{
+			fail("division by zero");
+			return COMPILER_NO_NODE;
+		}
+		result = integers ? floor(a / b) : a / b;
+		break;
+	default:
+		if(!integers || (opcode == VM_INSTRUCTION_MOD && b == 0))
+		{
+			fail("invalid constant operation");
+			return COMPILER_NO_NODE;
+		}
+		switch(opcode)
+		{
+		case VM_INSTRUCTION_MOD:	result = (uint32_t) a % (uint32_t) b;				break;
+		case VM_INSTRUCTION_AND:	result = (uint32_t) a & (uint32_t) b;				break;
+		case VM_INSTRUCTION_OR:		result = (uint32_t) a | (uint32_t) b;				break;
+		case VM_INSTRUCTION_XOR:	result = (uint32_t) a ^ (uint32_t) b;				break;
+		case VM_INSTRUCTION_LSHIFT:	result = b < 32 ? (uint32_t) ((uint32_t) a << (uint32_t) b) : 0;	break;
+		default:					result = b < 32 ? (uint32_t) a >> (uint32_t) b : 0;	break;
+		}
+		break;
+	}
+	nodes[left].value = result;
+	nodes[left].variable = COMPILER_NO_NODE;
+	return left;
+}
+
+/**
+ * @param expression Expression.
+ * @return Rank of the widest variable or constant of the expression.
+ */
+uint8_t Compiler::rank(uint16_t expression)
+{
+	const compiler_node_t& n = nodes[expression];
+	switch(n.kind)
+	{
+	case COMPILER_NODE_NUMBER:		return constantrank(n.value);
+	case COMPILER_NODE_VARIABLE:	return typerank(variables[n.variable].type);
+	case COMPILER_NODE_NOT:			return rank(n.left);
+	default:
+	{
+		uint8_t left = rank(n.left);
+		uint8_t right = rank(n.right);
+		return left > right ? left : right;
+	}
+	}
+}
+
+/**
+ * Widens the variables without declared type of an expression.
+ * @param expression Expression.
+ * @param rank Rank the variables need.
+ * @param changed Set if a type changed.
+ * @return True.
+ */
+bool Compiler::widen(uint16_t expression, uint8_t rank, bool* changed)
+{
+	const compiler_node_t& n = nodes[expression];
+	switch(n.kind)
+	{
+	case COMPILER_NODE_NUMBER:
+		return true;
+	case COMPILER_NODE_VARIABLE:
+	{
+		compiler_variable_t* v = &variables[n.variable];
+		if(!v->typed && typerank(v->type) < rank)
+		{
+			v->type = ranktype(rank);
+			*changed = true;
+		}
+		return true;
+	}
+	case COMPILER_NODE_NOT:
+		return widen(n.left, rank, changed);
+	default:
+		return widen(n.left, rank, changed) && widen(n.right, rank, changed);
+	}
+}
+
+/**
+ * Adds the weight to the uses of the variables of an expression.
+ * @param expression Expression.
+ * @param weight Weight of the uses.
+ */
+void Compiler::count(uint16_t expression, uint32_t weight)
+{
+	const compiler_node_t& n = nodes[expression];
+	switch(n.kind)
+	{
+	case COMPILER_NODE_NUMBER:
+		break;
+	case COMPILER_NODE_VARIABLE:
+		variables[n.variable].uses += weight;
+		break;
+	case COMPILER_NODE_NOT:
+		count(n.left, weight);
+		break;
+	default:
+		count(n.left, weight);
+		count(n.right, weight);
+		break;
+	}
+}
+
+/**
+ * Infers the types of variables without declared type and counts the uses.
+ * @param statement First statement of a block.
+ * @param weight Weight of the uses, 0 to skip counting.
+ * @param changed Set if a type changed.
+ * @return True.
+ */
+bool Compiler::infer(uint16_t statement, uint32_t weight, bool* changed)
+{
+	for(uint16_t s = statement; s != COMPILER_NO_NODE; s = nodes[s].next)
+	{
+		const compiler_node_t& n = nodes[s];
+		switch(n.kind)
+		{
+		case COMPILER_NODE_ASSIGN:
+		{
+			compiler_variable_t* v = &variables[n.variable];
+			uint8_t r = rank(n.left);
+			if(!v->typed && typerank(v->type) < r)
+			{
+				v->type = ranktype(r);
+				*changed = true;
+			}
+			v->uses += weight;
+			count(n.left, weight);
+			break;
+		}
+		case COMPILER_NODE_IF:
+		case COMPILER_NODE_WHILE:
+		{
+			uint32_t inner = n.kind == COMPILER_NODE_WHILE && weight < (1ul << 24) ? weight * COMPILER_LOOP_WEIGHT : weight;
+			const compiler_node_t& c = nodes[n.left];
+			uint8_t left = rank(c.left);
+			uint8_t right = rank(c.right);
+			uint8_t r = left > right ? left : right;
+			widen(c.left, r, changed);
+			widen(c.right, r, changed);
+			count(c.left, inner);
+			count(c.right, inner);
+			infer(n.right, inner, changed);
+			infer(n.extra, weight, changed);
+			break;
+		}
+		case COMPILER_NODE_SLEEP:
+			count(n.left, weight);
+			break;
+		default:
+			break;
+		}
+	}
+	return true;
+}
+
+/**
+ * Assigns registers to the most used variables and defines the other variables in the assembler.
+ * @return True if all variables were defined.
+ */
+bool Compiler::allocate(void)
+{
+	temporaries = registers < COMPILER_TEMPORARIES ? registers : COMPILER_TEMPORARIES;
+	for(uint8_t r = 0; r < registers - temporaries; r++)
+	{
+		uint16_t best = COMPILER_NO_NODE;
+		for(uint16_t i = 0; i < variablecount; i++)
+		{
+			const compiler_variable_t& v = variables[i];
+			if(!v.constant && !v.memory && v.reg == COMPILER_NO_REGISTER && v.uses > 0
+					&& (best == COMPILER_NO_NODE || v.uses > variables[best].uses))
+			{
+				best = i;
+			}
+		}
+		if(best == COMPILER_NO_NODE)
+		{
+			break;
+		}
+		variables[best].reg = r;
+	}
+	for(uint16_t i = 0; i < variablecount; i++)
+	{
+		compiler_variable_t* v = &variables[i];
+		if(v->constant || v->reg != COMPILER_NO_REGISTER)
+		{
+			continue;
+		}
+		v->symbol = assembler.symbol(v->name, strlen(v->name));
+		if(v->symbol == ASSEMBLER_NO_SYMBOL || !assembler.variable(v->symbol, v->type, v->fixed, v->address))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @param variable Variable.
+ * @return Register or address operand of the variable.
+ */
+asm_operand_t Compiler::location(uint16_t variable)
+{
+	const compiler_variable_t& v = variables[variable];
+	if(v.reg != COMPILER_NO_REGISTER)
+	{
+		return operand(ASSEMBLER_OPERAND_REGISTER, v.reg);
+	}
+	return operand(ASSEMBLER_OPERAND_ADDRESS, 0, v.symbol);
+}
+
+/**
+ * Reserves an intermediate result, the highest free register or 4 Bytes of memory. Released by restoring depth.
+ * @param operand Register or address operand.
+ * @return True if an intermediate result was left.
+ */
+bool Compiler::temporary(asm_operand_t* operand)
+{
+	if(depth >= COMPILER_DEPTH)
+	{
+		return fail("expression too complex");
+	}
+	if(depth < temporaries)
+	{
+		*operand = ::operand(ASSEMBLER_OPERAND_REGISTER, registers - 1 - depth);
+		depth++;
+		return true;
+	}
+	char name[8];
+	uint8_t index = depth - temporaries;
+	snprintf(name, sizeof(name), "$t%u", index);
+	uint16_t symbol = assembler.symbol(name, strlen(name));
+	if(symbol == ASSEMBLER_NO_SYMBOL)
+	{
+		return false;
+	}
+	if(index >= memorytemporaries)
+	{
+		if(!assembler.variable(symbol, VM_OPERAND_TYPE_UINT32, false, 0))
+		{
+			return false;
+		}
+		memorytemporaries = index + 1;
+	}
+	*operand = ::operand(ASSEMBLER_OPERAND_ADDRESS, 0, symbol);
+	depth++;
+	return true;
+}
+
+/**
+ * Emits an instruction with a destination and a source operand.
+ * @return True if the instruction was emitted.
+ */
+bool Compiler::emit(uint8_t opcode, uint8_t type, const asm_operand_t& first, const asm_operand_t& second)
+{
+	asm_operand_t operands[2] = {first, second};
+	return assembler.instruction(opcode, type, operands, 2);
+}
+
+/**
+ * @param variable Variable.
+ * @param type Type of the operation.
+ * @return True if the variable is read as the type without conversion (registers hold zero extended values, wider
+ * 		variables in memory are truncated by reading their lower Bytes).
+ */
+bool Compiler::direct(uint16_t variable, uint8_t type)
+{
+	const compiler_variable_t& v = variables[variable];
+	if((v.type == VM_OPERAND_TYPE_DEC) != (type == VM_OPERAND_TYPE_DEC))
+	{
+		return false;
+	}
+	return v.type == type || v.reg != COMPILER_NO_REGISTER || Assembler::typesize(v.type) > Assembler::typesize(type);
+}
+
+/**
+ * Loads a variable converted to a type.
+ * @param destination Register or address.
+ * @param type Type of the destination.
+ * @param variable Variable.
+ * @return True if the variable was loaded.
+ */
+bool Compiler::load(const asm_operand_t& destination, uint8_t type, uint16_t variable)
+{
+	const compiler_variable_t& v = variables[variable];
+	if((v.type == VM_OPERAND_TYPE_DEC) != (type == VM_OPERAND_TYPE_DEC))
+	{
+		return fail("dec and integer mixed:", v.name, strlen(v.name));
+	}
+	if(direct(variable, type))
+	{
+		return emit(VM_INSTRUCTION_LOAD, type, destination, location(variable));
+	}
+	//narrower variable in memory, zero extended in a register
+	if(destination.kind == ASSEMBLER_OPERAND_REGISTER)
+	{
+		return emit(VM_INSTRUCTION_LOAD, v.type, destination, location(variable));
+	}
+	uint8_t saved = depth;
+	asm_operand_t t;
+	bool success = temporary(&t);
+	if(success && t.kind == ASSEMBLER_OPERAND_ADDRESS)
+	{
+		success = emit(VM_INSTRUCTION_LOAD, VM_OPERAND_TYPE_UINT32, t, operand(ASSEMBLER_OPERAND_LITERAL, 0));
+	}
+	success = success && emit(VM_INSTRUCTION_LOAD, v.type, t, location(variable))
+			&& emit(VM_INSTRUCTION_LOAD, type, destination, t);
+	depth = saved;
+	return success;
+}
+
+/**
+ * Provides an expression as source operand, literal, variable or intermediate result.
+ * @param expression Expression.
+ * @param destinationvariable Variable which is overwritten before the operand is read (copied).
+ * @param type Type of the operation.
+ * @param operand Operand.
+ * @return True if the operand was provided.
+ */
+bool Compiler::source(uint16_t expression, uint16_t destinationvariable, uint8_t type, asm_operand_t* operand)
+{
+	const compiler_node_t& n = nodes[expression];
+	if(n.kind == COMPILER_NODE_NUMBER)
+	{
+		*operand = ::operand(ASSEMBLER_OPERAND_LITERAL, n.value);
+		return true;
+	}
+	if(n.kind == COMPILER_NODE_VARIABLE && n.variable != destinationvariable && direct(n.variable, type))
+	{
+		*operand = location(n.variable);
+		return true;
+	}
+	return temporary(operand) && generate(*operand, COMPILER_NO_NODE, type, expression);
+}
+
+/**
+ * Computes an expression into a destination.
+ * @param destination Register or address.
+ * @param destinationvariable Variable of the destination, COMPILER_NO_NODE for intermediate results.
+ * @param type Type of the operations.
+ * @param expression Expression.
+ * @return True if the code was emitted.
+ */
+bool Compiler::generate(const asm_operand_t& destination, uint16_t destinationvariable, uint8_t type, uint16_t expression)
+{
+	const compiler_node_t& n = nodes[expression];
+	switch(n.kind)
+	{
+	case COMPILER_NODE_NUMBER:
+		return emit(VM_INSTRUCTION_LOAD, type, destination, operand(ASSEMBLER_OPERAND_LITERAL, n.value));
+	case COMPILER_NODE_VARIABLE:
+		return n.variable == destinationvariable || load(destination, type, n.variable);
+	case COMPILER_NODE_NOT:
+		if(type == VM_OPERAND_TYPE_DEC)
+		{
+			return fail("~ is not defined for dec");
+		}
+		return generate(destination, destinationvariable, type, n.left)
+				&& assembler.instruction(VM_INSTRUCTION_NOT, type, &destination, 1);
+	default:
+		break;
+	}
+	if(type == VM_OPERAND_TYPE_DEC && n.op != VM_INSTRUCTION_ADD && n.op != VM_INSTRUCTION_SUB
+			&& n.op != VM_INSTRUCTION_MUL && n.op != VM_INSTRUCTION_DIV && n.op != VM_INSTRUCTION_MOD)
+	{
+		return fail("bit operations are not defined for dec");
+	}
+	uint16_t left = n.left;
+	uint16_t right = n.right;
+	bool commutative = n.op == VM_INSTRUCTION_ADD || n.op == VM_INSTRUCTION_MUL || n.op == VM_INSTRUCTION_AND
+			|| n.op == VM_INSTRUCTION_OR || n.op == VM_INSTRUCTION_XOR;
+	if(commutative && nodes[right].kind == COMPILER_NODE_VARIABLE && nodes[right].variable == destinationvariable)
+	{
+		left = n.right;
+		right = n.left;
+	}
+	uint8_t saved = depth;
+	asm_operand_t src;
+	//the source is computed first, it may read the destination variable
+	bool success = source(right, destinationvariable, type, &src);
+	if(success && !(nodes[left].kind == COMPILER_NODE_VARIABLE && nodes[left].variable == destinationvariable))
+	{
+		success = generate(destination, destinationvariable, type, left);
+	}
+	success = success && emit(n.op, type, destination, src);
+	depth = saved;
+	return success;
+}
+
+/**
+ * Emits a COMPARE which jumps to the true or false label.
+ * @param expression Condition.
+ * @param truelabel Symbol of the label jumped to if the condition holds.
+ * @param falselabel Symbol of the label jumped to otherwise.
+ * @return True if the code was emitted.
+ */
+bool Compiler::condition(uint16_t expression, uint16_t truelabel, uint16_t falselabel)
+{
+	const compiler_node_t& n = nodes[expression];
+	uint16_t left = n.left;
+	uint16_t right = n.right;
+	uint8_t relation = n.op;
+	if(nodes[left].kind == COMPILER_NODE_NUMBER && nodes[right].kind == COMPILER_NODE_NUMBER)
+	{
+		double a = nodes[left].value;
+		double b = nodes[right].value;
+		uint8_t outcome = a < b ? COMPILER_LESS : (a == b ? COMPILER_EQUAL : COMPILER_GREATER);
+		asm_operand_t target = operand(ASSEMBLER_OPERAND_LABEL, 0, (relation & outcome) ? truelabel : falselabel);
+		return assembler.instruction(VM_INSTRUCTION_JUMP, 0, &target, 1);
+	}
+	if(nodes[left].kind == COMPILER_NODE_NUMBER)
+	{
+		left = n.right;
+		right = n.left;
+		relation = (relation & COMPILER_EQUAL) | ((relation & COMPILER_LESS) << 2) | ((relation & COMPILER_GREATER) >> 2);
+	}
+	uint8_t leftrank = rank(left);
+	uint8_t rightrank = rank(right);
+	uint8_t type = ranktype(leftrank > rightrank ? leftrank : rightrank);
+
+	uint8_t saved = depth;
+	asm_operand_t operands[5];
+	bool success;
+	if(nodes[left].kind == COMPILER_NODE_VARIABLE && direct(nodes[left].variable, type))
+	{
+		operands[0] = location(nodes[left].variable);
+		success = true;
+	}
+	else
+	{
+		success = temporary(&operands[0]) && generate(operands[0], COMPILER_NO_NODE, type, left);
+	}
+	success = success && source(right, COMPILER_NO_NODE, type, &operands[1]);
+	operands[2] = operand(ASSEMBLER_OPERAND_LABEL, 0, (relation & COMPILER_LESS) ? truelabel : falselabel);
+	operands[3] = operand(ASSEMBLER_OPERAND_LABEL, 0, (relation & COMPILER_EQUAL) ? truelabel : falselabel);
+	operands[4] = operand(ASSEMBLER_OPERAND_LABEL, 0, (relation & COMPILER_GREATER) ? truelabel : falselabel);
+	success = success && assembler.instruction(VM_INSTRUCTION_COMPARE, type, operands, 5);
+	depth = saved;
+	return success;
+}
+
+/**
+ * @return Symbol of a new label.
+ */
+uint16_t Compiler::newlabel(void)
+{
+	char name[8];
+	snprintf(name, sizeof(name), "$L%u", labelcount++);
+	return assembler.symbol(name, strlen(name));
+}
+
+/**
+ * Emits a block.
+ * @param statement First statement.
+ * @return True if the code was emitted.
+ */
+bool Compiler::statements(uint16_t statement)
+{
+	for(uint16_t s = statement; s != COMPILER_NO_NODE; s = nodes[s].next)
+	{
+		if(!this->statement(s))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Emits one statement.
+ * @param statement Statement.
+ * @return True if the code was emitted.
+ */
+bool Compiler::statement(uint16_t statement)
+{
+	const compiler_node_t& n = nodes[statement];
+	assembler.setLine(n.line);
+	switch(n.kind)
+	{
+	case COMPILER_NODE_ASSIGN:
+		return generate(location(n.variable), n.variable, variables[n.variable].type, n.left);
+	case COMPILER_NODE_IF:
+	{
+		uint16_t truelabel = newlabel();
+		uint16_t falselabel = newlabel();
+		if(!condition(n.left, truelabel, falselabel) || !assembler.label(truelabel) || !statements(n.right))
+		{
+			return false;
+		}
+		if(n.extra == COMPILER_NO_NODE)
+		{
+			return assembler.label(falselabel);
+		}
+		uint16_t endlabel = newlabel();
+		asm_operand_t end = operand(ASSEMBLER_OPERAND_LABEL, 0, endlabel);
+		return assembler.instruction(VM_INSTRUCTION_JUMP, 0, &end, 1) && assembler.label(falselabel)
+				&& statements(n.extra) && assembler.label(endlabel);
+	}
+	case COMPILER_NODE_WHILE:
+	{
+		//the condition is placed behind the body, one jump per iteration
+		uint16_t bodylabel = newlabel();
+		uint16_t conditionlabel = newlabel();
+		uint16_t endlabel = newlabel();
+		asm_operand_t target = operand(ASSEMBLER_OPERAND_LABEL, 0, conditionlabel);
+		return assembler.instruction(VM_INSTRUCTION_JUMP, 0, &target, 1) && assembler.label(bodylabel)
+				&& statements(n.right) && assembler.label(conditionlabel)
+				&& condition(n.left, bodylabel, endlabel) && assembler.label(endlabel);
+	}
+	case COMPILER_NODE_SLEEP:
+	{
+		if(nodes[n.left].kind != COMPILER_NODE_NUMBER)
+		{
+			return fail("sleep needs a constant time");
+		}
+		if(timesymbol == ASSEMBLER_NO_SYMBOL)
+		{
+			timesymbol = assembler.symbol("$time", 5);
+			if(!assembler.variable(timesymbol, VM_OPERAND_TYPE_UINT32, false, 0))
+			{
+				return false;
+			}
+		}
+		asm_operand_t time = operand(ASSEMBLER_OPERAND_ADDRESS, 0, timesymbol);
+		return assembler.instruction(VM_INSTRUCTION_TIME, 0, &time, 1)
+				&& emit(VM_INSTRUCTION_SLEEPUNTIL, 0, time, operand(ASSEMBLER_OPERAND_LITERAL, nodes[n.left].value));
+	}
+	case COMPILER_NODE_HALT:
+		return assembler.instruction(VM_INSTRUCTION_HALT, 0, 0, 0);
+	case COMPILER_NODE_MAP:
+	{
+		const compiler_map_t& map = maps[n.variable];
+		asm_operand_t operands[6];
+		operands[0] = operand(ASSEMBLER_OPERAND_NUMBER, n.variable);
+		operands[1] = operand(ASSEMBLER_OPERAND_NUMBER, map.options);
+		operands[2] = location(map.variable);
+		operands[3] = operand(ASSEMBLER_OPERAND_NUMBER, map.port);
+		operands[4] = operand(ASSEMBLER_OPERAND_ADDRESS, NO_MAPPING);
+		if(map.url)
+		{
+			operands[4] = string(map.url, map.urllength);
+#ifndef VM_HARVARD
+			//hosts of earlier maps are shared, the URLMAP reads them from the code in memory
+			for(uint16_t i = 0; i < n.variable; i++)
+			{
+				if(maps[i].url && maps[i].urllength == map.urllength && strncmp(maps[i].url, map.url, map.urllength) == 0)
+				{
+					operands[4] = operand(ASSEMBLER_OPERAND_ADDRESS,
+							COMPILER_MAP_URL_OFFSET + (i >= VM_OPTYPE_MAP_IDS ? COMPILER_MAP_WIDE_OFFSET : 0), maplabels[i]);
+					break;
+				}
+			}
+#endif
+		}
+		operands[5] = string(map.resource, map.resourcelength);
+		maplabels[n.variable] = newlabel();
+		return assembler.label(maplabels[n.variable])
+				&& assembler.instruction(VM_INSTRUCTION_URLMAP, variables[map.variable].type, operands, 6);
+	}
+	case COMPILER_NODE_PID:
+	{
+		const compiler_pid_t& pid = pids[n.variable];
+		asm_operand_t operands[11];
+		operands[0] = operand(ASSEMBLER_OPERAND_NUMBER, n.variable);
+		operands[1] = location(pid.input);
+		operands[2] = location(pid.output);
+		operands[3] = location(pid.setpoint);
+		for(uint8_t i = 0; i < 7; i++)
+		{
+			operands[4 + i] = operand(ASSEMBLER_OPERAND_LITERAL, pid.parameters[i]);
+		}
+		return assembler.instruction(VM_INSTRUCTION_PIDINIT, 0, operands, 11)
+				&& assembler.instruction(VM_INSTRUCTION_PIDRUN, 0, operands, 1);
+	}
+	default:
+		return fail("invalid statement");
+	}
+}
+
+#endif /* VM_TOOLCHAIN */
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Implementation of InstructionCache.h
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+#include "InstructionCache.h"
+
+/**
+ * @brief Direct mapped cache of decoded instructions. Entries are tagged with the address of the instruction,
+ * the whole cache is tagged with the code version of the memory it was filled from.
+ */
+InstructionCache::InstructionCache()
+{
+	invalidate(0);
+}
+
+/**
+ * Stores a decoded instruction, replaces the instruction which used the same cache index.
+ * @param instruction Decoded instruction.
+ */
+void InstructionCache::insert(const vm_instruction_t* instruction)
+{
+	entries[index(instruction->pc)] = *instruction;
+}
+
+/**
+ * Drops all cached instructions.
+ * @param codeversion Code version the cache will be filled from.
+ */
+void InstructionCache::invalidate(uint32_t codeversion)
+{
+	for(uint16_t i = 0; i < VM_DECODE_CACHE_SIZE; i++)
+	{
+		entries[i].pc = NO_INSTRUCTION;
+	}
+	version = codeversion;
+}
+
+/**
+ *
+ * @return Number of cache entries.
+ */
+uint16_t InstructionCache::getCacheSize()
+{
+	return VM_DECODE_CACHE_SIZE;
+}
@@ -15,9 +15,32 @@
 
 
 #include <stdio.h>
-#include <stdexcept>
 
+extern "C" {
+#include "irq.h"
+#include "xtimer.h"
+}
 #include "Memory.h"
+#include "Opcodes.h"
+
+///Keeps the compiler from moving memory accesses across the sequence counter updates
+#define MEMORY_BARRIER()	__asm__ volatile("" ::: "memory")
+
+#ifdef VM_NO_EXCEPTIONS
+///Sets the sticky access error flag and leaves the accessor
+#define MEMORY_VIOLATION(message)					do { accesserror = true; return; } while(0)
+///Sets the sticky access error flag and leaves the accessor with a return value
+#define MEMORY_VIOLATION_RETURN(message, value)		do { accesserror = true; return value; } while(0)
+#else
+#include <stdexcept>
+///Throws std::range_error
+#define MEMORY_VIOLATION(message)					throw std::range_error(message)
+///Throws std::range_error
+#define MEMORY_VIOLATION_RETURN(message, value)		throw std::range_error(message)
+#endif
+
+memory_map_block_t Memory::pool[MEMORY_MAP_POOL];
+Memory* Memory::poolowners[MEMORY_MAP_POOL];
 
 /**
  * @brief Implementation of a Memory which can be used by multiple threads. Load and store operations are protected via mutex. Values will be passed by value to ensure data integrity between threads.
@@ -25,6 +48,14 @@
 Memory::Memory()
 {
 	mutex_init(&mutex);
+	codesize = 0;
+	codeimage = defaultcode();
+	codeversion = 0;
+	accesserror = false;
+	sharedsequence = 0;
+	writeepoch = 0;
+	memset(blocks, MEMORY_NO_BLOCK, sizeof(blocks));
+	mapcount = 0;
 	Memory::clear();
 }
 
@@ -37,9 +68,10 @@ void Memory::store(uint16_t address, uint8_t value)
 {
 	if(checkmemoryaddress(&address, sizeof(uint8_t)))
 	{
-		throw std::range_error("Memory access violation (store)");
+		MEMORY_VIOLATION("Memory access violation (store)");
 	}
-	this->memory[address] = value;
+	checkcodewrite(address);
+	write(address, &value, sizeof(uint8_t));
 }
 
 /**
@@ -51,9 +83,10 @@ void Memory::storeaddress(uint16_t baseaddress, uint16_t value)
 {
 	if(checkmemoryaddress(&baseaddress, sizeof(uint16_t)))
 	{
-		throw std::range_error("Memory access violation (storeaddress)");
+		MEMORY_VIOLATION("Memory access violation (storeaddress)");
 	}
-	memcpy(memory + baseaddress, &value, sizeof(uint16_t));
+	checkcodewrite(baseaddress);
+	write(baseaddress, &value, sizeof(uint16_t));
 }
 
 /**
@@ -65,9 +98,10 @@ void Memory::storerational(uint16_t baseaddress, rational_t value)
 {
 	if(checkmemoryaddress(&baseaddress, sizeof(rational_t)))
 	{
-		throw std::range_error("Memory access violation (storedecimal)");
+		MEMORY_VIOLATION("Memory access violation (storedecimal)");
 	}
-	memcpy(memory + baseaddress, &value, sizeof(rational_t));
+	checkcodewrite(baseaddress);
+	write(baseaddress, &value, sizeof(rational_t));
 }
 
 /**
@@ -79,9 +113,10 @@ void Memory::storeunsigned(uint16_t baseaddress, uint32_t value)
 {
 	if(checkmemoryaddress(&baseaddress, sizeof(uint32_t)))
 	{
-		throw std::range_error("Memory access violation (storeunsigned)");
+		MEMORY_VIOLATION("Memory access violation (storeunsigned)");
 	}
-	memcpy(memory + baseaddress, &value, sizeof(uint32_t));
+	checkcodewrite(baseaddress);
+	write(baseaddress, &value, sizeof(uint32_t));
 }
 
 /**
@@ -93,7 +128,7 @@ uint8_t Memory::load(uint16_t address)
 {
 	if(checkmemoryaddress(&address, sizeof(uint8_t)))
 	{
-		throw std::range_error("Memory access violation (load)");
+		MEMORY_VIOLATION_RETURN("Memory access violation (load)", 0);
 	}
 	return this->memory[address];
 }
@@ -107,10 +142,10 @@ uint16_t Memory::loadaddress(uint16_t baseaddress)
 {
 	if(checkmemoryaddress(&baseaddress, sizeof(uint16_t)))
 	{
-		throw std::range_error("Memory access violation (loadaddress)");
+		MEMORY_VIOLATION_RETURN("Memory access violation (loadaddress)", 0);
 	}
 	uint16_t value;
-	memcpy(&value, memory+baseaddress, sizeof(uint16_t));
+	read(baseaddress, &value, sizeof(uint16_t));
 	return value;
 }
 
@@ -123,10 +158,10 @@ rational_t Memory::loadrational(uint16_t baseaddress)
 {
 	if(checkmemoryaddress(&baseaddress, sizeof(rational_t)))
 	{
-		throw std::range_error("Memory access violation (loaddecimal)");
+		MEMORY_VIOLATION_RETURN("Memory access violation (loaddecimal)", rational_t());
 	}
 	rational_t value;
-	memcpy(&value, memory+baseaddress, sizeof(rational_t));
+	read(baseaddress, &value, sizeof(rational_t));
 	return value;
 }
 
@@ -139,10 +174,10 @@ uint32_t Memory::loadunsigned(uint16_t baseaddress)
 {
 	if(checkmemoryaddress(&baseaddress, sizeof(uint32_t)))
 	{
-		throw std::range_error("Memory access violation (loadunsigned)");
+		MEMORY_VIOLATION_RETURN("Memory access violation (loadunsigned)", 0);
 	}
 	uint32_t value;
-	memcpy(&value, memory+baseaddress, sizeof(uint32_t));
+	read(baseaddress, &value, sizeof(uint32_t));
 	return value;
 }
 
@@ -154,16 +189,341 @@ uint32_t Memory::loadunsigned(uint16_t baseaddress)
  */
 void Memory::copy(uint16_t srcaddress, uint8_t len, uint16_t destaddress)
 {
-	if(checkmemoryaddress(&srcaddress, sizeof(uint16_t)) || checkmemoryaddress(&destaddress, sizeof(uint16_t)))
+	if((uint32_t) srcaddress + len > MEMORY_SIZE || (uint32_t) destaddress + len > MEMORY_SIZE)
+	{//both ranges, isshared() and the copy access len bytes
+		MEMORY_VIOLATION("Memory access violation (copy)");
+	}
+	checkcodewrite(destaddress);
+	if(len > 0 && (isshared(srcaddress, len) || isshared(destaddress, len)))
 	{
-		throw std::range_error("Memory access violation");
+		uint8_t buffer[UINT8_MAX];
+		readshared(srcaddress, buffer, len);
+		writeshared(destaddress, buffer, len);
+		return;
 	}
+	writeepoch++;
 	memmove(memory+destaddress, memory+srcaddress, len);
+	writeepoch++;
+}
+
+/**
+ * Marks a value as shared with other threads (mapped values, PID inputs, outputs and setpoints).
+ * Multi byte accesses to shared values are protected by a sequence lock, so no thread reads a partly written value.
+ * Marks are kept until the memory is cleared.
+ * @param address Address of the value.
+ * @param size Size of the value.
+ */
+void Memory::share(uint16_t address, uint16_t size)
+{
+	markwords(sharedwords, address, size);
+}
+
+/**
+ * Marks the words of a value in a bitmap like sharedwords.
+ * @param words Bitmap of MEMORY_SHARED_MAP_SIZE Bytes.
+ * @param address Address of the value.
+ * @param size Size of the value.
+ */
+void Memory::markwords(uint8_t* words, uint16_t address, uint16_t size)
+{
+	if(size == 0 || address >= MEMORY_SIZE)
+	{
+		return;
+	}
+	uint32_t last = (uint32_t) address + size - 1;
+	if(last >= MEMORY_SIZE)
+	{
+		last = MEMORY_SIZE - 1;
+	}
+	for(uint32_t word = address / MEMORY_SHARED_WORD_SIZE; word <= last / MEMORY_SHARED_WORD_SIZE; word++)
+	{
+		words[word >> 3] |= (1 << (word & 7));
+	}
+}
+
+/**
+ * @param words Bitmap of MEMORY_SHARED_MAP_SIZE Bytes (see markwords()).
+ * @return True if every shared word is marked in the bitmap.
+ */
+bool Memory::sharedwithin(const uint8_t* words) const
+{
+	for(uint16_t i = 0; i < MEMORY_SHARED_MAP_SIZE; i++)
+	{
+		if(sharedwords[i] & ~words[i])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Reads a shared value. Retries if a write to a shared value happened during the read (sequence lock reader, never blocks).
+ * @param address Address of the value.
+ * @param value Destination of the value.
+ * @param size Size of the value.
+ */
+void Memory::readshared(uint16_t address, void* value, uint16_t size) const
+{
+	uint32_t sequence;
+	do
+	{
+		while((sequence = sharedsequence) & 1)
+		{//writer on another core
+		}
+		MEMORY_BARRIER();
+		memcpy(value, memory + address, size);
+		MEMORY_BARRIER();
+	} while(sequence != sharedsequence);
+}
+
+/**
+ * Writes a shared value (sequence lock writer). Interrupts are disabled for the write only, so writers of different
+ * threads are serialized and readers which were preempted during the write retry.
+ * @param address Address of the value.
+ * @param value Source of the value.
+ * @param size Size of the value.
+ */
+void Memory::writeshared(uint16_t address, const void* value, uint16_t size)
+{
+	unsigned state = irq_disable();
+	sharedsequence++;
+	MEMORY_BARRIER();
+	memmove(memory + address, value, size);
+	MEMORY_BARRIER();
+	for(uint32_t word = address / MEMORY_SHARED_WORD_SIZE; word <= (address + size - 1u) / MEMORY_SHARED_WORD_SIZE; word++)
+	{//mapped values are shared, so every write to them ends here (see takeDirtyWords())
+		dirtywords[word >> 3] |= (1 << (word & 7));
+	}
+	sharedsequence++;
+	irq_restore(state);
+}
+
+/**
+ * Marks the URL-Maps whose value overlaps a written range changed (called with the mutex locked, so the address index
+ * is not rebuilt and a URL-Map is not deleted by another thread meanwhile).
+ * @param address Start of the written range.
+ * @param size Size of the written range.
+ */
+void Memory::touch(uint16_t address, uint16_t size)
+{
+	uint32_t end = (uint32_t) address + size;
+	for(uint32_t candidate = address < 3 ? 0 : address - 3; candidate < end; candidate++)//values are at most 4 bytes
+	{
+		for(uint16_t slot = addressslot(candidate); addressindex[slot] != MEMORY_NO_MAP; slot = (slot + 1) & (MEMORY_INDEX_SIZE - 1))
+		{
+			uint16_t id = addressindex[slot];
+			memory_map_block_t* block = used(id);
+			uint8_t index = id % MEMORY_MAP_BLOCK;
+			if(block && block->value_address[index] == candidate && candidate + valuesize(block->optype[index]) > address)
+			{
+				block->dirty |= mapbit(id);
+			}
+		}
+	}
+}
+
+/**
+ * Takes the shared words written since the last call and marks the URL-Maps of their values changed (called with the
+ * mutex locked). The writers only set a bit per word in the sequence lock section of writeshared(), the URL-Maps
+ * of a word are looked up here by the thread which pushes the values.
+ */
+void Memory::takeDirtyWords(void)
+{
+	for(uint16_t i = 0; i < MEMORY_SHARED_MAP_SIZE; i++)
+	{
+		unsigned state = irq_disable();
+		uint8_t bits = dirtywords[i];
+		dirtywords[i] = 0;
+		irq_restore(state);
+		for(; bits && mapcount; bits &= bits - 1)
+		{
+			uint16_t word = i * 8 + __builtin_ctz(bits);
+			touch(word * MEMORY_SHARED_WORD_SIZE, MEMORY_SHARED_WORD_SIZE);
+		}
+	}
+}
+
+/**
+ * Stores a block of bytes (e.g. uploaded bytecode) with one range check.
+ * @param baseaddress Address where to store the block.
+ * @param data Bytes to store.
+ * @param len Number of bytes.
+ */
+void Memory::storeBlock(uint16_t baseaddress, const uint8_t* data, uint16_t len)
+{
+	if((uint32_t) baseaddress + len > MEMORY_SIZE)
+	{
+		MEMORY_VIOLATION("Memory access violation (storeBlock)");
+	}
+	if(len == 0)
+	{
+		return;
+	}
+	checkcodewrite(baseaddress);
+	if(isshared(baseaddress, len))
+	{
+		writeshared(baseaddress, data, len);
+		return;
+	}
+	writeepoch++;
+	memcpy(memory + baseaddress, data, len);
+	writeepoch++;
+}
+
+/**
+ * Copies code (literal operands) into the memory with one block write.
+ * @param codeaddress Code address of the first Byte.
+ * @param len Number of Bytes.
+ * @param destaddress Memory address of the first Byte.
+ */
+void Memory::copyCode(uint16_t codeaddress, uint16_t len, uint16_t destaddress)
+{
+	if((uint32_t) codeaddress + len > getCodeSegmentSize())
+	{
+		MEMORY_VIOLATION("Code access violation (copyCode)");
+	}
+	if(!codeimage && (uint32_t) codeaddress < (uint32_t) destaddress + len && (uint32_t) destaddress < (uint32_t) codeaddress + len)
+	{//code in the memory overlaps the destination, copied Byte by Byte like single stores
+		for(uint16_t i = 0; i < len; i++)
+		{
+			store(destaddress + i, memory[codeaddress + i]);
+		}
+		return;
+	}
+	storeBlock(destaddress, dumpCode() + codeaddress, len);
+}
+
+/**
+ * Stores bytecode. In Harvard mode the bytecode is stored in the code segment (a program image is detached),
+ * otherwise in the code region of the memory. Use setCodeSize() afterwards to mark the code region.
+ * @param baseaddress Address where to store the bytecode.
+ * @param data Bytecode.
+ * @param len Number of bytes.
+ * @return True if the bytecode was stored, false if it does not fit into the code segment.
+ */
+bool Memory::storeCode(uint16_t baseaddress, const uint8_t* data, uint16_t len)
+{
+#ifdef VM_HARVARD
+	if((uint32_t) baseaddress + len > MEMORY_CODE_SIZE)
+	{
+		return false;
+	}
+	if(codeimage != codesegment)
+	{
+		codeimage = codesegment;
+		codesize = 0;
+	}
+	memcpy(codesegment + baseaddress, data, len);
+	codeversion++;
+#else
+	if((uint32_t) baseaddress + len > MEMORY_SIZE)
+	{
+		return false;
+	}
+	storeBlock(baseaddress, data, len);
+#endif
+	return true;
+}
+
+/**
+ * Loads uint8_t from the code region (program image or memory).
+ * @param address Address of the value to load.
+ * @return Unsigned value from the code.
+ */
+uint8_t Memory::loadcode(uint16_t address)
+{
+	if(!codeimage)
+	{
+		return load(address);
+	}
+	if(address >= codesize)
+	{
+		MEMORY_VIOLATION_RETURN("Code access violation (loadcode)", 0);
+	}
+	return codeimage[address];
+}
+
+/**
+ * Loads uint16_t from the code region (program image or memory).
+ * @param baseaddress Address of the value to load.
+ * @return Unsigned value from the code.
+ */
+uint16_t Memory::loadcodeaddress(uint16_t baseaddress)
+{
+	if(!codeimage)
+	{
+		return loadaddress(baseaddress);
+	}
+	if((uint32_t) baseaddress + sizeof(uint16_t) > codesize)
+	{
+		MEMORY_VIOLATION_RETURN("Code access violation (loadcodeaddress)", 0);
+	}
+	uint16_t value;
+	memcpy(&value, codeimage + baseaddress, sizeof(uint16_t));
+	return value;
+}
+
+/**
+ * Loads uint32_t from the code region (program image or memory).
+ * @param baseaddress Address of the value to load.
+ * @return Unsigned value from the code.
+ */
+uint32_t Memory::loadcodeunsigned(uint16_t baseaddress)
+{
+	if(!codeimage)
+	{
+		return loadunsigned(baseaddress);
+	}
+	if((uint32_t) baseaddress + sizeof(uint32_t) > codesize)
+	{
+		MEMORY_VIOLATION_RETURN("Code access violation (loadcodeunsigned)", 0);
+	}
+	uint32_t value;
+	memcpy(&value, codeimage + baseaddress, sizeof(uint32_t));
+	return value;
+}
+
+/**
+ * Sets the size of the code region. Bytecode is stored from address 0 to size, writes to this region change the code version.
+ * Detaches a program image.
+ * @param size Size of the bytecode program.
+ */
+void Memory::setCodeSize(uint16_t size)
+{
+	codeimage = defaultcode();
+	codesize = size;
+	codeversion++;
+}
+
+/**
+ * Executes code from a read-only program image (e.g. a const array in flash) instead of copying it into the memory.
+ * The image replaces the code region (or the code segment in Harvard mode): code loads and string literals are read
+ * from the image, data stays in the memory and clear() does not touch the code. Programs must not use the code region of
+ * the memory for data.
+ * @param image Program image, must stay valid until it is replaced (NULL detaches the image).
+ * @param size Size of the program image.
+ */
+void Memory::setCodeImage(const uint8_t* image, uint16_t size)
+{
+	codeimage = image ? image : defaultcode();
+	codesize = image ? size : 0;
+	codeversion++;
+}
+
+/**
+ * Size of the code region.
+ * @return Size of the bytecode program.
+ */
+uint16_t Memory::getCodeSize()
+{
+	return codesize;
 }
 
 /**
  *
- * Maps a URL and Resource to a memory address. Defines OPtype and Map-Options.
+ * Maps a URL and Resource to a memory address. Defines OPtype and Map-Options. The URL-Map is taken from the block of its
+ * id range, a free block of the map pool is assigned to the instance if no id of the range is mapped.
  * @param id				ID of the URL mapping to use.
  * @param optype			Operand type of the mapping (what datatype is the value).
  * @param map_options		Mapping options (Coap Method, handled by server/client, ...)
@@ -171,22 +531,37 @@ void Memory::copy(uint16_t srcaddress, uint8_t len, uint16_t destaddress)
  * @param port
  * @param url_address		Address of URL where the value can be requested (for server: empty, for client: address (e.g. affe::1)). Length is resticted by memory size, must be NULL terminated (cstring).
  * @param resource_address	Address od resource where the value can be requested (for server and for client: resource (e.g. /sensor)). Length is resticted by memory size, must be NULL terminated (cstring).
+ * @return True if the URL-Map was created, false if the map pool has no free block.
  */
-void Memory::map(uint8_t id, uint8_t optype, uint8_t map_options, uint16_t value_address, uint16_t port, uint16_t url_address, uint16_t resource_address)
+bool Memory::map(uint16_t id, uint8_t optype, uint8_t map_options, uint16_t value_address, uint16_t port, uint16_t url_address, uint16_t resource_address)
 {
 	if(checkMapId(&id))
 	{
-		throw std::range_error("Map Id Access violation (map)");
+		MEMORY_VIOLATION_RETURN("Map Id Access violation (map)", false);
 	}
 	mutex_lock(&mutex);
-	this->mappings[id].optype = optype;
-	this->mappings[id].map_options = map_options;
-	this->mappings[id].value_address = value_address;
-	this->mappings[id].port = port;
-	this->mappings[id].url_address = url_address;
-	this->mappings[id].resource_address = resource_address;
-	this->mappings[id].status = 0;
+	memory_map_block_t* block = allocate(id);
+	if(!block)
+	{
+		mutex_unlock(&mutex);
+		return false;
+	}
+	uint8_t index = id % MEMORY_MAP_BLOCK;
+	block->optype[index] = optype;
+	block->map_options[index] = map_options;
+	block->value_address[index] = value_address;
+	block->port[index] = port;
+	block->url_address[index] = url_address;
+	block->resource_address[index] = resource_address;
+	block->status[index] = 0;
+	block->pushed &= ~mapbit(id);
+	block->dirty |= mapbit(id);//the value is pushed once after it is mapped
+	const unsigned char* resource = loadresource(map_options, resource_address, &block->resourcelengths[index]);
+	block->resourcehashes[index] = hashresource(resource, block->resourcelengths[index]);
+	reindex();
 	mutex_unlock(&mutex);
+	share(value_address, sizeof(uint32_t));//read and written by the gcoap thread
+	return true;
 }
 
 /**
@@ -195,39 +570,64 @@ void Memory::map(uint8_t id, uint8_t optype, uint8_t map_options, uint16_t value
  * @param deleteafter Defines if the map should be deleted if checkmap return VM_MAP_STATUS_DONE
  * @return Returns 0x00 if no error but map-value was not set, 0x01 if map value was set, error code if an error occurred.
  */
-uint8_t Memory::checkmap(uint8_t id, bool deleteafter)
+uint8_t Memory::checkmap(uint16_t id, bool deleteafter)
 {
 	if(checkMapId(&id))
 	{
-		throw std::range_error("Map Id Access violation (checkmap)");
+		MEMORY_VIOLATION_RETURN("Map Id Access violation (checkmap)", 0);
 	}
-	if(this->mappings[id].value_address == NO_MAPPING || this->mappings[id].url_address == NO_MAPPING || this->mappings[id].resource_address == NO_MAPPING || this->mappings[id].status == VM_MAP_STATUS_NO_MAPPING)
+	const memory_map_block_t* block = used(id);
+	uint8_t index = id % MEMORY_MAP_BLOCK;
+	if(!block || !complete(block, index))
 	{
 		return 0;
 	}
-	uint8_t temp = mappings[id].status;
-	if(deleteafter && temp == VM_MAP_STATUS_DONE && (mappings[id].map_options & VM_MAP_OPTION_LIFETIME_MASK) == VM_MAP_OPTION_LIFETIME_ONCE)
+	uint8_t temp = block->status[index];
+	if(deleteafter && temp == VM_MAP_STATUS_DONE && (block->map_options[index] & VM_MAP_OPTION_LIFETIME_MASK) == VM_MAP_OPTION_LIFETIME_ONCE)
 	{//unmap ^ ONLY when done and no error
 		unmap(id);
 	}
 	return temp;
 }
 
+/**
+ * Checks if a URL-Map waits to be handled. Does not unmap the value.
+ * @param id ID of the URL mapping to check.
+ * @return True if the URL-Map is used and neither done nor failed.
+ */
+bool Memory::mapPending(uint16_t id)
+{
+	if(checkMapId(&id))
+	{
+		MEMORY_VIOLATION_RETURN("Map Id Access violation (mapPending)", false);
+	}
+	const memory_map_block_t* block = used(id);
+	uint8_t index = id % MEMORY_MAP_BLOCK;
+	if(!block || !complete(block, index))
+	{
+		return false;
+	}
+	return !(block->status[index] & VM_MAP_STATUS_DONE);
+}
+
 /**
  * Sets done flag in URL-Map
  * @param id ID of URL-Map
  */
-void Memory::map_done(uint8_t id)
+void Memory::map_done(uint16_t id)
 {
 	if(checkMapId(&id))
 	{
-		throw std::range_error("Map Id Access violation (map_done)");
+		MEMORY_VIOLATION("Map Id Access violation (map_done)");
 	}
-	if(this->mappings[id].value_address == NO_MAPPING || this->mappings[id].url_address == NO_MAPPING || this->mappings[id].resource_address == NO_MAPPING || this->mappings[id].status == VM_MAP_STATUS_NO_MAPPING)
+	mutex_lock(&mutex);//called by the gcoap threads, the block may be returned to the pool meanwhile
+	memory_map_block_t* block = used(id);
+	uint8_t index = id % MEMORY_MAP_BLOCK;
+	if(block && complete(block, index))
 	{
-		return;
+		block->status[index] = VM_MAP_STATUS_DONE;
 	}
-	mappings[id].status = VM_MAP_STATUS_DONE;
+	mutex_unlock(&mutex);
 }
 
 /**
@@ -235,40 +635,313 @@ void Memory::map_done(uint8_t id)
  * @param id ID of URL-Map
  * @param code errorcode
  */
-void Memory::map_error(uint8_t id, uint8_t code)
+void Memory::map_error(uint16_t id, uint8_t code)
 {
 	if(checkMapId(&id))
 	{
-		throw std::range_error("Map Id Access violation (map_error)");
+		MEMORY_VIOLATION("Map Id Access violation (map_error)");
 	}
-	if(this->mappings[id].value_address == NO_MAPPING || this->mappings[id].url_address == NO_MAPPING || this->mappings[id].resource_address == NO_MAPPING || this->mappings[id].status == VM_MAP_STATUS_NO_MAPPING)
+	mutex_lock(&mutex);//called by the gcoap threads, the block may be returned to the pool meanwhile
+	memory_map_block_t* block = used(id);
+	uint8_t index = id % MEMORY_MAP_BLOCK;
+	if(block && complete(block, index))
 	{
-		return;
+		block->status[index] |= (code | VM_MAP_STATUS_DONE);
+	}
+	mutex_unlock(&mutex);
+}
+
+/**
+ * Takes the change of a mapped value to push it (client URL-Maps with POST or PUT). The value is changed if it was
+ * written since the last call and differs from the last pushed value, rational values by more than VM_MAP_DEADBAND.
+ * The first call after the URL-Map is created always returns true. The value is recorded as pushed. Shared words written
+ * since the last call are turned into changed URL-Maps first (see takeDirtyWords()), writers never take the mutex.
+ * @param id ID of URL-Map
+ * @return True if the value has to be pushed.
+ */
+bool Memory::mapChanged(uint16_t id)
+{
+	if(checkMapId(&id))
+	{
+		MEMORY_VIOLATION_RETURN("Map Id Access violation (mapChanged)", false);
+	}
+	bool changed = false;
+	mutex_lock(&mutex);
+	takeDirtyWords();
+	memory_map_block_t* block = used(id);
+	uint8_t index = id % MEMORY_MAP_BLOCK;
+	if(block && complete(block, index))
+	{
+		bool dirty = block->dirty & mapbit(id);
+		block->dirty &= ~mapbit(id);
+		uint16_t address = block->value_address[index];
+		uint8_t size = valuesize(block->optype[index]);
+		if(dirty && checkmemoryaddress(&address, size))
+		{//pushed anyway, the load of the value reports the violation
+			changed = true;
+		}
+		else if(dirty)
+		{
+			uint32_t value = 0;
+			read(address, &value, size);
+			changed = !(block->pushed & mapbit(id)) || differs(block->optype[index], value, block->pushedvalues[index]);
+			if(changed)
+			{
+				block->pushed |= mapbit(id);
+				block->pushedvalues[index] = value;
+			}
+		}
 	}
-	mappings[id].status |= (code | VM_MAP_STATUS_DONE);
+	mutex_unlock(&mutex);
+	return changed;
+}
+
+/**
+ * Marks a URL-Map changed and not pushed, e.g. after its request failed. mapChanged() returns true for the next call.
+ * @param id ID of URL-Map
+ */
+void Memory::map_resend(uint16_t id)
+{
+	if(checkMapId(&id))
+	{
+		MEMORY_VIOLATION("Map Id Access violation (map_resend)");
+	}
+	mutex_lock(&mutex);
+	memory_map_block_t* block = used(id);
+	if(block)
+	{
+		block->pushed &= ~mapbit(id);
+		block->dirty |= mapbit(id);
+	}
+	mutex_unlock(&mutex);
+}
+
+/**
+ * @param optype Operand type of a URL-Map.
+ * @return Size of the mapped value in bytes.
+ */
+uint8_t Memory::valuesize(uint8_t optype)
+{
+	switch(optype & VM_OPTYPE_MASK)
+	{
+	case VM_OPERAND_TYPE_UINT8:
+		return sizeof(uint8_t);
+	case VM_OPERAND_TYPE_UINT16:
+		return sizeof(uint16_t);
+	default:
+		return sizeof(uint32_t);
+	}
+}
+
+/**
+ * Compares a mapped value with its last pushed value.
+ * @param optype Operand type of the URL-Map.
+ * @param value Raw bytes of the value.
+ * @param pushed Raw bytes of the last pushed value.
+ * @return True if the values differ, rational values by more than VM_MAP_DEADBAND.
+ */
+bool Memory::differs(uint8_t optype, uint32_t value, uint32_t pushed)
+{
+	if(value == pushed)
+	{
+		return false;
+	}
+	if((optype & VM_OPTYPE_MASK) != VM_OPERAND_TYPE_DEC)
+	{
+		return true;
+	}
+	rational_t difference;
+	rational_t last;
+	memcpy(&difference, &value, sizeof(rational_t));
+	memcpy(&last, &pushed, sizeof(rational_t));
+	difference -= last;
+	if(difference < rational_t(0))
+	{
+		difference = -difference;
+	}
+	return difference > rational_t(VM_MAP_DEADBAND);
 }
 
 /**
  * Unmaps a URL-Map.
  * @param id ID of the URL map which should be deleted (set to NO_MAPPING).
  */
-void Memory::unmap(uint8_t id)
+void Memory::unmap(uint16_t id)
 {
 	if(checkMapId(&id))
 	{
-		throw std::range_error("Map Id Access violation (unmap)");
+		MEMORY_VIOLATION("Map Id Access violation (unmap)");
 	}
 	mutex_lock(&mutex);
-	this->mappings[id].optype = 0;
-	this->mappings[id].map_options = 0;
-	this->mappings[id].value_address = NO_MAPPING;
-	this->mappings[id].url_address = NO_MAPPING;
-	this->mappings[id].resource_address = NO_MAPPING;
-	this->mappings[id].port = 0;
-	this->mappings[id].status = VM_MAP_STATUS_NO_MAPPING;
+	if(used(id))
+	{
+		release(id);
+		reindex();
+	}
 	mutex_unlock(&mutex);
 }
 
+/**
+ * Sets a copy of a URL-Map unused.
+ * @param mapping URL-Map.
+ */
+void Memory::clearMap(url_map_t* mapping)
+{
+	mapping->optype = 0;
+	mapping->map_options = 0;
+	mapping->value_address = NO_MAPPING;
+	mapping->url_address = NO_MAPPING;
+	mapping->resource_address = NO_MAPPING;
+	mapping->port = 0;
+	mapping->status = VM_MAP_STATUS_NO_MAPPING;
+}
+
+/**
+ * Takes the URL-Map of an id (called with the mutex locked). Assigns a free block of the map pool to the id range if it has none.
+ * @param id Map id (range checked by caller).
+ * @return Block of the id with the URL-Map marked used, NULL if the map pool has no free block.
+ */
+memory_map_block_t* Memory::allocate(uint16_t id)
+{
+	uint8_t* block = &blocks[id / MEMORY_MAP_BLOCK];
+	if(*block == MEMORY_NO_BLOCK)
+	{
+		uint8_t free = MEMORY_NO_BLOCK;
+		unsigned state = irq_disable();//the pool is shared by all instances
+		for(uint8_t i = 0; i < MEMORY_MAP_POOL && free == MEMORY_NO_BLOCK; i++)
+		{
+			if(!poolowners[i])
+			{
+				poolowners[i] = this;
+				free = i;
+			}
+		}
+		irq_restore(state);
+		if(free == MEMORY_NO_BLOCK)
+		{
+			return 0;
+		}
+		pool[free].active = 0;//the fields of unused URL-Maps are never read
+		pool[free].dirty = 0;
+		pool[free].pushed = 0;
+		*block = free;
+	}
+	memory_map_block_t* entry = &pool[*block];
+	if(!(entry->active & mapbit(id)))
+	{
+		entry->active |= mapbit(id);
+		mapcount++;
+	}
+	return entry;
+}
+
+/**
+ * Deletes the used URL-Map of an id (called with the mutex locked). The block of the id range returns to the map pool
+ * with its last URL-Map.
+ * @param id Map id (range checked by caller).
+ */
+void Memory::release(uint16_t id)
+{
+	uint8_t* block = &blocks[id / MEMORY_MAP_BLOCK];
+	pool[*block].active &= ~mapbit(id);
+	mapcount--;
+	if(pool[*block].active == 0)
+	{
+		uint8_t free = *block;
+		*block = MEMORY_NO_BLOCK;
+		unsigned state = irq_disable();
+		poolowners[free] = 0;
+		irq_restore(state);
+	}
+}
+
+/**
+ * Loads the resource of a URL-Map, directly coded in the code (VM_MAP_OPTION_RESOURCE_LITERAL) or placed in memory.
+ * @param map_options Map options of the URL-Map.
+ * @param address Resource address of the URL-Map.
+ * @param len Set to the length of the resource without the terminating zero, bounded by the end of the code or memory (NULL if not needed).
+ * @return Readonly pointer to the resource.
+ */
+const unsigned char* Memory::loadresource(uint8_t map_options, uint16_t address, uint16_t* len) const
+{
+	bool literal = (map_options & VM_MAP_OPTION_RESOURCE_MASK) == VM_MAP_OPTION_RESOURCE_LITERAL;
+	uint32_t end = literal && codeimage ? getCodeSegmentSize() : MEMORY_SIZE;
+	if(address == NO_MAPPING || address >= end)
+	{
+		if(len)
+		{
+			*len = 0;
+		}
+		return (const unsigned char*) "";
+	}
+	const unsigned char* resource = literal ? loadcodestring(address) : loadurl(address);
+	if(len)
+	{
+		*len = strnlen((const char*) resource, end - address);
+	}
+	return resource;
+}
+
+/**
+ * FNV-1a hash of a resource.
+ * @param resource Resource.
+ * @param len Length of the resource.
+ * @return Hash of the resource.
+ */
+uint32_t Memory::hashresource(const unsigned char* resource, uint16_t len)
+{
+	uint32_t hash = UINT32_C(2166136261);
+	for(uint16_t i = 0; i < len; i++)
+	{
+		hash = (hash ^ resource[i]) * UINT32_C(16777619);
+	}
+	return hash;
+}
+
+/**
+ * Rebuilds the indexes of the URL-Maps (called with the mutex locked). Map ids are inserted in ascending order,
+ * so lookups find the lowest map id of equal resources or value addresses first. Id ranges without block and unused
+ * URL-Maps are skipped.
+ */
+void Memory::reindex(void)
+{
+	memset(resourceindex, 0xff, sizeof(resourceindex));//MEMORY_NO_MAP
+	memset(addressindex, 0xff, sizeof(addressindex));
+	for(uint16_t range = 0; range < MEMORY_MAP_SIZE / MEMORY_MAP_BLOCK; range++)
+	{
+		if(blocks[range] == MEMORY_NO_BLOCK)
+		{
+			continue;
+		}
+		const memory_map_block_t& block = pool[blocks[range]];
+		for(uint32_t bits = block.active; bits; bits &= bits - 1)
+		{
+			uint8_t i = __builtin_ctzl(bits);//lowest used URL-Map
+			uint16_t id = range * MEMORY_MAP_BLOCK + i;
+			if(block.value_address[i] == NO_MAPPING)
+			{
+				continue;
+			}
+			uint16_t slot = addressslot(block.value_address[i]);
+			while(addressindex[slot] != MEMORY_NO_MAP)
+			{
+				slot = (slot + 1) & (MEMORY_INDEX_SIZE - 1);
+			}
+			addressindex[slot] = id;
+			if(block.resource_address[i] == NO_MAPPING)
+			{
+				continue;
+			}
+			slot = block.resourcehashes[i] & (MEMORY_INDEX_SIZE - 1);
+			while(resourceindex[slot] != MEMORY_NO_MAP)
+			{
+				slot = (slot + 1) & (MEMORY_INDEX_SIZE - 1);
+			}
+			resourceindex[slot] = id;
+		}
+	}
+}
+
 /**
  * Loads a URL from memory (cstring).
  * @param address Start address of the URL to load.
@@ -279,6 +952,74 @@ const unsigned char* Memory::loadurl(uint16_t address) const
 	return memory+address;//returns pointer to CString
 }
 
+/**
+ * Loads a string literal of the code (cstring), e.g. the URL of a URL-Map with VM_MAP_OPTION_URL_LITERAL.
+ * @param address Start address of the string in the code.
+ * @return Readonly pointer to the string, empty string if address is behind the program image.
+ */
+const unsigned char* Memory::loadcodestring(uint16_t address) const
+{
+	if(!codeimage)
+	{
+		return memory+address;
+	}
+	if(address >= getCodeSegmentSize())
+	{
+		return (const unsigned char*) "";
+	}
+	return codeimage+address;
+}
+
+/**
+ * Dumps the code.
+ * @return Readonly pointer to the code (program image, code segment or memory).
+ */
+const uint8_t* Memory::dumpCode() const
+{
+	return codeimage ? codeimage : memory;
+}
+
+/**
+ * Readable size of the code: size of the program image, of the code segment (Harvard mode) or of the memory.
+ * @return Size of the code dump.
+ */
+uint16_t Memory::getCodeSegmentSize() const
+{
+	if(!codeimage)
+	{
+		return MEMORY_SIZE;
+	}
+#ifdef VM_HARVARD
+	if(codeimage == codesegment)
+	{
+		return MEMORY_CODE_SIZE;
+	}
+#endif
+	return codesize;
+}
+
+/**
+ * Copies a code region. Program images and the code segment are only written while the VM is stopped,
+ * code in the memory is copied like data (see snapshot()).
+ * @param address Start address of the region.
+ * @param buffer Buffer of at least len bytes.
+ * @param len Length of the region.
+ * @return True if buffer holds a copy, false if the region is out of range.
+ */
+bool Memory::snapshotCode(uint16_t address, uint8_t* buffer, uint16_t len) const
+{
+	if(!codeimage)
+	{
+		return snapshot(address, buffer, len);
+	}
+	if((uint32_t) address + len > getCodeSegmentSize())
+	{
+		return false;
+	}
+	memcpy(buffer, codeimage + address, len);
+	return true;
+}
+
 /**
  * Dumps Memory.
  * @return Readonly pointer to memory array.
@@ -289,12 +1030,97 @@ const uint8_t* Memory::dump() const
 }
 
 /**
- * Dumps URL-Maps.
- * @return Readonly pointer to URL mapping array.
+ * Copies a memory region which was not written during the copy, without stopping the VM.
+ * The copy is repeated if the write epoch or the shared sequence changed while copying.
+ * @param address Start address of the region.
+ * @param buffer Buffer of at least len bytes.
+ * @param len Length of the region.
+ * @return True if buffer holds a consistent copy, false if the region is out of range or kept changing.
  */
-const url_map_t* Memory::dumpMap() const
+bool Memory::snapshot(uint16_t address, uint8_t* buffer, uint16_t len) const
 {
-	return this->mappings;
+	if((uint32_t) address + len > MEMORY_SIZE)
+	{
+		return false;
+	}
+	for(uint8_t i = 0; i < MEMORY_SNAPSHOT_RETRIES; i++)
+	{
+		uint32_t epoch = writeepoch;
+		uint32_t sequence = sharedsequence;
+		if(!(epoch & 1) && !(sequence & 1))
+		{
+			MEMORY_BARRIER();
+			memcpy(buffer, memory + address, len);
+			MEMORY_BARRIER();
+			if(epoch == writeepoch && sequence == sharedsequence)
+			{
+				return true;
+			}
+		}
+		xtimer_usleep(MEMORY_SNAPSHOT_BACKOFF_US);
+	}
+	return false;
+}
+
+/**
+ * Copies a URL-Map. Mappings are changed under the memory mutex, so the copy is no partly changed mapping.
+ * @param id ID of the URL-Map.
+ * @return Copy of the URL-Map, an unused URL-Map (NO_MAPPING addresses, VM_MAP_STATUS_NO_MAPPING) if the id is not mapped.
+ */
+url_map_t Memory::getMap(uint16_t id)
+{
+	url_map_t copy;
+	clearMap(&copy);
+	if(checkMapId(&id))
+	{
+		return copy;
+	}
+	mutex_lock(&mutex);
+	const memory_map_block_t* block = used(id);
+	if(block)
+	{
+		uint8_t index = id % MEMORY_MAP_BLOCK;
+		copy.optype = block->optype[index];
+		copy.map_options = block->map_options[index];
+		copy.value_address = block->value_address[index];
+		copy.url_address = block->url_address[index];
+		copy.resource_address = block->resource_address[index];
+		copy.port = block->port[index];
+		copy.status = block->status[index];
+	}
+	mutex_unlock(&mutex);
+	return copy;
+}
+
+/**
+ * Finds the next used URL-Map with the given map options. Id ranges without block are skipped, unused URL-Maps with the
+ * bitmap of the block. Used by other threads to iterate the URL-Maps without scanning unused ids, a URL-Map deleted
+ * meanwhile is returned unused by getMap().
+ * @param id First id to check.
+ * @param mask Map options compared (0 for all used URL-Maps).
+ * @param options Value of the compared map options (e.g. VM_MAP_OPTION_DIRECTION_CLIENT).
+ * @return Id of the next used URL-Map (id or higher), MEMORY_NO_MAP if there is none.
+ */
+uint16_t Memory::nextMap(uint16_t id, uint8_t mask, uint8_t options) const
+{
+	for(; id < MEMORY_MAP_SIZE; id = (id / MEMORY_MAP_BLOCK + 1) * MEMORY_MAP_BLOCK)
+	{
+		const memory_map_block_t* block = mapblock(id);
+		if(!block)
+		{
+			continue;
+		}
+		uint16_t base = id - id % MEMORY_MAP_BLOCK;
+		for(uint32_t bits = block->active & ~(mapbit(id) - 1); bits; bits &= bits - 1)
+		{
+			uint8_t i = __builtin_ctzl(bits);//lowest used URL-Map
+			if((block->map_options[i] & mask) == options)
+			{
+				return base + i;
+			}
+		}
+	}
+	return MEMORY_NO_MAP;
 }
 
 /**
@@ -307,43 +1133,96 @@ uint16_t Memory::getMemorySize()
 }
 
 /**
- * Size of URL-Maps.
- * @return Size of the URL mapping array.
+ * Number of URL-Map ids.
+ * @return Number of URL-Map ids (the map pool may hold fewer URL-Maps).
  */
-uint8_t Memory::getMapSize()
+uint16_t Memory::getMapSize()
 {
 	return MEMORY_MAP_SIZE;
 }
 
 /**
- * Checks if there is a URL-Map for the specified address.
+ * Checks if there is a URL-Map for the specified address. The index is read under the mutex, it is rebuilt by other threads.
  * @param address The Memory address to check if a mapping exists.
- * @return Id of the mapping, 0xff if no mapping exists (possible because we use 4Bit map-ids in VM INstructions -> max 16 mappings)
+ * @return Id of the mapping, MEMORY_NO_MAP if no mapping exists.
+ */
+uint16_t Memory::getMapForAddress(uint16_t address)
+{
+	if(address == NO_MAPPING)
+	{//unused mappings
+		return MEMORY_NO_MAP;
+	}
+	uint16_t found = MEMORY_NO_MAP;
+	mutex_lock(&mutex);
+	for(uint16_t slot = addressslot(address); addressindex[slot] != MEMORY_NO_MAP; slot = (slot + 1) & (MEMORY_INDEX_SIZE - 1))
+	{
+		uint16_t id = addressindex[slot];
+		const memory_map_block_t* block = used(id);
+		if(block && block->value_address[id % MEMORY_MAP_BLOCK] == address)
+		{
+			found = id;
+			break;
+		}
+	}
+	mutex_unlock(&mutex);
+	return found;
+}
+
+/**
+ * Finds the URL-Map of a resource (e.g. a requested URI path). Only URL-Maps with a resource and a value address are found.
+ * The resource is compared with the memory only if its hash and length match. Resources are hashed when they are mapped,
+ * a resource changed in memory afterwards is found after it is mapped again.
+ * @param resource Resource to find (not zero terminated).
+ * @param len Length of the resource.
+ * @return Id of the mapping, MEMORY_NO_MAP if no mapping exists.
  */
-uint8_t Memory::getMapForAddress(uint16_t address)
+uint16_t Memory::findResource(const uint8_t* resource, uint16_t len)
 {
-	for(uint8_t i = 0; i < MEMORY_MAP_SIZE; i++)
+	uint32_t hash = hashresource(resource, len);
+	uint16_t found = MEMORY_NO_MAP;
+	mutex_lock(&mutex);
+	for(uint16_t slot = hash & (MEMORY_INDEX_SIZE - 1); resourceindex[slot] != MEMORY_NO_MAP; slot = (slot + 1) & (MEMORY_INDEX_SIZE - 1))
 	{
-		if(this->mappings[i].value_address == address)
+		uint16_t id = resourceindex[slot];
+		const memory_map_block_t* block = mapblock(id);
+		uint8_t index = id % MEMORY_MAP_BLOCK;
+		if(block->resourcehashes[index] == hash && block->resourcelengths[index] == len
+				&& memcmp(loadresource(block->map_options[index], block->resource_address[index], 0), resource, len) == 0)
 		{
-			return i;
+			found = id;
+			break;
 		}
 	}
-	return 0xff;
+	mutex_unlock(&mutex);
+	return found;
 }
 
 /**
- *	Clears memory and sets all mappings to NO_MAPPING.
+ *	Clears memory and deletes all mappings, their blocks return to the map pool.
  */
 void Memory::clear()
 {
 	mutex_lock(&mutex);
+	writeepoch++;
 	memset(memory, 0, MEMORY_SIZE);
-	mutex_unlock(&mutex);
-	for(uint8_t i = 0; i < MEMORY_MAP_SIZE; i++)
-	{
-		Memory::unmap(i);
+	memset(sharedwords, 0, MEMORY_SHARED_MAP_SIZE);
+	memset(dirtywords, 0, MEMORY_SHARED_MAP_SIZE);
+	writeepoch++;
+	codeversion++;
+	accesserror = false;
+	unsigned state = irq_disable();
+	for(uint16_t range = 0; range < MEMORY_MAP_SIZE / MEMORY_MAP_BLOCK; range++)
+	{//all blocks return to the map pool
+		if(blocks[range] != MEMORY_NO_BLOCK)
+		{
+			poolowners[blocks[range]] = 0;
+			blocks[range] = MEMORY_NO_BLOCK;
+		}
 	}
+	irq_restore(state);
+	mapcount = 0;
+	reindex();
+	mutex_unlock(&mutex);
 }
 
 /**
@@ -362,7 +1241,19 @@ inline bool Memory::checkmemoryaddress(uint16_t* address, uint8_t typesize)
  * @param id URL-Map id to access.
  * @return True if id is not valid.
  */
-inline bool Memory::checkMapId(uint8_t* id)
+inline bool Memory::checkMapId(uint16_t* id)
 {
 	return *id >= MEMORY_MAP_SIZE;
 }
+
+/**
+ * Changes the code version if the write access starts inside the code region.
+ * @param address Address of the write access.
+ */
+inline void Memory::checkcodewrite(uint16_t address)
+{
+	if(address < codesize && !codeimage)
+	{
+		codeversion++;
+	}
+}
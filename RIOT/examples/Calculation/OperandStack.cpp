@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Implementation of OperandStack
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+
+#include <string.h>
+#include "OperandStack.h"
+
+/**
+ * @brief Creates an empty operand stack.
+ */
+OperandStack::OperandStack()
+{
+	pointer = 0;
+	memset(slots, 0, sizeof(slots));
+}
+
+/**
+ *
+ * @return Readonly pointer to the slots, the first slot is the bottom of the stack.
+ */
+const uint32_t* OperandStack::dump(void) const
+{
+	return slots;
+}
+
+/**
+ *
+ * @return Number of values on the stack.
+ */
+uint8_t OperandStack::getDepth() const
+{
+	return pointer;
+}
+
+/**
+ *
+ * @return Number of slots.
+ */
+uint8_t OperandStack::getStackSize() const
+{
+	return OPERAND_STACK_SIZE;
+}
+
+/**
+ * Clears the operand stack.
+ */
+void OperandStack::clear()
+{
+	pointer = 0;
+	memset(slots, 0, sizeof(slots));
+}
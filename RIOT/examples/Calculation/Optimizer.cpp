@@ -0,0 +1,809 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Implementation of Optimizer
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+#include <string.h>
+
+#include "Optimizer.h"
+
+///Jump targets of the program (shared by all optimizers, the optimizer is not reentrant)
+static uint8_t jumptargets[(MEMORY_CODE_REGION + 7) / 8];
+
+/**
+ * @param optype OPTYPE of the instruction.
+ * @return Size of a literal operand of the OPTYPE in Bytes, 0 for unsupported types.
+ */
+static uint8_t literalwidth(uint8_t optype)
+{
+	switch(optype & VM_OPTYPE_MASK)
+	{
+	case VM_OPERAND_TYPE_UINT8:		return sizeof(uint8_t);
+	case VM_OPERAND_TYPE_UINT16:	return sizeof(uint16_t);
+	case VM_OPERAND_TYPE_UINT32:	return sizeof(uint32_t);
+	case VM_OPERAND_TYPE_DEC:		return sizeof(rational_t);
+	default:						return 0;
+	}
+}
+
+/**
+ * @param pc Code address.
+ * @return True if the address is a jump target or a return address.
+ */
+static inline bool targeted(uint16_t pc)
+{
+	return jumptargets[pc >> 3] & (1 << (pc & 0x07));
+}
+
+/**
+ * Folds an operation with a literal into a constant.
+ * @param opcode Operation (ADD, SUB or MUL).
+ * @param value Constant in literal representation, replaced by the result.
+ * @param literal Literal operand of the operation.
+ * @return True if the operation was folded.
+ */
+template<typename T>
+static bool foldtyped(uint8_t opcode, uint32_t* value, uint32_t literal)
+{
+	T a = operand_type<T>::fromliteral(*value);
+	T b = operand_type<T>::fromliteral(literal);
+	switch(opcode)
+	{
+	case VM_INSTRUCTION_ADD:	OpAdd::apply(a, b);	break;
+	case VM_INSTRUCTION_SUB:	OpSub::apply(a, b);	break;
+	case VM_INSTRUCTION_MUL:	OpMul::apply(a, b);	break;
+	default:					return false;
+	}
+	*value = operand_type<T>::toliteral(a);
+	return true;
+}
+
+/**
+ * @param optype OPTYPE of the instructions.
+ * @param opcode Operation (ADD, SUB or MUL).
+ * @param value Constant in literal representation, replaced by the result.
+ * @param literal Literal operand of the operation.
+ * @return True if the operation was folded.
+ */
+static bool foldliteral(uint8_t optype, uint8_t opcode, uint32_t* value, uint32_t literal)
+{
+	switch(optype & VM_OPTYPE_MASK)
+	{
+	case VM_OPERAND_TYPE_UINT8:		return foldtyped<uint8_t>(opcode, value, literal);
+	case VM_OPERAND_TYPE_UINT16:	return foldtyped<uint16_t>(opcode, value, literal);
+	case VM_OPERAND_TYPE_UINT32:	return foldtyped<uint32_t>(opcode, value, literal);
+	case VM_OPERAND_TYPE_DEC:		return foldtyped<rational_t>(opcode, value, literal);
+	default:						return false;
+	}
+}
+
+/**
+ * @param address Start of the accessed data.
+ * @param len Length of the accessed data.
+ * @param from Start of the range.
+ * @param to End of the range (exclusive).
+ * @return True if the data overlaps the range.
+ */
+static bool overlaps(uint16_t address, uint32_t len, uint16_t from, uint16_t to)
+{
+	return address < to && (uint32_t) address + len > from;
+}
+
+/**
+ * @brief Creates an optimizer for the program of a VM.
+ * @param vm VM whose code region is rewritten, must not execute while the optimizer runs.
+ */
+Optimizer::Optimizer(VM* vm)
+{
+	this->vm = vm;
+	memory = vm->getMemory();
+	rewritecount = 0;
+	saved = 0;
+	cycles = 0;
+}
+
+/**
+ * Runs optimization passes over the program. Strength reduction and jump threading patch instructions in place,
+ * constant folding, superinstructions and dead code removal shorten the program. Instructions are only folded or fused
+ * if no instruction but the first is a jump target (entering them in the middle is impossible afterwards). Without
+ * Harvard mode instructions are only patched if no instruction accesses data in the code region, the code is only
+ * moved if no instruction accesses data in the moved part of the code region.
+ * @param passes Passes to run (OPTIMIZER_PASS_*).
+ * @return Number of changes (patched instructions and targets, rewrites), 0 if the program is unchanged.
+ */
+uint16_t Optimizer::optimize(uint8_t passes)
+{
+	rewritecount = 0;
+	saved = 0;
+	cycles = 0;
+	uint16_t codesize = memory->getCodeSize();
+	if(codesize == 0 || codesize > MEMORY_CODE_REGION || memory->getCodeImage() || !vm->verify())
+	{//read-only images can not be rewritten, unverified programs may contain unknown jump targets
+		return 0;
+	}
+	uint16_t savedprogramcounter = vm->programcounter;
+	uint32_t savedstatuscode = vm->statuscode;
+	uint16_t changes = 0;
+
+#ifndef VM_HARVARD
+	bool patchable = !codeaccessed(0, codesize);
+#else
+	bool patchable = true;
+#endif
+	if(patchable && (passes & OPTIMIZER_PASS_STRENGTH))
+	{
+		changes += reduce(codesize);
+	}
+	if(patchable && (passes & OPTIMIZER_PASS_THREAD))
+	{
+		changes += thread(codesize);
+	}
+	marktargets(codesize);
+
+	vm_instruction_t first;
+	vm_instruction_t second;
+	uint8_t buffer[OPTIMIZER_FUSED_SIZE];
+	for(uint16_t pc = 0; pc < codesize && rewritecount < VM_OPTIMIZER_REWRITES; )
+	{
+		sweep(&first, pc, codesize);
+		vm_rewrite_t* current = &rewrites[rewritecount];
+		uint16_t end = first.next;
+		if(passes & OPTIMIZER_PASS_DEADCODE)
+		{
+			end = unreachable(first, codesize);
+		}
+		if(end > first.next)
+		{
+			current->pc = first.next;
+			current->end = end;
+			current->opcode = VM_INSTRUCTION_HALT;
+			current->saved = end - first.next;
+			current->cycles = 0;//never executed
+			rewritecount++;
+			pc = end;
+			continue;
+		}
+		uint8_t folded = 0;
+		if(passes & OPTIMIZER_PASS_FOLD)
+		{
+			folded = fold(first, codesize, &end, &current->literal);
+		}
+		if(folded > 0)
+		{
+			current->pc = first.pc;
+			current->end = end;
+			current->opcode = VM_INSTRUCTION_LOAD;
+			current->saved = end - first.next;
+			current->cycles = folded * OPTIMIZER_DISPATCH_CYCLES;
+			rewritecount++;
+			pc = end;
+			continue;
+		}
+		if((passes & OPTIMIZER_PASS_FUSE) && first.next < codesize)
+		{
+			sweep(&second, first.next, codesize);
+			uint8_t opcode = fusable(first, second);
+			if(opcode && !targeted(second.pc))
+			{
+				current->pc = first.pc;
+				current->end = second.next;
+				current->opcode = opcode;
+				current->saved = second.next - first.pc - encode(first, second, opcode, buffer);
+				current->cycles = OPTIMIZER_DISPATCH_CYCLES;
+				rewritecount++;
+				pc = second.next;
+				continue;
+			}
+		}
+		pc = first.next;
+	}
+
+#ifndef VM_HARVARD
+	if(rewritecount > 0 && codeaccessed(rewrites[0].pc, codesize))
+	{//data in the code region behind the first rewrite would be moved
+		rewritecount = 0;
+	}
+#endif
+	if(rewritecount > 0)
+	{
+		rewrite(codesize);
+		changes += rewritecount;
+	}
+	vm->programcounter = savedprogramcounter;
+	vm->statuscode = savedstatuscode;
+	return changes;
+}
+
+/**
+ * Replaces instruction pairs by superinstructions only (see optimize()).
+ * @return Number of fused pairs, 0 if the program is unchanged.
+ */
+uint8_t Optimizer::fuse()
+{
+	return optimize(OPTIMIZER_PASS_FUSE);
+}
+
+/**
+ * Decodes the instruction at an address, instructions with operand lists are skipped like by the verifier.
+ * @param in Record to write the decoded instruction into.
+ * @param pc Address of the instruction.
+ * @param codesize Size of the code region.
+ * @return True if the instruction was decoded without error.
+ */
+bool Optimizer::sweep(vm_instruction_t* in, uint16_t pc, uint16_t codesize)
+{
+	vm->programcounter = pc;
+	vm->decode(in);
+	switch(in->opcode)
+	{
+	case VM_INSTRUCTION_MULTILOAD:
+	case VM_INSTRUCTION_URLMAP:
+	case VM_INSTRUCTION_PIDINIT:
+		vm->skipOperands(in, codesize);
+		break;
+	default:
+		break;
+	}
+	return (vm->statuscode & VM_ERROR_MASK) == 0;
+}
+
+/**
+ * Replaces MUL, DIV and MOD of unsigned values by a literal power of two by LSHIFT, RSHIFT and AND with the same operand size.
+ * @param codesize Size of the code region.
+ * @return Number of replaced instructions.
+ */
+uint16_t Optimizer::reduce(uint16_t codesize)
+{
+	uint16_t reduced = 0;
+	vm_instruction_t in;
+	for(uint16_t pc = 0; pc < codesize; pc = in.next)
+	{
+		sweep(&in, pc, codesize);
+		if((in.opcode != VM_INSTRUCTION_MUL && in.opcode != VM_INSTRUCTION_DIV && in.opcode != VM_INSTRUCTION_MOD)
+				|| !in.kernel || (in.optype & VM_ADDRESS_MASK) != VM_LITERAL || (in.optype & VM_OPTYPE_MASK) == VM_OPERAND_TYPE_DEC)
+		{
+			continue;
+		}
+		uint32_t value = loadliteral(in.operand, in.optype);
+		if(value == 0 || (value & (value - 1)) != 0)
+		{//division by zero keeps its error
+			continue;
+		}
+		uint8_t shift = 0;
+		while((value >> shift) != 1)
+		{
+			shift++;
+		}
+		uint8_t opcode;
+		switch(in.opcode)
+		{
+		case VM_INSTRUCTION_MUL:
+			opcode = VM_INSTRUCTION_LSHIFT;
+			value = shift;
+			cycles += OPTIMIZER_MUL_CYCLES;
+			break;
+		case VM_INSTRUCTION_DIV:
+			opcode = VM_INSTRUCTION_RSHIFT;
+			value = shift;
+			cycles += OPTIMIZER_DIV_CYCLES;
+			break;
+		default:
+			opcode = VM_INSTRUCTION_AND;
+			value = value - 1;
+			cycles += OPTIMIZER_DIV_CYCLES;
+			break;
+		}
+		memory->storeCode(in.pc, &opcode, 1);
+		storeliteral(in.operand, in.optype, value);
+		reduced++;
+	}
+	return reduced;
+}
+
+/**
+ * Replaces jump targets which point to a JUMP by the target of the JUMP (followed over at most OPTIMIZER_THREAD_HOPS JUMPs).
+ * @param codesize Size of the code region.
+ * @return Number of replaced targets.
+ */
+uint16_t Optimizer::thread(uint16_t codesize)
+{
+	uint16_t threaded = 0;
+	vm_instruction_t in;
+	vm_instruction_t jump;
+	uint16_t field;
+	for(uint16_t pc = 0; pc < codesize; pc = in.next)
+	{
+		sweep(&in, pc, codesize);
+		uint8_t count = targetfields(in, &field);
+		for(uint8_t i = 0; i < count; i++)
+		{
+			uint16_t original = memory->loadcodeaddress(field + 2 * i);
+			uint16_t target = original;
+			uint8_t hops = 0;
+			while(hops < OPTIMIZER_THREAD_HOPS && sweep(&jump, target, codesize) && jump.opcode == VM_INSTRUCTION_JUMP)
+			{
+				target = memory->loadcodeaddress(jump.pc + 2);
+				hops++;
+			}
+			if(target != original)
+			{
+				memory->storeCode(field + 2 * i, (const uint8_t*) &target, sizeof(uint16_t));
+				cycles += hops * OPTIMIZER_DISPATCH_CYCLES;
+				threaded++;
+			}
+		}
+	}
+	return threaded;
+}
+
+/**
+ * Marks all jump targets and return addresses of the program.
+ * @param codesize Size of the code region.
+ */
+void Optimizer::marktargets(uint16_t codesize)
+{
+	vm_instruction_t in;
+	uint16_t field;
+	memset(jumptargets, 0, (codesize + 7) / 8);
+	for(uint16_t pc = 0; pc < codesize; pc = in.next)
+	{
+		sweep(&in, pc, codesize);
+		uint8_t count = targetfields(in, &field);
+		for(uint8_t i = 0; i < count; i++)
+		{
+			uint16_t target = memory->loadcodeaddress(field + 2 * i);
+			jumptargets[target >> 3] |= (1 << (target & 0x07));
+		}
+		if(in.opcode == VM_INSTRUCTION_CALL)
+		{//return address
+			jumptargets[in.next >> 3] |= (1 << (in.next & 0x07));
+		}
+	}
+}
+
+/**
+ * Folds the ADD, SUB and MUL of literals following a LOAD of a literal into the loaded constant. The instructions
+ * need the same OPTYPE and destination and must not be jump targets.
+ * @param load Decoded LOAD.
+ * @param codesize Size of the code region.
+ * @param end Set to the address behind the last folded instruction.
+ * @param literal Set to the folded constant.
+ * @return Number of folded instructions.
+ */
+uint8_t Optimizer::fold(const vm_instruction_t& load, uint16_t codesize, uint16_t* end, uint32_t* literal)
+{
+	if(load.opcode != VM_INSTRUCTION_LOAD || !load.kernel || (load.optype & VM_ADDRESS_MASK) != VM_LITERAL)
+	{
+		return 0;
+	}
+	uint8_t folded = 0;
+	uint32_t value = loadliteral(load.operand, load.optype);
+	vm_instruction_t in;
+	*end = load.next;
+	while(*end < codesize && !targeted(*end) && folded < UINT8_MAX)
+	{
+		sweep(&in, *end, codesize);
+		if(!in.kernel || in.optype != load.optype || in.address != load.address
+				|| !foldliteral(in.optype, in.opcode, &value, loadliteral(in.operand, in.optype)))
+		{
+			break;
+		}
+		*end = in.next;
+		folded++;
+	}
+	*literal = value;
+	return folded;
+}
+
+/**
+ * @param in Decoded instruction.
+ * @param codesize Size of the code region.
+ * @return Address behind the unreachable code following an instruction which never continues with the next one
+ * (the next jump target or the end of the code), the next instruction otherwise.
+ */
+uint16_t Optimizer::unreachable(const vm_instruction_t& in, uint16_t codesize)
+{
+	switch(in.opcode)
+	{
+	case VM_INSTRUCTION_HALT:
+	case VM_INSTRUCTION_RESET:
+	case VM_INSTRUCTION_JUMP:
+	case VM_INSTRUCTION_RETURN:
+	case VM_INSTRUCTION_COMPARE:
+	case VM_INSTRUCTION_SCOMPARE:
+	case VM_INSTRUCTION_ADDCOMPARE:
+	case VM_INSTRUCTION_URLMAPCOMPARE:
+	case VM_INSTRUCTION_COMPARETIME:
+	case VM_INSTRUCTION_TIMECOMPARE:
+		break;
+	default:
+		return in.next;
+	}
+	vm_instruction_t dead;
+	uint16_t end = in.next;
+	while(end < codesize && !targeted(end))
+	{
+		sweep(&dead, end, codesize);
+		end = dead.next;
+	}
+	return end;
+}
+
+/**
+ * Writes the rewritten program: replaced instructions are encoded, removed ones skipped, all other instructions are
+ * moved to close the gaps and their jump targets relocated.
+ * @param codesize Size of the code region.
+ */
+void Optimizer::rewrite(uint16_t codesize)
+{
+	vm_instruction_t first;
+	vm_instruction_t second;
+	uint8_t buffer[OPTIMIZER_FUSED_SIZE];
+	uint16_t field;
+	uint16_t out = 0;
+	uint8_t done = 0;
+	for(uint16_t pc = 0; pc < codesize; )
+	{//the code only shrinks, every instruction is read before its bytes are overwritten
+		if(done < rewritecount && rewrites[done].pc == pc)
+		{
+			const vm_rewrite_t& current = rewrites[done++];
+			uint8_t len = 0;
+			if(current.opcode == VM_INSTRUCTION_LOAD)
+			{//first instruction with the folded constant
+				sweep(&first, pc, codesize);
+				len = first.next - first.pc;
+				copycode(pc, len, buffer);
+				memory->storeCode(out, buffer, len);
+				storeliteral(out + first.operand - first.pc, first.optype, current.literal);
+			}
+			else if(current.opcode != VM_INSTRUCTION_HALT)
+			{
+				sweep(&first, pc, codesize);
+				sweep(&second, first.next, codesize);
+				len = encode(first, second, current.opcode, buffer);
+				memory->storeCode(out, buffer, len);
+			}
+			out += len;
+			pc = current.end;
+			cycles += current.cycles;
+			continue;
+		}
+		sweep(&first, pc, codesize);
+		uint16_t targets[3];
+		uint8_t count = targetfields(first, &field);
+		for(uint8_t i = 0; i < count; i++)
+		{
+			targets[i] = relocate(memory->loadcodeaddress(field + 2 * i));
+		}
+		for(uint16_t i = pc; i < first.next; i++)
+		{
+			uint8_t value = memory->loadcode(i);
+			memory->storeCode(out + i - pc, &value, 1);
+		}
+		for(uint8_t i = 0; i < count; i++)
+		{
+			memory->storeCode(out + field - pc + 2 * i, (const uint8_t*) &targets[i], sizeof(uint16_t));
+		}
+		out += first.next - pc;
+		pc = first.next;
+	}
+	uint8_t zero = 0;
+	for(uint16_t i = out; i < codesize; i++)
+	{//old code behind the program
+		memory->storeCode(i, &zero, 1);
+	}
+	memory->setCodeSize(out);
+	saved = codesize - out;
+}
+
+/**
+ * @param first Decoded first instruction.
+ * @param second Decoded following instruction.
+ * @return Opcode of the superinstruction replacing the pair, 0 (HALT) if the pair can not be fused.
+ */
+uint8_t Optimizer::fusable(const vm_instruction_t& first, const vm_instruction_t& second)
+{
+	switch(first.opcode)
+	{
+	case VM_INSTRUCTION_ADD://literal increment of the compared value, no register operands
+		if(second.opcode == VM_INSTRUCTION_COMPARE && first.kernel && second.kernel
+				&& first.optype == ((second.optype & VM_OPTYPE_MASK) | VM_LITERAL)
+				&& (second.optype & ~(VM_OPTYPE_MASK | VM_ADDRESS_MASK)) == 0
+				&& first.address == second.address)
+		{
+			return VM_INSTRUCTION_ADDCOMPARE;
+		}
+		break;
+	case VM_INSTRUCTION_TIME:
+		if(second.opcode == VM_INSTRUCTION_COMPARETIME)
+		{
+			return VM_INSTRUCTION_TIMECOMPARE;
+		}
+		break;
+	case VM_INSTRUCTION_URLMAPCHECK://status byte compared as uint8_t
+		if(second.opcode == VM_INSTRUCTION_COMPARE
+				&& (second.optype & ~VM_ADDRESS_MASK) == VM_OPERAND_TYPE_UINT8
+				&& first.address == second.address)
+		{
+			return VM_INSTRUCTION_URLMAPCOMPARE;
+		}
+		break;
+	default:
+		break;
+	}
+	return 0;
+}
+
+/**
+ * Encodes the superinstruction of a pair, jump targets are relocated.
+ * @param first Decoded first instruction.
+ * @param second Decoded following instruction.
+ * @param opcode Opcode of the superinstruction (see fusable()).
+ * @param buffer Buffer of at least OPTIMIZER_FUSED_SIZE Bytes.
+ * @return Size of the superinstruction.
+ */
+uint8_t Optimizer::encode(const vm_instruction_t& first, const vm_instruction_t& second, uint8_t opcode, uint8_t* buffer)
+{
+	uint8_t len = 0;
+	uint8_t jumps = 3;
+	buffer[len++] = opcode;
+	switch(opcode)
+	{
+	case VM_INSTRUCTION_ADDCOMPARE:
+		buffer[len++] = second.optype;
+		memcpy(buffer + len, &first.address, sizeof(uint16_t));
+		len += sizeof(uint16_t);
+		copycode(first.operand, literalwidth(first.optype), buffer + len);
+		len += literalwidth(first.optype);
+		break;
+	case VM_INSTRUCTION_TIMECOMPARE:
+		memcpy(buffer + len, &first.address, sizeof(uint16_t));
+		len += sizeof(uint16_t);
+		memcpy(buffer + len, &second.address, sizeof(uint16_t));
+		len += sizeof(uint16_t);
+		copycode(second.operand, sizeof(uint32_t), buffer + len);
+		len += sizeof(uint32_t);
+		jumps = 2;
+		break;
+	case VM_INSTRUCTION_URLMAPCOMPARE:
+		buffer[len++] = (first.optype & 0xf0) | (second.optype & (VM_OPTYPE_MASK | VM_ADDRESS_MASK));
+		if(VM_OPTYPE_IS_WIDE_ID(first.optype))
+		{
+			memcpy(buffer + len, &first.id, sizeof(uint16_t));
+			len += sizeof(uint16_t);
+		}
+		memcpy(buffer + len, &first.address, sizeof(uint16_t));
+		len += sizeof(uint16_t);
+		break;
+	default:
+		return 0;
+	}
+	if(opcode != VM_INSTRUCTION_TIMECOMPARE)
+	{//operand of the COMPARE
+		if((second.optype & VM_ADDRESS_MASK) == VM_LITERAL)
+		{
+			copycode(second.operand, literalwidth(second.optype), buffer + len);
+			len += literalwidth(second.optype);
+		}
+		else
+		{
+			memcpy(buffer + len, &second.operand, sizeof(uint16_t));
+			len += sizeof(uint16_t);
+		}
+	}
+	for(uint8_t i = 0; i < jumps; i++)
+	{
+		uint16_t target = relocate(second.jump[i]);
+		memcpy(buffer + len, &target, sizeof(uint16_t));
+		len += sizeof(uint16_t);
+	}
+	return len;
+}
+
+/**
+ * Finds the jump targets coded in an instruction. Targets are 16Bit addresses stored one after another.
+ * @param in Decoded instruction.
+ * @param field Set to the code address of the first target.
+ * @return Number of targets (0 if the instruction has none).
+ */
+uint8_t Optimizer::targetfields(const vm_instruction_t& in, uint16_t* field)
+{
+	switch(in.opcode)
+	{
+	case VM_INSTRUCTION_JUMP://verified, always literal
+		*field = in.pc + 2;
+		return 1;
+	case VM_INSTRUCTION_CALL:
+		*field = in.pc + 1;
+		return 1;
+	case VM_INSTRUCTION_COMPARE:
+	case VM_INSTRUCTION_SCOMPARE:
+	case VM_INSTRUCTION_ADDCOMPARE:
+	case VM_INSTRUCTION_URLMAPCOMPARE:
+		*field = in.next - 3 * sizeof(uint16_t);
+		return 3;
+	case VM_INSTRUCTION_COMPARETIME:
+	case VM_INSTRUCTION_TIMECOMPARE:
+		*field = in.next - 2 * sizeof(uint16_t);
+		return 2;
+	default:
+		return 0;
+	}
+}
+
+/**
+ * @param target Jump target in the original program (never inside replaced or removed instructions).
+ * @return Jump target in the rewritten program.
+ */
+uint16_t Optimizer::relocate(uint16_t target)
+{
+	uint16_t relocated = target;
+	for(uint8_t i = 0; i < rewritecount && rewrites[i].pc < target; i++)
+	{
+		relocated -= rewrites[i].saved;
+	}
+	return relocated;
+}
+
+/**
+ * @param from Start of the range.
+ * @param codesize Size of the code region (end of the range).
+ * @return True if any instruction of the program may access data in the range of the code region.
+ */
+bool Optimizer::codeaccessed(uint16_t from, uint16_t codesize)
+{
+	vm_instruction_t in;
+	for(uint16_t pc = 0; pc < codesize; pc = in.next)
+	{
+		sweep(&in, pc, codesize);
+		if(accesses(in, from, codesize))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Checks if an instruction accesses data in a range of the memory. Accesses of unknown width are assumed to be 4 Bytes,
+ * strings to be 1 Byte (a string in the code region starts and ends inside one instruction).
+ * @param in Decoded instruction.
+ * @param from Start of the range.
+ * @param to End of the range (exclusive).
+ * @return True if the instruction may access data in the range.
+ */
+bool Optimizer::accesses(const vm_instruction_t& in, uint16_t from, uint16_t to)
+{
+	bool address = (in.optype & VM_ADDRESS_MASK) == VM_ADDRESS;
+	switch(in.opcode)
+	{
+	case VM_INSTRUCTION_ADD:
+	case VM_INSTRUCTION_SUB:
+	case VM_INSTRUCTION_MUL:
+	case VM_INSTRUCTION_DIV:
+	case VM_INSTRUCTION_MOD:
+	case VM_INSTRUCTION_AND:
+	case VM_INSTRUCTION_OR:
+	case VM_INSTRUCTION_XOR:
+	case VM_INSTRUCTION_LSHIFT:
+	case VM_INSTRUCTION_RSHIFT:
+	case VM_INSTRUCTION_LOAD:
+	case VM_INSTRUCTION_COMPARE:
+	case VM_INSTRUCTION_ADDCOMPARE:
+		return (!(in.optype & VM_REGISTER_DESTINATION) && overlaps(in.address, 4, from, to))
+				|| (address && !(in.optype & VM_REGISTER_OPERAND) && overlaps(in.operand, 4, from, to));
+	case VM_INSTRUCTION_NOT:
+		return !(in.optype & VM_REGISTER_DESTINATION) && overlaps(in.address, 4, from, to);
+	case VM_INSTRUCTION_PUSH:
+		return address && overlaps(in.operand, 4, from, to);
+	case VM_INSTRUCTION_POP:
+	case VM_INSTRUCTION_TIME:
+	case VM_INSTRUCTION_COMPARETIME:
+	case VM_INSTRUCTION_SLEEPUNTIL:
+	case VM_INSTRUCTION_URLMAPCHECK:
+		return overlaps(in.address, 4, from, to);
+	case VM_INSTRUCTION_TIMECOMPARE:
+		return overlaps(in.address, 4, from, to) || overlaps(in.operand, 4, from, to);
+	case VM_INSTRUCTION_URLMAPCOMPARE:
+		return overlaps(in.address, 1, from, to) || (address && overlaps(in.operand, 1, from, to));
+	case VM_INSTRUCTION_COPY:
+		return overlaps(in.address, in.literal, from, to) || overlaps(in.operand, in.literal, from, to);
+	case VM_INSTRUCTION_MULTILOAD://opcode, optype, address, count, operands
+	{
+		uint8_t optype = memory->loadcode(in.pc + 1);
+		uint8_t count = memory->loadcode(in.pc + 4);
+		bool access = overlaps(memory->loadcodeaddress(in.pc + 2), (uint32_t) count * 4, from, to);
+		for(uint8_t i = 0; i < count && !access && (optype & VM_ADDRESS_MASK) == VM_ADDRESS; i++)
+		{
+			access = overlaps(memory->loadcodeaddress(in.pc + 5 + 2 * i), 4, from, to);
+		}
+		return access;
+	}
+	case VM_INSTRUCTION_URLMAP://opcode, optype, (wide ID), map options, value address, port, URL, resource
+	{
+		uint16_t pc = in.pc + (VM_OPTYPE_IS_WIDE_ID(memory->loadcode(in.pc + 1)) ? 4 : 2);
+		uint8_t map_options = memory->loadcode(pc);
+		bool access = overlaps(memory->loadcodeaddress(pc + 1), 4, from, to);
+		pc += 5;
+		bool literal[2] = {(map_options & VM_MAP_OPTION_URL_MASK) == VM_MAP_OPTION_URL_LITERAL,
+				(map_options & VM_MAP_OPTION_RESOURCE_MASK) == VM_MAP_OPTION_RESOURCE_LITERAL};
+		for(uint8_t i = 0; i < 2 && pc < in.next; i++)
+		{
+			if(literal[i])
+			{
+				while(pc < in.next && memory->loadcode(pc++) != 0x00);
+			}
+			else
+			{
+				access = access || overlaps(memory->loadcodeaddress(pc), 1, from, to);
+				pc += sizeof(uint16_t);
+			}
+		}
+		return access;
+	}
+	case VM_INSTRUCTION_PIDINIT://opcode, optype, input, output and setpoint address, parameters
+	{
+		bool access = false;
+		for(uint8_t i = 0; i < 3; i++)
+		{
+			access = access || overlaps(memory->loadcodeaddress(in.pc + 2 + 2 * i), sizeof(rational_t), from, to);
+		}
+		return access;
+	}
+	default:
+		return false;
+	}
+}
+
+/**
+ * @param address Code address of the literal.
+ * @param optype OPTYPE of the instruction.
+ * @return Literal, raw bits for rational_t (see operand_type::loadliteral()).
+ */
+uint32_t Optimizer::loadliteral(uint16_t address, uint8_t optype)
+{
+	switch(optype & VM_OPTYPE_MASK)
+	{
+	case VM_OPERAND_TYPE_UINT8:		return memory->loadcode(address);
+	case VM_OPERAND_TYPE_UINT16:	return memory->loadcodeaddress(address);
+	default:						return memory->loadcodeunsigned(address);
+	}
+}
+
+/**
+ * @param address Code address of the literal.
+ * @param optype OPTYPE of the instruction.
+ * @param value Literal (see loadliteral()).
+ */
+void Optimizer::storeliteral(uint16_t address, uint8_t optype, uint32_t value)
+{
+	uint8_t value8 = value;
+	uint16_t value16 = value;
+	switch(optype & VM_OPTYPE_MASK)
+	{
+	case VM_OPERAND_TYPE_UINT8:		memory->storeCode(address, &value8, sizeof(uint8_t));					break;
+	case VM_OPERAND_TYPE_UINT16:	memory->storeCode(address, (const uint8_t*) &value16, sizeof(uint16_t));	break;
+	default:						memory->storeCode(address, (const uint8_t*) &value, sizeof(uint32_t));	break;
+	}
+}
+
+/**
+ * @param address Code address of the first Byte.
+ * @param len Number of Bytes.
+ * @param buffer Buffer to copy the code into.
+ */
+void Optimizer::copycode(uint16_t address, uint8_t len, uint8_t* buffer)
+{
+	for(uint8_t i = 0; i < len; i++)
+	{
+		buffer[i] = memory->loadcode(address + i);
+	}
+}
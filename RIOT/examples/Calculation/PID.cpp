@@ -17,6 +17,7 @@
  */
 #include <stdio.h>
 #include "PID.h"
+#include "Scheduler.h"
 extern "C" {
 #include "xtimer.h"
 }
@@ -43,7 +44,8 @@ PID::PID()
 	inAuto = 0;
 	memory = 0;
 	initialized = false;
-	map_id = 0xff;
+	map_id = MEMORY_NO_MAP;
+	computations = 0;
 }
 
 /**
@@ -59,9 +61,10 @@ PID::PID()
  * @param _direction		Direction of the PID (PID_DIRECTION_DIRECT or PID_DIRECTION_REVERSE). Determines if output value has same sign as error.
  * @param _lowerLimit		Lower limit of the PID output.
  * @param _upperLimit		Upper Limit of the PID output.
+ * @return True if the PID was initialized, false if it is initialized already or an address is out of range.
  */
 bool PID::init(Memory* _memory, uint16_t _inputaddress, uint16_t _outputaddress, uint16_t _setpointaddress, rational_t _kp, rational_t _ki, rational_t _kd, uint32_t _sampleTime, uint8_t _direction, rational_t _lowerLimit, rational_t _upperLimit) {
-	if(initialized)
+	if(initialized || !inrange(_memory, _inputaddress) || !inrange(_memory, _outputaddress) || !inrange(_memory, _setpointaddress))
 	{
 		return false;
 	}
@@ -69,6 +72,9 @@ bool PID::init(Memory* _memory, uint16_t _inputaddress, uint16_t _outputaddress,
 	inputaddress = _inputaddress;
 	outputaddress = _outputaddress;
 	setpointaddress = _setpointaddress;
+	memory->share(inputaddress, sizeof(rational_t));//accessed by VM and PID thread
+	memory->share(outputaddress, sizeof(rational_t));
+	memory->share(setpointaddress, sizeof(rational_t));
 
 	inAuto = false;
 
@@ -106,7 +112,7 @@ bool PID::compute(void) {
 	{
 		return false;
 	}
-	if(map_id != 0xff && memory->checkmap(map_id, false) > 1)
+	if(map_id != MEMORY_NO_MAP && memory->checkmap(map_id, false) > 1)
 	{
 		//there is an error in the mapping, do not compute a new value
 		return false;
@@ -116,8 +122,8 @@ bool PID::compute(void) {
 	if(timeChange >= sampleTime)
 	{
 		/*Compute all the working error variables*/
-		rational_t in = memory->loadrational(inputaddress);
-		rational_t setpoint = memory->loadrational(setpointaddress);
+		rational_t in = memory->loadunchecked<rational_t>(inputaddress);
+		rational_t setpoint = memory->loadunchecked<rational_t>(setpointaddress);
 		rational_t error = setpoint - in;
 		iSum += (ki * error);
 		if(iSum > outMax)
@@ -141,11 +147,13 @@ bool PID::compute(void) {
 		{
 		  out = outMin;
 		}
-		memory->storerational(outputaddress, out);
+		memory->storeunchecked<rational_t>(outputaddress, out);
 
 		/*Remember some variables for next time*/
 		lastInput = in;
 		lastTime = now;
+		computations++;
+		Scheduler::notify();//wake the VM thread if an instance waits for the output (PIDWAIT)
 #ifdef TESTING
 		printf("in(%d): %f; set(%d): %f; err: %f; out(%d): %f;\n", inputaddress, (float)in, setpointaddress, (float)setpoint, (float)error, outputaddress, (float)out);
 #endif
@@ -209,13 +217,14 @@ void PID::setOutputLimits(rational_t min, rational_t max)
 
    if(inAuto)
    {
-	   if(memory->loadrational(outputaddress) > outMax)
+	   rational_t out = memory->loadunchecked<rational_t>(outputaddress);
+	   if(out > outMax)
 	   {
-		   memory->storerational(outputaddress, outMax);
+		   memory->storeunchecked<rational_t>(outputaddress, outMax);
 	   }
-	   else if(memory->loadrational(outputaddress) < outMin)
+	   else if(out < outMin)
 	   {
-		   memory->storerational(outputaddress, outMin);
+		   memory->storeunchecked<rational_t>(outputaddress, outMin);
 	   }
 
 	   if(iSum > outMax) iSum= outMax;
@@ -242,8 +251,8 @@ void PID::setMode(uint8_t mode)
  */
 void PID::initialize(void)
 {
-   iSum = memory->loadrational(outputaddress);
-   lastInput = memory->loadrational(inputaddress);
+   iSum = memory->loadunchecked<rational_t>(outputaddress);
+   lastInput = memory->loadunchecked<rational_t>(inputaddress);
    if(iSum > outMax)
    {
 	   iSum = outMax;
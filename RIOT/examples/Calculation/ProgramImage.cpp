@@ -0,0 +1,34 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Implementation of ProgramImage.h
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+#include "ProgramImage.h"
+
+/**
+ * @brief Empty program image.
+ */
+ProgramImage::ProgramImage()
+{
+	code = 0;
+	size = 0;
+}
+
+/**
+ * @brief Program image of a bytecode array, e.g. static const uint8_t program[] = {...}; which stays in flash.
+ * @param code Bytecode, must stay valid as long as the image is used.
+ * @param size Size of the bytecode.
+ */
+ProgramImage::ProgramImage(const uint8_t* code, uint16_t size)
+{
+	this->code = code;
+	this->size = size;
+}
@@ -0,0 +1,288 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Implementation of Scheduler.h
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+#include <new>
+
+extern "C" {
+#include "irq.h"
+#include "msg.h"
+}
+
+#include "Scheduler.h"
+#include "Optimizer.h"
+#include "ThreadVM.h"
+
+kernel_pid_t Scheduler::parked = KERNEL_PID_UNDEF;
+volatile bool Scheduler::armed = false;
+
+/**
+ * @brief Creates one VM per instance on the memory and the PID controllers of the instance. All instances are stopped.
+ */
+Scheduler::Scheduler()
+{
+	for(uint8_t i = 0; i < VM_INSTANCES; i++)
+	{
+		vms[i] = new (storage[i]) VM(&Memory::instance(i), PID::instances(i));
+		running[i] = false;
+		priority[i] = VM_PRIORITY_DEFAULT;
+	}
+	next = 0;
+}
+
+Scheduler::~Scheduler()
+{
+	for(uint8_t i = 0; i < VM_INSTANCES; i++)
+	{
+		vms[i]->~VM();
+	}
+}
+
+/**
+ * Continues the execution of an instance.
+ * @param instance Number of the instance.
+ * @return False if the instance does not exist.
+ */
+bool Scheduler::run(uint8_t instance)
+{
+	if(instance >= VM_INSTANCES)
+	{
+		return false;
+	}
+	running[instance] = true;
+	return true;
+}
+
+/**
+ * Stops the execution of an instance, the instance keeps its state.
+ * @param instance Number of the instance.
+ * @return False if the instance does not exist.
+ */
+bool Scheduler::stop(uint8_t instance)
+{
+	if(instance >= VM_INSTANCES)
+	{
+		return false;
+	}
+	running[instance] = false;
+	return true;
+}
+
+/**
+ * Clears an instance and starts its program from the beginning (clears the data of the instance in Harvard mode).
+ * @param instance Number of the instance.
+ * @return False if the instance does not exist.
+ */
+bool Scheduler::restart(uint8_t instance)
+{
+	if(instance >= VM_INSTANCES)
+	{
+		return false;
+	}
+#ifdef VM_HARVARD
+	vms[instance]->getMemory()->clear();//data only, the code segment is kept
+#endif
+	vms[instance]->clear();
+	running[instance] = true;
+	return true;
+}
+
+/**
+ * Optimizes the program of a stopped instance with all passes (see Optimizer), restart the instance afterwards.
+ * @param instance Number of the instance.
+ * @param saved Set to the number of Bytes the program shrank.
+ * @param cycles Set to the estimated number of cycles saved (see Optimizer::getCycles()).
+ * @return Number of changes, 0 if the instance does not exist or is running.
+ */
+uint16_t Scheduler::optimize(uint8_t instance, uint16_t* saved, uint32_t* cycles)
+{
+	*saved = 0;
+	*cycles = 0;
+	if(instance >= VM_INSTANCES || running[instance])
+	{
+		return 0;
+	}
+	Optimizer optimizer(vms[instance]);
+	uint16_t changes = optimizer.optimize(OPTIMIZER_PASSES_ALL);
+	*saved = optimizer.getSaved();
+	*cycles = optimizer.getCycles();
+	return changes;
+}
+
+/**
+ * Sets the priority of an instance (used by VM_SCHEDULER_PRIORITY only).
+ * @param instance Number of the instance.
+ * @param priority Priority, instances with higher values are scheduled first.
+ * @return False if the instance does not exist.
+ */
+bool Scheduler::setPriority(uint8_t instance, uint8_t priority)
+{
+	if(instance >= VM_INSTANCES)
+	{
+		return false;
+	}
+	this->priority[instance] = priority;
+	return true;
+}
+
+/**
+ *
+ * @param instance Number of the instance.
+ * @return Priority of the instance, 0 if the instance does not exist.
+ */
+uint8_t Scheduler::getPriority(uint8_t instance) const
+{
+	return instance < VM_INSTANCES ? priority[instance] : 0;
+}
+
+/**
+ *
+ * @param instance Number of the instance.
+ * @return True if the instance is scheduled.
+ */
+bool Scheduler::isRunning(uint8_t instance) const
+{
+	return instance < VM_INSTANCES && running[instance];
+}
+
+/**
+ *
+ * @param instance Number of the instance.
+ * @return True if the instance is scheduled and does not wait for an event.
+ */
+bool Scheduler::isRunnable(uint8_t instance)
+{
+	return isRunning(instance) && vms[instance]->wakeable();
+}
+
+/**
+ *
+ * @return True if no instance is runnable.
+ */
+bool Scheduler::idle()
+{
+	for(uint8_t i = 0; i < VM_INSTANCES; i++)
+	{
+		if(isRunnable(i))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Earliest time a scheduled instance waiting for time (SLEEPUNTIL) becomes runnable.
+ * @param remaining Time in µs until the instance is runnable.
+ * @return False if no scheduled instance waits for time.
+ */
+bool Scheduler::getWakeupTime(uint32_t* remaining)
+{
+	bool timed = false;
+	for(uint8_t i = 0; i < VM_INSTANCES; i++)
+	{
+		uint32_t time;
+		if(running[i] && vms[i]->getWakeupTime(&time) && (!timed || time < *remaining))
+		{
+			*remaining = time;
+			timed = true;
+		}
+	}
+	return timed;
+}
+
+/**
+ * Executes one batch (at most VM_RUN_MAX_STEPS instructions or VM_RUN_MAX_US) of the next runnable instance.
+ * Instances which halt are stopped.
+ * @return Number of the executed instance, VM_NO_INSTANCE if no instance is runnable.
+ */
+uint8_t Scheduler::schedule()
+{
+	uint8_t instance = select();
+	if(instance == VM_NO_INSTANCE)
+	{
+		return VM_NO_INSTANCE;
+	}
+	next = (instance + 1) % VM_INSTANCES;
+	vms[instance]->run(VM_RUN_MAX_STEPS, VM_RUN_MAX_US);
+	if(vms[instance]->halted())
+	{
+		running[instance] = false;
+	}
+	return instance;
+}
+
+/**
+ * Selects the instance executed next. The search starts behind the last executed instance,
+ * so instances (of equal priority) are executed in turn.
+ * @return Number of the instance, VM_NO_INSTANCE if no instance is runnable.
+ */
+uint8_t Scheduler::select()
+{
+	uint8_t selected = VM_NO_INSTANCE;
+	for(uint8_t i = 0; i < VM_INSTANCES; i++)
+	{
+		uint8_t instance = (next + i) % VM_INSTANCES;
+		if(!isRunnable(instance))
+		{
+			continue;
+		}
+#if VM_SCHEDULER == VM_SCHEDULER_PRIORITY
+		if(selected == VM_NO_INSTANCE || priority[instance] > priority[selected])
+		{
+			selected = instance;
+		}
+#else
+		return instance;
+#endif
+	}
+	return selected;
+}
+
+/**
+ * Arms the wakeup of a thread which is going to park. Events signaled by notify() after arming send one wakeup message,
+ * so the thread has to check the instances again after arming and before it parks.
+ * @param thread Thread which parks.
+ */
+void Scheduler::arm(kernel_pid_t thread)
+{
+	unsigned state = irq_disable();
+	parked = thread;
+	armed = true;
+	irq_restore(state);
+}
+
+/**
+ * @brief Disarms the wakeup after the parked thread continued.
+ */
+void Scheduler::disarm()
+{
+	armed = false;
+}
+
+/**
+ * Signals an event an instance may wait for (URL-Map handled, PID computed). Sends a wakeup message to the parked thread
+ * if the wakeup is armed, so the message queue holds at most one wakeup message per park. Can be called from any thread.
+ */
+void Scheduler::notify()
+{
+	unsigned state = irq_disable();
+	bool wakeup = armed;
+	armed = false;
+	irq_restore(state);
+	if(wakeup)
+	{
+		msg_t m;
+		m.content.value = VM_THREAD_MESSAGE(VM_THREAD_WAKEUP, VM_NO_INSTANCE, 0);
+		msg_try_send(&m, parked);//a full queue wakes the thread as well
+	}
+}
@@ -13,9 +13,21 @@
  */
 
 #include <string.h>
-#include <stdexcept>
 #include "Stack.h"
 
+#ifdef VM_NO_EXCEPTIONS
+///Sets the sticky stack error flag and leaves the function
+#define STACK_VIOLATION(exception, message)					do { stackerror = true; return; } while(0)
+///Sets the sticky stack error flag and leaves the function with a return value
+#define STACK_VIOLATION_RETURN(exception, message, value)	do { stackerror = true; return value; } while(0)
+#else
+#include <stdexcept>
+///Throws exception
+#define STACK_VIOLATION(exception, message)					throw exception(message)
+///Throws exception
+#define STACK_VIOLATION_RETURN(exception, message, value)	throw exception(message)
+#endif
+
 /**
  *	@brief Stack is a class used by the VM to store addresses in case of CALL and RETURN instructions.
  */
@@ -23,6 +35,7 @@ Stack::Stack()
 {
 	pointer = 0;
 	size = STACK_SIZE;
+	stackerror = false;
 }
 
 /**
@@ -32,7 +45,7 @@ void Stack::push(uint16_t address)
 {
 	if(pointer == size)
 	{
-		throw std::overflow_error("Stack Overflow");
+		STACK_VIOLATION(std::overflow_error, "Stack Overflow");
 	}
 	this->stack[pointer++] = address;
 }
@@ -44,7 +57,7 @@ void Stack::push(uint16_t address)
 uint16_t Stack::pop(void)
 {
 	if(pointer == 0) {
-		throw std::underflow_error("Stack Underflow");
+		STACK_VIOLATION_RETURN(std::underflow_error, "Stack Underflow", 0);
 	}
 	return this->stack[--pointer];
 }
@@ -56,7 +69,7 @@ uint16_t Stack::pop(void)
 uint16_t Stack::peek(void)
 {
 	if(pointer == 0) {
-		throw std::underflow_error("Stack Underflow");
+		STACK_VIOLATION_RETURN(std::underflow_error, "Stack Underflow", 0);
 	}
 	return this->stack[pointer - 1];
 }
@@ -103,5 +116,6 @@ bool Stack::isFull()
 void Stack::clear()
 {
 	pointer = 0;
+	stackerror = false;
 	memset(stack, 0, size * sizeof(uint16_t));
 }
@@ -32,7 +32,7 @@ void *pid_thread(void *arg)
 	//msg_t m;
 	//msg_init_queue(pid_rcv_queue, RCV_QUEUE_SIZE);
 	while (1) {
-		for(uint8_t i = 0; i < VM_PID_NUM_AVAILABLE; i++)
+		for(uint16_t i = 0; i < PID_NUM_INSTANCES; i++)
 		{
 			PID::instances()[i].compute();
 		}
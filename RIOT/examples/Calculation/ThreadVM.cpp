@@ -11,24 +11,28 @@
  *
  * @author      Mattes Besuden <besuden@uni-bremen.de>
  */
+#include <stdio.h>
+
 extern "C" {
 #include "thread.h"
 #include "msg.h"
+#include "xtimer.h"
 }
 
 #include "ThreadVM.h"
-#include "CalculationVM.h"
+#include "Scheduler.h"
 
 void *vm_thread(void* arg);
-void parse(msg_t* m, VM* vm);
-
-bool vm_thread_run = false;
-bool vm_thread_restart = false;
+void parse(msg_t* m, Scheduler* scheduler);
 
 static msg_t vm_thread_queue[RCV_QUEUE_SIZE];
+///Wakes the VM thread when the first instance waiting for time (SLEEPUNTIL) becomes runnable
+static xtimer_t vm_thread_timer;
+static msg_t vm_thread_wakeup;
 
 /**
- * VM thread function
+ * VM thread function, executes all VM instances. Parks in msg_receive() while no instance is runnable,
+ * waiting instances are woken by the wakeup timer or by Scheduler::notify().
  * @param arg
  */
 void *vm_thread(void *arg)
@@ -37,64 +41,87 @@ void *vm_thread(void *arg)
 	msg_t m;
 	msg_init_queue(vm_thread_queue, RCV_QUEUE_SIZE);
 
-	printf("VM Thread started, pid: %" PRIkernel_pid "\n", thread_getpid());
-	VM vm(&Memory::instance(), PID::instances());
+	printf("VM Thread started, pid: %" PRIkernel_pid ", %d instances\n", thread_getpid(), VM_INSTANCES);
+	static Scheduler scheduler;
 
 	while(1)
 	{
-		if(vm_thread_run)
+		if(!scheduler.idle())
 		{
-			if(msg_try_receive(&m) == 1)
-			{
-				parse(&m, &vm);
+			while(msg_try_receive(&m) == 1)
+			{//messages are only checked between batches, handle all pending ones
+				parse(&m, &scheduler);
 			}
-			if(vm_thread_restart)
+			uint8_t instance = scheduler.schedule();
+			if(instance != VM_NO_INSTANCE && scheduler.getVM(instance)->halted() && scheduler.getVM(instance)->errorFlag())
 			{
-				vm.clear();
-				vm_thread_restart = false;
-			}
-			vm.executeStep();
-			if(vm.halted())
-			{
-				vm_thread_run = false;
-				if(vm.errorFlag())
-				{
-					printf("VM ERROR: 0x%08" PRIx32 , vm.getStatuscode());
-				}
+				printf("VM %d ERROR: 0x%08" PRIx32 , instance, scheduler.getVM(instance)->getStatuscode());
 			}
 		}
 		else
 		{
-			msg_receive(&m);
-			parse(&m, &vm);
+			Scheduler::arm(thread_getpid());
+			if(scheduler.idle())
+			{//checked again after arming, an event signaled in between sends a wakeup message
+				uint32_t remaining;
+				bool timed = scheduler.getWakeupTime(&remaining);
+				if(timed)
+				{
+					vm_thread_wakeup.content.value = VM_THREAD_MESSAGE(VM_THREAD_WAKEUP, VM_NO_INSTANCE, 0);
+					xtimer_set_msg(&vm_thread_timer, remaining, &vm_thread_wakeup, thread_getpid());
+				}
+				msg_receive(&m);
+				if(timed)
+				{
+					xtimer_remove(&vm_thread_timer);
+				}
+				parse(&m, &scheduler);
+			}
+			Scheduler::disarm();
 		}
 	}
 	return 0;
 }
 
 /**
- * Parses received message and executes command
+ * Parses received message and executes command on the addressed VM instance
  * @param m Message
- * @param vm VM.h
+ * @param scheduler Scheduler of the VM instances
  */
-void parse(msg_t* m, VM* vm)
+void parse(msg_t* m, Scheduler* scheduler)
 {
-	switch(m->content.value)
+	uint8_t instance = VM_THREAD_INSTANCE(m->content.value);
+	switch(VM_THREAD_COMMAND(m->content.value))
 	{
 	case VM_THREAD_RUN:
-		vm_thread_run = true;
+		scheduler->run(instance);
 		break;
 	case VM_THREAD_STOP:
-		vm_thread_run = false;
+		scheduler->stop(instance);
 		break;
 	case VM_THREAD_RESTART:
-		vm_thread_restart = true;
-		vm_thread_run = true;
+		scheduler->restart(instance);
+		break;
+	case VM_THREAD_PRIORITY:
+		scheduler->setPriority(instance, VM_THREAD_ARGUMENT(m->content.value));
 		break;
+	case VM_THREAD_WAKEUP:
+		break;//the scheduler checks the waiting instances
 	case VM_THREAD_STATUS:
-		m->content.value = vm->getStatuscode();
+		m->content.value = instance < scheduler->getInstanceCount() ? scheduler->getVM(instance)->getStatuscode() : 0;
 		msg_send(m, m->sender_pid);
 		break;
+	case VM_THREAD_OPTIMIZE:
+	{
+		uint16_t saved = 0;
+		uint32_t cycles = 0;
+#ifdef VM_PEEPHOLE
+		scheduler->optimize(instance, &saved, &cycles);
+#endif
+		m->content.value = VM_THREAD_OPTIMIZED(saved, cycles);
+		msg_send(m, m->sender_pid);
+		break;
+	}
 	default: break;
 	}
 }
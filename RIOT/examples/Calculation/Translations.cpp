@@ -0,0 +1,400 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Programs translated into native code (see Translation.h), generated by the Translator (see Translator.h).
+ * 				Translate the programs again instead of editing this file.
+ */
+#include "CalculationVM.h"
+
+#ifdef VM_TRANSLATIONS
+
+///ggt (99 Bytes)
+static const uint8_t translated_ggt_code[] = {
+		0x20, 0x01, 0x70, 0x00, 0x5f, 0xe5, 0x73, 0x6d, 0x20, 0x01, 0x74, 0x00, 0x82, 0x3f, 0xa5, 0x43,
+		0x60, 0x80, 0x00, 0x52, 0x01, 0x70, 0x00, 0x00, 0x00, 0x00, 0x00, 0x2b, 0x00, 0x21, 0x00, 0x2b,
+		0x00, 0x20, 0x00, 0x70, 0x00, 0x74, 0x00, 0x51, 0x01, 0x59, 0x00, 0x52, 0x01, 0x74, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x39, 0x00, 0x59, 0x00, 0x39, 0x00, 0x52, 0x00, 0x70, 0x00, 0x74, 0x00, 0x4f,
+		0x00, 0x4f, 0x00, 0x45, 0x00, 0x02, 0x00, 0x70, 0x00, 0x74, 0x00, 0x51, 0x01, 0x2b, 0x00, 0x02,
+		0x00, 0x74, 0x00, 0x70, 0x00, 0x51, 0x01, 0x2b, 0x00, 0x60, 0x84, 0x00, 0x02, 0x00, 0x84, 0x00,
+		0x80, 0x00, 0x00
+};
+
+/**
+ * Translation of ggt, see vm_translated_t.
+ */
+static uint32_t translated_ggt(vm_translation_state_t* state, uint32_t max_steps)
+{
+	uint32_t steps = 0;
+	uint32_t statuscode = state->statuscode;
+	uint16_t programcounter;
+	uint32_t cells[4];
+	translatedfetch<uint32_t, 0x0070>(state, cells[0]);
+	translatedfetch<uint32_t, 0x0074>(state, cells[1]);
+	translatedfetch<uint32_t, 0x0080>(state, cells[2]);
+	translatedfetch<uint32_t, 0x0084>(state, cells[3]);
+	switch(state->programcounter)
+	{
+	case 0x0000: goto L0000;
+	case 0x0013: goto L0013;
+	case 0x0021: goto L0021;
+	case 0x002b: goto L002b;
+	case 0x0039: goto L0039;
+	case 0x0045: goto L0045;
+	case 0x004f: goto L004f;
+	case 0x0059: goto L0059;
+	case 0x005c: goto L005c;
+	default: return 0;
+	}
+L0000:	VM_TRANSLATED_BLOCK(0x0000, 3);
+	//0x0000 LOAD
+	translatedkernel<uint32_t, OpLoad, TranslatedCell<0>, TranslatedLiteral<0x6d73e55fu> >(state, cells);
+	//0x0008 LOAD
+	translatedkernel<uint32_t, OpLoad, TranslatedCell<1>, TranslatedLiteral<0x43a53f82u> >(state, cells);
+	//0x0010 TIME
+	VM_TRANSLATED_STATUS(0x0010, VM_INSTRUCTION_TIME);
+	translatedtime<TranslatedCell<2> >(state, cells);
+	VM_TRANSLATED_EXIT(0x0013);
+L0013:	VM_TRANSLATED_BLOCK(0x0013, 1);
+	//0x0013 COMPARE
+	VM_TRANSLATED_STATUS(0x0013, VM_INSTRUCTION_COMPARE);
+	VM_TRANSLATED_BRANCH((translatedcompare<uint32_t, TranslatedCell<0>, TranslatedLiteral<0x00000000u> >(state, cells)), L002b, L0021, L002b);
+L0021:	VM_TRANSLATED_BLOCK(0x0021, 2);
+	//0x0021 LOAD
+	translatedkernel<uint32_t, OpLoad, TranslatedCell<0>, TranslatedCell<1> >(state, cells);
+	//0x0027 JUMP
+	VM_TRANSLATED_STATUS(0x0027, VM_INSTRUCTION_JUMP);
+	goto L0059;
+L002b:	VM_TRANSLATED_BLOCK(0x002b, 1);
+	//0x002b COMPARE
+	VM_TRANSLATED_STATUS(0x002b, VM_INSTRUCTION_COMPARE);
+	VM_TRANSLATED_BRANCH((translatedcompare<uint32_t, TranslatedCell<1>, TranslatedLiteral<0x00000000u> >(state, cells)), L0039, L0059, L0039);
+L0039:	VM_TRANSLATED_BLOCK(0x0039, 1);
+	//0x0039 COMPARE
+	VM_TRANSLATED_STATUS(0x0039, VM_INSTRUCTION_COMPARE);
+	VM_TRANSLATED_BRANCH((translatedcompare<uint32_t, TranslatedCell<0>, TranslatedCell<1> >(state, cells)), L004f, L004f, L0045);
+L0045:	VM_TRANSLATED_BLOCK(0x0045, 2);
+	//0x0045 SUB
+	translatedkernel<uint32_t, OpSub, TranslatedCell<0>, TranslatedCell<1> >(state, cells);
+	//0x004b JUMP
+	VM_TRANSLATED_STATUS(0x004b, VM_INSTRUCTION_JUMP);
+	goto L002b;
+L004f:	VM_TRANSLATED_BLOCK(0x004f, 2);
+	//0x004f SUB
+	translatedkernel<uint32_t, OpSub, TranslatedCell<1>, TranslatedCell<0> >(state, cells);
+	//0x0055 JUMP
+	VM_TRANSLATED_STATUS(0x0055, VM_INSTRUCTION_JUMP);
+	goto L002b;
+L0059:	VM_TRANSLATED_BLOCK(0x0059, 1);
+	//0x0059 TIME
+	VM_TRANSLATED_STATUS(0x0059, VM_INSTRUCTION_TIME);
+	translatedtime<TranslatedCell<3> >(state, cells);
+	VM_TRANSLATED_EXIT(0x005c);
+L005c:	VM_TRANSLATED_BLOCK(0x005c, 2);
+	//0x005c SUB
+	translatedkernel<uint32_t, OpSub, TranslatedCell<3>, TranslatedCell<2> >(state, cells);
+	//0x0062 HALT
+	VM_TRANSLATED_STATUS(0x0062, VM_INSTRUCTION_HALT);
+	state->flags |= VM_FLAG_HALTED;
+	VM_TRANSLATED_EXIT(0x0062);
+leave:
+	translatedwriteback<uint32_t, 0x0070>(state, cells[0]);
+	translatedwriteback<uint32_t, 0x0074>(state, cells[1]);
+	translatedwriteback<uint32_t, 0x0080>(state, cells[2]);
+	translatedwriteback<uint32_t, 0x0084>(state, cells[3]);
+	state->programcounter = programcounter;
+	state->statuscode = statuscode;
+	return steps;
+}
+
+///expressions (228 Bytes)
+static const uint8_t translated_expressions_code[] = {
+		0x20, 0x85, 0x02, 0xc8, 0x20, 0x87, 0x03, 0xe8, 0x03, 0x20, 0x83, 0x01, 0x80, 0x02, 0x00, 0x00,
+		0x20, 0x03, 0x0c, 0x02, 0x00, 0x00, 0x00, 0x00, 0x20, 0xc6, 0x0f, 0x02, 0x04, 0x87, 0x0f, 0x32,
+		0x00, 0x20, 0x46, 0x00, 0x02, 0x03, 0x01, 0x07, 0x00, 0x02, 0x0d, 0x00, 0x03, 0x46, 0x00, 0x02,
+		0x0f, 0x04, 0x07, 0x00, 0x02, 0x02, 0x00, 0x05, 0x07, 0x00, 0x02, 0x07, 0x00, 0x13, 0x07, 0x00,
+		0x02, 0xff, 0x00, 0x20, 0x40, 0x04, 0x02, 0x02, 0x01, 0x01, 0x04, 0x02, 0xa0, 0x86, 0x01, 0x00,
+		0x20, 0x44, 0x08, 0x02, 0x03, 0x20, 0xc4, 0x0f, 0x02, 0x14, 0x85, 0x0f, 0x01, 0x11, 0x85, 0x0f,
+		0x03, 0x20, 0x44, 0x10, 0x02, 0x02, 0x12, 0x04, 0x10, 0x02, 0x10, 0x44, 0x10, 0x02, 0x0f, 0x20,
+		0x87, 0x00, 0x00, 0x00, 0x20, 0x01, 0x14, 0x02, 0x00, 0x00, 0x00, 0x00, 0x51, 0x01, 0xd8, 0x00,
+		0x01, 0x87, 0x00, 0x01, 0x00, 0x20, 0xc6, 0x0f, 0x00, 0x05, 0x87, 0x0f, 0x03, 0x00, 0x52, 0x87,
+		0x0f, 0x00, 0x00, 0xad, 0x00, 0x99, 0x00, 0xad, 0x00, 0x20, 0xc0, 0x0f, 0x00, 0x15, 0x81, 0x0f,
+		0x01, 0x00, 0x00, 0x00, 0x01, 0x40, 0x14, 0x02, 0x0f, 0x51, 0x01, 0xc0, 0x00, 0x52, 0x87, 0x00,
+		0x22, 0x01, 0xc0, 0x00, 0xb8, 0x00, 0xb8, 0x00, 0x01, 0x01, 0x14, 0x02, 0xe8, 0x03, 0x00, 0x00,
+		0x20, 0xc2, 0x0f, 0x01, 0x04, 0x83, 0x0f, 0x00, 0x04, 0x00, 0x00, 0x01, 0x42, 0x0c, 0x02, 0x0f,
+		0x02, 0x03, 0x0c, 0x02, 0x80, 0x00, 0x00, 0x00, 0x52, 0x87, 0x00, 0x2c, 0x01, 0x80, 0x00, 0xe3,
+		0x00, 0xe3, 0x00, 0x00
+};
+
+/**
+ * Translation of expressions, see vm_translated_t.
+ */
+static uint32_t translated_expressions(vm_translation_state_t* state, uint32_t max_steps)
+{
+	uint32_t steps = 0;
+	uint32_t statuscode = state->statuscode;
+	uint16_t programcounter;
+	uint32_t cells[6];
+	translatedfetch<rational_t, 0x020c>(state, cells[0]);
+	translatedfetch<uint16_t, 0x0200>(state, cells[1]);
+	translatedfetch<uint32_t, 0x0204>(state, cells[2]);
+	translatedfetch<uint8_t, 0x0208>(state, cells[3]);
+	translatedfetch<uint8_t, 0x0210>(state, cells[4]);
+	translatedfetch<uint32_t, 0x0214>(state, cells[5]);
+	switch(state->programcounter)
+	{
+	case 0x0000: goto L0000;
+	case 0x0080: goto L0080;
+	case 0x0099: goto L0099;
+	case 0x00ad: goto L00ad;
+	case 0x00b8: goto L00b8;
+	case 0x00c0: goto L00c0;
+	case 0x00d8: goto L00d8;
+	case 0x00e3: goto L00e3;
+	default: return 0;
+	}
+L0000:	VM_TRANSLATED_BLOCK(0x0000, 24);
+	//0x0000 LOAD
+	translatedkernel<uint8_t, OpLoad, TranslatedRegister<2>, TranslatedLiteral<0x000000c8u> >(state, cells);
+	//0x0004 LOAD
+	translatedkernel<uint16_t, OpLoad, TranslatedRegister<3>, TranslatedLiteral<0x000003e8u> >(state, cells);
+	//0x0009 LOAD
+	translatedkernel<rational_t, OpLoad, TranslatedRegister<1>, TranslatedLiteral<0x00000280u> >(state, cells);
+	//0x0010 LOAD
+	translatedkernel<rational_t, OpLoad, TranslatedCell<0>, TranslatedLiteral<0x00000000u> >(state, cells);
+	//0x0018 LOAD
+	translatedkernel<uint16_t, OpLoad, TranslatedRegister<15>, TranslatedRegister<2> >(state, cells);
+	//0x001c DIV
+	if(!translatedkernel<uint16_t, OpDiv, TranslatedRegister<15>, TranslatedLiteral<0x00000032u> >(state, cells)) VM_TRANSLATED_DIVIDEZERO(0x001c, VM_INSTRUCTION_DIV, 0x0021, 18);
+	//0x0021 LOAD
+	translatedkernel<uint16_t, OpLoad, TranslatedCell<1>, TranslatedRegister<3> >(state, cells);
+	//0x0026 ADD
+	translatedkernel<uint16_t, OpAdd, TranslatedCell<1>, TranslatedLiteral<0x0000000du> >(state, cells);
+	//0x002c MUL
+	translatedkernel<uint16_t, OpMul, TranslatedCell<1>, TranslatedRegister<15> >(state, cells);
+	//0x0031 DIV
+	if(!translatedkernel<uint16_t, OpDiv, TranslatedCell<1>, TranslatedLiteral<0x00000002u> >(state, cells)) VM_TRANSLATED_DIVIDEZERO(0x0031, VM_INSTRUCTION_DIV, 0x0037, 14);
+	//0x0037 MOD
+	if(!translatedkernel<uint16_t, OpMod, TranslatedCell<1>, TranslatedLiteral<0x00000007u> >(state, cells)) VM_TRANSLATED_DIVIDEZERO(0x0037, VM_INSTRUCTION_MOD, 0x003d, 13);
+	//0x003d XOR
+	translatedkernel<uint16_t, OpXor, TranslatedCell<1>, TranslatedLiteral<0x000000ffu> >(state, cells);
+	//0x0043 LOAD
+	translatedkernel<uint32_t, OpLoad, TranslatedCell<2>, TranslatedRegister<2> >(state, cells);
+	//0x0048 ADD
+	translatedkernel<uint32_t, OpAdd, TranslatedCell<2>, TranslatedLiteral<0x000186a0u> >(state, cells);
+	//0x0050 LOAD
+	translatedkernel<uint8_t, OpLoad, TranslatedCell<3>, TranslatedRegister<3> >(state, cells);
+	//0x0055 LOAD
+	translatedkernel<uint8_t, OpLoad, TranslatedRegister<15>, TranslatedRegister<2> >(state, cells);
+	//0x0059 LSHIFT
+	translatedkernel<uint8_t, OpLshift, TranslatedRegister<15>, TranslatedLiteral<0x00000001u> >(state, cells);
+	//0x005d OR
+	translatedkernel<uint8_t, OpOr, TranslatedRegister<15>, TranslatedLiteral<0x00000003u> >(state, cells);
+	//0x0061 LOAD
+	translatedkernel<uint8_t, OpLoad, TranslatedCell<4>, TranslatedRegister<2> >(state, cells);
+	//0x0066 NOT
+	translatedkernel<uint8_t, OpNot, TranslatedCell<4>, TranslatedLiteral<0x00000000u> >(state, cells);
+	//0x006a AND
+	translatedkernel<uint8_t, OpAnd, TranslatedCell<4>, TranslatedRegister<15> >(state, cells);
+	//0x006f LOAD
+	translatedkernel<uint16_t, OpLoad, TranslatedRegister<0>, TranslatedLiteral<0x00000000u> >(state, cells);
+	//0x0074 LOAD
+	translatedkernel<uint32_t, OpLoad, TranslatedCell<5>, TranslatedLiteral<0x00000000u> >(state, cells);
+	//0x007c JUMP
+	VM_TRANSLATED_STATUS(0x007c, VM_INSTRUCTION_JUMP);
+	goto L00d8;
+L0080:	VM_TRANSLATED_BLOCK(0x0080, 4);
+	//0x0080 ADD
+	translatedkernel<uint16_t, OpAdd, TranslatedRegister<0>, TranslatedLiteral<0x00000001u> >(state, cells);
+	//0x0085 LOAD
+	translatedkernel<uint16_t, OpLoad, TranslatedRegister<15>, TranslatedRegister<0> >(state, cells);
+	//0x0089 MOD
+	if(!translatedkernel<uint16_t, OpMod, TranslatedRegister<15>, TranslatedLiteral<0x00000003u> >(state, cells)) VM_TRANSLATED_DIVIDEZERO(0x0089, VM_INSTRUCTION_MOD, 0x008e, 1);
+	//0x008e COMPARE
+	VM_TRANSLATED_STATUS(0x008e, VM_INSTRUCTION_COMPARE);
+	VM_TRANSLATED_BRANCH((translatedcompare<uint16_t, TranslatedRegister<15>, TranslatedLiteral<0x00000000u> >(state, cells)), L00ad, L0099, L00ad);
+L0099:	VM_TRANSLATED_BLOCK(0x0099, 4);
+	//0x0099 LOAD
+	translatedkernel<uint32_t, OpLoad, TranslatedRegister<15>, TranslatedRegister<0> >(state, cells);
+	//0x009d RSHIFT
+	translatedkernel<uint32_t, OpRshift, TranslatedRegister<15>, TranslatedLiteral<0x00000001u> >(state, cells);
+	//0x00a4 ADD
+	translatedkernel<uint32_t, OpAdd, TranslatedCell<5>, TranslatedRegister<15> >(state, cells);
+	//0x00a9 JUMP
+	VM_TRANSLATED_STATUS(0x00a9, VM_INSTRUCTION_JUMP);
+	goto L00c0;
+L00ad:	VM_TRANSLATED_BLOCK(0x00ad, 1);
+	//0x00ad COMPARE
+	VM_TRANSLATED_STATUS(0x00ad, VM_INSTRUCTION_COMPARE);
+	VM_TRANSLATED_BRANCH((translatedcompare<uint16_t, TranslatedRegister<0>, TranslatedLiteral<0x00000122u> >(state, cells)), L00c0, L00b8, L00b8);
+L00b8:	VM_TRANSLATED_BLOCK(0x00b8, 1);
+	//0x00b8 ADD
+	translatedkernel<uint32_t, OpAdd, TranslatedCell<5>, TranslatedLiteral<0x000003e8u> >(state, cells);
+	VM_TRANSLATED_STATUS(0x00b8, VM_INSTRUCTION_ADD);
+L00c0:	VM_TRANSLATED_BLOCK(0x00c0, 4);
+	//0x00c0 LOAD
+	translatedkernel<rational_t, OpLoad, TranslatedRegister<15>, TranslatedRegister<1> >(state, cells);
+	//0x00c4 DIV
+	if(!translatedkernel<rational_t, OpDiv, TranslatedRegister<15>, TranslatedLiteral<0x00000400u> >(state, cells)) VM_TRANSLATED_DIVIDEZERO(0x00c4, VM_INSTRUCTION_DIV, 0x00cb, 2);
+	//0x00cb ADD
+	translatedkernel<rational_t, OpAdd, TranslatedCell<0>, TranslatedRegister<15> >(state, cells);
+	//0x00d0 SUB
+	translatedkernel<rational_t, OpSub, TranslatedCell<0>, TranslatedLiteral<0x00000080u> >(state, cells);
+	VM_TRANSLATED_STATUS(0x00d0, VM_INSTRUCTION_SUB);
+L00d8:	VM_TRANSLATED_BLOCK(0x00d8, 1);
+	//0x00d8 COMPARE
+	VM_TRANSLATED_STATUS(0x00d8, VM_INSTRUCTION_COMPARE);
+	VM_TRANSLATED_BRANCH((translatedcompare<uint16_t, TranslatedRegister<0>, TranslatedLiteral<0x0000012cu> >(state, cells)), L0080, L00e3, L00e3);
+L00e3:	VM_TRANSLATED_BLOCK(0x00e3, 1);
+	//0x00e3 HALT
+	VM_TRANSLATED_STATUS(0x00e3, VM_INSTRUCTION_HALT);
+	state->flags |= VM_FLAG_HALTED;
+	VM_TRANSLATED_EXIT(0x00e3);
+leave:
+	translatedwriteback<rational_t, 0x020c>(state, cells[0]);
+	translatedwriteback<uint16_t, 0x0200>(state, cells[1]);
+	translatedwriteback<uint32_t, 0x0204>(state, cells[2]);
+	translatedwriteback<uint8_t, 0x0208>(state, cells[3]);
+	translatedwriteback<uint8_t, 0x0210>(state, cells[4]);
+	translatedwriteback<uint32_t, 0x0214>(state, cells[5]);
+	state->programcounter = programcounter;
+	state->statuscode = statuscode;
+	return steps;
+}
+
+///divide (47 Bytes)
+static const uint8_t translated_divide_code[] = {
+		0x20, 0x07, 0x00, 0x02, 0x34, 0x12, 0x12, 0x06, 0x00, 0x02, 0x13, 0x07, 0x00, 0x02, 0xff, 0x00,
+		0x20, 0x86, 0x01, 0x00, 0x02, 0x60, 0x20, 0x02, 0x53, 0x29, 0x00, 0x20, 0x85, 0x02, 0x00, 0x05,
+		0x87, 0x01, 0x00, 0x01, 0x04, 0xc6, 0x01, 0x02, 0x00, 0x15, 0x87, 0x01, 0x04, 0x00, 0x54
+};
+
+/**
+ * Translation of divide, see vm_translated_t.
+ */
+static uint32_t translated_divide(vm_translation_state_t* state, uint32_t max_steps)
+{
+	uint32_t steps = 0;
+	uint32_t statuscode = state->statuscode;
+	uint16_t programcounter;
+	uint32_t cells[2];
+	translatedfetch<uint16_t, 0x0200>(state, cells[0]);
+	translatedfetch<uint32_t, 0x0220>(state, cells[1]);
+	switch(state->programcounter)
+	{
+	case 0x0000: goto L0000;
+	case 0x0018: goto L0018;
+	case 0x001b: goto L001b;
+	case 0x0029: goto L0029;
+	case 0x002e: goto L002e;
+	default: return 0;
+	}
+L0000:	VM_TRANSLATED_BLOCK(0x0000, 5);
+	//0x0000 LOAD
+	translatedkernel<uint16_t, OpLoad, TranslatedCell<0>, TranslatedLiteral<0x00001234u> >(state, cells);
+	//0x0006 NOT
+	translatedkernel<uint16_t, OpNot, TranslatedCell<0>, TranslatedLiteral<0x00000000u> >(state, cells);
+	//0x000a XOR
+	translatedkernel<uint16_t, OpXor, TranslatedCell<0>, TranslatedLiteral<0x000000ffu> >(state, cells);
+	//0x0010 LOAD
+	translatedkernel<uint16_t, OpLoad, TranslatedRegister<1>, TranslatedCell<0> >(state, cells);
+	//0x0015 TIME
+	VM_TRANSLATED_STATUS(0x0015, VM_INSTRUCTION_TIME);
+	translatedtime<TranslatedCell<1> >(state, cells);
+	VM_TRANSLATED_EXIT(0x0018);
+L0018:	VM_TRANSLATED_EXIT(0x0018);	//CALL
+L001b:	VM_TRANSLATED_BLOCK(0x001b, 4);
+	//0x001b LOAD
+	translatedkernel<uint8_t, OpLoad, TranslatedRegister<2>, TranslatedLiteral<0x00000000u> >(state, cells);
+	//0x001f MOD
+	if(!translatedkernel<uint16_t, OpMod, TranslatedRegister<1>, TranslatedLiteral<0x00000100u> >(state, cells)) VM_TRANSLATED_DIVIDEZERO(0x001f, VM_INSTRUCTION_MOD, 0x0024, 2);
+	//0x0024 DIV
+	if(!translatedkernel<uint16_t, OpDiv, TranslatedRegister<1>, TranslatedRegister<2> >(state, cells)) VM_TRANSLATED_DIVIDEZERO(0x0024, VM_INSTRUCTION_DIV, 0x0028, 1);
+	//0x0028 HALT
+	VM_TRANSLATED_STATUS(0x0028, VM_INSTRUCTION_HALT);
+	state->flags |= VM_FLAG_HALTED;
+	VM_TRANSLATED_EXIT(0x0028);
+L0029:	VM_TRANSLATED_BLOCK(0x0029, 1);
+	//0x0029 RSHIFT
+	translatedkernel<uint16_t, OpRshift, TranslatedRegister<1>, TranslatedLiteral<0x00000004u> >(state, cells);
+	VM_TRANSLATED_STATUS(0x0029, VM_INSTRUCTION_RSHIFT);
+L002e:	VM_TRANSLATED_EXIT(0x002e);	//RETURN
+leave:
+	translatedwriteback<uint16_t, 0x0200>(state, cells[0]);
+	translatedwriteback<uint32_t, 0x0220>(state, cells[1]);
+	state->programcounter = programcounter;
+	state->statuscode = statuscode;
+	return steps;
+}
+
+///shared (69 Bytes)
+static const uint8_t translated_shared_code[] = {
+		0x70, 0x00, 0x1f, 0x30, 0x02, 0x00, 0x00, 0x61, 0x66, 0x66, 0x65, 0x3a, 0x3a, 0x31, 0x00, 0x2f,
+		0x73, 0x65, 0x6e, 0x73, 0x6f, 0x72, 0x00, 0x01, 0x01, 0x30, 0x02, 0x03, 0x00, 0x00, 0x00, 0x01,
+		0x01, 0x40, 0x02, 0x01, 0x00, 0x00, 0x00, 0x01, 0x01, 0x50, 0x02, 0x01, 0x00, 0x01, 0x00, 0x52,
+		0x01, 0x40, 0x02, 0x0a, 0x00, 0x00, 0x00, 0x17, 0x00, 0x3d, 0x00, 0x3d, 0x00, 0x20, 0x86, 0x01,
+		0x50, 0x02, 0x72, 0x00, 0x00
+};
+
+/**
+ * Translation of shared, see vm_translated_t.
+ */
+static uint32_t translated_shared(vm_translation_state_t* state, uint32_t max_steps)
+{
+	uint32_t steps = 0;
+	uint32_t statuscode = state->statuscode;
+	uint16_t programcounter;
+	uint32_t cells[1];
+	translatedfetch<uint32_t, 0x0240>(state, cells[0]);
+	switch(state->programcounter)
+	{
+	case 0x0000: goto L0000;
+	case 0x0017: goto L0017;
+	case 0x003d: goto L003d;
+	case 0x0042: goto L0042;
+	case 0x0044: goto L0044;
+	default: return 0;
+	}
+L0000:	VM_TRANSLATED_EXIT(0x0000);	//URLMAP
+L0017:	VM_TRANSLATED_BLOCK(0x0017, 4);
+	//0x0017 ADD
+	translatedkernel<uint32_t, OpAdd, TranslatedMemory<0x0230>, TranslatedLiteral<0x00000003u> >(state, cells);
+	//0x001f ADD
+	translatedkernel<uint32_t, OpAdd, TranslatedCell<0>, TranslatedLiteral<0x00000001u> >(state, cells);
+	//0x0027 ADD
+	translatedkernel<uint32_t, OpAdd, TranslatedUnshared<0x0250>, TranslatedLiteral<0x00010001u> >(state, cells);
+	//0x002f COMPARE
+	VM_TRANSLATED_STATUS(0x002f, VM_INSTRUCTION_COMPARE);
+	VM_TRANSLATED_BRANCH((translatedcompare<uint32_t, TranslatedCell<0>, TranslatedLiteral<0x0000000au> >(state, cells)), L0017, L003d, L003d);
+L003d:	VM_TRANSLATED_BLOCK(0x003d, 1);
+	//0x003d LOAD
+	translatedkernel<uint16_t, OpLoad, TranslatedRegister<1>, TranslatedUnshared<0x0250> >(state, cells);
+	VM_TRANSLATED_STATUS(0x003d, VM_INSTRUCTION_LOAD);
+L0042:	VM_TRANSLATED_EXIT(0x0042);	//URLMAPDELETE
+L0044:	VM_TRANSLATED_BLOCK(0x0044, 1);
+	//0x0044 HALT
+	VM_TRANSLATED_STATUS(0x0044, VM_INSTRUCTION_HALT);
+	state->flags |= VM_FLAG_HALTED;
+	VM_TRANSLATED_EXIT(0x0044);
+leave:
+	translatedwriteback<uint32_t, 0x0240>(state, cells[0]);
+	state->programcounter = programcounter;
+	state->statuscode = statuscode;
+	return steps;
+}
+
+///Translated programs
+const vm_translation_t vm_translations[] = {
+		{"ggt", translated_ggt_code, sizeof(translated_ggt_code), translated_ggt},
+		{"expressions", translated_expressions_code, sizeof(translated_expressions_code), translated_expressions},
+		{"divide", translated_divide_code, sizeof(translated_divide_code), translated_divide},
+		{"shared", translated_shared_code, sizeof(translated_shared_code), translated_shared},
+};
+const uint8_t vm_translationcount = 4;
+
+#endif /* VM_TRANSLATIONS */
@@ -0,0 +1,721 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Implementation of Translator
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+#include "Translator.h"
+
+#ifdef VM_TOOLCHAIN
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "Assembler.h"
+
+/**
+ * @brief Creates a translator which writes the source of the translated programs into a buffer.
+ * @param source Buffer for the source.
+ * @param size Size of the buffer.
+ */
+Translator::Translator(char* source, uint32_t size)
+{
+	this->source = source;
+	this->size = size;
+	length = 0;
+	programcount = 0;
+	instructions = 0;
+	interpreted = 0;
+	cellcount = 0;
+	error[0] = '\0';
+	if(size > 0)
+	{
+		source[0] = '\0';
+	}
+}
+
+/**
+ * Translates the program in the code region of a VM and appends the translation to the source.
+ * @param vm VM with the verified program, must not execute while the translator runs.
+ * @param name Name of the program, a C identifier.
+ * @return True if the program was translated.
+ */
+bool Translator::translate(VM* vm, const char* name)
+{
+	if(error[0])
+	{
+		return false;
+	}
+	uint8_t namelength = strlen(name);
+	bool identifier = namelength > 0 && namelength <= TRANSLATOR_NAME_LENGTH && !(name[0] >= '0' && name[0] <= '9');
+	for(uint8_t i = 0; i < namelength && identifier; i++)
+	{
+		char c = name[i];
+		identifier = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+	}
+	if(!identifier)
+	{
+		return fail("invalid name");
+	}
+	for(uint8_t i = 0; i < programcount; i++)
+	{
+		if(strcmp(names[i], name) == 0)
+		{
+			return fail("name already used");
+		}
+	}
+	if(programcount >= TRANSLATOR_PROGRAMS)
+	{
+		return fail("too many programs");
+	}
+	if(!vm->verified() || !vm->verify())
+	{//only verified programs have known jump targets, memory addresses in range and known shared values
+		return fail("program not verified");
+	}
+	if(length == 0 && !prologue())
+	{
+		return false;
+	}
+	Memory* memory = vm->getMemory();
+	uint16_t codesize = memory->getCodeSize();
+	uint16_t savedprogramcounter = vm->programcounter;
+	uint32_t savedstatuscode = vm->statuscode;
+
+	append("\n///%s (%u Bytes)\nstatic const uint8_t translated_%s_code[] = {", name, codesize, name);
+	for(uint16_t pc = 0; pc < codesize; pc++)
+	{
+		append("%s0x%02x", pc == 0 ? "\n\t\t" : (pc % 16 == 0 ? ",\n\t\t" : ", "), memory->loadcode(pc));
+	}
+	append("\n};\n\n/**\n * Translation of %s, see vm_translated_t.\n */\n", name);
+	append("static uint32_t translated_%s(vm_translation_state_t* state, uint32_t max_steps)\n{\n", name);
+	append("\tuint32_t steps = 0;\n\tuint32_t statuscode = state->statuscode;\n\tuint16_t programcounter;\n");
+	findLeaders(vm, codesize);
+	findCells(vm, codesize);
+	cellsource();
+	append("\tswitch(state->programcounter)\n\t{\n");
+	vm_instruction_t in;
+	for(uint16_t pc = 0; pc < codesize; pc = in.next)
+	{
+		sweep(vm, &in, pc, codesize);
+		if(leader(pc) || !translatable(in, codesize))
+		{
+			append("\tcase 0x%04x: goto L%04x;\n", pc, pc);
+		}
+	}
+	append("\tdefault: return 0;\n\t}\n");
+	instructions = 0;
+	interpreted = 0;
+	uint16_t remaining = 0;
+	for(uint16_t pc = 0; pc < codesize; pc = in.next)
+	{
+		instructions++;
+		if(remaining == 0)
+		{
+			remaining = blocklength(vm, pc, codesize);
+			if(remaining > 0)
+			{
+				append("L%04x:\tVM_TRANSLATED_BLOCK(0x%04x, %u);\n", pc, pc, remaining);
+			}
+		}
+		sweep(vm, &in, pc, codesize);
+		if(remaining == 0)
+		{
+			interpreted++;
+			append("L%04x:\tVM_TRANSLATED_EXIT(0x%04x);\t//%s\n", pc, pc, Assembler::mnemonic(in.opcode));
+			continue;
+		}
+		block(in, --remaining);
+	}
+	append("leave:\n");
+	for(uint8_t i = 0, index = 0; i < cellcount; i++)
+	{
+		if(!cells[i].conflict && cells[i].written)
+		{
+			append("\ttranslatedwriteback<%s, 0x%04x>(state, cells[%u]);\n", operandtype(cells[i].type), cells[i].address, index);
+		}
+		index += cells[i].conflict ? 0 : 1;
+	}
+	append("\tstate->programcounter = programcounter;\n\tstate->statuscode = statuscode;\n\treturn steps;\n}\n");
+	vm->programcounter = savedprogramcounter;
+	vm->statuscode = savedstatuscode;
+
+	if(error[0])
+	{
+		return false;
+	}
+	strcpy(names[programcount++], name);
+	return true;
+}
+
+/**
+ * Appends the table of the translated programs, ends the source.
+ * @return Length of the source, 0 on errors (see getError()).
+ */
+uint32_t Translator::finish()
+{
+	if(length == 0)
+	{
+		prologue();
+	}
+	append("\n///Translated programs\nconst vm_translation_t vm_translations[] = {\n");
+	for(uint8_t i = 0; i < programcount; i++)
+	{
+		append("\t\t{\"%s\", translated_%s_code, sizeof(translated_%s_code), translated_%s},\n", names[i], names[i], names[i], names[i]);
+	}
+	if(programcount == 0)
+	{//arrays must not be empty
+		append("\t\t{0, 0, 0, 0}\n");
+	}
+	append("};\nconst uint8_t vm_translationcount = %u;\n\n#endif /* VM_TRANSLATIONS */\n", programcount);
+	return error[0] ? 0 : length;
+}
+
+/**
+ * Appends the start of the source.
+ * @return True if the source buffer was large enough.
+ */
+bool Translator::prologue()
+{
+	return append("/**\n"
+			" * @brief       Programs translated into native code (see Translation.h), generated by the Translator (see Translator.h).\n"
+			" * 				Translate the programs again instead of editing this file.\n"
+			" */\n"
+			"#include \"CalculationVM.h\"\n"
+			"\n"
+			"#ifdef VM_TRANSLATIONS\n");
+}
+
+/**
+ * Decodes the instruction at an address, instructions with operand lists are skipped like by the verifier.
+ * @param vm VM with the program.
+ * @param in Record to write the decoded instruction into.
+ * @param pc Address of the instruction.
+ * @param codesize Size of the code region.
+ */
+void Translator::sweep(VM* vm, vm_instruction_t* in, uint16_t pc, uint16_t codesize)
+{
+	vm->programcounter = pc;
+	vm->decode(in);
+	switch(in->opcode)
+	{
+	case VM_INSTRUCTION_MULTILOAD:
+	case VM_INSTRUCTION_URLMAP:
+	case VM_INSTRUCTION_PIDINIT:
+		vm->skipOperands(in, codesize);
+		break;
+	default:
+		break;
+	}
+}
+
+/**
+ * Marks the first instructions of the blocks: the start of the program, jump targets of translated instructions and the
+ * instructions behind jumps, branches, TIME, HALT and instructions executed by the interpreter.
+ * @param vm VM with the program.
+ * @param codesize Size of the code region.
+ */
+void Translator::findLeaders(VM* vm, uint16_t codesize)
+{
+	memset(leaders, 0, (codesize + 7) / 8);
+	markLeader(0);
+	vm_instruction_t in;
+	for(uint16_t pc = 0; pc < codesize; pc = in.next)
+	{
+		sweep(vm, &in, pc, codesize);
+		bool translated = translatable(in, codesize);
+		if(!translated || endsblock(in.opcode))
+		{
+			markLeader(in.next);
+		}
+		if(!translated)
+		{
+			continue;
+		}
+		if(in.opcode == VM_INSTRUCTION_COMPARE || in.opcode == VM_INSTRUCTION_ADDCOMPARE)
+		{
+			markLeader(in.jump[0]);
+			markLeader(in.jump[1]);
+			markLeader(in.jump[2]);
+		}
+		else if(in.opcode == VM_INSTRUCTION_JUMP)
+		{
+			markLeader(in.literal);
+		}
+	}
+}
+
+/**
+ * Collects the unshared memory operands of the translated instructions which can be kept in local cells.
+ * @param vm VM with the program.
+ * @param codesize Size of the code region.
+ */
+void Translator::findCells(VM* vm, uint16_t codesize)
+{
+	cellcount = 0;
+	vm_instruction_t in;
+	for(uint16_t pc = 0; pc < codesize; pc = in.next)
+	{
+		sweep(vm, &in, pc, codesize);
+		if(!translatable(in, codesize))
+		{
+			continue;
+		}
+		uint8_t type = in.optype & VM_OPTYPE_MASK;
+		bool literal = (in.optype & VM_ADDRESS_MASK) == VM_LITERAL;
+		switch(in.opcode)
+		{
+		case VM_INSTRUCTION_JUMP:
+		case VM_INSTRUCTION_HALT:
+			break;
+		case VM_INSTRUCTION_TIME:
+			addCell(in.address, VM_OPERAND_TYPE_UINT32, true);
+			break;
+		case VM_INSTRUCTION_ADDCOMPARE://memory operands only
+			addCell(in.address, type, true);
+			if(!literal)
+			{
+				addCell(in.operand, type, false);
+			}
+			break;
+		default:
+			if(!(in.optype & VM_REGISTER_DESTINATION))
+			{
+				addCell(in.address, type, in.opcode != VM_INSTRUCTION_COMPARE);
+			}
+			if(!literal && !(in.optype & VM_REGISTER_OPERAND) && in.opcode != VM_INSTRUCTION_NOT)
+			{
+				addCell(in.operand, type, false);
+			}
+			break;
+		}
+	}
+}
+
+/**
+ * Adds an access of a translated instruction to the cells. Unshared values accessed with another address or type than
+ * the cell they overlap stay in memory.
+ * @param address Address of the memory operand.
+ * @param type Operand type (VM_OPERAND_TYPE_*).
+ * @param written True if the instruction stores the operand.
+ */
+void Translator::addCell(uint16_t address, uint8_t type, bool written)
+{
+	if(!VM::verifiedUnshared(address, width(type)))
+	{
+		return;
+	}
+	bool overlaps = false;
+	for(uint8_t i = 0; i < cellcount; i++)
+	{
+		translator_cell_t& other = cells[i];
+		if(other.address == address && other.type == type)
+		{
+			other.written |= written;
+			return;
+		}
+		if(address < other.address + width(other.type) && other.address < address + width(type))
+		{
+			other.conflict = true;
+			overlaps = true;
+		}
+	}
+	if(!overlaps && cellcount < TRANSLATOR_CELLS)
+	{
+		translator_cell_t& added = cells[cellcount++];
+		added.address = address;
+		added.type = type;
+		added.written = written;
+		added.conflict = false;
+	}
+}
+
+/**
+ * @param address Address of a memory operand.
+ * @param type Operand type (VM_OPERAND_TYPE_*).
+ * @return Index of the local cell of the operand, -1 if the operand stays in memory.
+ */
+int16_t Translator::cell(uint16_t address, uint8_t type) const
+{
+	for(uint8_t i = 0, index = 0; i < cellcount; i++)
+	{
+		if(!cells[i].conflict)
+		{
+			if(cells[i].address == address && cells[i].type == type)
+			{
+				return index;
+			}
+			index++;
+		}
+	}
+	return -1;
+}
+
+/**
+ * Appends the local cells of the translated program, they are loaded before the programcounter is dispatched.
+ * @return True if the source buffer was large enough.
+ */
+bool Translator::cellsource()
+{
+	uint8_t count = 0;
+	for(uint8_t i = 0; i < cellcount; i++)
+	{
+		count += cells[i].conflict ? 0 : 1;
+	}
+	if(count == 0)
+	{
+		return append("\tuint32_t* cells = 0;\n\t(void) cells;\n");
+	}
+	append("\tuint32_t cells[%u];\n", count);
+	for(uint8_t i = 0, index = 0; i < cellcount; i++)
+	{
+		if(!cells[i].conflict)
+		{
+			append("\ttranslatedfetch<%s, 0x%04x>(state, cells[%u]);\n", operandtype(cells[i].type), cells[i].address, index++);
+		}
+	}
+	return !error[0];
+}
+
+/**
+ * @param pc Address of an instruction.
+ */
+void Translator::markLeader(uint16_t pc)
+{
+	if(pc < MEMORY_CODE_REGION)
+	{
+		leaders[pc >> 3] |= (1 << (pc & 0x07));
+	}
+}
+
+/**
+ * @param pc Address of an instruction.
+ * @return True if the instruction starts a block (see findLeaders()).
+ */
+bool Translator::leader(uint16_t pc) const
+{
+	return pc < MEMORY_CODE_REGION && (leaders[pc >> 3] & (1 << (pc & 0x07)));
+}
+
+/**
+ * Counts the instructions of the block starting at an instruction. A block ends before the next leader and before an
+ * instruction executed by the interpreter, or with a jump, branch, TIME or HALT.
+ * @param vm VM with the program.
+ * @param pc Address of the first instruction.
+ * @param codesize Size of the code region.
+ * @return Number of instructions, 0 if the instruction is executed by the interpreter.
+ */
+uint16_t Translator::blocklength(VM* vm, uint16_t pc, uint16_t codesize)
+{
+	vm_instruction_t in;
+	uint16_t count = 0;
+	for(uint16_t address = pc; address < codesize && (address == pc || !leader(address)); address = in.next)
+	{
+		sweep(vm, &in, address, codesize);
+		if(!translatable(in, codesize))
+		{
+			break;
+		}
+		count++;
+		if(endsblock(in.opcode))
+		{
+			break;
+		}
+	}
+	return count;
+}
+
+/**
+ * @param in Decoded instruction.
+ * @param codesize Size of the code region.
+ * @return True if the instruction is translated, false if it is executed by the interpreter.
+ */
+bool Translator::translatable(const vm_instruction_t& in, uint16_t codesize)
+{
+	switch(in.opcode)
+	{
+	case VM_INSTRUCTION_ADD:
+	case VM_INSTRUCTION_SUB:
+	case VM_INSTRUCTION_MUL:
+	case VM_INSTRUCTION_DIV:
+	case VM_INSTRUCTION_MOD:
+	case VM_INSTRUCTION_AND:
+	case VM_INSTRUCTION_OR:
+	case VM_INSTRUCTION_NOT:
+	case VM_INSTRUCTION_XOR:
+	case VM_INSTRUCTION_LSHIFT:
+	case VM_INSTRUCTION_RSHIFT:
+	case VM_INSTRUCTION_LOAD:
+	case VM_INSTRUCTION_COMPARE:
+		return in.kernel && !writescode(in, codesize);
+	case VM_INSTRUCTION_ADDCOMPARE:
+		return in.kernel && !(in.optype & (VM_REGISTER_DESTINATION | VM_REGISTER_OPERAND)) && !writescode(in, codesize);
+	case VM_INSTRUCTION_JUMP:
+		return (in.optype & VM_ADDRESS_MASK) == VM_LITERAL;//indirect jumps are not verified
+	case VM_INSTRUCTION_TIME://address not verified
+		return (uint32_t) in.address + sizeof(uint32_t) <= MEMORY_SIZE && !writescode(in, codesize);
+	case VM_INSTRUCTION_HALT:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/**
+ * @param opcode Opcode of a translated instruction.
+ * @return True if the instruction does not continue with the next instruction or ends the batch (yield point).
+ */
+bool Translator::endsblock(uint8_t opcode)
+{
+	return opcode == VM_INSTRUCTION_COMPARE || opcode == VM_INSTRUCTION_ADDCOMPARE || opcode == VM_INSTRUCTION_JUMP
+			|| opcode == VM_INSTRUCTION_TIME || opcode == VM_INSTRUCTION_HALT;
+}
+
+/**
+ * Appends a translated instruction. The last instruction of a block sets the statuscode, jumps and branches go to the
+ * blocks of their targets.
+ * @param in Decoded instruction (see translatable()).
+ * @param remaining Instructions of the block behind the instruction.
+ * @return True if the source buffer was large enough.
+ */
+bool Translator::block(const vm_instruction_t& in, uint16_t remaining)
+{
+	bool literal = (in.optype & VM_ADDRESS_MASK) == VM_LITERAL;
+	switch(in.opcode)
+	{
+	case VM_INSTRUCTION_ADD:
+	case VM_INSTRUCTION_SUB:
+	case VM_INSTRUCTION_MUL:
+	case VM_INSTRUCTION_DIV:
+	case VM_INSTRUCTION_MOD:
+	case VM_INSTRUCTION_AND:
+	case VM_INSTRUCTION_OR:
+	case VM_INSTRUCTION_NOT:
+	case VM_INSTRUCTION_XOR:
+	case VM_INSTRUCTION_LSHIFT:
+	case VM_INSTRUCTION_RSHIFT:
+	case VM_INSTRUCTION_LOAD:
+	{
+		bool divides = in.opcode == VM_INSTRUCTION_DIV || in.opcode == VM_INSTRUCTION_MOD;
+		append("\t//0x%04x %s\n\t%stranslatedkernel<%s, %s, ", in.pc, Assembler::mnemonic(in.opcode), divides ? "if(!" : "",
+				operandtype(in.optype), operation(in.opcode));
+		destinationoperand(in);
+		append(", ");
+		if(in.opcode == VM_INSTRUCTION_NOT)
+		{
+			append("TranslatedLiteral<0x00000000u>");
+		}
+		else
+		{
+			sourceoperand(in, literal);
+		}
+		if(divides)
+		{
+			append(" >(state, cells)) VM_TRANSLATED_DIVIDEZERO(0x%04x, VM_INSTRUCTION_%s, 0x%04x, %u);\n", in.pc,
+					Assembler::mnemonic(in.opcode), in.next, remaining);
+		}
+		else
+		{
+			append(" >(state, cells);\n");
+		}
+		if(remaining == 0)
+		{
+			return append("\tVM_TRANSLATED_STATUS(0x%04x, VM_INSTRUCTION_%s);\n", in.pc, Assembler::mnemonic(in.opcode));
+		}
+		return true;
+	}
+	case VM_INSTRUCTION_COMPARE:
+	case VM_INSTRUCTION_ADDCOMPARE:
+		append("\t//0x%04x %s\n\tVM_TRANSLATED_STATUS(0x%04x, VM_INSTRUCTION_%s);\n\tVM_TRANSLATED_BRANCH((translated%s<%s, ", in.pc,
+				Assembler::mnemonic(in.opcode), in.pc, Assembler::mnemonic(in.opcode),
+				in.opcode == VM_INSTRUCTION_COMPARE ? "compare" : "addcompare", operandtype(in.optype));
+		destinationoperand(in);
+		append(", ");
+		sourceoperand(in, literal);
+		if(in.opcode == VM_INSTRUCTION_ADDCOMPARE)
+		{
+			append(", 0x%08lxu", (unsigned long) in.increment);
+		}
+		return append(" >(state, cells)), L%04x, L%04x, L%04x);\n", in.jump[0], in.jump[1], in.jump[2]);
+	case VM_INSTRUCTION_TIME://yield point, the translated program is left behind the instruction (see VM::runTranslation())
+		append("\t//0x%04x TIME\n\tVM_TRANSLATED_STATUS(0x%04x, VM_INSTRUCTION_TIME);\n\ttranslatedtime<", in.pc, in.pc);
+		memoryoperand(in.address, VM_OPERAND_TYPE_UINT32);
+		return append(" >(state, cells);\n\tVM_TRANSLATED_EXIT(0x%04x);\n", in.next);
+	case VM_INSTRUCTION_JUMP:
+		return append("\t//0x%04x JUMP\n\tVM_TRANSLATED_STATUS(0x%04x, VM_INSTRUCTION_JUMP);\n\tgoto L%04x;\n", in.pc, in.pc, in.literal);
+	default://HALT
+		return append("\t//0x%04x HALT\n\tVM_TRANSLATED_STATUS(0x%04x, VM_INSTRUCTION_HALT);\n\tstate->flags |= VM_FLAG_HALTED;\n"
+				"\tVM_TRANSLATED_EXIT(0x%04x);\n", in.pc, in.pc, in.pc);
+	}
+}
+
+/**
+ * Appends the destination operand (register or memory address) of an instruction.
+ * @param in Decoded instruction.
+ * @return True if the source buffer was large enough.
+ */
+bool Translator::destinationoperand(const vm_instruction_t& in)
+{
+	if(in.optype & VM_REGISTER_DESTINATION && in.opcode != VM_INSTRUCTION_ADDCOMPARE)
+	{
+		return append("TranslatedRegister<%u>", in.address);
+	}
+	return memoryoperand(in.address, in.optype);
+}
+
+/**
+ * Appends the source operand (register, memory address or literal) of an instruction.
+ * @param in Decoded instruction.
+ * @param literal True if the operand is a literal.
+ * @return True if the source buffer was large enough.
+ */
+bool Translator::sourceoperand(const vm_instruction_t& in, bool literal)
+{
+	if(literal)
+	{
+		return append("TranslatedLiteral<0x%08lxu>", (unsigned long) in.literal);
+	}
+	if(in.optype & VM_REGISTER_OPERAND)
+	{
+		return append("TranslatedRegister<%u>", in.operand);
+	}
+	return memoryoperand(in.operand, in.optype);
+}
+
+/**
+ * Appends a memory operand, values the verifier proved unshared are kept in a local cell (see findCells()) or accessed
+ * without sequence lock.
+ * @param address Address of the operand.
+ * @param optype OPTYPE of the instruction (operand type).
+ * @return True if the source buffer was large enough.
+ */
+bool Translator::memoryoperand(uint16_t address, uint8_t optype)
+{
+	int16_t index = cell(address, optype & VM_OPTYPE_MASK);
+	if(index >= 0)
+	{
+		return append("TranslatedCell<%d>", index);
+	}
+	return append("%s<0x%04x>", VM::verifiedUnshared(address, width(optype)) ? "TranslatedUnshared" : "TranslatedMemory", address);
+}
+
+/**
+ * @param type Operand type or OPTYPE.
+ * @return Width of an operand in memory.
+ */
+uint8_t Translator::width(uint8_t type)
+{
+	switch(type & VM_OPTYPE_MASK)
+	{
+	case VM_OPERAND_TYPE_UINT8:		return sizeof(uint8_t);
+	case VM_OPERAND_TYPE_UINT16:	return sizeof(uint16_t);
+	case VM_OPERAND_TYPE_DEC:		return sizeof(rational_t);
+	default:						return sizeof(uint32_t);
+	}
+}
+
+/**
+ * Without Harvard mode a write into the code region changes the program, such instructions are not translated.
+ * @param in Decoded instruction.
+ * @param codesize Size of the code region.
+ * @return True if the instruction writes into the code region.
+ */
+bool Translator::writescode(const vm_instruction_t& in, uint16_t codesize)
+{
+#ifndef VM_HARVARD
+	return in.opcode != VM_INSTRUCTION_COMPARE && !(in.optype & VM_REGISTER_DESTINATION && in.opcode != VM_INSTRUCTION_ADDCOMPARE)
+			&& in.address < codesize;
+#else
+	(void) in;
+	(void) codesize;
+	return false;
+#endif
+}
+
+/**
+ * @param optype OPTYPE of an instruction.
+ * @return C++ type of the operands.
+ */
+const char* Translator::operandtype(uint8_t optype)
+{
+	switch(optype & VM_OPTYPE_MASK)
+	{
+	case VM_OPERAND_TYPE_UINT8:		return "uint8_t";
+	case VM_OPERAND_TYPE_UINT16:	return "uint16_t";
+	case VM_OPERAND_TYPE_DEC:		return "rational_t";
+	default:						return "uint32_t";
+	}
+}
+
+/**
+ * @param opcode Opcode of an arithmetic, logic or LOAD instruction.
+ * @return Operation of the kernel (Operations.h).
+ */
+const char* Translator::operation(uint8_t opcode)
+{
+	switch(opcode)
+	{
+	case VM_INSTRUCTION_ADD:	return "OpAdd";
+	case VM_INSTRUCTION_SUB:	return "OpSub";
+	case VM_INSTRUCTION_MUL:	return "OpMul";
+	case VM_INSTRUCTION_DIV:	return "OpDiv";
+	case VM_INSTRUCTION_MOD:	return "OpMod";
+	case VM_INSTRUCTION_AND:	return "OpAnd";
+	case VM_INSTRUCTION_OR:		return "OpOr";
+	case VM_INSTRUCTION_NOT:	return "OpNot";
+	case VM_INSTRUCTION_XOR:	return "OpXor";
+	case VM_INSTRUCTION_LSHIFT:	return "OpLshift";
+	case VM_INSTRUCTION_RSHIFT:	return "OpRshift";
+	default:					return "OpLoad";
+	}
+}
+
+/**
+ * Appends formatted text to the source.
+ * @param format Format like printf.
+ * @return True if the source buffer was large enough.
+ */
+bool Translator::append(const char* format, ...)
+{
+	if(error[0])
+	{
+		return false;
+	}
+	va_list arguments;
+	va_start(arguments, format);
+	int written = vsnprintf(source + length, size - length, format, arguments);
+	va_end(arguments);
+	if(written < 0 || (uint32_t) written >= size - length)
+	{
+		if(size > length)
+		{
+			source[length] = '\0';
+		}
+		return fail("source buffer too small");
+	}
+	length += written;
+	return true;
+}
+
+/**
+ * Sets the error if no error occurred before.
+ * @param message Error message.
+ * @return Always false.
+ */
+bool Translator::fail(const char* message)
+{
+	if(!error[0])
+	{
+		snprintf(error, sizeof(error), "%s", message);
+	}
+	return false;
+}
+
+#endif /* VM_TOOLCHAIN */
@@ -0,0 +1,19 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Mango VM (examples/ggt_Mango) for the benchmarks, only compiled with make BENCHMARK=1.
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+#ifdef BENCHMARK
+#include "mango.c"
+#else
+///ISO C forbids an empty translation unit
+typedef int benchmark_mango_disabled_t;
+#endif
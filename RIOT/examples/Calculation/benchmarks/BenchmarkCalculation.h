@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Workloads of the benchmarks on the Calculation VM (see Benchmarks.h). The GCD workload is the bytecode of
+ * 				test_print_ggt, so its translation (Translations.cpp) is used by the translated engine. The other
+ * 				workloads are assembled when they are loaded.
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+#ifndef BENCHMARKS_BENCHMARKCALCULATION_H_
+#define BENCHMARKS_BENCHMARKCALCULATION_H_
+
+#include "CalculationVM.h"
+#include "Assembler.h"
+
+///Same program as test_print_ggt in TestExamples.h, result (uint32_t) at 0x0070
+static const uint8_t benchmark_calculation_gcd[] = {
+		VM_INSTRUCTION_LOAD, 0x01, 0x70, 0x00, 0x5F, 0xE5, 0x73, 0x6D,
+		VM_INSTRUCTION_LOAD, 0x01, 0x74, 0x00, 0x82, 0x3F, 0xA5, 0x43,
+		VM_INSTRUCTION_TIME, 0x80, 0x00,
+		VM_INSTRUCTION_COMPARE, 0x01, 0x70, 0x00, 0x00, 0x00, 0x00, 0x00, 0x2B, 0x00, 0x21, 0x00, 0x2B, 0x00,
+		VM_INSTRUCTION_LOAD, 0x00, 0x70, 0x00, 0x74, 0x00,
+		VM_INSTRUCTION_JUMP, 0x01, 0x59, 0x00,
+		VM_INSTRUCTION_COMPARE, 0x01, 0x74, 0x00, 0x00, 0x00, 0x00, 0x00, 0x39, 0x00, 0x59, 0x00, 0x39, 0x00,
+		VM_INSTRUCTION_COMPARE, 0x00, 0x70, 0x00, 0x74, 0x00, 0x4F, 0x00, 0x4F, 0x00, 0x45, 0x00,
+		VM_INSTRUCTION_SUB, 0x00, 0x70, 0x00, 0x74, 0x00,
+		VM_INSTRUCTION_JUMP, 0x01, 0x2B, 0x00,
+		VM_INSTRUCTION_SUB, 0x00, 0x74, 0x00, 0x70, 0x00,
+		VM_INSTRUCTION_JUMP, 0x01, 0x2B, 0x00,
+		VM_INSTRUCTION_TIME, 0x84, 0x00,
+		VM_INSTRUCTION_SUB, 0x00, 0x84, 0x00, 0x80, 0x00,
+		VM_INSTRUCTION_HALT
+};
+
+///PID steps (count %u), result (dec) at 0x0200
+static const char* benchmark_calculation_pid =
+		".var input dec @0x200\n"
+		".var integral dec\n"
+		".var last dec\n"
+		".var error dec\n"
+		".var derivative dec\n"
+		".var output dec\n"
+		".var term dec\n"
+		".var n u32\n"
+		"	LOAD.dec @input, #20\n"
+		"	LOAD.dec @integral, #0\n"
+		"	LOAD.dec @last, #0\n"
+		"	LOAD.u32 @n, #0\n"
+		"loop:	LOAD.dec @error, #50\n"
+		"	SUB.dec @error, @input\n"
+		"	ADD.dec @integral, @error\n"
+		"	LOAD.dec @derivative, @error\n"
+		"	SUB.dec @derivative, @last\n"
+		"	LOAD.dec @last, @error\n"
+		"	LOAD.dec @output, @error\n"
+		"	MUL.dec @output, #0.5\n"
+		"	LOAD.dec @term, @integral\n"
+		"	MUL.dec @term, #0.0625\n"
+		"	ADD.dec @output, @term\n"
+		"	LOAD.dec @term, @derivative\n"
+		"	MUL.dec @term, #0.25\n"
+		"	ADD.dec @output, @term\n"
+		"	LOAD.dec @term, @output\n"
+		"	MUL.dec @term, #0.125\n"
+		"	ADD.dec @input, @term\n"
+		"	ADD.u32 @n, #1\n"
+		"	COMPARE.u32 @n, #%u, loop, done, done\n"
+		"done:	HALT\n";
+
+///Counting loop (count %u), result at 0x0200
+static const char* benchmark_calculation_loop =
+		".var n u32 @0x200\n"
+		"	LOAD.u32 @n, #0\n"
+		"loop:	ADD.u32 @n, #1\n"
+		"	COMPARE.u32 @n, #%u, loop, done, done\n"
+		"done:	HALT\n";
+
+///Polling of a URL mapping (polls %u), result at 0x0200
+static const char* benchmark_calculation_poll =
+		".var n u32 @0x200\n"
+		".var value u32 @0x210\n"
+		".var status u8\n"
+		"	URLMAP.u32 0, client|get|ever, @value, 0, \"affe::1\", \"/sensor\"\n"
+		"	LOAD.u32 @n, #0\n"
+		"loop:	URLMAPCHECK 0, @status\n"
+		"	ADD.u32 @n, #1\n"
+		"	COMPARE.u8 @status, #1, next, done, next\n"
+		"next:	COMPARE.u32 @n, #%u, loop, done, done\n"
+		"done:	URLMAPDELETE 0\n"
+		"	HALT\n";
+
+/**
+ * @return VM of the Calculation engines.
+ */
+inline VM& benchmark_calculation_vm(void)
+{
+	static VM vm(&Memory::instance(), PID::instances());
+	return vm;
+}
+
+///Address of the result of the loaded workload
+static uint16_t benchmark_calculation_result = 0;
+
+/**
+ * Loads a workload into the VM.
+ * @param workload Workload.
+ * @param translated Execute the translation of the workload.
+ * @return False if the workload could not be assembled.
+ */
+inline bool benchmark_calculation_load(uint8_t workload, bool translated)
+{
+	static uint8_t program[256];
+	VM& vm = benchmark_calculation_vm();
+#ifdef VM_TRANSLATIONS
+	vm.setTranslation(translated);
+#else
+	(void) translated;
+#endif
+	Memory::instance().clear();
+	if(workload == BENCHMARK_GCD)
+	{
+		benchmark_calculation_result = 0x0070;
+		vm.setProgram(const_cast<uint8_t*>(benchmark_calculation_gcd), sizeof(benchmark_calculation_gcd));
+		return true;
+	}
+	char source[1024];
+	switch(workload)
+	{
+	case BENCHMARK_PID:
+		snprintf(source, sizeof(source), benchmark_calculation_pid, BENCHMARK_PID_STEPS);
+		break;
+	case BENCHMARK_LOOP:
+		snprintf(source, sizeof(source), benchmark_calculation_loop, BENCHMARK_LOOP_COUNT);
+		break;
+	default:
+		snprintf(source, sizeof(source), benchmark_calculation_poll, BENCHMARK_POLLS);
+		break;
+	}
+	Assembler assembler(program, sizeof(program));
+	uint16_t size = assembler.assemble(source);
+	if(!size)
+	{
+		printf("%s: %s\n", benchmark_workloads[workload], assembler.getError());
+		return false;
+	}
+	benchmark_calculation_result = 0x0200;
+	vm.setProgram(program, size);
+	return true;
+}
+
+inline bool benchmark_calculation_interpreted(uint8_t workload)
+{
+	return benchmark_calculation_load(workload, false);
+}
+
+inline uint32_t benchmark_calculation_execute(uint32_t* instructions)
+{
+	VM& vm = benchmark_calculation_vm();
+	vm.clear();
+	while(!vm.halted())
+	{
+		*instructions += vm.run(VM_RUN_MAX_STEPS, 0);
+	}
+	return Memory::instance().loadunsigned(benchmark_calculation_result);
+}
+
+inline uint32_t benchmark_calculation_ram(void)
+{
+	return sizeof(VM) + sizeof(Memory);
+}
+
+inline uint32_t benchmark_calculation_program(void)
+{
+	return Memory::instance().getCodeSize();
+}
+
+static const benchmark_engine_t benchmark_calculation = {
+		"calculation", benchmark_calculation_interpreted, benchmark_calculation_execute,
+		benchmark_calculation_ram, benchmark_calculation_program
+};
+
+#ifdef VM_TRANSLATIONS
+/**
+ * Loads a workload which has a translation (Translations.cpp).
+ */
+inline bool benchmark_calculation_translated_load(uint8_t workload)
+{
+	return benchmark_calculation_load(workload, true) && benchmark_calculation_vm().translated();
+}
+
+static const benchmark_engine_t benchmark_calculation_translated = {
+		"calculation translated", benchmark_calculation_translated_load, benchmark_calculation_execute,
+		benchmark_calculation_ram, benchmark_calculation_program
+};
+#endif
+
+#endif /* BENCHMARKS_BENCHMARKCALCULATION_H_ */
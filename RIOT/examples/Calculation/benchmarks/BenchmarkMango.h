@@ -0,0 +1,291 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Workloads of the benchmarks on the Mango VM (examples/ggt_Mango, compiled by benchmark_mango.c). Every
+ * 				iteration initializes the VM and imports the module (a module is executed once). Locals are addressed
+ * 				relative to the stack pointer (ldloc/stloc operand = local + stack depth), the listings name the locals.
+ * 				Syscalls are handled by the host: result (pops the result), map, checkmap (pushes the status), unmap.
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+#ifndef BENCHMARKS_BENCHMARKMANGO_H_
+#define BENCHMARKS_BENCHMARKMANGO_H_
+
+#include "mango.h"
+
+///Syscall which reports the result (top of the stack)
+#define BENCHMARK_MANGO_SYSCALL_RESULT		(0x0000)
+///Syscall which maps the polled URL (see benchmark_map)
+#define BENCHMARK_MANGO_SYSCALL_MAP			(0x0001)
+///Syscall which pushes the status of the polled mapping
+#define BENCHMARK_MANGO_SYSCALL_CHECKMAP	(0x0002)
+///Syscall which deletes the polled mapping
+#define BENCHMARK_MANGO_SYSCALL_UNMAP		(0x0003)
+///Stack size of the Mango VM
+#define BENCHMARK_MANGO_STACK_SIZE			(64)
+
+///Same program as examples/ggt_Mango, locals: a, b
+static const uint8_t benchmark_mango_gcd[] = {
+		0xFF, 0x00, 0x02, 0x00,			//magic, executable, no imports
+		0x00, 0x00, 0x00, 0x02,			//initializer: nop nop nop halt
+		0x04, 0x02, 0x00, 0x02,			//function (8): safe critical (syscall), max stack 2, 0 arguments, 2 locals
+		0x33, 0x5F, 0xE5, 0x73, 0x6D,	//ldc.x32 1836311903
+		0x13, 0x01,						//stloc.x32 a
+		0x33, 0x82, 0x3F, 0xA5, 0x43,	//ldc.x32 1134903170
+		0x13, 0x02,						//stloc.x32 b
+		0x10, 0x00,						//ldloc.x32 a
+		0x22, 0x06,						//brtrue.s loop
+		0x10, 0x01,						//ldloc.x32 b
+		0x13, 0x01,						//stloc.x32 a
+		0x20, 0x1D,						//br.s done
+		0x10, 0x01,						//loop: ldloc.x32 b
+		0x21, 0x19,						//brfalse.s done
+		0x10, 0x00,						//ldloc.x32 a
+		0x10, 0x02,						//ldloc.x32 b
+		0x52,							//cgt.i32.un
+		0x21, 0x09,						//brfalse.s else
+		0x10, 0x00,						//ldloc.x32 a
+		0x10, 0x02,						//ldloc.x32 b
+		0x41,							//sub.i32
+		0x13, 0x01,						//stloc.x32 a
+		0x20, 0xEC,						//br.s loop
+		0x10, 0x01,						//else: ldloc.x32 b
+		0x10, 0x01,						//ldloc.x32 a
+		0x41,							//sub.i32
+		0x13, 0x02,						//stloc.x32 b
+		0x20, 0xE3,						//br.s loop
+		0x10, 0x00,						//done: ldloc.x32 a
+		0x1E, 0x01, 0x00, 0x00,			//syscall BENCHMARK_MANGO_SYSCALL_RESULT
+		0x18,							//ret
+		0x00, 0x00, 0x01,				//app info: no features, 1 module
+		0x1C, 0x08, 0x00, 0x02			//entry point: call.s 8, halt
+};
+
+///PID steps (50, see BENCHMARK_PID_STEPS), locals: input, integral, last, error, derivative, output, n
+static const uint8_t benchmark_mango_pid[] = {
+		0xFF, 0x00, 0x02, 0x00,			//magic, executable, no imports
+		0x00, 0x00, 0x00, 0x02,			//initializer: nop nop nop halt
+		0x04, 0x04, 0x00, 0x07,			//function (8): safe critical (syscall), max stack 4, 0 arguments, 7 locals
+		0x33, 0x00, 0x14, 0x00, 0x00,	//ldc.x32 20 (dec)
+		0x13, 0x01,						//stloc.x32 input
+		0x29,							//ldc.i32.0
+		0x13, 0x02,						//stloc.x32 integral
+		0x29,							//ldc.i32.0
+		0x13, 0x03,						//stloc.x32 last
+		0x29,							//ldc.i32.0
+		0x13, 0x07,						//stloc.x32 n
+		0x33, 0x00, 0x32, 0x00, 0x00,	//loop: ldc.x32 50 (dec)
+		0x10, 0x01,						//ldloc.x32 input
+		0x41,							//sub.i32
+		0x13, 0x04,						//stloc.x32 error
+		0x10, 0x01,						//ldloc.x32 integral
+		0x10, 0x04,						//ldloc.x32 error
+		0x40,							//add.i32
+		0x13, 0x02,						//stloc.x32 integral
+		0x10, 0x03,						//ldloc.x32 error
+		0x10, 0x03,						//ldloc.x32 last
+		0x41,							//sub.i32
+		0x13, 0x05,						//stloc.x32 derivative
+		0x10, 0x03,						//ldloc.x32 error
+		0x13, 0x03,						//stloc.x32 last
+		0x10, 0x03,						//ldloc.x32 error
+		0x33, 0x80, 0x00, 0x00, 0x00,	//ldc.x32 0.5 (dec)
+		0x42,							//mul.i32
+		0x31,							//ldc.i32.8
+		0x49,							//shr.i32
+		0x10, 0x02,						//ldloc.x32 integral
+		0x32, 0x10,						//ldc.i32.s 0.0625 (dec)
+		0x42,							//mul.i32
+		0x31,							//ldc.i32.8
+		0x49,							//shr.i32
+		0x40,							//add.i32
+		0x10, 0x05,						//ldloc.x32 derivative
+		0x32, 0x40,						//ldc.i32.s 0.25 (dec)
+		0x42,							//mul.i32
+		0x31,							//ldc.i32.8
+		0x49,							//shr.i32
+		0x40,							//add.i32
+		0x13, 0x06,						//stloc.x32 output
+		0x10, 0x00,						//ldloc.x32 input
+		0x10, 0x06,						//ldloc.x32 output
+		0x32, 0x20,						//ldc.i32.s 0.125 (dec)
+		0x42,							//mul.i32
+		0x31,							//ldc.i32.8
+		0x49,							//shr.i32
+		0x40,							//add.i32
+		0x13, 0x01,						//stloc.x32 input
+		0x10, 0x06,						//ldloc.x32 n
+		0x2A,							//ldc.i32.1
+		0x40,							//add.i32
+		0x06,							//dup.x32
+		0x13, 0x08,						//stloc.x32 n
+		0x32, 0x32,						//ldc.i32.s 50
+		0x56,							//clt.i32.un
+		0x22, 0xB0,						//brtrue.s loop
+		0x10, 0x00,						//ldloc.x32 input
+		0x1E, 0x01, 0x00, 0x00,			//syscall BENCHMARK_MANGO_SYSCALL_RESULT
+		0x18,							//ret
+		0x00, 0x00, 0x01,				//app info: no features, 1 module
+		0x1C, 0x08, 0x00, 0x02			//entry point: call.s 8, halt
+};
+
+///Counting loop (1000, see BENCHMARK_LOOP_COUNT), locals: n
+static const uint8_t benchmark_mango_loop[] = {
+		0xFF, 0x00, 0x02, 0x00,			//magic, executable, no imports
+		0x00, 0x00, 0x00, 0x02,			//initializer: nop nop nop halt
+		0x04, 0x02, 0x00, 0x01,			//function (8): safe critical (syscall), max stack 2, 0 arguments, 1 local
+		0x29,							//ldc.i32.0
+		0x13, 0x01,						//stloc.x32 n
+		0x10, 0x00,						//loop: ldloc.x32 n
+		0x2A,							//ldc.i32.1
+		0x40,							//add.i32
+		0x06,							//dup.x32
+		0x13, 0x02,						//stloc.x32 n
+		0x33, 0xE8, 0x03, 0x00, 0x00,	//ldc.x32 1000
+		0x56,							//clt.i32.un
+		0x22, 0xF1,						//brtrue.s loop
+		0x10, 0x00,						//ldloc.x32 n
+		0x1E, 0x01, 0x00, 0x00,			//syscall BENCHMARK_MANGO_SYSCALL_RESULT
+		0x18,							//ret
+		0x00, 0x00, 0x01,				//app info: no features, 1 module
+		0x1C, 0x08, 0x00, 0x02			//entry point: call.s 8, halt
+};
+
+///Polling of a URL mapping (200 polls, see BENCHMARK_POLLS), locals: n
+static const uint8_t benchmark_mango_poll[] = {
+		0xFF, 0x00, 0x02, 0x00,			//magic, executable, no imports
+		0x00, 0x00, 0x00, 0x02,			//initializer: nop nop nop halt
+		0x04, 0x02, 0x00, 0x01,			//function (8): safe critical (syscall), max stack 2, 0 arguments, 1 local
+		0x1E, 0x00, 0x01, 0x00,			//syscall BENCHMARK_MANGO_SYSCALL_MAP
+		0x29,							//ldc.i32.0
+		0x13, 0x01,						//stloc.x32 n
+		0x1E, 0xFF, 0x02, 0x00,			//loop: syscall BENCHMARK_MANGO_SYSCALL_CHECKMAP (pushes status)
+		0x10, 0x01,						//ldloc.x32 n
+		0x2A,							//ldc.i32.1
+		0x40,							//add.i32
+		0x13, 0x02,						//stloc.x32 n
+		0x2A,							//ldc.i32.1 (VM_MAP_STATUS_DONE)
+		0x4F,							//ceq.i32
+		0x22, 0x0A,						//brtrue.s done
+		0x10, 0x00,						//ldloc.x32 n
+		0x33, 0xC8, 0x00, 0x00, 0x00,	//ldc.x32 200
+		0x56,							//clt.i32.un
+		0x22, 0xE8,						//brtrue.s loop
+		0x1E, 0x00, 0x03, 0x00,			//done: syscall BENCHMARK_MANGO_SYSCALL_UNMAP
+		0x10, 0x00,						//ldloc.x32 n
+		0x1E, 0x01, 0x00, 0x00,			//syscall BENCHMARK_MANGO_SYSCALL_RESULT
+		0x18,							//ret
+		0x00, 0x00, 0x01,				//app info: no features, 1 module
+		0x1C, 0x08, 0x00, 0x02			//entry point: call.s 8, halt
+};
+
+///Module name (12 bytes)
+static const uint8_t benchmark_mango_name[12] = {'b', 'e', 'n', 'c', 'h'};
+///Heap of the Mango VM (VM state, stack and module), mango_initialize needs 4 byte alignment
+static uint32_t benchmark_mango_heap[64];
+///Image of the loaded workload
+static const uint8_t* benchmark_mango_image = 0;
+static uint32_t benchmark_mango_image_size = 0;
+///Heap used by the last iteration
+static uint32_t benchmark_mango_heap_used = 0;
+
+inline bool benchmark_mango_load(uint8_t workload)
+{
+	static const uint8_t* const images[BENCHMARK_WORKLOADS] = {
+			benchmark_mango_gcd, benchmark_mango_pid, benchmark_mango_loop, benchmark_mango_poll
+	};
+	static const uint32_t sizes[BENCHMARK_WORKLOADS] = {
+			sizeof(benchmark_mango_gcd), sizeof(benchmark_mango_pid), sizeof(benchmark_mango_loop), sizeof(benchmark_mango_poll)
+	};
+	Memory::instance().clear();
+	Memory::instance().storeBlock(BENCHMARK_URL_ADDRESS, (const uint8_t*) benchmark_url, sizeof(benchmark_url));
+	benchmark_mango_image = images[workload];
+	benchmark_mango_image_size = sizes[workload];
+	return true;
+}
+
+/**
+ * Handles a syscall of the workloads.
+ * @param vm Mango VM.
+ * @param result Set by BENCHMARK_MANGO_SYSCALL_RESULT.
+ * @return False if the syscall is unknown or the stack overflows.
+ */
+inline bool benchmark_mango_syscall(mango_vm* vm, uint32_t* result)
+{
+	Memory* mem = &Memory::instance();
+	switch(mango_syscall(vm))
+	{
+	case BENCHMARK_MANGO_SYSCALL_RESULT:
+		*result = *(uint32_t*) mango_stack_top(vm);
+		mango_stack_free(vm, sizeof(uint32_t));
+		return true;
+	case BENCHMARK_MANGO_SYSCALL_MAP:
+		benchmark_map(mem);
+		return true;
+	case BENCHMARK_MANGO_SYSCALL_CHECKMAP:
+	{
+		uint32_t* status = (uint32_t*) mango_stack_alloc(vm, sizeof(uint32_t), 0);
+		if(!status)
+		{
+			return false;
+		}
+		*status = mem->checkmap(0);
+		return true;
+	}
+	case BENCHMARK_MANGO_SYSCALL_UNMAP:
+		mem->unmap(0);
+		return true;
+	default:
+		return false;
+	}
+}
+
+inline uint32_t benchmark_mango_execute(uint32_t* instructions)
+{
+	mango_vm* vm = mango_initialize(benchmark_mango_heap, sizeof(benchmark_mango_heap), BENCHMARK_MANGO_STACK_SIZE, NULL);
+	if(!vm || mango_module_import(vm, benchmark_mango_name, benchmark_mango_image, benchmark_mango_image_size, NULL,
+			MANGO_IMPORT_TRUSTED_MODULE | MANGO_IMPORT_SKIP_VERIFICATION) != MANGO_E_SUCCESS)
+	{
+		puts("Mango: initialization failed");
+		return 0;
+	}
+	benchmark_mango_heap_used = mango_heap_size(vm) - mango_heap_available(vm);
+	uint32_t start = mango_instructions;
+	uint32_t result = 0;
+	mango_result status;
+	while((status = mango_execute(vm)) == MANGO_E_SYSCALL)
+	{
+		if(!benchmark_mango_syscall(vm, &result))
+		{
+			break;
+		}
+	}
+	if(status != MANGO_E_SUCCESS && status != MANGO_E_SYSCALL)
+	{
+		printf("Mango: error %u\n", (unsigned) status);
+	}
+	*instructions += mango_instructions - start;
+	return result;
+}
+
+inline uint32_t benchmark_mango_ram(void)
+{
+	return benchmark_mango_heap_used;
+}
+
+inline uint32_t benchmark_mango_program(void)
+{
+	return benchmark_mango_image_size;
+}
+
+static const benchmark_engine_t benchmark_mango = {
+		"mango", benchmark_mango_load, benchmark_mango_execute, benchmark_mango_ram, benchmark_mango_program
+};
+
+#endif /* BENCHMARKS_BENCHMARKMANGO_H_ */
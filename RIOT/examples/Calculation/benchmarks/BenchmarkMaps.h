@@ -0,0 +1,270 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Benchmarks of the scans over the URL-Maps (build with make BENCHMARK=maps on native, the map pool is enlarged
+ * 				so one instance holds VM_MEMORY_MAP_SIZE URL-Maps). With 16, 64 and 256 used URL-Maps, spread over all ids and
+ * 				every second one a client, every scan is measured on the Memory (blocks with one array per field and a bitmap
+ * 				of the used URL-Maps) and on an array of url_map_t of all ids with the same URL-Maps (the layout before the
+ * 				blocks, scans visit every entry).
+ *
+ * 				Scans: all (ids of the used URL-Maps, like gcoap_statusMappings), client (ids of the client URL-Maps, like
+ * 				check_clientmappings), checkmap (status of every used URL-Map, like URLMAPCHECK), address (URL-Map of the value
+ * 				address of every used URL-Map, like PID inputs). The time of one complete scan is the fastest of
+ * 				BENCHMARK_MAP_RUNS runs, the iterations are calibrated to run at least BENCHMARK_MAP_MIN_US.
+ *
+ * 				Output is CSV: mappings,scan,ns_blocks,ns_array.
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+#ifndef BENCHMARKS_BENCHMARKMAPS_H_
+#define BENCHMARKS_BENCHMARKMAPS_H_
+
+#include "Memory.h"
+#include "URL_Mapping.h"
+
+///Minimum time of a measurement in µs (iterations are doubled until it is reached)
+#define BENCHMARK_MAP_MIN_US		(5000)
+///Measurements of every scan, the fastest is reported
+#define BENCHMARK_MAP_RUNS			(5)
+///Number of scans
+#define BENCHMARK_MAP_SCANS			(4)
+
+///URL-Maps of all ids in the layout before the blocks (reference of the scans)
+static url_map_t benchmark_map_array[MEMORY_MAP_SIZE];
+///Used URL-Maps of the measurement
+static uint16_t benchmark_map_count = 0;
+
+/**
+ * Scan over the URL-Maps.
+ * @param blocks Scan the Memory (true) or benchmark_map_array (false).
+ * @return Result of the scan (compared between both layouts).
+ */
+typedef uint32_t (*benchmark_map_scan_t)(bool blocks);
+
+/**
+ * @return Sum of the ids of the used URL-Maps.
+ */
+inline uint32_t benchmark_map_all(bool blocks)
+{
+	uint32_t sum = 0;
+	if(blocks)
+	{
+		Memory& mem = Memory::instance();
+		for(uint16_t id = mem.nextMap(0); id != MEMORY_NO_MAP; id = mem.nextMap(id + 1))
+		{
+			sum += id;
+		}
+		return sum;
+	}
+	for(uint16_t id = 0; id < MEMORY_MAP_SIZE; id++)
+	{
+		if(benchmark_map_array[id].status != VM_MAP_STATUS_NO_MAPPING)
+		{
+			sum += id;
+		}
+	}
+	return sum;
+}
+
+/**
+ * @return Sum of the ids of the client URL-Maps.
+ */
+inline uint32_t benchmark_map_client(bool blocks)
+{
+	uint32_t sum = 0;
+	if(blocks)
+	{
+		Memory& mem = Memory::instance();
+		for(uint16_t id = mem.nextMap(0, VM_MAP_OPTION_DIRECTION_MASK, VM_MAP_OPTION_DIRECTION_CLIENT); id != MEMORY_NO_MAP;
+				id = mem.nextMap(id + 1, VM_MAP_OPTION_DIRECTION_MASK, VM_MAP_OPTION_DIRECTION_CLIENT))
+		{
+			sum += id;
+		}
+		return sum;
+	}
+	for(uint16_t id = 0; id < MEMORY_MAP_SIZE; id++)
+	{
+		if(benchmark_map_array[id].status != VM_MAP_STATUS_NO_MAPPING
+				&& (benchmark_map_array[id].map_options & VM_MAP_OPTION_DIRECTION_MASK) == VM_MAP_OPTION_DIRECTION_CLIENT)
+		{
+			sum += id;
+		}
+	}
+	return sum;
+}
+
+/**
+ * @return Sum of the status of the used URL-Maps.
+ */
+inline uint32_t benchmark_map_checkmap(bool blocks)
+{
+	uint32_t sum = 0;
+	Memory& mem = Memory::instance();
+	uint16_t step = MEMORY_MAP_SIZE / benchmark_map_count;
+	for(uint16_t id = 0; id < MEMORY_MAP_SIZE; id += step)
+	{
+		if(blocks)
+		{
+			sum += mem.checkmap(id, false);
+			continue;
+		}
+		const url_map_t& entry = benchmark_map_array[id];
+		if(entry.status != VM_MAP_STATUS_NO_MAPPING && entry.value_address != NO_MAPPING && entry.url_address != NO_MAPPING
+				&& entry.resource_address != NO_MAPPING)
+		{
+			sum += entry.status;
+		}
+	}
+	return sum;
+}
+
+/**
+ * @return Sum of the ids found for the value addresses of the used URL-Maps.
+ */
+inline uint32_t benchmark_map_address(bool blocks)
+{
+	uint32_t sum = 0;
+	Memory& mem = Memory::instance();
+	uint16_t step = MEMORY_MAP_SIZE / benchmark_map_count;
+	for(uint16_t id = 0; id < MEMORY_MAP_SIZE; id += step)
+	{
+		uint16_t address = 4 * id;
+		if(blocks)
+		{
+			sum += mem.getMapForAddress(address);
+			continue;
+		}
+		for(uint16_t i = 0; i < MEMORY_MAP_SIZE; i++)
+		{
+			if(benchmark_map_array[i].status != VM_MAP_STATUS_NO_MAPPING && benchmark_map_array[i].value_address == address)
+			{
+				sum += i;
+				break;
+			}
+		}
+	}
+	return sum;
+}
+
+/**
+ * Maps count URL-Maps in the Memory and in benchmark_map_array, spread over all ids.
+ * @param count Number of URL-Maps.
+ * @return False if the map pool can not hold the URL-Maps.
+ */
+inline bool benchmark_map_load(uint16_t count)
+{
+	Memory& mem = Memory::instance();
+	mem.clear();
+	benchmark_map_count = count;
+	for(uint16_t id = 0; id < MEMORY_MAP_SIZE; id++)
+	{
+		benchmark_map_array[id].optype = 0;
+		benchmark_map_array[id].map_options = 0;
+		benchmark_map_array[id].value_address = NO_MAPPING;
+		benchmark_map_array[id].url_address = NO_MAPPING;
+		benchmark_map_array[id].resource_address = NO_MAPPING;
+		benchmark_map_array[id].port = 0;
+		benchmark_map_array[id].status = VM_MAP_STATUS_NO_MAPPING;
+	}
+	for(uint16_t i = 0; i < count; i++)
+	{
+		uint16_t id = i * (MEMORY_MAP_SIZE / count);
+		uint8_t options = VM_MAP_OPTION_LIFETIME_EVER | ((i & 1) ? VM_MAP_OPTION_DIRECTION_CLIENT : VM_MAP_OPTION_DIRECTION_SERVER);
+		url_map_t& entry = benchmark_map_array[id];
+		entry.optype = VM_OPERAND_TYPE_UINT32;
+		entry.map_options = options;
+		entry.value_address = 4 * id;
+		entry.url_address = 0;
+		entry.resource_address = 0;
+		entry.status = (i % 3) == 0 ? VM_MAP_STATUS_DONE : 0;
+		if(!mem.map(id, entry.optype, options, entry.value_address, 0, 0, 0))
+		{
+			return false;
+		}
+		if(entry.status)
+		{
+			mem.map_done(id);
+		}
+	}
+	return true;
+}
+
+/**
+ * Measures one complete scan.
+ * @param scan Scan.
+ * @param blocks Scan the Memory (true) or benchmark_map_array (false).
+ * @param result Result of the scan.
+ * @return Time of one scan in ns.
+ */
+inline double benchmark_map_time(benchmark_map_scan_t scan, bool blocks, uint32_t* result)
+{
+	uint32_t iterations = 1;
+	uint32_t us = 0;
+	do
+	{
+		iterations <<= 1;
+		uint32_t start = xtimer_now();
+		for(uint32_t i = 0; i < iterations; i++)
+		{
+			*result = benchmark_opaque(scan(blocks));
+		}
+		us = xtimer_now() - start;
+	} while(us < BENCHMARK_MAP_MIN_US && iterations < (UINT32_C(1) << 24));
+	uint32_t fastest = us;
+	for(uint8_t run = 1; run < BENCHMARK_MAP_RUNS; run++)
+	{
+		uint32_t start = xtimer_now();
+		for(uint32_t i = 0; i < iterations; i++)
+		{
+			*result = benchmark_opaque(scan(blocks));
+		}
+		us = xtimer_now() - start;
+		fastest = us < fastest ? us : fastest;
+	}
+	return (double) fastest * 1000.0 / iterations;
+}
+
+/**
+ * @brief Measures all scans with 16, 64 and 256 URL-Maps and prints the results as CSV.
+ */
+inline void run_map_benchmarks()
+{
+	static const uint16_t counts[] = {16, 64, 256};
+	static const char* const names[BENCHMARK_MAP_SCANS] = {"all", "client", "checkmap", "address"};
+	static const benchmark_map_scan_t scans[BENCHMARK_MAP_SCANS] = {
+			benchmark_map_all, benchmark_map_client, benchmark_map_checkmap, benchmark_map_address
+	};
+	printf("# map benchmarks, %u ids, %u URL-Maps per block, pool of %u URL-Maps, fastest of %u runs\n", MEMORY_MAP_SIZE,
+			MEMORY_MAP_BLOCK, MEMORY_MAP_POOL * MEMORY_MAP_BLOCK, BENCHMARK_MAP_RUNS);
+	puts("mappings,scan,ns_blocks,ns_array");
+	for(uint8_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+	{
+		if(counts[c] > MEMORY_MAP_SIZE || !benchmark_map_load(counts[c]))
+		{
+			printf("# %u mappings not supported (map pool too small)\n", counts[c]);
+			continue;
+		}
+		for(uint8_t s = 0; s < BENCHMARK_MAP_SCANS; s++)
+		{
+			uint32_t results[2];
+			double ns[2];
+			ns[0] = benchmark_map_time(scans[s], true, &results[0]);
+			ns[1] = benchmark_map_time(scans[s], false, &results[1]);
+			printf("%u,%s,%.1f,%.1f%s\n", counts[c], names[s], ns[0], ns[1], results[0] == results[1] ? "" : ",ERROR");
+			if(results[0] != results[1])
+			{
+				benchmark_errors++;
+			}
+		}
+	}
+	Memory::instance().clear();
+	printf("Benchmarks completed, %" PRIu32 " Errors\n", benchmark_errors);
+}
+
+#endif /* BENCHMARKS_BENCHMARKMAPS_H_ */
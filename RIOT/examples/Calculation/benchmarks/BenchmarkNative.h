@@ -0,0 +1,158 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Workloads of the benchmarks in native C (reference results, see Benchmarks.h). Same algorithms and
+ * 				fixed-point arithmetic (dec, 8 fractional bits) as the VM programs, inputs are hidden from the optimizer.
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+#ifndef BENCHMARKS_BENCHMARKNATIVE_H_
+#define BENCHMARKS_BENCHMARKNATIVE_H_
+
+#include "Memory.h"
+#include "Opcodes.h"
+#include "URL_Mapping.h"
+
+///URL and resource of the polled mapping, stored in the memory for the engines without URLMAP instruction
+static const char benchmark_url[] = "affe::1\0/sensor";
+///Address of benchmark_url in the memory
+#define BENCHMARK_URL_ADDRESS		(0x0300)
+///Address of the value of the polled mapping
+#define BENCHMARK_VALUE_ADDRESS		(0x0210)
+
+/**
+ * Maps the polled URL (like the URLMAP of the Calculation program).
+ * @param mem Memory.
+ */
+inline void benchmark_map(Memory* mem)
+{
+	mem->map(0, VM_OPERAND_TYPE_UINT32, VM_MAP_OPTION_URL_ADDRESS | VM_MAP_OPTION_RESOURCE_ADDRESS | VM_MAP_OPTION_DIRECTION_CLIENT
+			| VM_MAP_OPTION_METHOD_GET | VM_MAP_OPTION_LIFETIME_EVER, BENCHMARK_VALUE_ADDRESS, 0, BENCHMARK_URL_ADDRESS, BENCHMARK_URL_ADDRESS + 8);
+}
+
+/**
+ * @return GCD of 1836311903 and 1134903170 (subtraction like examples/ggt).
+ */
+inline uint32_t benchmark_native_gcd(void)
+{
+	uint32_t a = benchmark_opaque(UINT32_C(1836311903));
+	uint32_t b = benchmark_opaque(UINT32_C(1134903170));
+	if(a == 0)
+	{
+		a = b;
+	}
+	else
+	{
+		while(b != 0)
+		{
+			if(a > b)
+			{
+				a = a - b;
+			}
+			else
+			{
+				b = b - a;
+			}
+		}
+	}
+	return a;
+}
+
+/**
+ * Multiplication of dec values (8 fractional bits, like fixed8_t).
+ */
+inline int32_t benchmark_native_mul(int32_t value, int32_t factor)
+{
+	return (value * factor) >> 8;
+}
+
+/**
+ * @return Input of the plant after BENCHMARK_PID_STEPS steps (dec bits), setpoint 50, input 20, kp 0.5, ki 0.0625, kd 0.25.
+ */
+inline uint32_t benchmark_native_pid(void)
+{
+	int32_t input = benchmark_opaque(20 << 8);
+	int32_t integral = 0;
+	int32_t last = 0;
+	for(uint32_t n = 0; n < BENCHMARK_PID_STEPS; n = benchmark_opaque(n + 1))
+	{
+		int32_t error = (50 << 8) - input;
+		integral += error;
+		int32_t derivative = error - last;
+		last = error;
+		int32_t output = benchmark_native_mul(error, 128) + benchmark_native_mul(integral, 16) + benchmark_native_mul(derivative, 64);
+		input += benchmark_native_mul(output, 32);
+	}
+	return (uint32_t) input;
+}
+
+/**
+ * @return BENCHMARK_LOOP_COUNT.
+ */
+inline uint32_t benchmark_native_loop(void)
+{
+	uint32_t n = 0;
+	do
+	{
+		n = benchmark_opaque(n + 1);
+	} while(n < BENCHMARK_LOOP_COUNT);
+	return n;
+}
+
+/**
+ * @return Number of polls until the mapping is done (BENCHMARK_POLLS, the mapping is never answered).
+ */
+inline uint32_t benchmark_native_poll(void)
+{
+	Memory* mem = &Memory::instance();
+	benchmark_map(mem);
+	uint32_t n = 0;
+	do
+	{
+		uint8_t status = mem->checkmap(0);
+		n++;
+		if(status == VM_MAP_STATUS_DONE)
+		{
+			break;
+		}
+	} while(n < BENCHMARK_POLLS);
+	mem->unmap(0);
+	return n;
+}
+
+///Workload of the native engine
+static uint32_t (*benchmark_native_workload)(void) = 0;
+
+inline bool benchmark_native_load(uint8_t workload)
+{
+	static uint32_t (* const workloads[BENCHMARK_WORKLOADS])(void) = {
+			benchmark_native_gcd, benchmark_native_pid, benchmark_native_loop, benchmark_native_poll
+	};
+	Memory::instance().clear();
+	Memory::instance().storeBlock(BENCHMARK_URL_ADDRESS, (const uint8_t*) benchmark_url, sizeof(benchmark_url));
+	benchmark_native_workload = workloads[workload];
+	return true;
+}
+
+inline uint32_t benchmark_native_execute(uint32_t* instructions)
+{
+	(void) instructions;
+	return benchmark_native_workload();
+}
+
+inline uint32_t benchmark_native_none(void)
+{
+	return 0;
+}
+
+static const benchmark_engine_t benchmark_native = {
+		"native", benchmark_native_load, benchmark_native_execute, benchmark_native_none, benchmark_native_none
+};
+
+#endif /* BENCHMARKS_BENCHMARKNATIVE_H_ */
@@ -0,0 +1,392 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Micro-benchmarks of the opcodes of the Calculation VM (build with make BENCHMARK=opcodes on native). Every
+ * 				opcode is measured with every operand type and every operand mode (literal, address, register) the
+ * 				verifier accepts: a loop executes BENCHMARK_OPCODE_COPIES copies of the instruction, the iterations are
+ * 				calibrated to run at least BENCHMARK_OPCODE_MIN_US, the same loop without the copies is subtracted.
+ * 				Opcodes which only run together with others (stack arithmetic, RETURN) are measured in a sequence and the
+ * 				helpers are subtracted with a reference sequence. Superinstructions are created by the Optimizer.
+ * 				Blocking and yielding opcodes (URLMAP, URLMAPWAIT, PIDWAIT, SLEEPUNTIL ...) and HALT, RESET are not measured.
+ *
+ * 				Output is CSV: opcode,type,mode,instructions,ns_per_instruction,ns_without_dispatch. The dispatch overhead
+ * 				is the time of a JUMP to the next instruction (fetch, decode and dispatch only). Times include the decode
+ * 				cache (VM_DECODE_CACHE), instructions which share a cache index with the loop are decoded again.
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+#ifndef BENCHMARKS_BENCHMARKOPCODES_H_
+#define BENCHMARKS_BENCHMARKOPCODES_H_
+
+#include "CalculationVM.h"
+#include "Assembler.h"
+#include "Optimizer.h"
+
+///Copies of the measured instruction in the loop
+#define BENCHMARK_OPCODE_COPIES		(16)
+///Minimum time of a measurement in µs (iterations are doubled until it is reached)
+#define BENCHMARK_OPCODE_MIN_US		(5000)
+///Measurements of every opcode and its reference, the fastest are compared
+#define BENCHMARK_OPCODE_RUNS		(7)
+///Size of the generated source
+#define BENCHMARK_OPCODE_SOURCE		(4096)
+///Address of the limit of the loop counter
+#define BENCHMARK_OPCODE_LIMIT		(0x0424)
+
+///Operand types
+#define BENCHMARK_TYPE_U32			(0x01)
+#define BENCHMARK_TYPE_DEC			(0x02)
+#define BENCHMARK_TYPE_U8			(0x04)
+#define BENCHMARK_TYPE_U16			(0x08)
+#define BENCHMARK_TYPES_ALL			(0x0f)
+///Types of the logic instructions (not defined for decimal_t)
+#define BENCHMARK_TYPES_INTEGER		(BENCHMARK_TYPE_U32 | BENCHMARK_TYPE_U8 | BENCHMARK_TYPE_U16)
+///No operand type (the instruction has no OPTYPE)
+#define BENCHMARK_TYPE_NONE			(0x10)
+
+///Operand modes
+#define BENCHMARK_MODE_LITERAL		(0x01)
+#define BENCHMARK_MODE_ADDRESS		(0x02)
+#define BENCHMARK_MODE_REGISTER		(0x04)
+#define BENCHMARK_MODES_ALL			(0x07)
+
+/**
+ * Measured opcode. Formats are repeated BENCHMARK_OPCODE_COPIES times, placeholders:
+ * $T type, $D destination (@a or register r0), $S source (literal, @b or register r1), $I number of the copy.
+ */
+typedef struct {
+	const char* name;
+	uint8_t types;
+	uint8_t modes;
+	///Instructions of the loop body
+	const char* body;
+	///Reference sequence subtracted from the body (NULL: only the loop is subtracted)
+	const char* reference;
+	///Code behind the loop (subroutines)
+	const char* tail;
+	///Executed instructions per copy of the body which are reported
+	uint8_t instructions;
+	///POP instructions of the reference which the body does not execute (added with the time of PUSH+POP of the same type and mode)
+	uint8_t pops;
+	///Fuse superinstructions (Optimizer)
+	bool fuse;
+} benchmark_opcode_t;
+
+///Stack arithmetic: the body pops two values and pushes the result, the reference pops twice
+#define BENCHMARK_STACK(op)		{op, BENCHMARK_TYPES_ALL, BENCHMARK_MODE_LITERAL | BENCHMARK_MODE_ADDRESS, \
+		"PUSH.$T $S\nPUSH.$T $S\n" op ".$T\nPOP.$T @a\n", "PUSH.$T $S\nPUSH.$T $S\nPOP.$T @a\nPOP.$T @a\n", 0, 1, 1, false}
+///Instruction with destination and source
+#define BENCHMARK_BINARY(op)	{op, BENCHMARK_TYPES_ALL, BENCHMARK_MODES_ALL, op ".$T $D, $S\n", 0, 0, 1, 0, false}
+///Logic instruction with destination and source
+#define BENCHMARK_LOGIC(op)		{op, BENCHMARK_TYPES_INTEGER, BENCHMARK_MODES_ALL, op ".$T $D, $S\n", 0, 0, 1, 0, false}
+
+static const benchmark_opcode_t benchmark_opcodes[] = {
+		{"JUMP", BENCHMARK_TYPE_NONE, BENCHMARK_MODE_LITERAL, "JUMP j$I\nj$I:\n", 0, 0, 1, 0, false},
+		{"PUSH+POP", BENCHMARK_TYPES_ALL, BENCHMARK_MODE_LITERAL | BENCHMARK_MODE_ADDRESS, "PUSH.$T $S\nPOP.$T @a\n", 0, 0, 2, 0, false},
+		BENCHMARK_BINARY("ADD"), BENCHMARK_BINARY("SUB"), BENCHMARK_BINARY("MUL"), BENCHMARK_BINARY("DIV"),
+		BENCHMARK_BINARY("MOD"),
+		BENCHMARK_STACK("SADD"), BENCHMARK_STACK("SSUB"), BENCHMARK_STACK("SMUL"), BENCHMARK_STACK("SDIV"),
+		BENCHMARK_LOGIC("AND"), BENCHMARK_LOGIC("OR"),
+		{"NOT", BENCHMARK_TYPES_INTEGER, BENCHMARK_MODE_ADDRESS | BENCHMARK_MODE_REGISTER, "NOT.$T $D\n", 0, 0, 1, 0, false},
+		BENCHMARK_LOGIC("XOR"), BENCHMARK_LOGIC("LSHIFT"), BENCHMARK_LOGIC("RSHIFT"), BENCHMARK_BINARY("LOAD"),
+		{"MULTILOAD", BENCHMARK_TYPES_ALL, BENCHMARK_MODE_LITERAL | BENCHMARK_MODE_ADDRESS, "MULTILOAD.$T @a, $S, $S\n", 0, 0, 1, 0, false},
+		{"COPY", BENCHMARK_TYPE_NONE, BENCHMARK_MODE_ADDRESS, "COPY @a, 4, @b\n", 0, 0, 1, 0, false},
+		{"COMPARE", BENCHMARK_TYPES_ALL, BENCHMARK_MODES_ALL, "COMPARE.$T $D, $S, c$I, c$I, c$I\nc$I:\n", 0, 0, 1, 0, false},
+		{"CALL+RETURN", BENCHMARK_TYPE_NONE, BENCHMARK_MODE_LITERAL, "CALL function\n", 0, "function:	RETURN\n", 2, 0, false},
+		{"SCOMPARE", BENCHMARK_TYPES_ALL, BENCHMARK_MODE_LITERAL | BENCHMARK_MODE_ADDRESS,
+				"PUSH.$T $S\nPUSH.$T $S\nSCOMPARE.$T s$I, s$I, s$I\ns$I:\n", "PUSH.$T $S\nPUSH.$T $S\nPOP.$T @a\nPOP.$T @a\n", 0, 1, 2, false},
+		{"ADDCOMPARE", BENCHMARK_TYPES_ALL, BENCHMARK_MODE_LITERAL | BENCHMARK_MODE_ADDRESS,
+				"ADD.$T @a, #1\nCOMPARE.$T @a, $S, c$I, c$I, c$I\nc$I:\n", 0, 0, 1, 0, true},
+		{"TIME", BENCHMARK_TYPE_NONE, BENCHMARK_MODE_ADDRESS, "TIME @a\n", 0, 0, 1, 0, false},
+		{"COMPARETIME", BENCHMARK_TYPE_NONE, BENCHMARK_MODE_ADDRESS, "COMPARETIME @a, 1000, t$I, t$I\nt$I:\n", 0, 0, 1, 0, false},
+		{"TIMECOMPARE", BENCHMARK_TYPE_NONE, BENCHMARK_MODE_ADDRESS, "TIME @a\nCOMPARETIME @b, 1000, t$I, t$I\nt$I:\n", 0, 0, 1, 0, true},
+		{"URLMAPCHECK", BENCHMARK_TYPE_NONE, BENCHMARK_MODE_ADDRESS, "URLMAPCHECK 0, @s\n", 0, 0, 1, 0, false},
+		{"URLMAPCOMPARE", BENCHMARK_TYPE_NONE, BENCHMARK_MODE_ADDRESS,
+				"URLMAPCHECK 0, @s\nCOMPARE.u8 @s, #1, c$I, c$I, c$I\nc$I:\n", 0, 0, 1, 0, true}
+};
+
+/**
+ * Operand type of a benchmark.
+ */
+typedef struct {
+	uint8_t type;
+	const char* name;
+	///Literal of the source and initial value of the operands
+	const char* literal;
+} benchmark_type_t;
+
+static const benchmark_type_t benchmark_types[] = {
+		{BENCHMARK_TYPE_U32, "u32", "#3"}, {BENCHMARK_TYPE_DEC, "dec", "#1.5"},
+		{BENCHMARK_TYPE_U8, "u8", "#3"}, {BENCHMARK_TYPE_U16, "u16", "#3"}, {BENCHMARK_TYPE_NONE, "", "#3"}
+};
+
+/**
+ * Expands the placeholders of a format and appends the result.
+ * @param out Buffer.
+ * @param length Length of the content of the buffer, updated.
+ * @param format Format (see benchmark_opcode_t).
+ * @param type Operand type.
+ * @param mode Operand mode (BENCHMARK_MODE_*).
+ * @param index Number of the copy.
+ * @return False if the buffer is too small.
+ */
+inline bool benchmark_opcode_expand(char* out, uint16_t* length, const char* format, const benchmark_type_t* type,
+		uint8_t mode, uint8_t index)
+{
+	char number[4];
+	snprintf(number, sizeof(number), "%u", index);
+	for(const char* c = format; *c; c++)
+	{
+		const char* insert = 0;
+		char single[2] = {*c, 0};
+		if(*c == '$')
+		{
+			c++;
+			switch(*c)
+			{
+			case 'T':
+				insert = type->name[0] ? type->name : "u32";
+				break;
+			case 'D':
+				insert = mode == BENCHMARK_MODE_REGISTER ? "r0" : "@a";
+				break;
+			case 'S':
+				insert = mode == BENCHMARK_MODE_LITERAL ? type->literal : mode == BENCHMARK_MODE_ADDRESS ? "@b" : "r1";
+				break;
+			default:
+				insert = number;
+				break;
+			}
+		}
+		else
+		{
+			insert = single;
+		}
+		uint16_t len = strlen(insert);
+		if(*length + len >= BENCHMARK_OPCODE_SOURCE)
+		{
+			return false;
+		}
+		memcpy(out + *length, insert, len + 1);
+		*length += len;
+	}
+	return true;
+}
+
+/**
+ * Generates the source of a measured loop.
+ * @param source Buffer of BENCHMARK_OPCODE_SOURCE characters.
+ * @param body Format of the loop body (NULL: empty loop).
+ * @param tail Code behind the loop (NULL: none).
+ * @param type Operand type.
+ * @param mode Operand mode.
+ * @return False if the source is too large.
+ */
+inline bool benchmark_opcode_source(char* source, const char* body, const char* tail, const benchmark_type_t* type, uint8_t mode)
+{
+	uint16_t length = 0;
+	source[0] = 0;
+	const char* setup =
+			".var a $T @0x400\n"
+			".var b $T @0x410\n"
+			".var n u32 @0x420\n"
+			".var limit u32 @0x424\n"
+			".var s u8 @0x428\n"
+			"	LOAD.$T @a, $S\n"
+			"	LOAD.$T @b, $S\n"
+			"	LOAD.u32 @n, #0\n";
+	const char* registers =
+			"	LOAD.$T r0, $S\n"
+			"	LOAD.$T r1, $S\n";
+	const char* loop =
+			"	ADD.u32 @n, #1\n"
+			"	COMPARE.u32 @n, @limit, loop, done, done\n"
+			"done:	HALT\n";
+	bool fits = benchmark_opcode_expand(source, &length, setup, type, BENCHMARK_MODE_LITERAL, 0)
+			&& (mode != BENCHMARK_MODE_REGISTER || benchmark_opcode_expand(source, &length, registers, type, BENCHMARK_MODE_LITERAL, 0))
+			&& benchmark_opcode_expand(source, &length, "loop:\n", type, mode, 0);
+	for(uint8_t i = 0; body && fits && i < BENCHMARK_OPCODE_COPIES; i++)
+	{
+		fits = benchmark_opcode_expand(source, &length, body, type, mode, i);
+	}
+	return fits && benchmark_opcode_expand(source, &length, loop, type, mode, 0)
+			&& (!tail || benchmark_opcode_expand(source, &length, tail, type, mode, 0));
+}
+
+/**
+ * Assembles a measured loop.
+ * @param program Buffer of the code, the code stays below the variables at 0x0400.
+ * @param body Format of the loop body (NULL: empty loop).
+ * @param benchmark Measured opcode (tail).
+ * @param type Operand type.
+ * @param mode Operand mode.
+ * @return Size of the code, 0 if the assembler does not accept the combination.
+ */
+inline uint16_t benchmark_opcode_assemble(uint8_t* program, const char* body, const benchmark_opcode_t* benchmark,
+		const benchmark_type_t* type, uint8_t mode)
+{
+	static char source[BENCHMARK_OPCODE_SOURCE];
+	if(!benchmark_opcode_source(source, body, benchmark->tail, type, mode))
+	{
+		return 0;
+	}
+	Assembler assembler(program, 0x0400);
+	return assembler.assemble(source);
+}
+
+/**
+ * Loads a measured loop into the VM. The loop counter is fused in every loop, superinstructions in the bodies.
+ * @param vm VM.
+ * @param program Code of the loop.
+ * @param size Size of the code.
+ * @param fused Minimum number of superinstructions the Optimizer has to create.
+ * @return False if the verifier does not accept the loop or too few superinstructions were created.
+ */
+inline bool benchmark_opcode_load(VM& vm, uint8_t* program, uint16_t size, uint8_t fused)
+{
+	Memory::instance().clear();
+	vm.setProgram(program, size);
+	Optimizer optimizer(&vm);
+	if(optimizer.fuse() < fused)
+	{
+		return false;
+	}
+	vm.clear();
+	return vm.verified();
+}
+
+/**
+ * Executes the loaded loop.
+ * @param vm VM.
+ * @param iterations Iterations of the loop.
+ * @return Time in µs, UINT32_MAX if the execution failed.
+ */
+inline uint32_t benchmark_opcode_time(VM& vm, uint32_t iterations)
+{
+	vm.clear();
+	Memory::instance().storeunsigned(BENCHMARK_OPCODE_LIMIT, iterations);
+	uint32_t start = xtimer_now();
+	while(!vm.halted())
+	{
+		vm.run(VM_RUN_MAX_STEPS, 0);
+	}
+	uint32_t us = xtimer_now() - start;
+	return vm.getStatuscode() & VM_ERROR_MASK ? UINT32_MAX : us;
+}
+
+/**
+ * Measures the time of one copy of a body against the empty loop or a reference. Body and reference are executed
+ * alternately BENCHMARK_OPCODE_RUNS times, the fastest runs are compared.
+ * @param vm VM.
+ * @param benchmark Measured opcode.
+ * @param type Operand type.
+ * @param mode Operand mode.
+ * @param ns Time of one copy in ns.
+ * @param failed Set if the execution failed.
+ * @return False if the combination is not supported.
+ */
+inline bool benchmark_opcode_copy(VM& vm, const benchmark_opcode_t* benchmark, const benchmark_type_t* type, uint8_t mode,
+		double* ns, bool* failed)
+{
+	static uint8_t body[0x0400];
+	static uint8_t reference[0x0400];
+	uint8_t fused = benchmark->fuse ? BENCHMARK_OPCODE_COPIES : 0;
+	uint16_t bodysize = benchmark_opcode_assemble(body, benchmark->body, benchmark, type, mode);
+	uint16_t referencesize = benchmark_opcode_assemble(reference, benchmark->reference, benchmark, type, mode);
+	if(!bodysize || !referencesize || !benchmark_opcode_load(vm, body, bodysize, fused))
+	{
+		return false;
+	}
+	*failed = true;
+	uint32_t iterations = 1;
+	uint32_t us = benchmark_opcode_time(vm, iterations);
+	while(us != UINT32_MAX && us < BENCHMARK_OPCODE_MIN_US && iterations < (UINT32_C(1) << 24))
+	{
+		iterations <<= 1;
+		us = benchmark_opcode_time(vm, iterations);
+	}
+	uint32_t fastest[2] = {UINT32_MAX, UINT32_MAX};
+	for(uint8_t run = 0; us != UINT32_MAX && run < 2 * BENCHMARK_OPCODE_RUNS; run++)
+	{
+		bool isbody = !(run & 1);
+		if(!(isbody ? benchmark_opcode_load(vm, body, bodysize, fused) : benchmark_opcode_load(vm, reference, referencesize, 0)))
+		{
+			return true;
+		}
+		us = benchmark_opcode_time(vm, iterations);
+		fastest[run & 1] = us < fastest[run & 1] ? us : fastest[run & 1];
+	}
+	if(us == UINT32_MAX)
+	{
+		return true;
+	}
+	*failed = false;
+	*ns = ((double) fastest[0] - (double) fastest[1]) * 1000.0 / ((double) iterations * BENCHMARK_OPCODE_COPIES);
+	return true;
+}
+
+/**
+ * @brief Measures all opcodes with all operand types and modes and prints the results as CSV.
+ */
+inline void run_opcode_benchmarks()
+{
+	static const char* const modes[] = {"literal", "address", "register"};
+	VM& vm = benchmark_calculation_vm();
+#ifdef VM_TRANSLATIONS
+	vm.setTranslation(false);
+#endif
+	double dispatch = 0;
+	double pushpop[sizeof(benchmark_types) / sizeof(benchmark_types[0])][3] = {{0}};
+	printf("# opcode benchmarks, %s dispatch, %u copies, fastest of %u runs\n", VM::getDispatchEngine(),
+			BENCHMARK_OPCODE_COPIES, BENCHMARK_OPCODE_RUNS);
+	puts("opcode,type,mode,instructions,ns_per_instruction,ns_without_dispatch");
+	for(uint8_t b = 0; b < sizeof(benchmark_opcodes) / sizeof(benchmark_opcodes[0]); b++)
+	{
+		const benchmark_opcode_t* benchmark = &benchmark_opcodes[b];
+		for(uint8_t t = 0; t < sizeof(benchmark_types) / sizeof(benchmark_types[0]); t++)
+		{
+			const benchmark_type_t* type = &benchmark_types[t];
+			if(!(benchmark->types & type->type))
+			{
+				continue;
+			}
+			for(uint8_t m = 0; m < 3; m++)
+			{
+				uint8_t mode = 1 << m;
+				double ns;
+				bool failed;
+				if(!(benchmark->modes & mode) || !benchmark_opcode_copy(vm, benchmark, type, mode, &ns, &failed))
+				{
+					continue;
+				}
+				if(failed)
+				{
+					printf("# %s.%s %s failed\n", benchmark->name, type->name, modes[m]);
+					benchmark_errors++;
+					continue;
+				}
+				ns = (ns + benchmark->pops * pushpop[t][m]) / benchmark->instructions;
+				//JUMP and PUSH+POP are measured first, they are subtracted from the others
+				if(b == 0)
+				{
+					dispatch = ns;
+				}
+				else if(b == 1)
+				{
+					pushpop[t][m] = ns;
+				}
+				printf("%s,%s,%s,%u,%.2f,%.2f\n", benchmark->name, type->name, modes[m], benchmark->instructions, ns, ns - dispatch);
+			}
+		}
+	}
+	printf("dispatch,,,1,%.2f,0.00\n", dispatch);
+	printf("Benchmarks completed, %" PRIu32 " Errors\n", benchmark_errors);
+}
+
+#endif /* BENCHMARKS_BENCHMARKOPCODES_H_ */
@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Benchmarks of the Calculation VM, the Mango VM (examples/ggt_Mango) and native C on the same workloads
+ * 				(build with make BENCHMARK=1 on native). Every engine executes every workload BENCHMARK_RUNS times with
+ * 				BENCHMARK_ITERATIONS complete program executions (load state, run until halt) per run. Reported are µs per
+ * 				iteration (mean, standard deviation, minimum and maximum over the runs), executed instructions per second,
+ * 				RAM of the engine state and the size of the program. The results of all engines are checked against the
+ * 				native results. make benchmark-size prints the code size of the engines. make BENCHMARK=opcodes runs the
+ * 				micro-benchmarks of the opcodes instead (see BenchmarkOpcodes.h), make BENCHMARK=maps the scans
+ * 				over the URL-Maps (see BenchmarkMaps.h).
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+#ifndef BENCHMARKS_H_
+#define BENCHMARKS_H_
+
+#include <stdio.h>
+#include <math.h>
+#include <inttypes.h>
+
+#include "calculationconfig.h"
+
+#ifndef VM_TOOLCHAIN
+#error "Benchmarks need the assembler (VM_TOOLCHAIN, native)"
+#endif
+
+///Measured runs of every workload (mean and variance are taken over the runs)
+#define BENCHMARK_RUNS				(10)
+///Complete program executions of a run
+#define BENCHMARK_ITERATIONS		(100)
+
+///Workload: subtractive GCD of two consecutive Fibonacci numbers (same program as test_print_ggt)
+#define BENCHMARK_GCD				(0)
+///Workload: fixed-point (dec) PID steps with a simulated plant
+#define BENCHMARK_PID				(1)
+///Workload: counting loop
+#define BENCHMARK_LOOP				(2)
+///Workload: polling the status of a URL mapping which is never answered
+#define BENCHMARK_POLL				(3)
+///Number of workloads
+#define BENCHMARK_WORKLOADS			(4)
+
+///PID steps of BENCHMARK_PID
+#define BENCHMARK_PID_STEPS			(50)
+///Count of BENCHMARK_LOOP
+#define BENCHMARK_LOOP_COUNT		(1000)
+///Polls of BENCHMARK_POLL
+#define BENCHMARK_POLLS				(200)
+
+/**
+ * Engine executing the workloads.
+ */
+typedef struct {
+	const char* name;
+	/**
+	 * Loads a workload.
+	 * @param workload Workload (BENCHMARK_GCD ...).
+	 * @return False if the engine can not execute the workload.
+	 */
+	bool (*load)(uint8_t workload);
+	/**
+	 * Executes the loaded workload once.
+	 * @param instructions Incremented by the number of executed instructions (unchanged if the engine does not count).
+	 * @return Result of the workload.
+	 */
+	uint32_t (*execute)(uint32_t* instructions);
+	/**
+	 * @return Bytes of RAM used by the engine state (0 if there is none).
+	 */
+	uint32_t (*ram)(void);
+	/**
+	 * @return Size of the loaded program in bytes (0 for native code).
+	 */
+	uint32_t (*program)(void);
+} benchmark_engine_t;
+
+/**
+ * Statistics of the runs of one engine and workload.
+ */
+typedef struct {
+	///Mean of the µs per iteration
+	double mean;
+	///Sample variance of the µs per iteration
+	double variance;
+	double min;
+	double max;
+	///Executed instructions per iteration (0 if not counted)
+	uint32_t instructions;
+	///Result of the last iteration
+	uint32_t result;
+} benchmark_result_t;
+
+/**
+ * Hides a value from the optimizer, so native workloads are not evaluated at compile time.
+ * @param value Value.
+ * @return The value.
+ */
+template<typename T>
+inline T benchmark_opaque(T value)
+{
+	__asm__ volatile("" : "+r" (value));
+	return value;
+}
+
+static const char* const benchmark_workloads[BENCHMARK_WORKLOADS] = {"gcd", "pid", "loop", "poll"};
+///Errors (results different from native) of the benchmarks
+static uint32_t benchmark_errors = 0;
+
+#include "BenchmarkNative.h"
+#include "BenchmarkCalculation.h"
+#include "BenchmarkMango.h"
+
+/**
+ * Measures one workload on one engine.
+ * @param engine Engine, the workload is loaded.
+ * @param result Statistics of the runs.
+ */
+inline void benchmark_measure(const benchmark_engine_t* engine, benchmark_result_t* result)
+{
+	uint32_t instructions = 0;
+	result->result = engine->execute(&instructions);//warm up
+	result->instructions = instructions;
+	double sum = 0;
+	double squares = 0;
+	result->min = INFINITY;
+	result->max = 0;
+	for(uint8_t run = 0; run < BENCHMARK_RUNS; run++)
+	{
+		uint32_t start = xtimer_now();
+		for(uint16_t i = 0; i < BENCHMARK_ITERATIONS; i++)
+		{
+			result->result = engine->execute(&instructions);
+		}
+		double us = (double) (xtimer_now() - start) / BENCHMARK_ITERATIONS;
+		sum += us;
+		squares += us * us;
+		result->min = us < result->min ? us : result->min;
+		result->max = us > result->max ? us : result->max;
+	}
+	result->mean = sum / BENCHMARK_RUNS;
+	result->variance = BENCHMARK_RUNS > 1 ? (squares - sum * result->mean) / (BENCHMARK_RUNS - 1) : 0;
+	if(result->variance < 0)
+	{
+		result->variance = 0;
+	}
+}
+
+/**
+ * @brief Runs all workloads on all engines and prints one line per workload and engine.
+ */
+inline void run_benchmarks()
+{
+	const benchmark_engine_t* engines[] = {
+			&benchmark_native,
+			&benchmark_calculation,
+#ifdef VM_TRANSLATIONS
+			&benchmark_calculation_translated,
+#endif
+			&benchmark_mango
+	};
+	printf("Running benchmarks (%u runs of %u iterations, %s dispatch)...\n", BENCHMARK_RUNS, BENCHMARK_ITERATIONS, VM::getDispatchEngine());
+	printf("%-6s %-22s %10s %9s %10s %10s %12s %8s %8s %10s\n", "work", "engine", "us/iter", "stddev", "min", "max",
+			"instr/s", "RAM", "program", "result");
+	for(uint8_t workload = 0; workload < BENCHMARK_WORKLOADS; workload++)
+	{
+		uint32_t expected = 0;
+		for(uint8_t e = 0; e < sizeof(engines) / sizeof(engines[0]); e++)
+		{
+			const benchmark_engine_t* engine = engines[e];
+			if(!engine->load(workload))
+			{
+				printf("%-6s %-22s not supported\n", benchmark_workloads[workload], engine->name);
+				continue;
+			}
+			benchmark_result_t result;
+			benchmark_measure(engine, &result);
+			if(e == 0)
+			{
+				expected = result.result;
+			}
+			double ips = result.instructions && result.mean > 0 ? result.instructions / result.mean * 1000000.0 : 0;
+			printf("%-6s %-22s %10.3f %9.3f %10.3f %10.3f %12.0f %8" PRIu32 " %8" PRIu32 " %10" PRIu32 "%s\n",
+					benchmark_workloads[workload], engine->name, result.mean, sqrt(result.variance), result.min, result.max,
+					ips, engine->ram(), engine->program(), result.result, result.result == expected ? "" : " ERROR");
+			if(result.result != expected)
+			{
+				benchmark_errors++;
+			}
+		}
+	}
+	printf("Benchmarks completed, %" PRIu32 " Errors\n", benchmark_errors);
+}
+
+#include "BenchmarkOpcodes.h"
+#include "BenchmarkMaps.h"
+
+#endif /* BENCHMARKS_H_ */
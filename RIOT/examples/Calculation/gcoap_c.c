@@ -25,10 +25,49 @@ extern "C" {
 #include "Opcodes.h"
 #include "xtimer.h"
 
-///Utility array to store which mapping (array index) has pending requests (CoAP packet token).
-static uint16_t active_requests[VM_MEMORY_MAP_SIZE];
+#ifdef __arm__
+///Every client mapping is checked about every 2s
+#define GCOAP_C_PERIOD	(2000000)
+#else
+///Every client mapping is checked about every 1s
+#define GCOAP_C_PERIOD	(1000000)
+#endif
+///Observers of changed server mappings are notified about every 100ms
+#define GCOAP_C_NOTIFY_PERIOD	(100000)
+
+/**
+ * Pending request of a mapping.
+ */
+typedef struct {
+	///CoAP message ID of the request
+	uint16_t msgid;
+	///ID of the URL-Map, NO_MAPPING if the entry is free
+	uint16_t map_id;
+	///VM instance of the URL-Map
+	uint8_t instance;
+} gcoap_c_request_t;
+
+///Utility array to store which mappings have pending requests, gcoap has at most GCOAP_REQ_WAITING_MAX open requests.
+static gcoap_c_request_t active_requests[GCOAP_REQ_WAITING_MAX];
 static int32_t get_active_index(coap_pkt_t* pdu);
+static int32_t find_active_index(uint8_t instance, uint16_t map_id);
 static void _resp_handler(unsigned req_state, coap_pkt_t* pdu);
+void gcoap_s_notify(void);
+
+/**
+ * Sleeps in slices of at most GCOAP_C_NOTIFY_PERIOD and notifies the observers of the server mappings after every slice.
+ * @param us Sleep time in µs
+ */
+static void _sleep(uint32_t us)
+{
+	while(us > 0)
+	{
+		uint32_t slice = us < GCOAP_C_NOTIFY_PERIOD ? us : GCOAP_C_NOTIFY_PERIOD;
+		xtimer_usleep(slice);
+		us -= slice;
+		gcoap_s_notify();
+	}
+}
 
 /**
  * Callback handler for CoAP responses.
@@ -37,14 +76,17 @@ static void _resp_handler(unsigned req_state, coap_pkt_t* pdu);
  */
 static void _resp_handler(unsigned req_state, coap_pkt_t* pdu)
 {
-	int32_t index = get_active_index(pdu);
-	if(index < 0)
+	int32_t active = get_active_index(pdu);
+	if(active < 0)
 	{
 		return;
 	}
-	active_requests[index] = 0; //remove active request
+	uint8_t instance = active_requests[active].instance;
+	uint16_t index = active_requests[active].map_id;
+	active_requests[active].map_id = NO_MAPPING; //remove active request
     if (req_state == GCOAP_MEMO_TIMEOUT) {
-    	gcoap_error(index, VM_MAP_STATUS_ERROR_TIMEOUT);
+    	gcoap_error(instance, index, VM_MAP_STATUS_ERROR_TIMEOUT);
+    	gcoap_resend(instance, index);//pushed values are sent again
         return;
     }
     else if (req_state == GCOAP_MEMO_ERR) {
@@ -56,18 +98,18 @@ static void _resp_handler(unsigned req_state, coap_pkt_t* pdu)
                 || coap_get_code_class(pdu) == COAP_CLASS_SERVER_FAILURE) {
         	//failure
         	//set failure code...
-        	gcoap_error(index, VM_MAP_STATUS_ERROR_SERVER);
+        	gcoap_error(instance, index, VM_MAP_STATUS_ERROR_SERVER);
         }
         else {
             //handle response
-        	if(gcoap_store_value(pdu->content_type, index, pdu->payload, pdu->payload_len))
+        	if(gcoap_store_value(instance, pdu->content_type, index, pdu->payload, pdu->payload_len))
         	{
         		//store error
-        		gcoap_error(index, VM_MAP_STATUS_ERROR_STORE);
+        		gcoap_error(instance, index, VM_MAP_STATUS_ERROR_STORE);
         	}
         	else
         	{
-        		gcoap_done(index);
+        		gcoap_done(instance, index);
         	}
 //        	printf("Got answer: %.*s\n", pdu->payload_len, pdu->payload);
         }
@@ -76,12 +118,12 @@ static void _resp_handler(unsigned req_state, coap_pkt_t* pdu)
         //empty payload (must have been a post or put or a GET error)
     	if(coap_get_code_class(pdu) == COAP_CLASS_SERVER_FAILURE)
     	{
-    		gcoap_error(index, VM_MAP_STATUS_ERROR_SERVER);
+    		gcoap_error(instance, index, VM_MAP_STATUS_ERROR_SERVER);
     	}
     	else
     	{
     		//no error -> done
-    		gcoap_done(index);
+    		gcoap_done(instance, index);
     	}
     }
 }
@@ -89,13 +131,31 @@ static void _resp_handler(unsigned req_state, coap_pkt_t* pdu)
 /**
  * Utility function to get the index of an active CoAP request.
  * @param pdu
- * @return
+ * @return Index in active_requests, -1 if the request is unknown
  */
 static int32_t get_active_index(coap_pkt_t* pdu)
 {
-	for(uint8_t i = 0; i < VM_MEMORY_MAP_SIZE; i++)
+	for(uint8_t i = 0; i < GCOAP_REQ_WAITING_MAX; i++)
+	{
+		if(active_requests[i].map_id != NO_MAPPING && ntohs(pdu->hdr->id) == active_requests[i].msgid)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+/**
+ * Utility function to find the active CoAP request of a mapping.
+ * @param instance VM instance of the mapping
+ * @param map_id ID of the mapping, NO_MAPPING to find a free entry
+ * @return Index in active_requests, -1 if the mapping has no active request (or there is no free entry)
+ */
+static int32_t find_active_index(uint8_t instance, uint16_t map_id)
+{
+	for(uint8_t i = 0; i < GCOAP_REQ_WAITING_MAX; i++)
 	{
-		if(ntohs(pdu->hdr->id) == active_requests[i])
+		if(active_requests[i].map_id == map_id && (map_id == NO_MAPPING || active_requests[i].instance == instance))
 		{
 			return i;
 		}
@@ -107,17 +167,18 @@ static int32_t get_active_index(coap_pkt_t* pdu)
  * Sends a CoAP request.
  * @param buf
  * @param len
+ * @param instance VM instance of the mapping
  * @param mapping
  * @return
  */
-static size_t _send(uint8_t *buf, size_t len, const url_map_t* mapping)
+static size_t _send(uint8_t *buf, size_t len, uint8_t instance, const url_map_t* mapping)
 {
     size_t bytes_sent;
     uint16_t port = mapping->port;
     ipv6_addr_t addr;
     /* parse destination address */
     char host[40];
-    gcoap_get_host(mapping, host);
+    gcoap_get_host(instance, mapping, host);
     if (ipv6_addr_from_str(&addr, host) == NULL) {
         printf("gcoap_c: invalid address\n");
         return 0;
@@ -132,27 +193,26 @@ static size_t _send(uint8_t *buf, size_t len, const url_map_t* mapping)
 }
 
 /**
- * Function to check for CoAP client mappings. Sends CoAP requests to the host and resource specified in the mapping.
+ * Function to check for CoAP client mappings of a VM instance. Sends CoAP requests to the host and resource specified in the mapping.
+ * Only the used client mappings are visited (unused ids, blocks and server mappings are skipped). GET requests are sent
+ * on every check, POST and PUT requests only if the value changed since the last push (see gcoap_take_change).
+ * @param instance VM instance
+ * @param interval Sleep time in µs before every mapping
  */
-void check_clientmappings(void);
-void check_clientmappings(void)
+static void check_clientmappings_instance(uint8_t instance, uint32_t interval)
 {
-	const url_map_t* mappings = gcoap_get_mappings();
-	uint8_t mapsize = gcoap_get_map_size();
-	for(uint8_t i = 0; i < mapsize; i++)
+	for(uint16_t i = gcoap_next_client_mapping(instance, 0); i < VM_MEMORY_MAP_SIZE; i = gcoap_next_client_mapping(instance, i + 1))
 	{
-#ifdef __arm__
-		xtimer_usleep(2000000 / VM_MEMORY_MAP_SIZE); //check every mapping about every 2s
-#else
-		xtimer_usleep(1000000 / VM_MEMORY_MAP_SIZE); //check every mapping about every 1s
-#endif
-		if(mappings[i].url_address == NO_MAPPING || mappings[i].value_address == NO_MAPPING || (mappings[i].status > 1 && (mappings[i].map_options & VM_MAP_OPTION_LIFETIME_ONCE)))
+		_sleep(interval);
+		url_map_t mapping = gcoap_get_mapping(instance, i);//copy, the mapping may be deleted meanwhile
+		if(mapping.url_address == NO_MAPPING || mapping.value_address == NO_MAPPING || (mapping.status > 1 && (mapping.map_options & VM_MAP_OPTION_LIFETIME_ONCE)))
 		{
 			continue;
 		}
-		if(mappings[i].map_options & VM_MAP_OPTION_DIRECTION_CLIENT)
+		if(mapping.map_options & VM_MAP_OPTION_DIRECTION_CLIENT)
 		{
-			if(active_requests[i] != 0)
+			int32_t slot = find_active_index(instance, NO_MAPPING);
+			if(find_active_index(instance, i) >= 0 || slot < 0)
 			{
 				continue;
 			}
@@ -161,43 +221,75 @@ void check_clientmappings(void)
 			size_t len = 0;
 			size_t new_payload_len;
 			char ressource[64];
-			gcoap_get_resource(&mappings[i], ressource);
+			gcoap_get_resource(instance, &mapping, ressource);
 			if(strlen(ressource) < 1)
 			{
 				printf("gcoap_c: no resource specified");
 				continue;
 			}
-			switch(mappings[i].map_options & VM_MAP_OPTION_METHOD)
+			if((mapping.map_options & VM_MAP_OPTION_METHOD) != VM_MAP_OPTION_METHOD_GET && !gcoap_take_change(instance, i))
+			{//value not changed since the last push
+				continue;
+			}
+			switch(mapping.map_options & VM_MAP_OPTION_METHOD)
 			{
 			case VM_MAP_OPTION_METHOD_GET:
 				len = gcoap_request(&pdu, &buf[0], GCOAP_PDU_BUF_SIZE, COAP_GET, ressource);
 				break;
 			case VM_MAP_OPTION_METHOD_POST:
 				gcoap_req_init(&pdu, &buf[0], GCOAP_PDU_BUF_SIZE, COAP_POST, ressource);
-				new_payload_len = gcoap_load_value(pdu.content_type, pdu.payload, pdu.payload_len, i);
+				new_payload_len = gcoap_load_value(instance, pdu.content_type, pdu.payload, pdu.payload_len, i);
 				len = gcoap_finish(&pdu, new_payload_len, COAP_FORMAT_TEXT);
 				break;
 			case VM_MAP_OPTION_METHOD_PUT:
 				gcoap_req_init(&pdu, &buf[0], GCOAP_PDU_BUF_SIZE, COAP_PUT, ressource);
-				new_payload_len = gcoap_load_value(pdu.content_type, pdu.payload, pdu.payload_len, i);
+				new_payload_len = gcoap_load_value(instance, pdu.content_type, pdu.payload, pdu.payload_len, i);
 				len = gcoap_finish(&pdu, new_payload_len, COAP_FORMAT_TEXT);
 				break;
 			default:
 				break;
 			}
-			if (!_send(&buf[0], len, &mappings[i]))
+			if (!_send(&buf[0], len, instance, &mapping))
 			{
-                //error
+				gcoap_resend(instance, i);
 			}
 			else
 			{
-				active_requests[i] = ntohs(pdu.hdr->id);
+				active_requests[slot].msgid = ntohs(pdu.hdr->id);
+				active_requests[slot].instance = instance;
+				active_requests[slot].map_id = i;
 			}
 
 		}
 	}
 }
 
+/**
+ * Function to check for CoAP client mappings of all VM instances. The period is divided by the number of client mappings,
+ * so every mapping is checked about once per GCOAP_C_PERIOD.
+ */
+void check_clientmappings(void);
+void check_clientmappings(void)
+{
+	uint32_t count = 0;
+	for(uint8_t instance = 0; instance < VM_INSTANCES; instance++)
+	{
+		for(uint16_t i = gcoap_next_client_mapping(instance, 0); i < VM_MEMORY_MAP_SIZE; i = gcoap_next_client_mapping(instance, i + 1))
+		{
+			count++;
+		}
+	}
+	if(count == 0)
+	{
+		_sleep(GCOAP_C_PERIOD);
+		return;
+	}
+	for(uint8_t instance = 0; instance < VM_INSTANCES; instance++)
+	{
+		check_clientmappings_instance(instance, GCOAP_C_PERIOD / count);
+	}
+}
+
 /**
  * Thread to check URL mappings.
  * @param args
@@ -205,6 +297,10 @@ void check_clientmappings(void)
 void *coap_c_thread(void *args)
 {
 	(void) args;
+	for(uint8_t i = 0; i < GCOAP_REQ_WAITING_MAX; i++)
+	{
+		active_requests[i].map_id = NO_MAPPING;
+	}
 	while(1)
 	{
 		check_clientmappings();
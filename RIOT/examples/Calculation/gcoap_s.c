@@ -8,6 +8,9 @@
 
 /**
  * @brief       Implementation of gcoap server used as an interface for the Calculation VM (upload of Bytecode, get status information, etc).
+ * 				The resources of a VM instance are available below /vm/<n>/, the resources without prefix address instance 0.
+ * 				The resources of the server mappings are available with GET, an Observe registration is notified when the
+ * 				mapped value changes (see gcoap_s_notify()).
  *
  * @author      Mattes Besuden <besuden@uni-bremen.de>
  */
@@ -16,6 +19,8 @@
 extern "C" {
 #endif
 
+	#include <stdlib.h>
+
 	#include "net/gnrc/coap.h"
 	#include "od.h"
 	#include "fmt.h"
@@ -25,6 +30,7 @@ extern "C" {
 	#include "Opcodes.h"
 
 	static ssize_t _dump_handler(coap_pkt_t* pdu, uint8_t *buf, size_t len);
+	static ssize_t _priority_handler(coap_pkt_t* pdu, uint8_t *buf, size_t len);
 	static ssize_t _status_handler(coap_pkt_t* pdu, uint8_t *buf, size_t len);
 	static ssize_t _status_map_handler(coap_pkt_t* pdu, uint8_t *buf, size_t len);
 	static ssize_t _status_pid_handler(coap_pkt_t* pdu, uint8_t *buf, size_t len);
@@ -33,9 +39,11 @@ extern "C" {
 	static ssize_t _upload_multipart_handler(coap_pkt_t* pdu, uint8_t *buf, size_t len);
 	static ssize_t _value_get_handler(coap_pkt_t* pdu, uint8_t *buf, size_t len);
 	static ssize_t _value_post_handler(coap_pkt_t* pdu, uint8_t *buf, size_t len);
+	static ssize_t _value_resource_handler(coap_pkt_t* pdu, uint8_t *buf, size_t len);
 
 	/* CoAP resources */
 	static const coap_resource_t _resources[] = {
+		{ "/*", COAP_GET, _value_resource_handler },//resources of the server mappings, used if no other path matches
 		{ "/dump", COAP_POST, _dump_handler },
 		{ "/status", COAP_GET, _status_handler },
 		{ "/status/map", COAP_GET, _status_map_handler },
@@ -53,10 +61,85 @@ extern "C" {
 		NULL
 	};
 
+	/* CoAP resources of every VM instance, registered below /vm/<n> */
+	static const coap_resource_t _instance_resources[] = {
+		{ "/dump", COAP_POST, _dump_handler },
+		{ "/priority", COAP_POST, _priority_handler },
+		{ "/status", COAP_GET, _status_handler },
+		{ "/status/map", COAP_GET, _status_map_handler },
+		{ "/status/pid", COAP_GET, _status_pid_handler },
+		{ "/status/vm", COAP_GET, _status_vm_handler },
+		{ "/upload", COAP_POST, _upload_handler },
+		{ "/upload/multipart", COAP_POST, _upload_multipart_handler },
+	};
+
+	///Number of resources of a VM instance
+	#define VM_INSTANCE_RESOURCES	(sizeof(_instance_resources) / sizeof(_instance_resources[0]))
+	///Maximum length of the path of an instance resource ("/vm/255/upload/multipart")
+	#define VM_INSTANCE_PATH_MAX	(28)
+
+	static coap_resource_t _vm_resources[VM_INSTANCES * VM_INSTANCE_RESOURCES];
+	static char _vm_paths[VM_INSTANCES * VM_INSTANCE_RESOURCES][VM_INSTANCE_PATH_MAX];
+
+	static gcoap_listener_t _vm_listener = {
+		&_vm_resources[0],
+		VM_INSTANCES * VM_INSTANCE_RESOURCES,
+		NULL
+	};
+
 	kernel_pid_t vm_thread_pid;
 
+	/**
+	 * Gets the VM instance a request is addressed to.
+	 * @param pdu
+	 * @return Instance n for requests to /vm/<n>/..., 0 for all other requests
+	 */
+	static uint8_t _instance(coap_pkt_t* pdu)
+	{
+		if(strncmp((const char*)pdu->url, "/vm/", 4) != 0)
+		{
+			return 0;
+		}
+		return (uint8_t) strtoul((const char*)pdu->url + 4, NULL, 10);//only paths of existing instances are registered
+	}
+
+	/**
+	 * Sends a command to a VM instance.
+	 * @param command Command (see ThreadVM.h)
+	 * @param instance VM instance
+	 * @param argument Argument of the command
+	 * @return 1 if the command was sent
+	 */
+	static int _send_command(uint8_t command, uint8_t instance, uint8_t argument)
+	{
+		msg_t m;
+		m.content.value = VM_THREAD_MESSAGE(command, instance, argument);
+		return msg_try_send(&m, vm_thread_pid);
+	}
+
+	/**
+	 * Optimizes the uploaded program and restarts the VM instance. The response carries the code size before and
+	 * after the optimization and the estimated cycles saved (uint16_t each, empty if the VM thread did not answer).
+	 * @param pdu
+	 * @param buf
+	 * @param len
+	 * @param instance VM instance
+	 * @return
+	 */
+	static ssize_t _restart_optimized(coap_pkt_t* pdu, uint8_t *buf, size_t len, uint8_t instance)
+	{
+		gcoap_resp_init(pdu, buf, len, COAP_CODE_VALID);
+		size_t payload_len = gcoap_optimizeVM(instance, pdu->payload, len - (pdu->payload - buf), vm_thread_pid);
+		if(_send_command(VM_THREAD_RESTART, instance, 0) != 1)
+		{
+			return gcoap_response(pdu, buf, len, COAP_CODE_INTERNAL_SERVER_ERROR);
+		}
+		return gcoap_finish(pdu, payload_len, COAP_FORMAT_OCTET);
+	}
+
 	/**
 	 * CoAP handler which returns a memory dump starting at the address specified by POST payload.
+	 * The payload is the hex address, optionally followed by a segment selector: 'd' for data (default), 'c' for code.
 	 * @param pdu
 	 * @param buf
 	 * @param len
@@ -68,26 +151,64 @@ extern "C" {
 		{
 			return gcoap_response(pdu, buf, len, COAP_CODE_UNSUPPORTED_CONTENT_FORMAT);
 		}
+		if(pdu->payload_len != 4 && (pdu->payload_len != 5 || (pdu->payload[4] != 'c' && pdu->payload[4] != 'd')))
+		{
+			return gcoap_response(pdu, buf, len, COAP_CODE_BAD_REQUEST);
+		}
+		uint8_t instance = _instance(pdu);
+		bool code = pdu->payload_len == 5 && pdu->payload[4] == 'c';
 		uint16_t startaddress = gcoap_fromHex((char) pdu->payload[0], (char) pdu->payload[1]) << 8 | gcoap_fromHex((char) pdu->payload[2], (char) pdu->payload[3]);
-		uint16_t dumpsize = gcoap_dumpSize();
+		uint16_t dumpsize = code ? gcoap_codeSize(instance) : gcoap_dumpSize(instance);
 
-		if(pdu->payload_len != 4 || startaddress >= dumpsize)
+		if(startaddress >= dumpsize)
 		{
 			return gcoap_response(pdu, buf, len, COAP_CODE_BAD_REQUEST);
 		}
 
-		const uint8_t* dump = gcoap_dumpMemory();
 		size_t new_payload_len = 64;//TODO rework and check for overflows
 		if(new_payload_len + startaddress >= dumpsize)
 		{
 			new_payload_len = dumpsize - startaddress;
 		}
+		uint8_t snapshot[64];
+		if(code ? !gcoap_snapshotCode(instance, startaddress, snapshot, new_payload_len) : !gcoap_snapshotMemory(instance, startaddress, snapshot, new_payload_len))
+		{//memory kept changing, client can retry
+			return gcoap_response(pdu, buf, len, COAP_CODE_SERVICE_UNAVAILABLE);
+		}
 		gcoap_resp_init(pdu, buf, len, COAP_CODE_CONTENT);
-		memcpy(pdu->payload, &dump[startaddress], new_payload_len);
+		memcpy(pdu->payload, snapshot, new_payload_len);
 
 		return gcoap_finish(pdu, new_payload_len, COAP_FORMAT_OCTET);
 	}
 
+	/**
+	 * CoAP handler which sets the scheduling priority of a VM instance to the decimal POST payload (0-255).
+	 * @param pdu
+	 * @param buf
+	 * @param len
+	 * @return
+	 */
+	static ssize_t _priority_handler(coap_pkt_t* pdu, uint8_t *buf, size_t len)
+	{
+		char priority[4] = {0};
+		if(pdu->payload_len < 1 || pdu->payload_len >= sizeof(priority))
+		{
+			return gcoap_response(pdu, buf, len, COAP_CODE_BAD_REQUEST);
+		}
+		memcpy(priority, pdu->payload, pdu->payload_len);
+		char* end;
+		unsigned long value = strtoul(priority, &end, 10);
+		if(*end != 0 || value > UINT8_MAX)
+		{
+			return gcoap_response(pdu, buf, len, COAP_CODE_BAD_REQUEST);
+		}
+		if(_send_command(VM_THREAD_PRIORITY, _instance(pdu), (uint8_t) value) != 1)
+		{
+			return gcoap_response(pdu, buf, len, COAP_CODE_INTERNAL_SERVER_ERROR);
+		}
+		return gcoap_response(pdu, buf, len, COAP_CODE_CHANGED);
+	}
+
 	/**
 	 * CoAP handler which returns the combined status information of the device (VM, mappings, pids).
 	 * @param pdu
@@ -106,10 +227,11 @@ extern "C" {
 		//		id: <Mode>
 		//
 		//would be useful
+		uint8_t instance = _instance(pdu);
 		gcoap_resp_init(pdu, buf, len, COAP_CODE_CONTENT);
-		size_t new_payload_len = gcoap_statusVM(pdu->payload, len, vm_thread_pid);
-		new_payload_len += gcoap_statusMappings(pdu->payload + new_payload_len, len - new_payload_len);
-		new_payload_len += gcoap_statusPID(pdu->payload + new_payload_len, len - new_payload_len);
+		size_t new_payload_len = gcoap_statusVM(instance, pdu->payload, len, vm_thread_pid);
+		new_payload_len += gcoap_statusMappings(instance, pdu->payload + new_payload_len, len - new_payload_len);
+		new_payload_len += gcoap_statusPID(instance, pdu->payload + new_payload_len, len - new_payload_len);
 		return gcoap_finish(pdu, new_payload_len, COAP_FORMAT_OCTET);
 	}
 
@@ -122,8 +244,9 @@ extern "C" {
 	 */
 	static ssize_t _status_map_handler(coap_pkt_t* pdu, uint8_t *buf, size_t len)
 	{
+		uint8_t instance = _instance(pdu);
 		gcoap_resp_init(pdu, buf, len, COAP_CODE_CONTENT);
-		size_t payload_len = gcoap_statusMappings(pdu->payload, len);
+		size_t payload_len = gcoap_statusMappings(instance, pdu->payload, len);
 		return gcoap_finish(pdu, payload_len, COAP_FORMAT_OCTET);
 	}
 
@@ -136,8 +259,9 @@ extern "C" {
 	 */
 	static ssize_t _status_pid_handler(coap_pkt_t* pdu, uint8_t *buf, size_t len)
 	{
+		uint8_t instance = _instance(pdu);
 		gcoap_resp_init(pdu, buf, len, COAP_CODE_CONTENT);
-		size_t payload_len = gcoap_statusPID(pdu->payload, len);
+		size_t payload_len = gcoap_statusPID(instance, pdu->payload, len);
 		return gcoap_finish(pdu, payload_len, COAP_FORMAT_OCTET);
 	}
 	/**
@@ -149,13 +273,14 @@ extern "C" {
 	 */
 	static ssize_t _status_vm_handler(coap_pkt_t* pdu, uint8_t *buf, size_t len)
 	{
+		uint8_t instance = _instance(pdu);
 		gcoap_resp_init(pdu, buf, len, COAP_CODE_CONTENT);
-		size_t payload_len = gcoap_statusVM(pdu->payload, len, vm_thread_pid);
+		size_t payload_len = gcoap_statusVM(instance, pdu->payload, len, vm_thread_pid);
 		return gcoap_finish(pdu, payload_len, COAP_FORMAT_OCTET);
 	}
 
 	/**
-	 * CoAP handler which stores the payload bytecode in the shared memory and restarts the VM.
+	 * CoAP handler which stores the payload bytecode in the shared memory, optimizes it and restarts the VM (see _restart_optimized()).
 	 * @param pdu
 	 * @param buf
 	 * @param len
@@ -163,55 +288,54 @@ extern "C" {
 	 */
 	static ssize_t _upload_handler(coap_pkt_t* pdu, uint8_t *buf, size_t len)
 	{
-		msg_t m;
-		m.content.value = VM_THREAD_STOP;
-		if(msg_try_send(&m, vm_thread_pid) != 1)
+		uint8_t instance = _instance(pdu);
+		if(_send_command(VM_THREAD_STOP, instance, 0) != 1)
 		{//try to stop VM before storing new bytecode;
 			return gcoap_response(pdu, buf, len, COAP_CODE_PRECONDITION_FAILED);
 		}
+		//every early return sets the VM_Thread to run again, the old bytecode is kept
+		uint16_t codelen = pdu->payload_len;
+		bool hex = false;
 		switch(pdu->content_type)
 		{
 		case 42: //OCTET
-			if(pdu->payload_len > gcoap_dumpSize())
-			{
-				return gcoap_response(pdu, buf, len, COAP_CODE_REQUEST_ENTITY_TOO_LARGE);
-			}
-			for(uint16_t i = 0; i < pdu->payload_len; i++)
-			{
-				gcoap_store(i, pdu->payload[i]);
-			}
 			break;
 		case 0: //TEXT
 		default: //unknown assume text
 			//if text, hex notation is used -> 2chars for 1 Byte
-			if(pdu->payload_len % 2 == 1 || pdu->payload_len / 2 > gcoap_dumpSize())//if text, payload_len must be even -> 2chars for one byte
+			if(pdu->payload_len % 2 == 1)//if text, payload_len must be even -> 2chars for one byte
 			{
-				m.content.value = VM_THREAD_RUN;
-				msg_try_send(&m, vm_thread_pid);
-				//set VM_Thread to run because no new bytecode was uploaded;
+				_send_command(VM_THREAD_RUN, instance, 0);
 				return gcoap_response(pdu, buf, len, COAP_CODE_BAD_REQUEST);
 			}
-			for(uint16_t i = 0; i < pdu->payload_len; i = i + 2)
-			{
-
-				gcoap_store(i / 2, gcoap_fromHex((char)pdu->payload[i], (char)pdu->payload[i+1]));
-			}
+			codelen = pdu->payload_len / 2;
+			hex = true;
 			break;
 		}
-		m.content.value = VM_THREAD_RESTART;
-		if(msg_try_send(&m, vm_thread_pid) == 1)
+		if(codelen > gcoap_codeCapacity(instance))
+		{//code segment in Harvard mode, may be smaller than the memory
+			_send_command(VM_THREAD_RUN, instance, 0);
+			return gcoap_response(pdu, buf, len, COAP_CODE_REQUEST_ENTITY_TOO_LARGE);
+		}
+		if(hex)
 		{
-			return gcoap_response(pdu, buf, len, COAP_CODE_VALID);
+			for(uint16_t i = 0; i < pdu->payload_len; i = i + 2)
+			{//decoded in place, byte i/2 is written after chars i and i+1 are read
+				pdu->payload[i / 2] = gcoap_fromHex((char)pdu->payload[i], (char)pdu->payload[i+1]);
+			}
 		}
-		else
+		if(!gcoap_storeCode(instance, 0, pdu->payload, codelen))
 		{
-			return gcoap_response(pdu, buf, len, COAP_CODE_INTERNAL_SERVER_ERROR);
+			_send_command(VM_THREAD_RUN, instance, 0);
+			return gcoap_response(pdu, buf, len, COAP_CODE_REQUEST_ENTITY_TOO_LARGE);
 		}
+		gcoap_code_written(instance, 0, codelen);
+		return _restart_optimized(pdu, buf, len, instance);
 	}
 
 	/**
 	 * CoAP handler which stores the payload bytecode in the shared memory starting at the address specified by the first 4 characters (interpreted as hex address).
-	 * Can be used to upload large bytecode scripts, due to the missing blockwise-transfer of gcoap. By POSTing only the address ffff to this handler, the VM will be restarted.
+	 * Can be used to upload large bytecode scripts, due to the missing blockwise-transfer of gcoap. By POSTing only the address ffff to this handler, the program is optimized and the VM restarted (see _restart_optimized()).
 	 * @param pdu
 	 * @param buf
 	 * @param len
@@ -224,34 +348,30 @@ extern "C" {
 		{
 			return gcoap_response(pdu, buf, len, COAP_CODE_BAD_REQUEST);
 		}
-		msg_t m;
-		m.content.value = VM_THREAD_STOP;
-		if(msg_try_send(&m, vm_thread_pid) != 1)
+		uint8_t instance = _instance(pdu);
+		if(_send_command(VM_THREAD_STOP, instance, 0) != 1)
 		{//try to stop VM before storing new bytecode;
 			return gcoap_response(pdu, buf, len, COAP_CODE_PRECONDITION_FAILED);
 		}
 		uint16_t startaddress = gcoap_fromHex((char)pdu->payload[0], (char)pdu->payload[1]) << 8 | gcoap_fromHex((char)pdu->payload[2], (char)pdu->payload[3]);
 		if(pdu->payload_len == 4 && startaddress == NO_MAPPING)
 		{
-			//start VM
-			m.content.value = VM_THREAD_RESTART;
-			if(msg_try_send(&m, vm_thread_pid) == 1)
-			{
-				return gcoap_response(pdu, buf, len, COAP_CODE_VALID);
-			}
-			else
-			{
-				return gcoap_response(pdu, buf, len, COAP_CODE_INTERNAL_SERVER_ERROR);
-			}
+			//start VM, the upload is complete
+			return _restart_optimized(pdu, buf, len, instance);
 		}
 		switch(pdu->content_type)
 		{
 		case COAP_FORMAT_NONE: //since gcoap example only send with COAP_FORMAT_NONE
 		case COAP_FORMAT_TEXT: //TEXT
 			for(uint16_t i = 0; i < (pdu->payload_len - 4); i = i + 2)
+			{//decoded in place behind the address
+				pdu->payload[4 + i/2] = gcoap_fromHex((char)pdu->payload[i + 4], (char)pdu->payload[i+5]);
+			}
+			if(!gcoap_storeCode(instance, startaddress, pdu->payload + 4, (pdu->payload_len - 4) / 2))
 			{
-				gcoap_store(startaddress + i/2, gcoap_fromHex((char)pdu->payload[i + 4], (char)pdu->payload[i+5]));
+				return gcoap_response(pdu, buf, len, COAP_CODE_REQUEST_ENTITY_TOO_LARGE);
 			}
+			gcoap_code_written(instance, startaddress, (pdu->payload_len - 4) / 2);
 			return gcoap_response(pdu, buf, len, COAP_CODE_VALID);
 		default: //unknown
 			return gcoap_response(pdu, buf, len, COAP_CODE_UNSUPPORTED_CONTENT_FORMAT);
@@ -263,7 +383,8 @@ extern "C" {
 	 * the requested value can be requested by POSTing the mapping string.
 	 * The handler checks if the string is mapped and returns the value or COAP_ERROR_404 if not mapped.
 	 * Since query strings are not supported, the POST mappings can not be implemented since we had to post
-	 * the map string AND the value in the same message.
+	 * the map string AND the value in the same message. A GET on the mapped resource itself returns the value as well and
+	 * can be observed (see _value_resource_handler()).
 	 * @param pdu
 	 * @param buf
 	 * @param len
@@ -296,13 +417,107 @@ extern "C" {
 	}
 
 	/**
-	 * Initializes CoAP listener, sets process ID of VM thread.
+	 * CoAP handler which returns the value of the server mapping of the requested path (text format) or COAP_ERROR_404 if the
+	 * path is not mapped. With the Observe option the client is registered by gcoap and notified by gcoap_s_notify().
+	 * @param pdu
+	 * @param buf
+	 * @param len
+	 * @return
+	 */
+	static ssize_t _value_resource_handler(coap_pkt_t* pdu, uint8_t *buf, size_t len)
+	{
+		size_t url_len = strlen((const char*)pdu->url);
+		gcoap_resp_init(pdu, buf, len, COAP_CODE_CONTENT);
+		size_t available = len - (pdu->payload - buf);
+		if(url_len > available)
+		{
+			return gcoap_response(pdu, buf, len, COAP_CODE_404);
+		}
+		memcpy(pdu->payload, pdu->url, url_len);
+		ssize_t payload_len = gcoap_check_server_value(COAP_FORMAT_TEXT, pdu->payload, url_len, available);
+		if(payload_len > 0)
+		{
+			return gcoap_finish(pdu, payload_len, COAP_FORMAT_TEXT);
+		}
+		return gcoap_response(pdu, buf, len, COAP_CODE_404);
+	}
+
+	/**
+	 * Sends a notification to the observer of every server mapping whose value changed since the last check (see
+	 * gcoap_take_change()). Called periodically by the client thread.
+	 */
+	void gcoap_s_notify(void)
+	{
+		uint8_t buf[GCOAP_PDU_BUF_SIZE];
+		coap_pkt_t pdu;
+		char resource[NANOCOAP_URL_MAX];
+		for(uint8_t instance = 0; instance < VM_INSTANCES; instance++)
+		{
+			for(uint16_t i = gcoap_next_server_mapping(instance, 0); i < VM_MEMORY_MAP_SIZE; i = gcoap_next_server_mapping(instance, i + 1))
+			{
+				if(!gcoap_take_change(instance, i))
+				{
+					continue;
+				}
+				url_map_t mapping = gcoap_get_mapping(instance, i);//copy, the mapping may be deleted meanwhile
+				if(mapping.resource_address == NO_MAPPING || strlen((const char*)gcoap_loadresource(instance, &mapping)) >= sizeof(resource))
+				{
+					continue;
+				}
+				gcoap_get_resource(instance, &mapping, resource);
+				if(gcoap_obs_init(&pdu, buf, GCOAP_PDU_BUF_SIZE, resource) != GCOAP_OBS_INIT_OK)
+				{//not observed
+					continue;
+				}
+				size_t payload_len = gcoap_peek_value(instance, COAP_FORMAT_TEXT, pdu.payload, pdu.payload_len, i);//a notification keeps ONCE mappings
+				ssize_t len = gcoap_finish(&pdu, payload_len, COAP_FORMAT_TEXT);
+				if(len > 0)
+				{
+					gcoap_obs_send(buf, len, resource);
+				}
+			}
+		}
+	}
+
+	/**
+	 * Compares the paths of two resources (gcoap expects resources in alphabetical order).
+	 * @param a
+	 * @param b
+	 * @return
+	 */
+	static int _compare_resources(const void* a, const void* b)
+	{
+		return strcmp(((const coap_resource_t*)a)->path, ((const coap_resource_t*)b)->path);
+	}
+
+	/**
+	 * Creates the resources /vm/<n>/... of all VM instances.
+	 */
+	static void _init_instance_resources(void)
+	{
+		for(uint16_t instance = 0; instance < VM_INSTANCES; instance++)
+		{
+			for(uint8_t i = 0; i < VM_INSTANCE_RESOURCES; i++)
+			{
+				uint16_t index = instance * VM_INSTANCE_RESOURCES + i;
+				snprintf(_vm_paths[index], VM_INSTANCE_PATH_MAX, "/vm/%u%s", instance, _instance_resources[i].path);
+				_vm_resources[index] = _instance_resources[i];
+				_vm_resources[index].path = _vm_paths[index];
+			}
+		}
+		qsort(_vm_resources, VM_INSTANCES * VM_INSTANCE_RESOURCES, sizeof(coap_resource_t), _compare_resources);//"/vm/10" < "/vm/2"
+	}
+
+	/**
+	 * Initializes CoAP listeners, sets process ID of VM thread.
 	 * @param vm_thread
 	 */
 	void gcoap_s_init(kernel_pid_t vm_thread)
 	{
 		vm_thread_pid = vm_thread;
+		_init_instance_resources();
 		gcoap_register_listener(&_listener);
+		gcoap_register_listener(&_vm_listener);
 	}
 
 #ifdef __cplusplus
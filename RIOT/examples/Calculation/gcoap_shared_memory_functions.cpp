@@ -14,13 +14,16 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string>
+#ifndef VM_NO_EXCEPTIONS
 #include <stdexcept>
+#endif
 
 #include "gcoap_shared_memory_functions.h"
 #include "Opcodes.h"
 
 #include "ThreadVM.h"
 #include "PID.h"
+#include "Scheduler.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -30,19 +33,65 @@ extern "C" {
 
 	/**
 	 * @see Memory::store(uint16_t, uint8_t) from Memory.h
+	 * @param instance VM instance
 	 * @param address Address to write data to
 	 * @param value Value to write
 	 */
-	void gcoap_store(uint16_t address, uint8_t value)
+	void gcoap_store(uint8_t instance, uint16_t address, uint8_t value)
 	{
+#ifdef VM_NO_EXCEPTIONS
+		if(address >= Memory::instance(instance).getMemorySize())
+		{//checked here, the sticky error flag of the memory belongs to the VM thread
+			printf("Memory access violation at %d\n", address);
+			return;
+		}
+		Memory::instance(instance).store(address, value);
+#else
 		try
 		{
-			Memory::instance().store(address, value);
+			Memory::instance(instance).store(address, value);
 		}
 		catch(std::range_error &e)
 		{
 			printf("Memory access violation at %d\n", address);
 		}
+#endif
+	}
+
+	/**
+	 * Stores uploaded bytecode with a single range check (into the code segment in Harvard mode).
+	 * @see Memory::storeCode(uint16_t, const uint8_t*, uint16_t) from Memory.h
+	 * @param instance VM instance
+	 * @param address Address to write bytecode to
+	 * @param data Bytecode
+	 * @param len Number of bytes
+	 * @return True if the bytecode was stored, false if it does not fit
+	 */
+	bool gcoap_storeCode(uint8_t instance, uint16_t address, const uint8_t* data, uint16_t len)
+	{
+		if(!Memory::instance(instance).storeCode(address, data, len))
+		{
+			printf("Code access violation at %d\n", address);
+			return false;
+		}
+		return true;
+	}
+
+	/**
+	 * Marks uploaded bytecode as code region of the shared memory. An upload starting at address 0 replaces the code region,
+	 * other uploads extend it. Decoded instructions of the old code are invalidated.
+	 * @see Memory::setCodeSize(uint16_t) from Memory.h
+	 * @param instance VM instance
+	 * @param address Start address of the uploaded bytecode
+	 * @param len Length of the uploaded bytecode
+	 */
+	void gcoap_code_written(uint8_t instance, uint16_t address, uint16_t len)
+	{
+		uint16_t end = address + len;
+		if(address == 0 || end > Memory::instance(instance).getCodeSize())
+		{
+			Memory::instance(instance).setCodeSize(end);
+		}
 	}
 //	uint8_t gcoap_load(uint16_t address)
 //	{
@@ -88,16 +137,66 @@ extern "C" {
 //
 	/**
 	 * @see Memory::loadurl(uint16_t) from Memory.h
+	 * @param instance VM instance
 	 * @param address Address to load from
 	 * @return Pointer to URL (cstring)
 	 */
-	const unsigned char* gcoap_loadurl(uint16_t address)
+	const unsigned char* gcoap_loadurl(uint8_t instance, uint16_t address)
+	{
+		return Memory::instance(instance).loadurl(address);
+	}
+
+	/**
+	 * Loads the host of a URL-Map, string literals are read from the code, other strings from the memory.
+	 * @see Memory::loadcodestring(uint16_t) from Memory.h
+	 * @param instance VM instance of the URL-Map
+	 * @param mapping URL-Map to get host from
+	 * @return Pointer to host (cstring)
+	 */
+	const unsigned char* gcoap_loadhost(uint8_t instance, const url_map_t* mapping)
 	{
-		return Memory::instance().loadurl(address);
+		if((mapping->map_options & VM_MAP_OPTION_URL_MASK) == VM_MAP_OPTION_URL_LITERAL)
+		{
+			return Memory::instance(instance).loadcodestring(mapping->url_address);
+		}
+		return Memory::instance(instance).loadurl(mapping->url_address);
 	}
 
 	/**
-	 * Loads value from shared memory into buffer, if requested value is mapped via URL-Map
+	 * Loads the resource of a URL-Map, string literals are read from the code, other strings from the memory.
+	 * @see Memory::loadcodestring(uint16_t) from Memory.h
+	 * @param instance VM instance of the URL-Map
+	 * @param mapping URL-Map to get resource from
+	 * @return Pointer to resource (cstring)
+	 */
+	const unsigned char* gcoap_loadresource(uint8_t instance, const url_map_t* mapping)
+	{
+		if((mapping->map_options & VM_MAP_OPTION_RESOURCE_MASK) == VM_MAP_OPTION_RESOURCE_LITERAL)
+		{
+			return Memory::instance(instance).loadcodestring(mapping->resource_address);
+		}
+		return Memory::instance(instance).loadurl(mapping->resource_address);
+	}
+
+	/**
+	 * Range check of the value of a URL-Map, done before a gcoap thread accesses the value (the sticky error flag of the
+	 * memory belongs to the VM thread).
+	 * @param instance VM instance of the URL-Map
+	 * @param mapping URL-Map
+	 * @return True if the value is inside the memory
+	 */
+	static bool gcoap_value_in_range(uint8_t instance, const url_map_t* mapping)
+	{
+		if(mapping->value_address > Memory::instance(instance).getMemorySize() - Memory::valuesize(mapping->optype))
+		{
+			printf("Memory access violation at %d\n", mapping->value_address);
+			return false;
+		}
+		return true;
+	}
+
+	/**
+	 * Loads value from shared memory into buffer, if requested value is mapped via URL-Map (resource indexes of all VM instances are searched)
 	 * @param content_type Requested content format
 	 * @param payload Payload data which includes requested url. Also buffer to write into if mapping was found.
 	 * @param payload_len Length of payload data
@@ -106,13 +205,16 @@ extern "C" {
 	 */
 	uint8_t gcoap_check_server_value(uint16_t content_type, uint8_t* payload, unsigned payload_len, size_t max_len)
 	{
-		const url_map_t* mappings = Memory::instance().dumpMap();
-		for(uint8_t i = 0; i < Memory::instance().getMapSize(); i++)
+		if(payload_len > UINT16_MAX)
+		{
+			return 0;
+		}
+		for(uint8_t instance = 0; instance < VM_INSTANCES; instance++)
 		{
-			const char* url = (const char*)Memory::instance().loadurl(mappings[i].resource_address);
-			if(strlen(url) == payload_len && strncmp(url, (const char*)payload, payload_len) == 0)
+			uint16_t id = Memory::instance(instance).findResource(payload, payload_len);
+			if(id != MEMORY_NO_MAP)
 			{
-				return gcoap_load_value(content_type, payload, max_len, i);
+				return gcoap_load_value(instance, content_type, payload, max_len, id);
 			}
 		}
 		return 0;
@@ -120,101 +222,96 @@ extern "C" {
 
 	/**
 	 * Loads value from shared memory into payload buffer.
+	 * @param instance VM instance of the URL-Map
 	 * @param content_type requested data Format
 	 * @param payload Payload buffer to write into
 	 * @param max_len Max length to write
 	 * @param map_id ID of URL-Map
 	 * @return Written bytes
 	 */
-	uint8_t gcoap_load_value(uint16_t content_type, uint8_t* payload, size_t max_len, uint8_t map_id)
+	uint8_t gcoap_load_value(uint8_t instance, uint16_t content_type, uint8_t* payload, size_t max_len, uint16_t map_id)
 	{
 		switch(content_type)
 		{
 		case 42://COAP_FORMAT_OCTET
-			return gcoap_load_value_octet(payload, max_len, map_id);
+			return gcoap_load_value_octet(instance, payload, max_len, map_id);
 		case 0://COAP_FORMAT_TEXT
 		default://no known format specified (use text)
-			return gcoap_load_value_text(payload, max_len, map_id);
+			return gcoap_load_value_text(instance, payload, max_len, map_id);
 		}
 		return 0;
 	}
 
 	/**
-	 * Loads data from shared memory into buffer (in text format).
+	 * Writes the value of a URL-Map into buffer (in text format).
+	 * @param instance VM instance of the URL-Map
 	 * @param payload Payload buffer to write into
 	 * @param max_len Max length to write
-	 * @param map_id ID of URL-Map
+	 * @param mapping URL-Map (value range checked by caller)
 	 * @return Written bytes
 	 */
-	uint8_t gcoap_load_value_text(uint8_t* payload, size_t max_len, uint8_t map_id)
+	static uint8_t gcoap_write_value_text(uint8_t instance, uint8_t* payload, size_t max_len, const url_map_t* mapping)
 	{
 		uint8_t len = 0;
-		const url_map_t* mappings = Memory::instance().dumpMap();
-		switch(mappings[map_id].optype & VM_OPTYPE_MASK)
+		switch(mapping->optype & VM_OPTYPE_MASK)
 		{
 		case VM_OPERAND_TYPE_UINT8:
-			len = snprintf((char*)payload, max_len, "%" PRIu8 , Memory::instance().load(mappings[map_id].value_address));
+			len = snprintf((char*)payload, max_len, "%" PRIu8 , Memory::instance(instance).load(mapping->value_address));
 			break;
 		case VM_OPERAND_TYPE_UINT16:
-			len = snprintf((char*)payload, max_len, "%" PRIu16 , Memory::instance().loadaddress(mappings[map_id].value_address));
+			len = snprintf((char*)payload, max_len, "%" PRIu16 , Memory::instance(instance).loadaddress(mapping->value_address));
 			break;
 		case VM_OPERAND_TYPE_UINT32:
-			len = snprintf((char*)payload, max_len, "%" PRIu32 , Memory::instance().loadunsigned(mappings[map_id].value_address));
+			len = snprintf((char*)payload, max_len, "%" PRIu32 , Memory::instance(instance).loadunsigned(mapping->value_address));
 			break;
 		case VM_OPERAND_TYPE_DEC:
 		{
-			rational_t value = Memory::instance().loadrational(mappings[map_id].value_address);
+			rational_t value = Memory::instance(instance).loadrational(mapping->value_address);
 			len = snprintf((char*)payload, max_len, "%d.%04d", (int32_t)value, (int32_t)(value * 10000) % 10000);
 		}
 		break;
 		default:
 			break;
 		}
-		if((mappings[map_id].status <= 1 /* no error in mapping */) && (mappings[map_id].map_options & VM_MAP_OPTION_LIFETIME_MASK) == VM_MAP_OPTION_LIFETIME_ONCE)
-		{
-			Memory::instance().unmap(map_id);
-		}
 		return len;
 	}
 
 	/**
-	 * Loads octet value from shared memory.
+	 * Writes the value of a URL-Map into buffer (octet format).
+	 * @param instance VM instance of the URL-Map
 	 * @param payload Payload buffer to write into
-	 * @param max_len Max length to write
-	 * @param map_id ID of URL-Map
+	 * @param mapping URL-Map (value range checked by caller)
 	 * @return Written bytes
 	 */
-	uint8_t gcoap_load_value_octet(uint8_t* payload, size_t max_len, uint8_t map_id)
+	static uint8_t gcoap_write_value_octet(uint8_t instance, uint8_t* payload, const url_map_t* mapping)
 	{
-		(void) max_len;
 		uint8_t len = 0;
-		const url_map_t* mappings = Memory::instance().dumpMap();
-		switch(mappings[map_id].optype & VM_OPTYPE_MASK)
+		switch(mapping->optype & VM_OPTYPE_MASK)
 		{
 		case VM_OPERAND_TYPE_UINT8:
 		{
-			uint8_t value = Memory::instance().load(mappings[map_id].value_address);
+			uint8_t value = Memory::instance(instance).load(mapping->value_address);
 			memcpy(payload, &value, sizeof(uint8_t));
 			len = sizeof(uint8_t);
 		}
 		break;
 		case VM_OPERAND_TYPE_UINT16:
 		{
-			uint16_t value = Memory::instance().loadaddress(mappings[map_id].value_address);
+			uint16_t value = Memory::instance(instance).loadaddress(mapping->value_address);
 			memcpy(payload, &value, sizeof(uint16_t));
 			len = sizeof(uint16_t);
 		}
 		break;
 		case VM_OPERAND_TYPE_UINT32:
 		{
-			uint32_t value = Memory::instance().loadunsigned(mappings[map_id].value_address);
+			uint32_t value = Memory::instance(instance).loadunsigned(mapping->value_address);
 			memcpy(payload, &value, sizeof(uint32_t));
 			len = sizeof(uint32_t);
 		}
 		break;
 		case VM_OPERAND_TYPE_DEC:
 		{
-			rational_t value = Memory::instance().loadrational(mappings[map_id].value_address);
+			rational_t value = Memory::instance(instance).loadrational(mapping->value_address);
 			memcpy(payload, &value, sizeof(rational_t));
 			len = sizeof(rational_t);
 		}
@@ -222,41 +319,109 @@ extern "C" {
 		default:
 			break;
 		}
-		if((mappings[map_id].map_options & VM_MAP_OPTION_LIFETIME_MASK) == VM_MAP_OPTION_LIFETIME_ONCE)
+		return len;
+	}
+
+	/**
+	 * Loads data from shared memory into buffer (in text format).
+	 * @param instance VM instance of the URL-Map
+	 * @param payload Payload buffer to write into
+	 * @param max_len Max length to write
+	 * @param map_id ID of URL-Map
+	 * @return Written bytes
+	 */
+	uint8_t gcoap_load_value_text(uint8_t instance, uint8_t* payload, size_t max_len, uint16_t map_id)
+	{
+		url_map_t mapping = Memory::instance(instance).getMap(map_id);
+		if(!gcoap_value_in_range(instance, &mapping))
+		{
+			return 0;
+		}
+		uint8_t len = gcoap_write_value_text(instance, payload, max_len, &mapping);
+		if((mapping.status <= 1 /* no error in mapping */) && (mapping.map_options & VM_MAP_OPTION_LIFETIME_MASK) == VM_MAP_OPTION_LIFETIME_ONCE)
 		{
-			Memory::instance().unmap(map_id);
+			Memory::instance(instance).unmap(map_id);
 		}
 		return len;
 	}
 
+	/**
+	 * Loads octet value from shared memory.
+	 * @param instance VM instance of the URL-Map
+	 * @param payload Payload buffer to write into
+	 * @param max_len Max length to write
+	 * @param map_id ID of URL-Map
+	 * @return Written bytes
+	 */
+	uint8_t gcoap_load_value_octet(uint8_t instance, uint8_t* payload, size_t max_len, uint16_t map_id)
+	{
+		(void) max_len;
+		url_map_t mapping = Memory::instance(instance).getMap(map_id);
+		if(!gcoap_value_in_range(instance, &mapping))
+		{
+			return 0;
+		}
+		uint8_t len = gcoap_write_value_octet(instance, payload, &mapping);
+		if((mapping.map_options & VM_MAP_OPTION_LIFETIME_MASK) == VM_MAP_OPTION_LIFETIME_ONCE)
+		{
+			Memory::instance(instance).unmap(map_id);
+		}
+		return len;
+	}
+
+	/**
+	 * Loads value from shared memory into payload buffer without deleting URL-Maps with VM_MAP_OPTION_LIFETIME_ONCE
+	 * (e.g. for notifications of observers, the URL-Map is kept for the next request).
+	 * @param instance VM instance of the URL-Map
+	 * @param content_type requested data Format
+	 * @param payload Payload buffer to write into
+	 * @param max_len Max length to write
+	 * @param map_id ID of URL-Map
+	 * @return Written bytes
+	 */
+	uint8_t gcoap_peek_value(uint8_t instance, uint16_t content_type, uint8_t* payload, size_t max_len, uint16_t map_id)
+	{
+		url_map_t mapping = Memory::instance(instance).getMap(map_id);
+		if(!gcoap_value_in_range(instance, &mapping))
+		{
+			return 0;
+		}
+		if(content_type == 42)//COAP_FORMAT_OCTET
+		{
+			return gcoap_write_value_octet(instance, payload, &mapping);
+		}
+		return gcoap_write_value_text(instance, payload, max_len, &mapping);
+	}
+
 	/**
 	 * Stores text data in shared memory.
+	 * @param instance VM instance of the URL-Map
 	 * @param payload		Data to be stored. Will be a copied into CString buffer due to atoi/atof functions (stores 0 if string is not valid).
 	 * @param payload_len	Length of incoming data.
 	 * @param mapping		URL-Map which determines memory address.
 	 * @return 0 if store was successful, -1 on error
 	 */
-	int8_t gcoap_store_value_text(uint8_t* payload, unsigned payload_len, const url_map_t* mapping)
+	int8_t gcoap_store_value_text(uint8_t instance, uint8_t* payload, unsigned payload_len, const url_map_t* mapping)
 	{
-		if(payload_len >= 15)
+		if(payload_len >= 15 || !gcoap_value_in_range(instance, mapping))
 		{
 			return -1;
 		}
-		char buf[15] = {0};
-		snprintf(buf, payload_len, "%s", (char*)payload);
+		char buf[15] = {0};//payload is not zero terminated
+		memcpy(buf, payload, payload_len);
 		switch(mapping->optype & VM_OPTYPE_MASK)
 		{
 		case VM_OPERAND_TYPE_UINT8:
-			Memory::instance().store(mapping->value_address, (uint8_t)atoi((const char*)payload));
+			Memory::instance(instance).store(mapping->value_address, (uint8_t)atoi(buf));
 			break;
 		case VM_OPERAND_TYPE_UINT16:
-			Memory::instance().storeaddress(mapping->value_address, (uint16_t)atoi((const char*)payload));
+			Memory::instance(instance).storeaddress(mapping->value_address, (uint16_t)atoi(buf));
 			break;
 		case VM_OPERAND_TYPE_UINT32:
-			Memory::instance().storeunsigned(mapping->value_address, (uint32_t)atoi((const char*)payload));
+			Memory::instance(instance).storeunsigned(mapping->value_address, (uint32_t)atoi(buf));
 			break;
 		case VM_OPERAND_TYPE_DEC:
-			Memory::instance().storerational(mapping->value_address, (rational_t)atof((const char*)payload));
+			Memory::instance(instance).storerational(mapping->value_address, (rational_t)atof(buf));
 			break;
 		default:
 			break;
@@ -266,27 +431,32 @@ extern "C" {
 
 	/**
 	 * Stores octet value in shared memory
+	 * @param instance VM instance of the URL-Map
 	 * @param payload Payload data
 	 * @param payload_len Payload length
 	 * @param mapping URL-Map
 	 * @return 0 if store was successful, -1 on error
 	 */
-	int8_t gcoap_store_value_octet(uint8_t* payload, unsigned payload_len, const url_map_t* mapping)
+	int8_t gcoap_store_value_octet(uint8_t instance, uint8_t* payload, unsigned payload_len, const url_map_t* mapping)
 	{
 		(void)payload_len;
+		if(!gcoap_value_in_range(instance, mapping))
+		{
+			return -1;
+		}
 		switch(mapping->optype & VM_OPTYPE_MASK)
 		{
 		case VM_OPERAND_TYPE_UINT8:
-			Memory::instance().store(mapping->value_address, *payload);
+			Memory::instance(instance).store(mapping->value_address, *payload);
 			break;
 		case VM_OPERAND_TYPE_UINT16:
-			Memory::instance().storeaddress(mapping->value_address, *((uint16_t*)payload));
+			Memory::instance(instance).storeaddress(mapping->value_address, *((uint16_t*)payload));
 			break;
 		case VM_OPERAND_TYPE_UINT32:
-			Memory::instance().storeunsigned(mapping->value_address, *((uint32_t*)payload));
+			Memory::instance(instance).storeunsigned(mapping->value_address, *((uint32_t*)payload));
 			break;
 		case VM_OPERAND_TYPE_DEC:
-			Memory::instance().storerational(mapping->value_address, *((rational_t*)payload));
+			Memory::instance(instance).storerational(mapping->value_address, *((rational_t*)payload));
 			break;
 		default:
 			break;
@@ -296,59 +466,106 @@ extern "C" {
 
 	/**
 	 * Stores Value in shared memory
+	 * @param instance VM instance of the URL-Map
 	 * @param content_type Content Format of payload data
 	 * @param map_id ID of URL-Map
 	 * @param payload Payload data
 	 * @param payload_len Payload length
 	 * @return 0 if store was successful, -1 on error
 	 */
-	int8_t gcoap_store_value(uint16_t content_type, uint8_t map_id, uint8_t* payload, unsigned payload_len)
+	int8_t gcoap_store_value(uint8_t instance, uint16_t content_type, uint16_t map_id, uint8_t* payload, unsigned payload_len)
 	{
 		int8_t return_val = 0;
-		const url_map_t* mappings = Memory::instance().dumpMap();
+		url_map_t mapping = Memory::instance(instance).getMap(map_id);
 		switch(content_type)
 		{
 		case 42: //octet
-			return_val = gcoap_store_value_octet(payload, payload_len, &mappings[map_id]);
+			return_val = gcoap_store_value_octet(instance, payload, payload_len, &mapping);
 			break;
 		case 0: //format text
 		default: //unknown assume text
-			return_val = gcoap_store_value_text(payload, payload_len, &mappings[map_id]);
+			return_val = gcoap_store_value_text(instance, payload, payload_len, &mapping);
 		}
 
-		if((mappings[map_id].map_options & VM_MAP_OPTION_LIFETIME_MASK) == VM_MAP_OPTION_LIFETIME_ONCE)
+		if((mapping.map_options & VM_MAP_OPTION_LIFETIME_MASK) == VM_MAP_OPTION_LIFETIME_ONCE)
 		{
-			Memory::instance().unmap(map_id);
+			Memory::instance(instance).unmap(map_id);
 		}
 		return return_val;
 	}
 
 	/**
-	 * @see Memory::dumpMap() from Memory.h
-	 * @return Pointer to URL-Maps
+	 * @see Memory::getMap(uint16_t) from Memory.h
+	 * @param instance VM instance
+	 * @param id ID of URL-Map
+	 * @return Copy of the URL-Map (status VM_MAP_STATUS_NO_MAPPING if it is unused)
+	 */
+	url_map_t gcoap_get_mapping(uint8_t instance, uint16_t id)
+	{
+		return Memory::instance(instance).getMap(id);
+	}
+
+	/**
+	 * @see Memory::nextMap(uint16_t) from Memory.h
+	 * @param instance VM instance
+	 * @param id First ID to check
+	 * @return ID of the next used URL-Map (id or higher), MEMORY_NO_MAP if there is none
+	 */
+	uint16_t gcoap_next_mapping(uint8_t instance, uint16_t id)
+	{
+		return Memory::instance(instance).nextMap(id);
+	}
+
+	/**
+	 * @see Memory::nextMap(uint16_t, uint8_t, uint8_t) from Memory.h
+	 * @param instance VM instance
+	 * @param id First ID to check
+	 * @return ID of the next used client URL-Map (id or higher), MEMORY_NO_MAP if there is none
+	 */
+	uint16_t gcoap_next_client_mapping(uint8_t instance, uint16_t id)
+	{
+		return Memory::instance(instance).nextMap(id, VM_MAP_OPTION_DIRECTION_MASK, VM_MAP_OPTION_DIRECTION_CLIENT);
+	}
+
+	/**
+	 * @see Memory::nextMap(uint16_t, uint8_t, uint8_t) from Memory.h
+	 * @param instance VM instance
+	 * @param id First ID to check
+	 * @return ID of the next used server URL-Map (id or higher), MEMORY_NO_MAP if there is none
+	 */
+	uint16_t gcoap_next_server_mapping(uint8_t instance, uint16_t id)
+	{
+		return Memory::instance(instance).nextMap(id, VM_MAP_OPTION_DIRECTION_MASK, VM_MAP_OPTION_DIRECTION_SERVER);
+	}
+
+	/**
+	 * @see Memory::getMapCount() from Memory.h
+	 * @param instance VM instance
+	 * @return Number of used URL-Maps
 	 */
-	const url_map_t* gcoap_get_mappings()
+	uint16_t gcoap_get_map_count(uint8_t instance)
 	{
-		return Memory::instance().dumpMap();
+		return Memory::instance(instance).getMapCount();
 	}
 
 	/**
 	 * @see Memory::getMapSize() from Memory.h
-	 * @return Number of URL-Maps
+	 * @return Number of URL-Map IDs
 	 */
-	uint8_t gcoap_get_map_size()
+	uint16_t gcoap_get_map_size()
 	{
 		return Memory::instance().getMapSize();
 	}
 
 	/**
-	 * Writes host string defined by URL-Map from shared memory into buffer.
+	 * Writes resource string defined by URL-Map from shared memory into buffer.
+	 * @param instance VM instance of the URL-Map.
 	 * @param mapping URL-Map to get resource from.
 	 * @param buf Buffer to write resource string into.
 	 */
-	void gcoap_get_resource(const url_map_t* mapping, char* buf)
+	void gcoap_get_resource(uint8_t instance, const url_map_t* mapping, char* buf)
 	{
-		const char* resource = (const char*)gcoap_loadurl(mapping->resource_address);
+		const char* resource = (const char*)gcoap_loadresource(instance, mapping);
 		size_t str_len = strlen(resource);
 		memcpy(buf, resource, str_len);
 		buf[str_len] = 0;
@@ -357,12 +574,13 @@ extern "C" {
 
 	/**
 	 * Writes host string defined by URL-Map from shared memory into buffer.
+	 * @param instance VM instance of the URL-Map.
 	 * @param mapping URL-Map to get host from.
 	 * @param buf Buffer to write host string into.
 	 */
-	void gcoap_get_host(const url_map_t* mapping, char* buf)
+	void gcoap_get_host(uint8_t instance, const url_map_t* mapping, char* buf)
 	{
-		const char* url = (const char*)gcoap_loadurl(mapping->url_address);
+		const char* url = (const char*)gcoap_loadhost(instance, mapping);
 		size_t str_len = strlen(url);//gcoap_parse_resource_offset(url);
 		memcpy(buf, url, str_len);
 		buf[str_len] = 0;
@@ -370,22 +588,65 @@ extern "C" {
 	}
 
 	/**
-	 * @see Memory::map_done(uint8_t) in Memory.h
+	 * @see Memory::map_done(uint16_t) in Memory.h
+	 * Wakes the VM thread (Scheduler::notify()).
+	 * @param instance VM instance
 	 * @param id ID of URL-map
 	 */
-	void gcoap_done(uint8_t id)
+	void gcoap_done(uint8_t instance, uint16_t id)
 	{
-		Memory::instance().map_done(id);
+		if(id >= Memory::instance(instance).getMapSize())
+		{//checked here, the sticky error flag of the memory belongs to the VM thread
+			return;
+		}
+		Memory::instance(instance).map_done(id);
+		Scheduler::notify();//wakes the VM thread if the instance waits for the mapping (URLMAPWAIT)
 	}
 
 	/**
-	 * @see Memory::map_error(uint8_t, uint8_t) in Memory.h
+	 * @see Memory::map_error(uint16_t, uint8_t) in Memory.h
+	 * Wakes the VM thread (Scheduler::notify()).
+	 * @param instance VM instance
 	 * @param id ID of URL-Map
 	 * @param errorcode Error code of URL-Map
 	 */
-	void gcoap_error(uint8_t id, uint8_t errorcode)
+	void gcoap_error(uint8_t instance, uint16_t id, uint8_t errorcode)
+	{
+		if(id >= Memory::instance(instance).getMapSize())
+		{
+			return;
+		}
+		Memory::instance(instance).map_error(id, errorcode);
+		Scheduler::notify();//wakes the VM thread if the instance waits for the mapping (URLMAPWAIT)
+	}
+
+	/**
+	 * @see Memory::mapChanged(uint16_t) in Memory.h
+	 * @param instance VM instance
+	 * @param id ID of URL-Map
+	 * @return True if the value of the URL-Map has to be pushed
+	 */
+	bool gcoap_take_change(uint8_t instance, uint16_t id)
+	{
+		if(id >= Memory::instance(instance).getMapSize())
+		{
+			return false;
+		}
+		return Memory::instance(instance).mapChanged(id);
+	}
+
+	/**
+	 * @see Memory::map_resend(uint16_t) in Memory.h
+	 * @param instance VM instance
+	 * @param id ID of URL-Map
+	 */
+	void gcoap_resend(uint8_t instance, uint16_t id)
 	{
-		Memory::instance().map_error(id, errorcode);
+		if(id >= Memory::instance(instance).getMapSize())
+		{
+			return;
+		}
+		Memory::instance(instance).map_resend(id);
 	}
 
 	/**
@@ -418,33 +679,84 @@ extern "C" {
 
 	/**
 	 * @see Memory::dump() in Memory.h
+	 * @param instance VM instance
 	 * @return Pointer to memory dump.
 	 */
-	const uint8_t* gcoap_dumpMemory(void)
+	const uint8_t* gcoap_dumpMemory(uint8_t instance)
+	{
+		return Memory::instance(instance).dump();
+	}
+
+	/**
+	 * Copies a consistent snapshot of a memory region into buffer while the VM keeps running.
+	 * @see Memory::snapshot(uint16_t, uint8_t*, uint16_t) in Memory.h
+	 * @param instance VM instance
+	 * @param address Start address of the region
+	 * @param buf Buffer to write the region into
+	 * @param len Length of the region
+	 * @return True if buf holds a consistent copy
+	 */
+	bool gcoap_snapshotMemory(uint8_t instance, uint16_t address, uint8_t* buf, uint16_t len)
 	{
-		return Memory::instance().dump();
+		return Memory::instance(instance).snapshot(address, buf, len);
+	}
+
+	/**
+	 * Copies a code region into buffer.
+	 * @see Memory::snapshotCode(uint16_t, uint8_t*, uint16_t) in Memory.h
+	 * @param instance VM instance
+	 * @param address Start address of the region
+	 * @param buf Buffer to write the region into
+	 * @param len Length of the region
+	 * @return True if buf holds the code
+	 */
+	bool gcoap_snapshotCode(uint8_t instance, uint16_t address, uint8_t* buf, uint16_t len)
+	{
+		return Memory::instance(instance).snapshotCode(address, buf, len);
+	}
+
+	/**
+	 * @see Memory::getCodeSegmentSize() in Memory.h
+	 * @param instance VM instance
+	 * @return Readable size of the code
+	 */
+	uint16_t gcoap_codeSize(uint8_t instance)
+	{
+		return Memory::instance(instance).getCodeSegmentSize();
+	}
+
+	/**
+	 * @see Memory::getCodeCapacity() in Memory.h
+	 * @param instance VM instance
+	 * @return Maximum size of uploaded bytecode
+	 */
+	uint16_t gcoap_codeCapacity(uint8_t instance)
+	{
+		return Memory::instance(instance).getCodeCapacity();
 	}
 
 	/**
 	 * @see Memory::getMemorySize() in Memory.h
+	 * @param instance VM instance
 	 * @return Size of shared memory
 	 */
-	uint16_t gcoap_dumpSize(void)
+	uint16_t gcoap_dumpSize(uint8_t instance)
 	{
-		return Memory::instance().getMemorySize();
+		return Memory::instance(instance).getMemorySize();
 	}
 
 	/**
 	 * Writes Status Bytes of VM instance into buffer. Needs Process ID of VM thread to get status flags.
+	 * @param instance VM instance
 	 * @param buf Buffer to write status information
 	 * @param buf_len Length of buffer
 	 * @param vm_thread_pid Process ID of VM thread
 	 * @return Bytes written
 	 */
-	size_t gcoap_statusVM(uint8_t* buf, size_t buf_len, kernel_pid_t vm_thread_pid)
+	size_t gcoap_statusVM(uint8_t instance, uint8_t* buf, size_t buf_len, kernel_pid_t vm_thread_pid)
 	{
 		msg_t m;
-		m.content.value = VM_THREAD_STATUS;
+		m.content.value = VM_THREAD_MESSAGE(VM_THREAD_STATUS, instance, 0);
 		msg_try_send(&m, vm_thread_pid);
 		int received = 0;
 		size_t payload_len = 0;
@@ -466,6 +778,59 @@ extern "C" {
 		return payload_len;
 	}
 
+	/**
+	 * Writes the result of an optimization into buffer: code size before and after the optimization (the current size of
+	 * the program) and the estimated cycles saved (uint16_t each).
+	 * @param instance VM instance
+	 * @param before Code size before the optimization
+	 * @param cycles Estimated cycles saved
+	 * @param buf Buffer to write the result
+	 * @param buf_len Length of buffer
+	 * @return Bytes written, 0 if the buffer is too small
+	 */
+	size_t gcoap_optimized(uint8_t instance, uint16_t before, uint16_t cycles, uint8_t* buf, size_t buf_len)
+	{
+		uint16_t result[3];
+		if(sizeof(result) > buf_len)
+		{
+			return 0;
+		}
+		result[0] = before;
+		result[1] = Memory::instance(instance).getCodeSize();
+		result[2] = cycles;
+		memcpy(buf, result, sizeof(result));
+		return sizeof(result);
+	}
+
+	/**
+	 * Optimizes the program of a stopped VM instance and writes the result into buffer (see gcoap_optimized()).
+	 * @param instance VM instance
+	 * @param buf Buffer to write the result
+	 * @param buf_len Length of buffer
+	 * @param vm_thread_pid Process ID of VM thread
+	 * @return Bytes written, 0 if the VM thread did not answer
+	 */
+	size_t gcoap_optimizeVM(uint8_t instance, uint8_t* buf, size_t buf_len, kernel_pid_t vm_thread_pid)
+	{
+		msg_t m;
+		uint16_t before = Memory::instance(instance).getCodeSize();
+		m.content.value = VM_THREAD_MESSAGE(VM_THREAD_OPTIMIZE, instance, 0);
+		msg_try_send(&m, vm_thread_pid);
+		int received = 0;
+		size_t payload_len = 0;
+		for(uint8_t i = 0; i < 3; i++)
+		{
+			received = msg_try_receive(&m);
+			if(received == 1)
+			{
+				payload_len = gcoap_optimized(instance, before, VM_THREAD_OPTIMIZED_CYCLES(m.content.value), buf, buf_len);
+				break;
+			}
+			xtimer_usleep(5000);
+		}
+		return payload_len;
+	}
+
 	/**
 	 * Writes Status Bytes of Memory instance into buffer (not implemented).
 	 * @param buf Buffer to write status information
@@ -480,42 +845,47 @@ extern "C" {
 	}
 
 	/**
-	 * Writes Status Bytes of URL-Mappings into buffer.
+	 * Writes Status Bytes of the used URL-Mappings into buffer: number of used URL-Maps (uint16_t), then ID (uint16_t)
+	 * and status (uint8_t) of every used URL-Map.
+	 * @param instance VM instance
 	 * @param buf Buffer to write status information
 	 * @param buf_len Length of buffer
 	 * @return Bytes written
 	 */
-	size_t gcoap_statusMappings(uint8_t* buf, size_t buf_len)
+	size_t gcoap_statusMappings(uint8_t instance, uint8_t* buf, size_t buf_len)
 	{
-		const url_map_t* mappings = gcoap_get_mappings();
-		uint8_t mapsize = gcoap_get_map_size();
-		size_t written = sizeof(uint8_t);
+		Memory& memory = Memory::instance(instance);
+		uint16_t count = memory.getMapCount();
+		size_t written = sizeof(uint16_t);
 		if(written > buf_len)
 		{
 			return 0;
 		}
-		memcpy(buf, &mapsize, sizeof(uint8_t));
-		for(uint8_t i = 0; i < mapsize; i++)
+		memcpy(buf, &count, sizeof(uint16_t));
+		for(uint16_t id = memory.nextMap(0); id != MEMORY_NO_MAP; id = memory.nextMap(id + 1))
 		{
-			if(written + sizeof(uint8_t) > buf_len)
+			if(written + sizeof(uint16_t) + sizeof(uint8_t) > buf_len)
 			{
 				return written;
 			}
-			memcpy(buf+written, &mappings[i].status, sizeof(uint8_t));
-			written += sizeof(uint8_t);
+			uint8_t status = memory.getMap(id).status;
+			memcpy(buf + written, &id, sizeof(uint16_t));
+			memcpy(buf + written + sizeof(uint16_t), &status, sizeof(uint8_t));
+			written += sizeof(uint16_t) + sizeof(uint8_t);
 		}
 		return written;
 	}
 
 	/**
-	 * Writes Status Bytes of PID instances into buffer.
+	 * Writes Status Bytes of the PID instances of a VM instance into buffer.
+	 * @param instance VM instance
 	 * @param buf Buffer to write status information
 	 * @param buf_len Length of buffer
 	 * @return Bytes written
 	 */
-	size_t gcoap_statusPID(uint8_t* buf, size_t buf_len)
+	size_t gcoap_statusPID(uint8_t instance, uint8_t* buf, size_t buf_len)
 	{
-		PID* pids = PID::instances();
+		PID* pids = PID::instances(instance);
 		uint8_t pid_num = VM_PID_NUM_AVAILABLE;
 		size_t written = sizeof(uint8_t);
 		if(written > buf_len)
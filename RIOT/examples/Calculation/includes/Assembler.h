@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Assembler of the calculation VM (host side, see VM_TOOLCHAIN). Translates the textual assembly language
+ * 				into bytecode (Opcodes.h). One instruction per line:
+ *
+ * 				[label:] MNEMONIC[.type] [operand {, operand}] [; comment]
+ *
+ * 				type:		u8, u16, u32 (default) or dec
+ * 				operands:	#value literal, @address or @name[+offset] address, rN register, "string", plain numbers
+ * 							(IDs, ports, lengths, code addresses), labels and map options joined by '|'
+ * 							(client, server, get, post, put, once, ever)
+ * 				directives:	.equ name value (constant), .var name type [@address] (variable, placed behind the code
+ * 							or at address 0 in Harvard mode if no address is given)
+ *
+ * 				Operand order follows the bytecode, e.g. COMPARE.u8 @x, #10, less, equal, greater or
+ * 				URLMAP.dec 0, client|get|ever, @value, 0, "affe::1", "/sensor". Superinstructions are produced by the
+ * 				Optimizer only. The programmatic interface (symbol(), label(), variable(), instruction(), finish()) is
+ * 				used by the Compiler.
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+#ifndef INCLUDES_ASSEMBLER_H_
+#define INCLUDES_ASSEMBLER_H_
+
+#include <stdint.h>
+
+#include "calculationconfig.h"
+#include "Opcodes.h"
+#include "URL_Mapping.h"
+
+///Maximum number of symbols (labels, variables, constants) of a program
+#define ASSEMBLER_SYMBOLS			(256)
+///Maximum length of a symbol name
+#define ASSEMBLER_SYMBOL_LENGTH		(23)
+///Maximum number of symbol references of a program (resolved by finish())
+#define ASSEMBLER_FIXUPS			(512)
+///Maximum number of operands of an instruction (MULTILOAD)
+#define ASSEMBLER_OPERANDS			(64)
+///Maximum length of an error message
+#define ASSEMBLER_ERROR_LENGTH		(64)
+///No symbol
+#define ASSEMBLER_NO_SYMBOL			(0xffff)
+
+///Operand: plain number (ID, port, length, map options, code address)
+#define ASSEMBLER_OPERAND_NUMBER	(0)
+///Operand: literal (#)
+#define ASSEMBLER_OPERAND_LITERAL	(1)
+///Operand: address (@)
+#define ASSEMBLER_OPERAND_ADDRESS	(2)
+///Operand: register (rN)
+#define ASSEMBLER_OPERAND_REGISTER	(3)
+///Operand: label (code address)
+#define ASSEMBLER_OPERAND_LABEL		(4)
+///Operand: string
+#define ASSEMBLER_OPERAND_STRING	(5)
+
+///Symbol: code address
+#define ASSEMBLER_SYMBOL_LABEL		(0)
+///Symbol: memory address of a variable
+#define ASSEMBLER_SYMBOL_VARIABLE	(1)
+///Symbol: constant
+#define ASSEMBLER_SYMBOL_CONSTANT	(2)
+
+/**
+ * Operand of an instruction.
+ */
+typedef struct {
+	///Kind of the operand (ASSEMBLER_OPERAND_*)
+	uint8_t kind;
+	///Symbol whose value is added to the value (labels, variables), ASSEMBLER_NO_SYMBOL for plain values
+	uint16_t symbol;
+	///Number, literal, address (offset to the symbol) or register number
+	double value;
+	///Characters of a string (not terminated)
+	const char* string;
+	///Length of the string
+	uint8_t length;
+} asm_operand_t;
+
+/**
+ * Label, variable or constant.
+ */
+typedef struct {
+	char name[ASSEMBLER_SYMBOL_LENGTH + 1];
+	///Kind of the symbol (ASSEMBLER_SYMBOL_*)
+	uint8_t kind;
+	///Value is known (labels after binding, variables after finish())
+	bool defined;
+	///Variable has a fixed address
+	bool fixed;
+	///Size of a variable in Bytes
+	uint8_t size;
+	///Code address, memory address or constant
+	double value;
+} asm_symbol_t;
+
+/**
+ * 16Bit field which is set to the value of a symbol by finish().
+ */
+typedef struct {
+	///Code address of the field
+	uint16_t position;
+	uint16_t symbol;
+	uint16_t offset;
+	///Source line of the reference
+	uint16_t line;
+} asm_fixup_t;
+
+class Assembler
+{
+public:
+	Assembler(uint8_t* code, uint16_t size);
+	~Assembler(void) { }
+
+	uint16_t assemble(const char* source);
+
+	uint16_t symbol(const char* name, uint8_t length);
+	bool label(uint16_t symbol);
+	bool variable(uint16_t symbol, uint8_t type, bool fixed, uint16_t address);
+	bool constant(uint16_t symbol, double value);
+	bool instruction(uint8_t opcode, uint8_t type, const asm_operand_t* operands, uint8_t count);
+	uint16_t finish(void);
+	bool fail(const char* message, const char* name = 0, uint8_t length = 0);
+
+	/**
+	 * @return Address behind the last emitted instruction.
+	 */
+	uint16_t getPosition(void) const {return position;}
+	/**
+	 * @return End of the variables placed by finish().
+	 */
+	uint16_t getDataEnd(void) const {return dataend;}
+	/**
+	 * @return First error, empty if the program was assembled.
+	 */
+	const char* getError(void) const {return error;}
+	/**
+	 * @return Source line of the first error.
+	 */
+	uint16_t getLine(void) const {return errorline;}
+	/**
+	 * @param line Source line reported with errors and stored with symbol references.
+	 */
+	void setLine(uint16_t line) {this->line = line;}
+	uint16_t getAddress(const char* name);
+
+	static uint8_t typesize(uint8_t type);
+	static const char* mnemonic(uint8_t opcode);
+
+private:
+	uint8_t* code;
+	uint16_t size;
+	uint16_t position;
+	uint16_t dataend;
+	asm_symbol_t symbols[ASSEMBLER_SYMBOLS];
+	uint16_t symbolcount;
+	asm_fixup_t fixups[ASSEMBLER_FIXUPS];
+	uint16_t fixupcount;
+	uint16_t line;
+	uint16_t errorline;
+	char error[ASSEMBLER_ERROR_LENGTH];
+	///Parser position in the current line and end of the line
+	const char* cursor;
+	const char* lineend;
+
+	bool parseline(void);
+	bool parsedirective(const char* name, uint8_t length);
+	bool parseoperand(asm_operand_t* operand);
+	bool parsevalue(asm_operand_t* operand, bool literal);
+	bool parsenumber(double* value);
+	uint8_t identifier(const char** name);
+	void skipspace(void);
+	bool lineended(void);
+
+	bool emit(uint8_t value);
+	bool emitaddress(const asm_operand_t& operand);
+	bool emittarget(const asm_operand_t& operand);
+	bool emitliteral(const asm_operand_t& operand, uint8_t type);
+	bool emitregister(const asm_operand_t& operand);
+	bool emitdestination(const asm_operand_t& operand);
+	bool emitsource(const asm_operand_t& operand, uint8_t type);
+	bool emitid(const asm_operand_t& operand, uint8_t type, uint16_t ids, uint16_t narrow);
+	bool emitstring(const asm_operand_t& operand);
+	bool placevariables(void);
+
+	Assembler(const Assembler&);
+	Assembler& operator=(const Assembler&);
+};
+
+#endif /* INCLUDES_ASSEMBLER_H_ */
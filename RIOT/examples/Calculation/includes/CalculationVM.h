@@ -20,14 +20,24 @@ extern "C" {
 
 #include "Opcodes.h"
 #include "Stack.h"
+#include "OperandStack.h"
 #include "PID.h"
+#include "InstructionCache.h"
+#include "Operations.h"
+#include "ProgramImage.h"
+#include "Translation.h"
+#ifndef VM_NO_EXCEPTIONS
 #include <stdexcept>
+#endif
+#include <type_traits>
 
 
 //Referenz https://github.com/DoubangoTelecom/libsigcomp/tree/master/libsigcomp/src
 
 class VM
 {
+	friend class Optimizer;
+	friend class Translator;
 public:
 
 	///Debug mode, on
@@ -41,9 +51,20 @@ public:
 	#define VM_FLAG_ERROR					0x02
 	///VM flag divide by zero error
 	#define VM_FLAG_DIVIDEZERO				0x04
+	///VM flag waiting for an event (SLEEPUNTIL, URLMAPWAIT, PIDWAIT), run() executes nothing until the event occurred
+	#define VM_FLAG_WAITING					0x08
+
+	///Wait event, time passed (SLEEPUNTIL)
+	#define VM_WAIT_TIME					0x01
+	///Wait event, URL-Map handled (URLMAPWAIT)
+	#define VM_WAIT_MAP						0x02
+	///Wait event, PID computed (PIDWAIT)
+	#define VM_WAIT_PID						0x03
 
 	///VM error code mask
 	#define VM_ERROR_MASK					0xff
+	///Opcode of the last fetched instruction in the statuscode
+	#define VM_STATUS_OPCODE(statuscode)	((uint8_t) ((statuscode) >> 8))
 	///VM error code suicide occurred
 	#define VM_ERROR_RESET					0x01
 	///VM error code divide by zero
@@ -58,14 +79,26 @@ public:
 	#define VM_ERROR_ID_UNAVAILABLE			0x06
 	///VM error code PID initialized (can not initialize again, clear before reinitialize)
 	#define VM_ERROR_PID_INIT				0x07
+	///VM error code stack overflow or underflow (CALL with full stack, RETURN with empty stack)
+	#define VM_ERROR_STACK					0x08
+	///VM error code URL-Map pool exhausted (no free block of mappings for the ID)
+	#define VM_ERROR_MAP_POOL				0x09
 
 
 	VM(Memory* memory, PID* pids);
 	~VM(void) { };
 
 
-	void setProgram(uint8_t* _program, uint16_t _size);
+	bool setProgram(uint8_t* _program, uint16_t _size);
+	void setProgramImage(const uint8_t* image, uint16_t size);
+	/**
+	 * Executes a program image without copying it into the memory.
+	 * @param image Program image, must stay valid while the VM executes it.
+	 */
+	void setProgramImage(const ProgramImage& image) {setProgramImage(image.getCode(), image.getSize());}
 	void executeStep(void);
+	uint32_t run(uint32_t max_steps, uint32_t max_us);
+	static const char* getDispatchEngine(void);
 
 	uint16_t getProgramcounter(void);
 
@@ -73,18 +106,33 @@ public:
 
 	Memory* getMemory(void);
 	Stack* getStack(void);
+	OperandStack* getOperandStack(void);
+	uint32_t getRegister(uint8_t index);
+	void setRegister(uint8_t index, uint32_t value);
 
 	void setDebugMode(uint8_t mode);
 	bool halted(void);
 	bool errorFlag(void);
+	bool verified(void);
+	bool waiting(void);
+	bool wakeable(void);
+	bool getWakeupTime(uint32_t* remaining);
 	uint32_t getStatuscode(void);
 
 	void clear();
+	bool verify(void);
+	static bool verifiedUnshared(uint16_t address, uint16_t size);
+	bool translated(void);
+	void setTranslation(bool enabled);
 
 private:
 	Memory* memory;
 	PID* pids;
 	Stack stack;
+	///Operand stack of PUSH, POP and the stack arithmetic instructions
+	OperandStack operands;
+	///Register file, raw bits of the values (the type is given by the OPTYPE like for memory operands)
+	uint32_t registers[VM_REGISTERS];
 
 	///8Bit flags
 	uint8_t flags;
@@ -95,44 +143,169 @@ private:
 	uint32_t statuscode;
 	bool execution_error;
 
-	//instruction
-	bool handleADD(void);
-	bool handleSUB(void);
-	bool handleMUL(void);
-	bool handleDIV(void);
-	bool handleMOD(void);
-	bool handleAND(void);
-	bool handleOR(void);
-	bool handleNOT(void);
-	bool handleXOR(void);
-	bool handleLSHIFT(void);
-	bool handleRSHIFT(void);
-	bool handleLOAD(void);
-	bool handleMULTILOAD(void);
-	bool handlePUSH(void);
-	bool handlePOP(void);
-	bool handleCOPY(void);
-	bool handleJUMP(void);
-	bool handleCOMPARE(void);
-	bool handleCALL(void);
-	bool handleRETURN(void);
-	bool handleTIME(void);
-	bool handleCOMPARETIME(void);
-	bool handleURLMAP(void);
-	bool handleURLMAPCHECK(void);
-	bool handleURLMAPDELETE(void);
-	bool handlePIDINIT(void);
-	bool handlePIDCLEAR(void);
-	bool handlePIDSTOP(void);
-	bool handlePIDRUN(void);
-	bool handleHALT(void);
-	bool handleRESET(void);
+	///Program passed verify(), kernels use unchecked memory access while the code version is unchanged
+	bool codeverified;
+	///Code version of the verified program
+	uint32_t verifiedversion;
+
+	///Event the VM waits for (VM_WAIT_*), valid while VM_FLAG_WAITING is set
+	uint8_t waitevent;
+	///URL-Map or PID id of the event
+	uint16_t waitid;
+	///Start time in µs (VM_WAIT_TIME) or PID computations when the wait started (VM_WAIT_PID)
+	uint32_t waitvalue;
+	///Time to wait after the start time in µs (VM_WAIT_TIME)
+	uint32_t waittimeout;
+
+#ifdef VM_TRANSLATIONS
+	///Translation of the verified program, NULL if the program is interpreted
+	const vm_translation_t* translation;
+	///Translation found for the verified program, selected by clear() if translations are enabled
+	const vm_translation_t* verifiedtranslation;
+	///Code version the translation was selected for
+	uint32_t translationversion;
+	///Translations are used (setTranslation())
+	bool translationenabled;
+	uint32_t runTranslation(uint32_t max_steps, uint32_t max_us, uint32_t start);
+	const vm_translation_t* findTranslation(void);
+#endif
+
+	///Instruction decoded in the current step (if not taken from the cache)
+	vm_instruction_t current;
+#ifdef VM_DECODE_CACHE
+	InstructionCache cache;
+#endif
+
+	//instruction, all handlers are inline and expanded into the dispatch engine
+	inline bool handleKERNEL(const vm_instruction_t& in);
+	inline bool handleMULTILOAD(const vm_instruction_t& in);
+	inline bool handlePUSH(const vm_instruction_t& in);
+	inline bool handlePOP(const vm_instruction_t& in);
+	inline bool handleCOPY(const vm_instruction_t& in);
+	inline bool handleJUMP(const vm_instruction_t& in);
+	inline bool handleCOMPARE(const vm_instruction_t& in);
+	inline bool handleCALL(const vm_instruction_t& in);
+	inline bool handleRETURN(const vm_instruction_t& in);
+	inline bool handleTIME(const vm_instruction_t& in);
+	inline bool handleCOMPARETIME(const vm_instruction_t& in);
+	inline bool handleTIMECOMPARE(const vm_instruction_t& in);
+	inline bool handleSLEEPUNTIL(const vm_instruction_t& in);
+	inline bool handleURLMAP(const vm_instruction_t& in);
+	inline bool handleURLMAPCHECK(const vm_instruction_t& in);
+	inline bool handleURLMAPDELETE(const vm_instruction_t& in);
+	inline bool handleURLMAPWAIT(const vm_instruction_t& in);
+	inline bool handleURLMAPCOMPARE(const vm_instruction_t& in);
+	inline bool handlePIDINIT(const vm_instruction_t& in);
+	inline bool handlePIDCLEAR(const vm_instruction_t& in);
+	inline bool handlePIDSTOP(const vm_instruction_t& in);
+	inline bool handlePIDRUN(const vm_instruction_t& in);
+	inline bool handlePIDWAIT(const vm_instruction_t& in);
+	inline bool handleHALT(const vm_instruction_t& in);
+	inline bool handleRESET(const vm_instruction_t& in);
+	inline bool handleUNSUPPORTED(const vm_instruction_t& in);
+
+	///Number of kernel operations (ADD, SUB, MUL, DIV, MOD, AND, OR, NOT, XOR, LSHIFT, RSHIFT, LOAD, COMPARE, ADDCOMPARE)
+	#define VM_KERNEL_OPS		14
+	///Kernel index of COMPARE
+	#define VM_KERNEL_COMPARE	12
+	///Kernel index of the superinstruction ADDCOMPARE
+	#define VM_KERNEL_ADDCOMPARE	13
+	///Kernels with range checked memory access
+	#define VM_ACCESS_CHECKED	0
+	///Kernels without range checks (verified programs)
+	#define VM_ACCESS_UNCHECKED	1
+	///Kernels indexed by operation, operand type index, literal/address mode and memory access
+	static vm_kernel_t kernels[VM_KERNEL_OPS][VM_OPERAND_TYPES][2][2];
+	///Loaders for literal operands indexed by operand type index
+	static uint32_t (*literals[VM_OPERAND_TYPES])(Memory* memory, uint16_t address);
+	static void initKernels(void);
+	static inline int8_t kernelindex(uint8_t opcode);
+	template<typename T> static void registerType(void);
+	template<class Op, typename T> static void registerKernel(uint8_t op);
+	template<class Op, typename T> static void registerKernel(uint8_t op, std::true_type supported);
+	template<class Op, typename T> static void registerKernel(uint8_t op, std::false_type supported);
+	template<typename T, class Op, bool literal, class Access> static bool kernel(VM* vm, const vm_instruction_t& in);
+	template<typename T, bool literal, class Access> static bool compare(VM* vm, const vm_instruction_t& in);
+	template<typename T, bool literal, class Access> static bool addcompare(VM* vm, const vm_instruction_t& in);
+
+	///Number of register modes: register destination with memory, literal or register operand, memory destination with register operand
+	#define VM_REGISTER_MODES	4
+	///Kernels with register operands indexed by operation, operand type index and register mode (memory access is range checked)
+	static vm_kernel_t regkernels[VM_KERNEL_OPS][VM_OPERAND_TYPES][VM_REGISTER_MODES];
+	static inline int8_t registermode(uint8_t optype);
+	struct RegisterDestination;
+	struct MemoryDestination;
+	struct RegisterSource;
+	struct MemorySource;
+	struct LiteralSource;
+	template<typename T, class Op, class Dst, class Src> static bool regkernel(VM* vm, const vm_instruction_t& in);
+	template<typename T, class Dst, class Src> static bool regcompare(VM* vm, const vm_instruction_t& in);
+
+	///Number of operand stack kernel operations (SADD, SSUB, SMUL, SDIV, SCOMPARE, PUSH with address, PUSH with literal, POP)
+	#define VM_STACK_KERNEL_OPS			8
+	///Stack kernel index of SCOMPARE
+	#define VM_STACK_KERNEL_COMPARE		4
+	///Stack kernel index of PUSH (PUSH with literal is the following index)
+	#define VM_STACK_KERNEL_PUSH		5
+	///Stack kernel index of POP
+	#define VM_STACK_KERNEL_POP			7
+	///Operand stack kernels indexed by operation and operand type index
+	static vm_kernel_t stackkernels[VM_STACK_KERNEL_OPS][VM_OPERAND_TYPES];
+	static inline int8_t stackkernelindex(uint8_t opcode, uint8_t optype);
+	inline void selectStackKernel(vm_instruction_t* in);
+	template<typename T, class Op> static bool stackkernel(VM* vm, const vm_instruction_t& in);
+	template<typename T> static bool stackcompare(VM* vm, const vm_instruction_t& in);
+	template<typename T, bool literal> static bool stackpush(VM* vm, const vm_instruction_t& in);
+	template<typename T> static bool stackpop(VM* vm, const vm_instruction_t& in);
+
+#if VM_DISPATCH == VM_DISPATCH_TABLE
+	///Programcounter is set by the handler
+	#define VM_ADVANCE_NONE		0
+	///Programcounter is set to the following instruction after the handler
+	#define VM_ADVANCE_NEXT		1
+	///Programcounter is incremented after the handler (handler decodes its operands itself)
+	#define VM_ADVANCE_INC		2
+
+	///Instruction handler
+	typedef bool (VM::*vm_handler_t)(const vm_instruction_t& in);
+	///Entry of the dispatch table
+	typedef struct {
+		vm_handler_t handler;
+		uint8_t advance;
+	} vm_dispatch_t;
+	///Dispatch table indexed by opcode
+	static vm_dispatch_t dispatchtable[256];
+	static void initDispatchtable(void);
+#endif
+
+	//Decoding
+	uint32_t interpret(uint32_t max_steps, uint32_t max_us, uint32_t start);
+	const vm_instruction_t* fetch(void);
+	bool decode(vm_instruction_t* in);
+	bool execute(const vm_instruction_t* in);
+	inline bool yieldpoint(uint8_t opcode);
+	inline bool checkerrors(bool success);
+	void wait(uint8_t event);
+	inline void selectKernel(vm_instruction_t* in, bool literal);
+
+	//Verification
+	bool verifyInstruction(uint16_t codesize, bool checktargets);
+	bool skipOperands(vm_instruction_t* in, uint16_t codesize);
+	inline bool verifyTarget(uint16_t target, uint16_t codesize);
+	inline bool verifyAddress(uint16_t address, uint8_t optype);
+	inline bool verifyDestination(const vm_instruction_t& in);
+	inline bool verifySource(const vm_instruction_t& in);
+	void verifyShared(const vm_instruction_t& in);
 
 	//Utility
 	inline uint8_t get_optype(void);
 	inline uint8_t get_number(void);
 	inline uint16_t get_address(void);
+	inline uint16_t get_mapid(uint8_t optype);
 	inline uint16_t get_operandaddress(uint8_t optype);
+	inline uint16_t get_destination(uint8_t optype);
+	inline uint16_t get_source(uint8_t optype);
+	inline rational_t decimalliteral(uint16_t address);
 };
 
 #endif /* CALCULATIONVM_H_ */
@@ -0,0 +1,276 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Compiler of the calculation language (host side, see VM_TOOLCHAIN). Translates programs into bytecode
+ * 				(Opcodes.h) with the Assembler:
+ *
+ * 				program		= { statement }
+ * 				statement	= "var" name [":" type] ["@" number] ["=" expression] ";"
+ * 							| "const" name "=" expression ";"
+ * 							| "map" name ("client" | "server") ("get" | "post" | "put") ["once" | "ever"] [string] string
+ * 							  ["port" number] ";"
+ * 							| "pid" "(" name "," name "," name "," kp "," ki "," kd "," sampletime "," lower "," upper
+ * 							  ["," direction] ")" ";"
+ * 							| name ("=" | "+=" | "-=" | "*=" | "/=" | "%=" | "&=" | "|=" | "^=" | "<<=" | ">>=") expression ";"
+ * 							| "if" "(" condition ")" block ["else" block]
+ * 							| "while" "(" condition ")" block
+ * 							| "sleep" "(" expression ")" ";"
+ * 							| "halt" ";"
+ * 				block		= "{" { statement } "}" | statement
+ * 				condition	= expression ("<" | "<=" | "==" | "!=" | ">=" | ">") expression
+ * 				expression	= numbers, variables and constants with | ^ & << >> + - * / % ~ and parentheses (precedence of C)
+ * 				type		= "u8" | "u16" | "u32" | "dec"
+ *
+ * 				Comments start with "//". Variables are global and have to be declared before they are used, maps
+ * 				(client: input from the URL, server: output) and PID controllers (input, output and setpoint, dec) get
+ * 				their IDs in the order of declaration. Operations are executed in the type of the assigned variable
+ * 				(conditions: the widest type of both sides), operands are converted to it. Integer types and dec are not
+ * 				mixed.
+ *
+ * 				Constant subexpressions are folded into literal operands. Variables without type get the smallest type
+ * 				which holds every constant they are assigned and compared with (dec for negative or fractional constants).
+ * 				The most used variables are kept in registers, variables with address, maps and PID controllers are
+ * 				stored in memory behind the code.
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+#ifndef INCLUDES_COMPILER_H_
+#define INCLUDES_COMPILER_H_
+
+#include "Assembler.h"
+
+///Maximum number of nodes (expressions and statements) of a program
+#define COMPILER_NODES				(1024)
+///Maximum number of variables and constants of a program
+#define COMPILER_VARIABLES			(64)
+///Registers reserved for intermediate results (the highest registers)
+#define COMPILER_TEMPORARIES		(4)
+///Maximum number of intermediate results of an expression
+#define COMPILER_DEPTH				(16)
+///No node
+#define COMPILER_NO_NODE			(0xffff)
+///Variable stored in memory
+#define COMPILER_NO_REGISTER		(0xff)
+///Type of a variable before inference
+#define COMPILER_TYPE_UNKNOWN		(0xff)
+
+///Node: number (value)
+#define COMPILER_NODE_NUMBER		(0)
+///Node: variable
+#define COMPILER_NODE_VARIABLE		(1)
+///Node: left op right (op is the opcode)
+#define COMPILER_NODE_BINARY		(2)
+///Node: ~left
+#define COMPILER_NODE_NOT			(3)
+///Node: left relation right (op is the relation)
+#define COMPILER_NODE_CONDITION		(4)
+///Node: variable = left
+#define COMPILER_NODE_ASSIGN		(5)
+///Node: if(left) right else extra
+#define COMPILER_NODE_IF			(6)
+///Node: while(left) right
+#define COMPILER_NODE_WHILE			(7)
+///Node: sleep(left)
+#define COMPILER_NODE_SLEEP			(8)
+///Node: halt
+#define COMPILER_NODE_HALT			(9)
+///Node: map declaration (variable is the map ID)
+#define COMPILER_NODE_MAP			(10)
+///Node: PID controller declaration (variable is the PID ID)
+#define COMPILER_NODE_PID			(11)
+
+///Relations are the COMPARE targets which are true: less
+#define COMPILER_LESS				(0x01)
+///Relation: equal
+#define COMPILER_EQUAL				(0x02)
+///Relation: greater
+#define COMPILER_GREATER			(0x04)
+
+/**
+ * Expression or statement.
+ */
+typedef struct {
+	///Kind of the node (COMPILER_NODE_*)
+	uint8_t kind;
+	///Opcode (BINARY) or relation (CONDITION)
+	uint8_t op;
+	uint16_t left;
+	uint16_t right;
+	///Else block (IF)
+	uint16_t extra;
+	///Next statement of the block
+	uint16_t next;
+	///Variable (VARIABLE, ASSIGN) or ID (MAP, PID)
+	uint16_t variable;
+	///Source line
+	uint16_t line;
+	///Number
+	double value;
+} compiler_node_t;
+
+/**
+ * Variable or constant.
+ */
+typedef struct {
+	char name[ASSEMBLER_SYMBOL_LENGTH + 1];
+	bool constant;
+	///Value of a constant
+	double value;
+	///Type (VM_OPERAND_TYPE_*), COMPILER_TYPE_UNKNOWN until inferred
+	uint8_t type;
+	///Type was declared
+	bool typed;
+	///Stored at a fixed address
+	bool fixed;
+	uint16_t address;
+	///Stored in memory (fixed address, map, PID controller)
+	bool memory;
+	///Register or COMPILER_NO_REGISTER
+	uint8_t reg;
+	///Uses weighted with the loop depth
+	uint32_t uses;
+	///Assembler symbol of variables in memory
+	uint16_t symbol;
+} compiler_variable_t;
+
+/**
+ * URL map declaration.
+ */
+typedef struct {
+	uint16_t variable;
+	uint8_t options;
+	uint16_t port;
+	///Host (client maps), 0 for servers
+	const char* url;
+	uint8_t urllength;
+	const char* resource;
+	uint8_t resourcelength;
+} compiler_map_t;
+
+/**
+ * PID controller declaration.
+ */
+typedef struct {
+	uint16_t input;
+	uint16_t output;
+	uint16_t setpoint;
+	///kp, ki, kd, sampletime, lower and upper limit, direction
+	double parameters[7];
+} compiler_pid_t;
+
+/**
+ * Token of the source.
+ */
+typedef struct {
+	///Kind: 'n' name, '0' number, '"' string, 'e' end, otherwise operator
+	char kind;
+	///Operator with up to three characters
+	char op[4];
+	const char* start;
+	uint8_t length;
+	double value;
+} compiler_token_t;
+
+class Compiler
+{
+public:
+	Compiler(uint8_t* code, uint16_t size);
+	~Compiler(void) { }
+
+	uint16_t compile(const char* source);
+	/**
+	 * @param registers Number of registers the program may use (at most VM_REGISTERS).
+	 */
+	void setRegisters(uint8_t registers) {this->registers = registers < VM_REGISTERS ? registers : VM_REGISTERS;}
+	/**
+	 * @return First error, empty if the program was compiled.
+	 */
+	const char* getError(void) const {return assembler.getError();}
+	/**
+	 * @return Source line of the first error.
+	 */
+	uint16_t getLine(void) const {return assembler.getLine();}
+	uint16_t getAddress(const char* name);
+	uint8_t getRegister(const char* name);
+	uint8_t getType(const char* name);
+
+private:
+	Assembler assembler;
+	uint8_t registers;
+	compiler_node_t nodes[COMPILER_NODES];
+	uint16_t nodecount;
+	compiler_variable_t variables[COMPILER_VARIABLES];
+	uint16_t variablecount;
+	compiler_map_t maps[VM_MEMORY_MAP_SIZE];
+	uint16_t mapcount;
+	compiler_pid_t pids[VM_PID_NUM_AVAILABLE];
+	uint8_t pidcount;
+	///Labels of the URLMAP instructions (shared hosts)
+	uint16_t maplabels[VM_MEMORY_MAP_SIZE];
+	///Intermediate results in use
+	uint8_t depth;
+	///Registers reserved for intermediate results
+	uint8_t temporaries;
+	///Intermediate results in memory defined in the Assembler
+	uint8_t memorytemporaries;
+	uint16_t labelcount;
+	///Variable of SLEEPUNTIL
+	uint16_t timesymbol;
+
+	const char* cursor;
+	uint16_t line;
+	compiler_token_t token;
+
+	bool fail(const char* message, const char* name = 0, uint8_t length = 0);
+	bool failed(void) const {return assembler.getError()[0] != '\0';}
+	void next(void);
+	bool accept(const char* op);
+	bool keyword(const char* word);
+	bool expect(const char* op);
+	bool name(const char** start, uint8_t* length);
+	bool constantexpression(double* value);
+	uint16_t node(uint8_t kind);
+	uint16_t find(const char* name, uint8_t length);
+	uint16_t declare(const char* name, uint8_t length);
+
+	uint16_t parseblock(bool braces);
+	uint16_t parsestatement(void);
+	uint16_t parsevar(void);
+	uint16_t parseconst(void);
+	uint16_t parsemap(void);
+	uint16_t parsepid(void);
+	uint16_t parseassign(void);
+	uint16_t parsecondition(void);
+	uint16_t parseexpression(uint8_t level);
+	uint16_t parseunary(void);
+	uint16_t binary(uint8_t opcode, uint16_t left, uint16_t right);
+
+	uint8_t rank(uint16_t expression);
+	bool widen(uint16_t expression, uint8_t rank, bool* changed);
+	void count(uint16_t expression, uint32_t weight);
+	bool infer(uint16_t statement, uint32_t weight, bool* changed);
+	bool allocate(void);
+
+	asm_operand_t location(uint16_t variable);
+	bool temporary(asm_operand_t* operand);
+	bool emit(uint8_t opcode, uint8_t type, const asm_operand_t& first, const asm_operand_t& second);
+	bool direct(uint16_t variable, uint8_t type);
+	bool load(const asm_operand_t& destination, uint8_t type, uint16_t variable);
+	bool generate(const asm_operand_t& destination, uint16_t destinationvariable, uint8_t type, uint16_t expression);
+	bool source(uint16_t expression, uint16_t destinationvariable, uint8_t type, asm_operand_t* operand);
+	bool condition(uint16_t expression, uint16_t truelabel, uint16_t falselabel);
+	bool statements(uint16_t statement);
+	bool statement(uint16_t statement);
+	uint16_t newlabel(void);
+
+	Compiler(const Compiler&);
+	Compiler& operator=(const Compiler&);
+};
+
+#endif /* INCLUDES_COMPILER_H_ */
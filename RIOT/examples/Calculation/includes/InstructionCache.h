@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Decoded instruction records and a direct mapped cache for them. Used by the calculation VM to avoid
+ * 				decoding the same bytecode instructions over and over again.
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+#ifndef INCLUDES_INSTRUCTIONCACHE_H_
+#define INCLUDES_INSTRUCTIONCACHE_H_
+
+#include <stdint.h>
+
+#include "calculationconfig.h"
+
+///Tag of an unused cache entry (0xffff can not be the address of a complete instruction)
+#define NO_INSTRUCTION	0xffff
+
+class VM;
+struct vm_instruction;
+
+///Type specialized implementation of an arithmetic or logic instruction
+typedef bool (*vm_kernel_t)(VM* vm, const struct vm_instruction& in);
+
+/**
+ * Fixed size record of a decoded instruction.
+ */
+typedef struct vm_instruction {
+	///Address of the instruction (cache tag)
+	uint16_t pc;
+	///Address of the following instruction
+	uint16_t next;
+	///Opcode
+	uint8_t opcode;
+	///OPTYPE of the instruction (0 if the instruction has none)
+	uint8_t optype;
+	///First address coded in the instruction (destination, source of COPY, CALL target)
+	uint16_t address;
+	///Address of the operand (points into the instruction if operand is literal, destination of COPY)
+	uint16_t operand;
+	///Resolved jump addresses (COMPARE: smaller, equal, greater; COMPARETIME: timeout, no timeout)
+	uint16_t jump[3];
+	///Literal value coded in the instruction (literal operand, JUMP target, COMPARETIME timeout, COPY length)
+	uint32_t literal;
+	union
+	{
+		///Second literal value coded in the instruction (ADDCOMPARE increment)
+		uint32_t increment;
+		///ID of the URL-Map (URL-Map instructions)
+		uint16_t id;
+	};
+	///Kernel selected by opcode and OPTYPE (arithmetic and logic instructions, NULL if the operand type is unsupported)
+	vm_kernel_t kernel;
+} vm_instruction_t;
+
+class InstructionCache
+{
+public:
+	InstructionCache(void);
+	~InstructionCache(void) { }
+
+	/**
+	 * Looks up a decoded instruction.
+	 * @param pc Address of the instruction.
+	 * @return Pointer to the decoded instruction, NULL if the instruction is not cached.
+	 */
+	vm_instruction_t* lookup(uint16_t pc)
+	{
+		vm_instruction_t* entry = &entries[index(pc)];
+		return entry->pc == pc ? entry : 0;
+	}
+
+	/**
+	 * Checks if the cache was filled from the current code.
+	 * @param codeversion Current code version of the memory.
+	 * @return True if cache entries can be used.
+	 */
+	bool isValid(uint32_t codeversion)
+	{
+		return version == codeversion;
+	}
+
+	void insert(const vm_instruction_t* instruction);
+	void invalidate(uint32_t codeversion);
+	uint16_t getCacheSize(void);
+
+private:
+	vm_instruction_t entries[VM_DECODE_CACHE_SIZE];
+	uint32_t version;
+
+	/**
+	 * @param pc Address of the instruction.
+	 * @return Cache index of the instruction.
+	 */
+	static uint16_t index(uint16_t pc)
+	{
+		return (pc ^ (pc >> 5)) & (VM_DECODE_CACHE_SIZE - 1);
+	}
+};
+
+#endif /* INCLUDES_INSTRUCTIONCACHE_H_ */
@@ -7,7 +7,10 @@
  */
 
 /**
- * @brief       Memory implementation to provide shared memory usable by multiple threads. Protects memory access via mutexes.
+ * @brief       Memory implementation to provide shared memory usable by multiple threads. Holds the code in the memory, in a separate
+ * 				code segment (Harvard mode) or in a read-only program image. URL mappings are taken in blocks from a pool
+ * 				shared by all instances and protected via mutexes, values shared with other threads (mapped values, PID inputs,
+ * 				outputs and setpoints) via a sequence lock.
  *
  * @author      Mattes Besuden <besuden@uni-bremen.de>
  */
@@ -22,20 +25,104 @@
 
 ///Defines memory size
 #define MEMORY_SIZE		VM_MEMORY_SIZE
-///Defines number of availabe URL-Mappings
+///Defines number of URL-Map ids
 #define MEMORY_MAP_SIZE	VM_MEMORY_MAP_SIZE
+///URL-Maps in a block of the map pool
+#define MEMORY_MAP_BLOCK	VM_MEMORY_MAP_BLOCK
+///Blocks of the map pool shared by all instances
+#define MEMORY_MAP_POOL		VM_MAP_POOL_BLOCKS
+///Most URL-Maps an instance can use (all ids or all blocks of the pool)
+#define MEMORY_MAP_CAPACITY	(MEMORY_MAP_SIZE < MEMORY_MAP_POOL * MEMORY_MAP_BLOCK ? MEMORY_MAP_SIZE : MEMORY_MAP_POOL * MEMORY_MAP_BLOCK)
+#ifdef VM_HARVARD
+///Defines code segment size
+#define MEMORY_CODE_SIZE	VM_CODE_SIZE
+///Size of the code region of the memory (program images may be larger)
+#define MEMORY_CODE_REGION	MEMORY_CODE_SIZE
+#else
+///Size of the code region of the memory (program images may be larger)
+#define MEMORY_CODE_REGION	MEMORY_SIZE
+#endif
+///Size of the words which are marked as shared
+#define MEMORY_SHARED_WORD_SIZE		4
+///Size of the bitmap of shared words
+#define MEMORY_SHARED_MAP_SIZE		((MEMORY_SIZE + 8 * MEMORY_SHARED_WORD_SIZE - 1) / (8 * MEMORY_SHARED_WORD_SIZE))
+///Number of copies snapshot() tries before giving up
+#define MEMORY_SNAPSHOT_RETRIES		8
+///Time in µs snapshot() sleeps before retrying, lets a preempted writer finish its write
+#define MEMORY_SNAPSHOT_BACKOFF_US	100
+///Slots of the open-addressing indexes of the URL-Maps (power of two, at least twice the number of URL-Maps of an instance)
+#define MEMORY_INDEX_SIZE			(MEMORY_MAP_CAPACITY <= 64 ? 128 : MEMORY_MAP_CAPACITY <= 128 ? 256 : 512)
+///Map id returned if no URL-Map matches
+#define MEMORY_NO_MAP				0xffff
+///Block of an id range without URL-Maps
+#define MEMORY_NO_BLOCK				0xff
+
+#if (MEMORY_INDEX_SIZE & (MEMORY_INDEX_SIZE - 1)) || MEMORY_INDEX_SIZE < 2 * MEMORY_MAP_CAPACITY
+#error "MEMORY_INDEX_SIZE must be a power of two and at least 2 * MEMORY_MAP_CAPACITY"
+#endif
+#if MEMORY_MAP_SIZE % MEMORY_MAP_BLOCK || MEMORY_MAP_SIZE >= MEMORY_NO_MAP || MEMORY_MAP_POOL >= MEMORY_NO_BLOCK
+#error "MEMORY_MAP_SIZE must be a multiple of MEMORY_MAP_BLOCK, the pool can have at most 254 blocks"
+#endif
+#if MEMORY_MAP_BLOCK > 32
+#error "MEMORY_MAP_BLOCK must fit into the 32Bit bitmap of used URL-Maps"
+#endif
+
+/**
+ * Block of URL-Maps of the map pool, assigned to one memory instance. Every field of the URL-Maps is stored in its own
+ * array (see url_map_t), so scans only touch the fields they compare. Unused URL-Maps are skipped with the bitmap.
+ */
+typedef struct {
+	///Bitmap of the used URL-Maps (bit i for the i-th id of the range), the block returns to the pool with the last one
+	uint32_t active;
+	uint8_t status[MEMORY_MAP_BLOCK];
+	uint8_t map_options[MEMORY_MAP_BLOCK];
+	uint8_t optype[MEMORY_MAP_BLOCK];
+	uint16_t value_address[MEMORY_MAP_BLOCK];
+	uint16_t url_address[MEMORY_MAP_BLOCK];
+	uint16_t resource_address[MEMORY_MAP_BLOCK];
+	uint16_t port[MEMORY_MAP_BLOCK];
+	///Hash of the resource of every URL-Map, taken when the URL-Map is created
+	uint32_t resourcehashes[MEMORY_MAP_BLOCK];
+	///Length of the resource of every URL-Map
+	uint16_t resourcelengths[MEMORY_MAP_BLOCK];
+	///Bitmap of the URL-Maps whose value was written since the change was taken (see Memory::mapChanged)
+	uint32_t dirty;
+	///Bitmap of the URL-Maps with a pushed value
+	uint32_t pushed;
+	///Last pushed value of every URL-Map (raw bytes of the value)
+	uint32_t pushedvalues[MEMORY_MAP_BLOCK];
+} memory_map_block_t;
 
 class Memory
 {
 public:
+	/**
+	 * Memory instances
+	 * @return Array of the shared memories of all VM instances
+	 */
+	static Memory* instances(void)
+	{
+	   static Memory shared_memories[VM_INSTANCES];
+	   return shared_memories;
+	}
+
 	/**
 	 * Memory instance
-	 * @return Instance of shared memory
+	 * @return Instance of shared memory (memory of the first VM instance)
 	 */
 	static Memory& instance()
 	{
-	   static Memory shared_memory;
-	   return shared_memory;
+	   return instances()[0];
+	}
+
+	/**
+	 * Memory instance
+	 * @param vm Number of the VM instance (must be lower than VM_INSTANCES).
+	 * @return Shared memory of the VM instance
+	 */
+	static Memory& instance(uint8_t vm)
+	{
+	   return instances()[vm];
 	}
 	Memory(void);
 	~Memory(void) { }
@@ -50,32 +137,306 @@ public:
 	rational_t loadrational(uint16_t baseaddress);
 	uint32_t loadunsigned(uint16_t baseaddress);
 
+	/**
+	 * Loads a value without range check. Only for addresses proven to be in range (see VM::verify).
+	 * @param baseaddress Address of the value to load.
+	 * @return Value from memory.
+	 */
+	template<typename T>
+	T loadunchecked(uint16_t baseaddress) const noexcept
+	{
+		T value;
+		read(baseaddress, &value, sizeof(T));
+		return value;
+	}
+
+	/**
+	 * Stores a value without range check. Only for addresses proven to be in range (see VM::verify).
+	 * @param baseaddress Address where to store value.
+	 * @param value Value to store.
+	 */
+	template<typename T>
+	void storeunchecked(uint16_t baseaddress, T value) noexcept
+	{
+		if(baseaddress < codesize && !codeimage)
+		{
+			codeversion++;
+		}
+		write(baseaddress, &value, sizeof(T));
+	}
+
+	/**
+	 * Starts a batch of stores of the VM thread (translated programs, see Translation.h). The write epoch stays odd until
+	 * endBatch(), so snapshots retry instead of every store changing the epoch twice.
+	 */
+	void beginBatch(void) {writeepoch++;}
+	/**
+	 * Ends a batch of stores started by beginBatch().
+	 */
+	void endBatch(void) {writeepoch++;}
+
+	/**
+	 * Stores a value of a batch without range check. Only for addresses proven to be in range and outside of the code region.
+	 * @param baseaddress Address where to store value.
+	 * @param value Value to store.
+	 */
+	template<typename T>
+	void storebatched(uint16_t baseaddress, T value) noexcept
+	{
+		if(isshared(baseaddress, sizeof(T)))
+		{
+			writeshared(baseaddress, &value, sizeof(T));
+			return;
+		}
+		memcpy(memory + baseaddress, &value, sizeof(T));
+	}
+
+	/**
+	 * Loads a value without range check and sequence lock. Only for addresses proven to be in range and never shared
+	 * with other threads (see VM::verifiedUnshared).
+	 * @param baseaddress Address of the value to load.
+	 * @return Value from memory.
+	 */
+	template<typename T>
+	T loadunshared(uint16_t baseaddress) const noexcept
+	{
+		T value;
+		memcpy(&value, memory + baseaddress, sizeof(T));
+		return value;
+	}
+
+	/**
+	 * Stores a value of a batch without range check and sequence lock. Only for addresses proven to be in range, outside
+	 * of the code region and never shared with other threads (see VM::verifiedUnshared).
+	 * @param baseaddress Address where to store value.
+	 * @param value Value to store.
+	 */
+	template<typename T>
+	void storeunshared(uint16_t baseaddress, T value) noexcept
+	{
+		memcpy(memory + baseaddress, &value, sizeof(T));
+	}
+
 	void copy(uint16_t src, uint8_t len, uint16_t dest);
+	void storeBlock(uint16_t baseaddress, const uint8_t* data, uint16_t len);
+	void copyCode(uint16_t codeaddress, uint16_t len, uint16_t destaddress);
+	bool storeCode(uint16_t baseaddress, const uint8_t* data, uint16_t len);
 
-	void map(uint8_t id, uint8_t optype, uint8_t map_options, uint16_t value_address, uint16_t port, uint16_t url_address, uint16_t resource_address);
-	uint8_t checkmap(uint8_t i) {return checkmap(i, true);}
-	uint8_t checkmap(uint8_t i, bool deleteafter);
-	void map_done(uint8_t id);
-	void map_error(uint8_t id, uint8_t code);
-	void unmap(uint8_t id);
+	uint8_t loadcode(uint16_t address);
+	uint16_t loadcodeaddress(uint16_t baseaddress);
+	uint32_t loadcodeunsigned(uint16_t baseaddress);
+
+	void share(uint16_t address, uint16_t size);
+	static void markwords(uint8_t* words, uint16_t address, uint16_t size);
+	bool sharedwithin(const uint8_t* words) const;
+	/**
+	 * Checks if a value is shared with other threads. Accesses to shared values are protected by the sequence lock.
+	 * @param address Address of the value.
+	 * @param size Size of the value.
+	 * @return True if any byte of the value is in a shared word.
+	 */
+	bool isshared(uint16_t address, uint16_t size) const
+	{
+		for(uint32_t word = address / MEMORY_SHARED_WORD_SIZE; word <= (address + size - 1u) / MEMORY_SHARED_WORD_SIZE; word++)
+		{
+			if(sharedwords[word >> 3] & (1 << (word & 7)))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void setCodeSize(uint16_t size);
+	uint16_t getCodeSize(void);
+	void setCodeImage(const uint8_t* image, uint16_t size);
+	/**
+	 * Read-only program image the code is executed from.
+	 * @return Program image, NULL if the code is stored in the memory (or the code segment in Harvard mode).
+	 */
+	const uint8_t* getCodeImage(void) const {return codeimage == defaultcode() ? 0 : codeimage;}
+	uint16_t getCodeSegmentSize(void) const;
+	/**
+	 * @return Number of bytes storeCode() accepts: size of the code segment in Harvard mode, of the memory otherwise.
+	 */
+	uint16_t getCodeCapacity(void) const {return MEMORY_CODE_REGION;}
+	const unsigned char* loadcodestring(uint16_t address) const;
+	const uint8_t* dumpCode(void) const;
+	bool snapshotCode(uint16_t address, uint8_t* buffer, uint16_t len) const;
+	/**
+	 * Code version, changes whenever the code region is written.
+	 * @return Code version of the memory.
+	 */
+	uint32_t getCodeVersion(void) const {return codeversion;}
+	/**
+	 * Sticky access error flag, set by out of range accesses if built with VM_NO_EXCEPTIONS (otherwise std::range_error is thrown).
+	 * @return True if an access failed since the last clearAccessError().
+	 */
+	bool accessError(void) const {return accesserror;}
+	void clearAccessError(void) {accesserror = false;}
+
+	bool map(uint16_t id, uint8_t optype, uint8_t map_options, uint16_t value_address, uint16_t port, uint16_t url_address, uint16_t resource_address);
+	uint8_t checkmap(uint16_t i) {return checkmap(i, true);}
+	uint8_t checkmap(uint16_t i, bool deleteafter);
+	bool mapPending(uint16_t id);
+	void map_done(uint16_t id);
+	void map_error(uint16_t id, uint8_t code);
+	bool mapChanged(uint16_t id);
+	void map_resend(uint16_t id);
+	void unmap(uint16_t id);
 
 	const unsigned char* loadurl(uint16_t address) const;
 
 	const uint8_t* dump(void) const;
-	const url_map_t* dumpMap(void) const;
+	bool snapshot(uint16_t address, uint8_t* buffer, uint16_t len) const;
+	url_map_t getMap(uint16_t id);
+	uint16_t nextMap(uint16_t id, uint8_t mask = 0, uint8_t options = 0) const;
 
 	uint16_t getMemorySize(void);
-	uint8_t getMapSize(void);
-	uint8_t getMapForAddress(uint16_t address);
+	uint16_t getMapSize(void);
+	static uint8_t valuesize(uint8_t optype);
+	/**
+	 * @return Number of used URL-Maps.
+	 */
+	uint16_t getMapCount(void) const {return mapcount;}
+	uint16_t getMapForAddress(uint16_t address);
+	uint16_t findResource(const uint8_t* resource, uint16_t len);
 
 	void clear(void);
 private:
 
 	mutex_t mutex;
 	uint8_t memory[MEMORY_SIZE];
-	url_map_t mappings[MEMORY_MAP_SIZE];
+	///Map pool shared by all instances
+	static memory_map_block_t pool[MEMORY_MAP_POOL];
+	///Owner of every block of the map pool (NULL if the block is free)
+	static Memory* poolowners[MEMORY_MAP_POOL];
+	///Pool block of every range of MEMORY_MAP_BLOCK map ids (MEMORY_NO_BLOCK if no id of the range is mapped)
+	uint8_t blocks[MEMORY_MAP_SIZE / MEMORY_MAP_BLOCK];
+	///Number of used URL-Maps
+	uint16_t mapcount;
+	///Map ids by resource hash (linear probing, MEMORY_NO_MAP if the slot is empty)
+	uint16_t resourceindex[MEMORY_INDEX_SIZE];
+	///Map ids by value address (linear probing, MEMORY_NO_MAP if the slot is empty)
+	uint16_t addressindex[MEMORY_INDEX_SIZE];
+	///Size of the code region (bytecode is stored from address 0 to codesize)
+	uint16_t codesize;
+	///Read-only program image which replaces the code region (NULL if the code is stored in the memory)
+	const uint8_t* codeimage;
+#ifdef VM_HARVARD
+	///Code segment (Harvard mode), separate from the data in memory
+	uint8_t codesegment[MEMORY_CODE_SIZE];
+#endif
+	/**
+	 * @return Code used if no program image is set: the code segment in Harvard mode, NULL (code in memory) otherwise.
+	 */
+	const uint8_t* defaultcode(void) const
+	{
+#ifdef VM_HARVARD
+		return codesegment;
+#else
+		return 0;
+#endif
+	}
+	///Incremented on every write to the code region
+	volatile uint32_t codeversion;
+	///Set by failed accesses (VM_NO_EXCEPTIONS only)
+	bool accesserror;
+	///Bitmap of words shared with other threads
+	uint8_t sharedwords[MEMORY_SHARED_MAP_SIZE];
+	///Bitmap of shared words written since the URL-Maps were last marked changed (see Memory::takeDirtyWords)
+	uint8_t dirtywords[MEMORY_SHARED_MAP_SIZE];
+	///Sequence lock of the shared words, odd while a shared value is written
+	volatile uint32_t sharedsequence;
+	///Write epoch of the unshared memory (written by the VM thread only), odd while a value is written
+	volatile uint32_t writeepoch;
 	inline bool checkmemoryaddress(uint16_t* address, uint8_t typesize);
-	inline bool checkMapId(uint8_t* id);
+	inline bool checkMapId(uint16_t* id);
+	/**
+	 * @param id Map id (range checked by caller).
+	 * @return Block of the id range, NULL if no id of the range is mapped.
+	 */
+	memory_map_block_t* mapblock(uint16_t id) const
+	{
+		uint8_t block = blocks[id / MEMORY_MAP_BLOCK];
+		return block == MEMORY_NO_BLOCK ? 0 : &pool[block];
+	}
+	/**
+	 * @param id Map id.
+	 * @return Bit of the id in the bitmap of its block.
+	 */
+	static uint32_t mapbit(uint16_t id) {return UINT32_C(1) << (id % MEMORY_MAP_BLOCK);}
+	/**
+	 * @param id Map id (range checked by caller).
+	 * @return Block of the id if the URL-Map is used, NULL otherwise.
+	 */
+	memory_map_block_t* used(uint16_t id) const
+	{
+		memory_map_block_t* block = mapblock(id);
+		return block && (block->active & mapbit(id)) ? block : 0;
+	}
+	/**
+	 * @param block Block of the URL-Map.
+	 * @param index Index of the URL-Map in the block.
+	 * @return True if value address, URL and resource are set (the URL-Map can be handled).
+	 */
+	static bool complete(const memory_map_block_t* block, uint8_t index)
+	{
+		return block->value_address[index] != NO_MAPPING && block->url_address[index] != NO_MAPPING
+				&& block->resource_address[index] != NO_MAPPING;
+	}
+	static bool differs(uint8_t optype, uint32_t value, uint32_t pushed);
+	void touch(uint16_t address, uint16_t size);
+	void takeDirtyWords(void);
+	static void clearMap(url_map_t* mapping);
+	memory_map_block_t* allocate(uint16_t id);
+	void release(uint16_t id);
+	const unsigned char* loadresource(uint8_t map_options, uint16_t address, uint16_t* len) const;
+	void reindex(void);
+	static uint32_t hashresource(const unsigned char* resource, uint16_t len);
+	/**
+	 * @param address Value address.
+	 * @return First slot of the address in addressindex.
+	 */
+	static uint16_t addressslot(uint16_t address) {return (address ^ (address >> 5)) & (MEMORY_INDEX_SIZE - 1);}
+	inline void checkcodewrite(uint16_t address);
+
+	/**
+	 * Reads a value, consistent with concurrent writes if the value is shared.
+	 * @param address Address of the value (range checked by caller).
+	 * @param value Destination of the value.
+	 * @param size Size of the value.
+	 */
+	void read(uint16_t address, void* value, uint8_t size) const
+	{
+		if(size > 1 && isshared(address, size))
+		{
+			readshared(address, value, size);
+			return;
+		}
+		memcpy(value, memory + address, size);
+	}
+
+	/**
+	 * Writes a value, atomic for readers of shared values. Writes to shared values mark the URL-Maps of the value changed.
+	 * @param address Address of the value (range checked by caller).
+	 * @param value Source of the value.
+	 * @param size Size of the value.
+	 */
+	void write(uint16_t address, const void* value, uint8_t size)
+	{
+		if(isshared(address, size))
+		{
+			writeshared(address, value, size);
+			return;
+		}
+		writeepoch++;
+		memcpy(memory + address, value, size);
+		writeepoch++;
+	}
+
+	void readshared(uint16_t address, void* value, uint16_t size) const;
+	void writeshared(uint16_t address, const void* value, uint16_t size);
 };
 
 #endif /* MEMORY_H_ */
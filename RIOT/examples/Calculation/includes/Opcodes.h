@@ -38,6 +38,20 @@
 
 ///ID coded inside OPTYPE (used for URL-Map and PID IDs)
 #define VM_OPTYPE_ID(x)			(x >> 4)
+///Number of IDs which can be coded inside the OPTYPE
+#define VM_OPTYPE_IDS			16
+///URL-Map ID 15 in the OPTYPE: the ID is coded as 16Bit operand following the OPTYPE (URL-Map instructions only, the type bits keep their meaning)
+#define VM_OPTYPE_WIDE_ID		0xf0
+///Number of URL-Map IDs which can be coded inside the OPTYPE (0 to 14, higher IDs are wide)
+#define VM_OPTYPE_MAP_IDS		(VM_OPTYPE_IDS - 1)
+///True if the OPTYPE of a URL-Map instruction is followed by a wide ID
+#define VM_OPTYPE_IS_WIDE_ID(x)	(((x) & VM_OPTYPE_WIDE_ID) == VM_OPTYPE_WIDE_ID)
+
+//Register operands of arithmetic, logic, LOAD and COMPARE instructions (unused OPTYPE bits, programs without these bits are unchanged)
+///Destination (first operand) is a register, coded as 8Bit register number instead of a 16Bit address
+#define VM_REGISTER_DESTINATION	0x80
+///Operand is a register, coded as 8Bit register number instead of a 16Bit address (VM_ADDRESS only)
+#define VM_REGISTER_OPERAND		0x40
 
 //Instructions (see OPCODE Details for details)
 ///Addition
@@ -51,6 +65,15 @@
 ///Modulus
 #define VM_INSTRUCTION_MOD					0x05
 
+///Stack addition, pops b and a, pushes a + b (OPTYPE type only)
+#define VM_INSTRUCTION_SADD					0x06
+///Stack substraction, pops b and a, pushes a - b (OPTYPE type only)
+#define VM_INSTRUCTION_SSUB					0x07
+///Stack multiplication, pops b and a, pushes a * b (OPTYPE type only)
+#define VM_INSTRUCTION_SMUL					0x08
+///Stack division, pops b and a, pushes a / b (OPTYPE type only)
+#define VM_INSTRUCTION_SDIV					0x09
+
 ///AND (not defined for decimal_t)
 #define VM_INSTRUCTION_AND					0x10
 ///OR (not defined for decimal_t)
@@ -70,9 +93,9 @@
 ///Loads n values into memory
 #define	VM_INSTRUCTION_MULTILOAD			0x21
 
-///Pushes value on Stack (not implemented)
+///Pushes a value (literal or from an address) of the OPTYPE type on the operand stack
 #define VM_INSTRUCTION_PUSH					0x30
-///Pops value from stack to memory (not implemented)
+///Pops a value of the OPTYPE type from the operand stack to an address
 #define VM_INSTRUCTION_POP					0x31
 
 ///Copies LENGTH Bytes From SRC Address to DEST Address whereas LENGTH can be a literal or an address
@@ -92,18 +115,31 @@
 #define VM_INSTRUCTION_RETURN				0x54
 
 //#define SWITCH			0x55//conditional jump
+///Pops b and a from the operand stack and jumps to address1 if a < b, address2 if a == b, address3 if a > b
+#define VM_INSTRUCTION_SCOMPARE				0x56
+///Superinstruction ADD + COMPARE (loop counter): adds the literal increment to the value at the address, then compares it like COMPARE (OPTYPE, address, increment, operand, 3 jump addresses)
+#define VM_INSTRUCTION_ADDCOMPARE			0x57
 
 ///Stores CPU time (uint32_t) in specified memory address
 #define VM_INSTRUCTION_TIME					0x60
 ///Compares CPU time with memory value (Address) if NOW - LAST > TIMEOUT Jump to Address else Jump to Address2
 #define VM_INSTRUCTION_COMPARETIME			0x61
+///Waits until NOW - LAST >= TIMEOUT (LAST at Address, TIMEOUT in ms) without polling, the VM thread sleeps if no other instance is runnable
+#define VM_INSTRUCTION_SLEEPUNTIL			0x62
+///Superinstruction TIME + COMPARETIME: stores CPU time at Address1, then compares like COMPARETIME with the time at Address2 (Address1, Address2, TIMEOUT, 2 jump addresses)
+#define VM_INSTRUCTION_TIMECOMPARE			0x63
 
+//URL-Map instructions: the ID of the URL-Map is coded in the OPTYPE, or with VM_OPTYPE_WIDE_ID as 16Bit operand after the OPTYPE
 ///Maps a Memory Address with an URL (uses map options defined in URL_Mapping.h)
 #define VM_INSTRUCTION_URLMAP				0x70
 ///Checks if Mapped value was handled at least once
 #define VM_INSTRUCTION_URLMAPCHECK			0x71
 ///Deletes URL Mapping
 #define VM_INSTRUCTION_URLMAPDELETE			0x72
+///Waits until URL Mapping x was handled (done or error), continues immediately if x is not mapped
+#define VM_INSTRUCTION_URLMAPWAIT			0x73
+///Superinstruction URLMAPCHECK + COMPARE: stores the status of URL Mapping x at the address, then compares it (uint8_t) like COMPARE (OPTYPE with ID, address, operand, 3 jump addresses)
+#define VM_INSTRUCTION_URLMAPCOMPARE		0x74
 
 ///Initializes PID x with parameters (doesn't start PID) can be used to change PID x (needs to be cleared first).
 #define VM_INSTRUCTION_PIDINIT				0x80
@@ -113,6 +149,8 @@
 #define VM_INSTRUCTION_PIDSTOP				0x83
 ///Starts PID x (set to AUTOMATIC)
 #define VM_INSTRUCTION_PIDRUN				0x84
+///Waits until PID x computed a new output, continues immediately if PID x is not running
+#define VM_INSTRUCTION_PIDWAIT				0x85
 
 //Only OPCODE instructions
 ///Stops execution, sets halt flag true
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Operand stack of the calculation VM. Holds uint8_t, uint16_t, uint32_t and rational_t values as 32Bit slots
+ * 				(raw bits like literals, the type is given by the OPTYPE of the instruction), so temporaries of PUSH, POP and
+ * 				the stack arithmetic instructions do not go through the memory.
+ * 				Push and pop are not checked, the VM checks the depth once per instruction (see hasSpace() and holds()).
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+#ifndef INCLUDES_OPERANDSTACK_H_
+#define INCLUDES_OPERANDSTACK_H_
+
+#include <stdint.h>
+
+#include "calculationconfig.h"
+
+///Defines the number of slots of the operand stack
+#define OPERAND_STACK_SIZE VM_STACK_SIZE
+
+class OperandStack
+{
+public:
+	OperandStack(void);
+	~OperandStack(void) { }
+
+	/**
+	 * @param count Number of values to push.
+	 * @return True if count values can be pushed.
+	 */
+	bool hasSpace(uint8_t count) const {return pointer + count <= OPERAND_STACK_SIZE;}
+	/**
+	 * @param count Number of values to pop.
+	 * @return True if the stack holds at least count values.
+	 */
+	bool holds(uint8_t count) const {return pointer >= count;}
+
+	/**
+	 * Pushes a value, the caller has to check hasSpace(1).
+	 * @param value Raw bits of the value.
+	 */
+	void push(uint32_t value) {slots[pointer++] = value;}
+	/**
+	 * Pops a value, the caller has to check holds(1).
+	 * @return Raw bits of the value.
+	 */
+	uint32_t pop(void) {return slots[--pointer];}
+	/**
+	 * Value on top of the stack, the caller has to check holds(1).
+	 * @return Reference to the raw bits of the value, can be overwritten in place.
+	 */
+	uint32_t& top(void) {return slots[pointer - 1];}
+
+	const uint32_t* dump(void) const;
+	uint8_t getDepth(void) const;
+	uint8_t getStackSize(void) const;
+	void clear(void);
+private:
+	uint32_t slots[OPERAND_STACK_SIZE];
+	uint8_t pointer;
+};
+
+#endif /* INCLUDES_OPERANDSTACK_H_ */
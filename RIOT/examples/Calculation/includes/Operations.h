@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Operand types and arithmetic/logic operations of the calculation VM. The VM instantiates one kernel per
+ * 				operation, operand type and literal/address mode from these definitions.
+ * 				A new operand type needs an operand_type specialization and one registerType call in the VM.
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+#ifndef INCLUDES_OPERATIONS_H_
+#define INCLUDES_OPERATIONS_H_
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "Opcodes.h"
+#include "Memory.h"
+
+///Number of operand type codes with kernels (type codes 0x08 to 0x0e are reserved)
+#define VM_OPERAND_TYPES		4
+///Index of an operand type code
+#define VM_OPERAND_TYPE_INDEX(x)	((x & VM_OPTYPE_MASK) >> 1)
+
+/**
+ * Memory access and literal conversion of an operand type. Literals and operand stack slots hold the raw bits of a value.
+ */
+template<typename T>
+struct operand_type;
+
+template<>
+struct operand_type<uint8_t>
+{
+	///Type code in the OPTYPE
+	static const uint8_t code = VM_OPERAND_TYPE_UINT8;
+	///Bitwise operations are defined
+	static const bool integer = true;
+	static uint8_t load(Memory* memory, uint16_t address) { return memory->load(address); }
+	static void store(Memory* memory, uint16_t address, uint8_t value) { memory->store(address, value); }
+	static uint32_t loadliteral(Memory* memory, uint16_t address) { return memory->loadcode(address); }
+	static uint8_t fromliteral(uint32_t literal) { return literal; }
+	static uint32_t toliteral(uint8_t value) { return value; }
+};
+
+template<>
+struct operand_type<uint16_t>
+{
+	///Type code in the OPTYPE
+	static const uint8_t code = VM_OPERAND_TYPE_UINT16;
+	///Bitwise operations are defined
+	static const bool integer = true;
+	static uint16_t load(Memory* memory, uint16_t address) { return memory->loadaddress(address); }
+	static void store(Memory* memory, uint16_t address, uint16_t value) { memory->storeaddress(address, value); }
+	static uint32_t loadliteral(Memory* memory, uint16_t address) { return memory->loadcodeaddress(address); }
+	static uint16_t fromliteral(uint32_t literal) { return literal; }
+	static uint32_t toliteral(uint16_t value) { return value; }
+};
+
+template<>
+struct operand_type<uint32_t>
+{
+	///Type code in the OPTYPE
+	static const uint8_t code = VM_OPERAND_TYPE_UINT32;
+	///Bitwise operations are defined
+	static const bool integer = true;
+	static uint32_t load(Memory* memory, uint16_t address) { return memory->loadunsigned(address); }
+	static void store(Memory* memory, uint16_t address, uint32_t value) { memory->storeunsigned(address, value); }
+	static uint32_t loadliteral(Memory* memory, uint16_t address) { return memory->loadcodeunsigned(address); }
+	static uint32_t fromliteral(uint32_t literal) { return literal; }
+	static uint32_t toliteral(uint32_t value) { return value; }
+};
+
+template<>
+struct operand_type<rational_t>
+{
+	///Type code in the OPTYPE
+	static const uint8_t code = VM_OPERAND_TYPE_DEC;
+	///Bitwise operations are defined
+	static const bool integer = false;
+	static rational_t load(Memory* memory, uint16_t address) { return memory->loadrational(address); }
+	static void store(Memory* memory, uint16_t address, rational_t value) { memory->storerational(address, value); }
+	static uint32_t loadliteral(Memory* memory, uint16_t address) { return memory->loadcodeunsigned(address); }//raw bits, same size as rational_t
+	static rational_t fromliteral(uint32_t literal)
+	{
+		rational_t value;
+		memcpy(&value, &literal, sizeof(rational_t));
+		return value;
+	}
+	static uint32_t toliteral(rational_t value)
+	{
+		uint32_t literal;
+		memcpy(&literal, &value, sizeof(rational_t));
+		return literal;
+	}
+};
+
+/**
+ * Memory access of the kernels with range checks (throws std::range_error, sets the access error flag of the memory with VM_NO_EXCEPTIONS).
+ */
+struct CheckedAccess
+{
+	template<typename T> static T load(Memory* memory, uint16_t address) { return operand_type<T>::load(memory, address); }
+	template<typename T> static void store(Memory* memory, uint16_t address, T value) { operand_type<T>::store(memory, address, value); }
+};
+
+/**
+ * Memory access of the kernels without range checks, used for verified programs only.
+ */
+struct UncheckedAccess
+{
+	template<typename T> static T load(Memory* memory, uint16_t address) noexcept { return memory->loadunchecked<T>(address); }
+	template<typename T> static void store(Memory* memory, uint16_t address, T value) noexcept { memory->storeunchecked<T>(address, value); }
+};
+
+/**
+ * Operations. apply() calculates destination = destination (op) operand and returns false on a division by zero.
+ */
+struct OpAdd
+{
+	static const bool load_destination = true;
+	static const bool load_operand = true;
+	static const bool integer_only = false;
+	template<typename T> static bool apply(T& a, T b) { a = a + b; return true; }
+};
+
+struct OpSub
+{
+	static const bool load_destination = true;
+	static const bool load_operand = true;
+	static const bool integer_only = false;
+	template<typename T> static bool apply(T& a, T b) { a = a - b; return true; }
+};
+
+struct OpMul
+{
+	static const bool load_destination = true;
+	static const bool load_operand = true;
+	static const bool integer_only = false;
+	template<typename T> static bool apply(T& a, T b) { a = a * b; return true; }
+};
+
+struct OpDiv
+{
+	static const bool load_destination = true;
+	static const bool load_operand = true;
+	static const bool integer_only = false;
+	template<typename T> static bool apply(T& a, T b)
+	{
+		if(b == 0)
+		{
+			return false;
+		}
+		a = a / b;
+		return true;
+	}
+};
+
+struct OpMod
+{
+	static const bool load_destination = true;
+	static const bool load_operand = true;
+	static const bool integer_only = false;
+	template<typename T> static bool apply(T& a, T b)
+	{
+		if(b == 0)
+		{
+			return false;
+		}
+		a = a % b;
+		return true;
+	}
+	static bool apply(rational_t& a, rational_t b)//imperformant, da kein mod auf fixed -> convert to float modulo konvert back
+	{
+		if(b == 0)
+		{
+			return false;
+		}
+#ifdef FIXEDTYPE
+		a = static_cast<rational_t>(fmod(static_cast<float>(a), static_cast<float>(b)));
+#else
+		a = fmod(a, b);
+#endif
+		return true;
+	}
+};
+
+struct OpAnd
+{
+	static const bool load_destination = true;
+	static const bool load_operand = true;
+	static const bool integer_only = true;
+	template<typename T> static bool apply(T& a, T b) { a = a & b; return true; }
+};
+
+struct OpOr
+{
+	static const bool load_destination = true;
+	static const bool load_operand = true;
+	static const bool integer_only = true;
+	template<typename T> static bool apply(T& a, T b) { a = a | b; return true; }
+};
+
+struct OpNot
+{
+	static const bool load_destination = true;
+	static const bool load_operand = false;
+	static const bool integer_only = true;
+	template<typename T> static bool apply(T& a, T b) { (void) b; a = a ^ -1; return true; }
+};
+
+struct OpXor
+{
+	static const bool load_destination = true;
+	static const bool load_operand = true;
+	static const bool integer_only = true;
+	template<typename T> static bool apply(T& a, T b) { a = a ^ b; return true; }
+};
+
+struct OpLshift
+{
+	static const bool load_destination = true;
+	static const bool load_operand = true;
+	static const bool integer_only = true;
+	template<typename T> static bool apply(T& a, T b) { a = a << b; return true; }
+};
+
+struct OpRshift
+{
+	static const bool load_destination = true;
+	static const bool load_operand = true;
+	static const bool integer_only = true;
+	template<typename T> static bool apply(T& a, T b) { a = a >> b; return true; }
+};
+
+struct OpLoad
+{
+	static const bool load_destination = false;
+	static const bool load_operand = true;
+	static const bool integer_only = false;
+	template<typename T> static bool apply(T& a, T b) { a = b; return true; }
+};
+
+#endif /* INCLUDES_OPERATIONS_H_ */
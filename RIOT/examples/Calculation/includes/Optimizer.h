@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Optimizer for the program in the code region of a VM. Runs before an uploaded program is started:
+ * 				- strength reduction: MUL, DIV and MOD by a literal power of two into LSHIFT, RSHIFT and AND (unsigned types),
+ * 				- jump threading: targets of jumps, calls and compares which point to a JUMP are replaced by its target,
+ * 				- constant folding: LOAD of a literal followed by ADD, SUB or MUL of literals into one LOAD,
+ * 				- superinstructions: ADD + COMPARE into ADDCOMPARE, TIME + COMPARETIME into TIMECOMPARE, URLMAPCHECK + COMPARE
+ * 				  into URLMAPCOMPARE,
+ * 				- dead code removal: code behind HALT, JUMP, RETURN and compares which is no jump target.
+ * 				Removed code is closed by moving the following code, all jump targets are relocated.
+ * 				Only verified programs are rewritten (no indirect jumps, all targets known), the VM has to be stopped and cleared afterwards.
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+#ifndef INCLUDES_OPTIMIZER_H_
+#define INCLUDES_OPTIMIZER_H_
+
+#include "CalculationVM.h"
+
+///Maximum size of a superinstruction in Bytes (ADDCOMPARE with 32Bit increment and literal)
+#define OPTIMIZER_FUSED_SIZE	(1 + 1 + 2 + 4 + 4 + 3 * 2)
+///Maximum number of JUMPs followed by jump threading for one target (ends loops of JUMPs)
+#define OPTIMIZER_THREAD_HOPS	(8)
+
+///Estimated cycles of the dispatch of one instruction (fetch, decode cache lookup, handler call)
+#define OPTIMIZER_DISPATCH_CYCLES	(30)
+///Estimated cycles a multiplication takes longer than a shift
+#define OPTIMIZER_MUL_CYCLES		(4)
+///Estimated cycles a division or modulo takes longer than a shift or AND (software division on Cortex-M0)
+#define OPTIMIZER_DIV_CYCLES		(40)
+
+///Pass: MUL, DIV and MOD by powers of two into shifts and AND
+#define OPTIMIZER_PASS_STRENGTH		0x01
+///Pass: jump threading
+#define OPTIMIZER_PASS_THREAD		0x02
+///Pass: constant folding of LOAD chains
+#define OPTIMIZER_PASS_FOLD			0x04
+///Pass: superinstructions
+#define OPTIMIZER_PASS_FUSE			0x08
+///Pass: dead code removal
+#define OPTIMIZER_PASS_DEADCODE		0x10
+///All passes
+#define OPTIMIZER_PASSES_ALL		0x1f
+
+/**
+ * Instructions which are replaced by a shorter instruction or removed.
+ */
+typedef struct {
+	///Address of the first replaced instruction
+	uint16_t pc;
+	///Address behind the last replaced instruction
+	uint16_t end;
+	///Opcode of the replacement (superinstruction, LOAD of a folded constant), HALT if the instructions are removed
+	uint8_t opcode;
+	///Folded constant (LOAD)
+	uint32_t literal;
+	///Bytes saved by the replacement
+	uint16_t saved;
+	///Estimated cycles saved by the replacement
+	uint16_t cycles;
+} vm_rewrite_t;
+
+class Optimizer
+{
+public:
+	Optimizer(VM* vm);
+	~Optimizer(void) { }
+
+	uint16_t optimize(uint8_t passes);
+	uint8_t fuse(void);
+	/**
+	 * @return Bytes the program shrank by the last run.
+	 */
+	uint16_t getSaved(void) const {return saved;}
+	/**
+	 * Estimated cycles saved by the last run, every changed instruction counted as executed once.
+	 * @return Estimated cycles.
+	 */
+	uint32_t getCycles(void) const {return cycles;}
+
+private:
+	VM* vm;
+	Memory* memory;
+	///Rewrites found by optimize(), ordered by address
+	vm_rewrite_t rewrites[VM_OPTIMIZER_REWRITES];
+	uint8_t rewritecount;
+	uint16_t saved;
+	uint32_t cycles;
+
+	bool sweep(vm_instruction_t* in, uint16_t pc, uint16_t codesize);
+	uint16_t reduce(uint16_t codesize);
+	uint16_t thread(uint16_t codesize);
+	void marktargets(uint16_t codesize);
+	uint8_t fold(const vm_instruction_t& load, uint16_t codesize, uint16_t* end, uint32_t* literal);
+	uint16_t unreachable(const vm_instruction_t& in, uint16_t codesize);
+	void rewrite(uint16_t codesize);
+	uint8_t fusable(const vm_instruction_t& first, const vm_instruction_t& second);
+	uint8_t encode(const vm_instruction_t& first, const vm_instruction_t& second, uint8_t opcode, uint8_t* buffer);
+	uint8_t targetfields(const vm_instruction_t& in, uint16_t* field);
+	uint16_t relocate(uint16_t target);
+	bool codeaccessed(uint16_t from, uint16_t codesize);
+	bool accesses(const vm_instruction_t& in, uint16_t from, uint16_t to);
+	uint32_t loadliteral(uint16_t address, uint8_t optype);
+	void storeliteral(uint16_t address, uint8_t optype, uint32_t value);
+	void copycode(uint16_t address, uint8_t len, uint8_t* buffer);
+
+	Optimizer(const Optimizer&);
+	Optimizer& operator=(const Optimizer&);
+};
+
+#endif /* INCLUDES_OPTIMIZER_H_ */
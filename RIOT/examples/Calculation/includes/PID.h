@@ -34,19 +34,32 @@ public:
 	///PID direction reverse, output signedness is reversed with parameter signedness
 	#define PID_DIRECTION_REVERSE 1
 
+	///Number of PID controllers of all VM instances
+	#define PID_NUM_INSTANCES (VM_PID_NUM_AVAILABLE * VM_INSTANCES)
+
 	PID();
 
 	/**
 	 * PID instances
-	 * @return Array of shared PID instances
+	 * @return Array of shared PID instances (PID_NUM_INSTANCES)
 	 */
 	static PID* instances(void)
 	{
 		//shared static pids(not initialized)
-		static PID vm_pids[VM_PID_NUM_AVAILABLE];
+		static PID vm_pids[PID_NUM_INSTANCES];
 		return vm_pids;
 	}
 
+	/**
+	 * PID instances of a VM instance
+	 * @param vm Number of the VM instance (must be lower than VM_INSTANCES).
+	 * @return Array of the VM_PID_NUM_AVAILABLE PID instances of the VM instance
+	 */
+	static PID* instances(uint8_t vm)
+	{
+		return instances() + vm * VM_PID_NUM_AVAILABLE;
+	}
+
 	bool init(Memory* _memory, uint16_t _inputaddress, uint16_t _outputaddress, uint16_t _setpointaddress,
 			rational_t _kp, rational_t _ki, rational_t _kd,
 			uint32_t _sampleTime, uint8_t _direction,
@@ -71,14 +84,29 @@ public:
 	rational_t getLowerLimit(void);
 
 	bool isInitialized(void);
+	/**
+	 * @return Number of computed outputs (changes with every new output, wraps around).
+	 */
+	uint32_t getComputations(void) {return computations;}
 
 
 private:
 
 	void initialize(void);
+	/**
+	 * Addresses are checked once by init(), the PID thread accesses its values without range check (a failed check would
+	 * set the sticky error flag of the VM thread).
+	 * @param memory Memory of the PID.
+	 * @param address Address of a rational value.
+	 * @return True if the value is inside the memory.
+	 */
+	static bool inrange(Memory* memory, uint16_t address)
+	{
+		return address <= memory->getMemorySize() - sizeof(rational_t);
+	}
 
 	Memory* memory;
-	uint8_t map_id;
+	uint16_t map_id;
 
 	rational_t kp;
 	rational_t ki;
@@ -99,6 +127,8 @@ private:
 	uint32_t sampleTime;
 
 	bool initialized;
+	///Number of computed outputs, read by the VM thread (PIDWAIT)
+	volatile uint32_t computations;
 
 };
 
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Read-only bytecode program the calculation VM executes in place, without copying it into the shared memory.
+ * 				The image is a const array (placed in flash by the linker).
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+#ifndef INCLUDES_PROGRAMIMAGE_H_
+#define INCLUDES_PROGRAMIMAGE_H_
+
+#include <stdint.h>
+
+class ProgramImage
+{
+public:
+	ProgramImage(void);
+	ProgramImage(const uint8_t* code, uint16_t size);
+	~ProgramImage(void) { }
+
+	/**
+	 * @return Bytecode of the image, NULL if no image is set.
+	 */
+	const uint8_t* getCode(void) const {return code;}
+	/**
+	 * @return Size of the image in bytes.
+	 */
+	uint16_t getSize(void) const {return size;}
+
+private:
+	const uint8_t* code;
+	uint16_t size;
+
+	ProgramImage(const ProgramImage&);
+	ProgramImage& operator=(const ProgramImage&);
+};
+
+#endif /* INCLUDES_PROGRAMIMAGE_H_ */
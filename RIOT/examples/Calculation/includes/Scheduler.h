@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Pool of VM instances and cooperative scheduler. Every instance executes its own program on its own memory,
+ * 				stack and PID controllers. The scheduler interleaves the instances in batches inside one thread.
+ * 				Instances waiting for an event (SLEEPUNTIL, URLMAPWAIT, PIDWAIT) are not runnable, the thread parks
+ * 				if no instance is runnable and is woken by a message from the thread signaling the event (see notify()).
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+#ifndef INCLUDES_SCHEDULER_H_
+#define INCLUDES_SCHEDULER_H_
+
+extern "C" {
+#include "kernel_types.h"
+}
+
+#include "CalculationVM.h"
+
+///Returned by Scheduler::schedule() if no instance is runnable
+#define VM_NO_INSTANCE	0xff
+
+class Scheduler
+{
+public:
+	Scheduler(void);
+	~Scheduler(void);
+
+	/**
+	 * @param instance Number of the instance (must be lower than VM_INSTANCES).
+	 * @return VM of the instance.
+	 */
+	VM* getVM(uint8_t instance) {return vms[instance];}
+	/**
+	 * @return Number of VM instances.
+	 */
+	uint8_t getInstanceCount(void) const {return VM_INSTANCES;}
+
+	bool run(uint8_t instance);
+	bool stop(uint8_t instance);
+	bool restart(uint8_t instance);
+	uint16_t optimize(uint8_t instance, uint16_t* saved, uint32_t* cycles);
+	bool setPriority(uint8_t instance, uint8_t priority);
+	uint8_t getPriority(uint8_t instance) const;
+	bool isRunning(uint8_t instance) const;
+	bool isRunnable(uint8_t instance);
+	bool idle(void);
+	bool getWakeupTime(uint32_t* remaining);
+
+	uint8_t schedule(void);
+
+	static void arm(kernel_pid_t thread);
+	static void disarm(void);
+	static void notify(void);
+
+private:
+	///Storage of the VMs (VM has no default constructor)
+	alignas(VM) uint8_t storage[VM_INSTANCES][sizeof(VM)];
+	VM* vms[VM_INSTANCES];
+	///Instance executes batches until it halts or is stopped
+	bool running[VM_INSTANCES];
+	uint8_t priority[VM_INSTANCES];
+	///Instance which is checked first by the next schedule()
+	uint8_t next;
+
+	///Parked thread woken by notify()
+	static kernel_pid_t parked;
+	///The next notify() sends a wakeup message to the parked thread
+	static volatile bool armed;
+
+	uint8_t select(void);
+
+	Scheduler(const Scheduler&);
+	Scheduler& operator=(const Scheduler&);
+};
+
+#endif /* INCLUDES_SCHEDULER_H_ */
@@ -33,10 +33,18 @@ public:
 	bool isEmpty(void);
 	bool isFull(void);
 	void clear(void);
+	/**
+	 * Sticky error flag, set by overflows and underflows if built with VM_NO_EXCEPTIONS (otherwise std::overflow_error or std::underflow_error is thrown).
+	 * @return True if an operation failed since the last clearError().
+	 */
+	bool error(void) const {return stackerror;}
+	void clearError(void) {stackerror = false;}
 private:
 	uint8_t size;
 	uint16_t stack[STACK_SIZE];
 	uint8_t pointer;
+	///Set by overflows and underflows (VM_NO_EXCEPTIONS only)
+	bool stackerror;
 };
 
 
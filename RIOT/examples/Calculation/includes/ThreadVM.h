@@ -7,7 +7,8 @@
  */
 
 /**
- * @brief       Defines communication codes to control the VM thread.
+ * @brief       Defines communication codes to control the VM thread. A message holds the command, the VM instance
+ * 				it applies to and an argument (see VM_THREAD_MESSAGE).
  *
  * @author      Mattes Besuden <besuden@uni-bremen.de>
  */
@@ -22,6 +23,29 @@
 #define VM_THREAD_STATUS	0x04
 ///Command to restart VM
 #define VM_THREAD_RESTART	0x08
+///Command to set the scheduling priority of a VM instance (priority is the argument)
+#define VM_THREAD_PRIORITY	0x10
+///Wakes the parked VM thread, an event an instance waits for occurred (sent by Scheduler::notify() and the wakeup timer)
+#define VM_THREAD_WAKEUP	0x20
+
+///Command to optimize the program of a stopped VM instance, answered with VM_THREAD_OPTIMIZED (see VM_PEEPHOLE)
+#define VM_THREAD_OPTIMIZE	0x40
+
+///Builds the message value of a command to a VM instance
+#define VM_THREAD_MESSAGE(command, instance, argument)	((uint32_t)(argument) << 16 | (uint32_t)(instance) << 8 | (command))
+///Command of a message value
+#define VM_THREAD_COMMAND(value)	((value) & 0xff)
+///VM instance of a message value
+#define VM_THREAD_INSTANCE(value)	(((value) >> 8) & 0xff)
+///Argument of a message value
+#define VM_THREAD_ARGUMENT(value)	(((value) >> 16) & 0xff)
+
+///Builds the answer to VM_THREAD_OPTIMIZE: Bytes saved and estimated cycles saved (saturated to 16Bit)
+#define VM_THREAD_OPTIMIZED(saved, cycles)	((uint32_t)((cycles) > UINT16_MAX ? UINT16_MAX : (cycles)) << 16 | (uint16_t)(saved))
+///Bytes saved of an answer to VM_THREAD_OPTIMIZE
+#define VM_THREAD_OPTIMIZED_SAVED(value)	((value) & 0xffff)
+///Estimated cycles saved of an answer to VM_THREAD_OPTIMIZE
+#define VM_THREAD_OPTIMIZED_CYCLES(value)	(((value) >> 16) & 0xffff)
 
 
 #endif /* INCLUDES_THREADVM_H_ */
@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Programs translated into native code ahead of time (see Translator.h). A translation is a C++ function with one
+ * 				block per straight-line run of instructions: kernels become inline operations on fixed memory addresses and
+ * 				registers, JUMP and COMPARE become gotos. The step budget is charged once per block. Unshared memory operands
+ * 				are kept in local cells while the translated function runs. Instructions which are not translated (time, URL map, PID, stack and indirect jumps)
+ * 				end the translated function and are executed by the interpreter. Translations are compiled into the native
+ * 				build (Translations.cpp) and used by the VM instead of the interpreter if the loaded program is verified and
+ * 				equal to the translated program.
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+#ifndef INCLUDES_TRANSLATION_H_
+#define INCLUDES_TRANSLATION_H_
+
+#include "Operations.h"
+
+#ifdef VM_TRANSLATIONS
+
+/**
+ * State of the VM a translated program runs on. Programcounter, flags and statuscode are copied back into the VM.
+ */
+typedef struct {
+	Memory* memory;
+	///Register file of the VM
+	uint32_t* registers;
+	uint16_t programcounter;
+	uint8_t flags;
+	uint32_t statuscode;
+} vm_translation_state_t;
+
+/**
+ * Translated program. Executes instructions from the programcounter until the step budget does not cover the next block,
+ * the VM halted or an instruction is reached which is executed by the interpreter. Programcounters inside a block are
+ * not entered (0 instructions executed), the interpreter executes up to the next block.
+ * @param state State of the VM.
+ * @param max_steps Maximum number of instructions to execute.
+ * @return Number of executed instructions.
+ */
+typedef uint32_t (*vm_translated_t)(vm_translation_state_t* state, uint32_t max_steps);
+
+/**
+ * Translation of a program.
+ */
+typedef struct {
+	const char* name;
+	///Bytecode of the translated program
+	const uint8_t* code;
+	uint16_t size;
+	vm_translated_t run;
+} vm_translation_t;
+
+///Translations compiled into the build (Translations.cpp)
+extern const vm_translation_t vm_translations[];
+///Number of translations compiled into the build
+extern const uint8_t vm_translationcount;
+
+/**
+ * Memory operand of a translated instruction which may be shared with other threads (unchecked access, the program is
+ * verified). Stores are part of the batch of the translated program (see Memory::beginBatch()).
+ */
+template<uint16_t address>
+struct TranslatedMemory
+{
+	template<typename T> static T load(vm_translation_state_t* state, uint32_t* cells) { (void) cells; return UncheckedAccess::load<T>(state->memory, address); }
+	template<typename T> static void store(vm_translation_state_t* state, uint32_t* cells, T value) { (void) cells; state->memory->storebatched<T>(address, value); }
+};
+
+/**
+ * Memory operand of a translated instruction which the verifier proved unshared (see VM::verifiedUnshared()), accessed
+ * without sequence lock. Stores are part of the batch of the translated program.
+ */
+template<uint16_t address>
+struct TranslatedUnshared
+{
+	template<typename T> static T load(vm_translation_state_t* state, uint32_t* cells) { (void) cells; return state->memory->loadunshared<T>(address); }
+	template<typename T> static void store(vm_translation_state_t* state, uint32_t* cells, T value) { (void) cells; state->memory->storeunshared<T>(address, value); }
+};
+
+/**
+ * Unshared memory operand kept in a local cell of the translated program (raw bits like a register), so the compiler
+ * can hold it in a register. Cells are loaded when the translated program is entered and written back when it is left
+ * (translatedfetch(), translatedwriteback()).
+ */
+template<uint8_t index>
+struct TranslatedCell
+{
+	template<typename T> static T load(vm_translation_state_t* state, uint32_t* cells) { (void) state; return operand_type<T>::fromliteral(cells[index]); }
+	template<typename T> static void store(vm_translation_state_t* state, uint32_t* cells, T value) { (void) state; cells[index] = operand_type<T>::toliteral(value); }
+};
+
+/**
+ * Register operand of a translated instruction.
+ */
+template<uint8_t index>
+struct TranslatedRegister
+{
+	template<typename T> static T load(vm_translation_state_t* state, uint32_t* cells) { (void) cells; return operand_type<T>::fromliteral(state->registers[index]); }
+	template<typename T> static void store(vm_translation_state_t* state, uint32_t* cells, T value) { (void) cells; state->registers[index] = operand_type<T>::toliteral(value); }
+};
+
+/**
+ * Literal operand of a translated instruction (raw bits like the literal of a decoded instruction).
+ */
+template<uint32_t literal>
+struct TranslatedLiteral
+{
+	template<typename T> static T load(vm_translation_state_t* state, uint32_t* cells) { (void) state; (void) cells; return operand_type<T>::fromliteral(literal); }
+};
+
+/**
+ * Loads a cell from memory when the translated program is entered.
+ * @param state State of the VM.
+ * @param cell Cell of the memory operand.
+ */
+template<typename T, uint16_t address>
+inline void translatedfetch(vm_translation_state_t* state, uint32_t& cell)
+{
+	cell = operand_type<T>::toliteral(state->memory->loadunshared<T>(address));
+}
+
+/**
+ * Writes a cell back into memory when the translated program is left.
+ * @param state State of the VM.
+ * @param cell Cell of the memory operand.
+ */
+template<typename T, uint16_t address>
+inline void translatedwriteback(vm_translation_state_t* state, uint32_t cell)
+{
+	state->memory->storeunshared<T>(address, operand_type<T>::fromliteral(cell));
+}
+
+/**
+ * TIME, stores the system time in µs like the interpreter.
+ * @param state State of the VM.
+ * @param cells Cells of the translated program.
+ */
+template<class Dst>
+inline void translatedtime(vm_translation_state_t* state, uint32_t* cells)
+{
+	Dst::template store<uint32_t>(state, cells, xtimer_now());
+}
+
+/**
+ * Arithmetic, logic or LOAD instruction, same calculation as the kernels of the VM.
+ * @param state State of the VM.
+ * @param cells Cells of the translated program.
+ * @return False on a division by zero.
+ */
+template<typename T, class Op, class Dst, class Src>
+inline bool translatedkernel(vm_translation_state_t* state, uint32_t* cells)
+{
+	T a = Op::load_destination ? Dst::template load<T>(state, cells) : T();
+	T b = Op::load_operand ? Src::template load<T>(state, cells) : T();
+	if(!Op::apply(a, b))
+	{
+		return false;
+	}
+	Dst::template store<T>(state, cells, a);
+	return true;
+}
+
+/**
+ * COMPARE, same comparison as the kernels of the VM.
+ * @param state State of the VM.
+ * @param cells Cells of the translated program.
+ * @return -1, 0 or 1 if the first value is smaller, equal or greater than the second value.
+ */
+template<typename T, class Dst, class Src>
+inline int8_t translatedcompare(vm_translation_state_t* state, uint32_t* cells)
+{
+	T value1 = Dst::template load<T>(state, cells);
+	T value2 = Src::template load<T>(state, cells);
+	return value1 < value2 ? -1 : (value1 > value2 ? 1 : 0);
+}
+
+/**
+ * Superinstruction ADDCOMPARE, adds the increment to the first value and compares the sum like translatedcompare().
+ * @param state State of the VM.
+ * @param cells Cells of the translated program.
+ * @return -1, 0 or 1 if the sum is smaller, equal or greater than the second value.
+ */
+template<typename T, class Dst, class Src, uint32_t increment>
+inline int8_t translatedaddcompare(vm_translation_state_t* state, uint32_t* cells)
+{
+	T value1 = Dst::template load<T>(state, cells);
+	OpAdd::apply(value1, operand_type<T>::fromliteral(increment));
+	Dst::template store<T>(state, cells, value1);
+	T value2 = Src::template load<T>(state, cells);
+	return value1 < value2 ? -1 : (value1 > value2 ? 1 : 0);
+}
+
+///Starts a block of count instructions at pc, charges the whole block or leaves if the step budget does not cover it (the
+///interpreter executes the rest of the budget)
+#define VM_TRANSLATED_BLOCK(pc, count)	\
+	if(max_steps - steps < (count)) { VM_TRANSLATED_EXIT(pc); }	\
+	steps += (count)
+///Statuscode of the instruction at pc like VM::fetch(), set by the last instruction of a block (kept local until the
+///translated program is left)
+#define VM_TRANSLATED_STATUS(pc, opcode)	\
+	statuscode = ((uint32_t) (pc) << 16) | ((opcode) << 8)
+///Leaves the translated program through the write back of the cells, the instruction at pc is executed by the interpreter
+#define VM_TRANSLATED_EXIT(pc)	\
+	{ programcounter = (pc); goto leave; }
+///Division by zero of the instruction at pc, halts the VM like the interpreter (programcounter behind the instruction),
+///the skipped instructions of the block are not executed
+#define VM_TRANSLATED_DIVIDEZERO(pc, opcode, next, skipped)	\
+	{ steps -= (skipped); VM_TRANSLATED_STATUS(pc, opcode); state->flags |= VM_FLAG_DIVIDEZERO | VM_FLAG_ERROR | VM_FLAG_HALTED;	\
+	statuscode |= VM_ERROR_DIVIDEZERO; VM_TRANSLATED_EXIT(next); }
+///Branches to the labels of a comparison result
+#define VM_TRANSLATED_BRANCH(result, less, equal, greater)	\
+	{ int8_t comparison = (result); if(comparison < 0) goto less; if(comparison > 0) goto greater; goto equal; }
+
+#endif /* VM_TRANSLATIONS */
+
+#endif /* INCLUDES_TRANSLATION_H_ */
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Ahead of time translator of verified programs into C++ source (host side, see VM_TOOLCHAIN). The source
+ * 				of all translated programs replaces Translations.cpp, the native build compiles it and the VM executes a
+ * 				translation instead of interpreting the program if the loaded program is equal (see Translation.h).
+ *
+ * 				Every straight-line run of instructions becomes a labeled block which charges the step budget once:
+ * 				arithmetic, logic, LOAD, COMPARE and ADDCOMPARE call the operations of the kernels (Operations.h) with
+ * 				memory addresses, registers and literals as template arguments, JUMP and COMPARE become gotos, HALT halts
+ * 				the VM. Memory operands the verifier proved unshared are accessed without sequence lock, those always
+ * 				accessed with the same address and type are kept in local cells (registers) while the translation runs. Other
+ * 				instructions, instructions without kernel and, without Harvard mode, instructions which write into the
+ * 				code region leave the translation and are executed by the interpreter.
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+#ifndef INCLUDES_TRANSLATOR_H_
+#define INCLUDES_TRANSLATOR_H_
+
+#include "CalculationVM.h"
+
+#ifdef VM_TOOLCHAIN
+
+///Maximum number of programs of one source
+#define TRANSLATOR_PROGRAMS			(16)
+///Maximum length of the name of a translated program
+#define TRANSLATOR_NAME_LENGTH		(23)
+///Maximum length of an error message
+#define TRANSLATOR_ERROR_LENGTH		(64)
+///Maximum number of unshared memory operands of one program kept in local cells
+#define TRANSLATOR_CELLS			(16)
+
+/**
+ * Unshared memory operand of a translated program kept in a local cell.
+ */
+typedef struct {
+	uint16_t address;
+	///VM_OPERAND_TYPE_*
+	uint8_t type;
+	///Stored by a translated instruction, written back when the translated program is left
+	bool written;
+	///Also accessed with another address or type, stays in memory
+	bool conflict;
+} translator_cell_t;
+
+class Translator
+{
+public:
+	Translator(char* source, uint32_t size);
+	~Translator(void) { }
+
+	bool translate(VM* vm, const char* name);
+	uint32_t finish(void);
+	/**
+	 * @return First error, empty if all programs were translated.
+	 */
+	const char* getError(void) const {return error;}
+	/**
+	 * @return Instructions of the last translated program.
+	 */
+	uint16_t getInstructions(void) const {return instructions;}
+	/**
+	 * @return Instructions of the last translated program which are executed by the interpreter.
+	 */
+	uint16_t getInterpreted(void) const {return interpreted;}
+
+private:
+	char* source;
+	uint32_t size;
+	uint32_t length;
+	char names[TRANSLATOR_PROGRAMS][TRANSLATOR_NAME_LENGTH + 1];
+	uint8_t programcount;
+	uint16_t instructions;
+	uint16_t interpreted;
+	///First instructions of the blocks of the program being translated
+	uint8_t leaders[(MEMORY_CODE_REGION + 7) / 8];
+	///Unshared memory operands of the program being translated
+	translator_cell_t cells[TRANSLATOR_CELLS];
+	uint8_t cellcount;
+	char error[TRANSLATOR_ERROR_LENGTH];
+
+	bool append(const char* format, ...) __attribute__((format(printf, 2, 3)));
+	bool fail(const char* message);
+	bool prologue(void);
+	void sweep(VM* vm, vm_instruction_t* in, uint16_t pc, uint16_t codesize);
+	void findLeaders(VM* vm, uint16_t codesize);
+	void markLeader(uint16_t pc);
+	bool leader(uint16_t pc) const;
+	void findCells(VM* vm, uint16_t codesize);
+	void addCell(uint16_t address, uint8_t type, bool written);
+	int16_t cell(uint16_t address, uint8_t type) const;
+	bool cellsource(void);
+	uint16_t blocklength(VM* vm, uint16_t pc, uint16_t codesize);
+	bool translatable(const vm_instruction_t& in, uint16_t codesize);
+	static bool endsblock(uint8_t opcode);
+	bool block(const vm_instruction_t& in, uint16_t remaining);
+	bool destinationoperand(const vm_instruction_t& in);
+	bool sourceoperand(const vm_instruction_t& in, bool literal);
+	bool memoryoperand(uint16_t address, uint8_t optype);
+	static uint8_t width(uint8_t type);
+	bool writescode(const vm_instruction_t& in, uint16_t codesize);
+	static const char* operandtype(uint8_t optype);
+	static const char* operation(uint8_t opcode);
+
+	Translator(const Translator&);
+	Translator& operator=(const Translator&);
+};
+
+#endif /* VM_TOOLCHAIN */
+
+#endif /* INCLUDES_TRANSLATOR_H_ */
@@ -14,8 +14,10 @@
 #ifndef INCLUDES_URL_MAPPING_H_
 #define INCLUDES_URL_MAPPING_H_
 
-///Number of possible URL-Mapings
-#define VM_MEMORY_MAP_SIZE	(16)		//4 Bit id im OPTYPE, könnte auf 5 erweitert werden
+///Number of URL-Map ids of a VM instance. Ids 0 to 14 are coded in the OPTYPE, higher ids as 16Bit operand (see VM_OPTYPE_WIDE_ID)
+#define VM_MEMORY_MAP_SIZE	(256)
+///Number of URL-Maps in a block of the map pool, an instance holds one block for every range of ids it uses (see VM_MAP_POOL_BLOCKS)
+#define VM_MEMORY_MAP_BLOCK	(16)
 
 ///Address used to show that value is not mapped (0xffff is max memory size, it is not useful to place a cstring there)
 #define NO_MAPPING 0xffff
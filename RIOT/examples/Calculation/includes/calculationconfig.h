@@ -7,7 +7,7 @@
  */
 
 /**
- * @brief       Configuration file for the calculation VM. Sets memory size, URL map size, stack size, available PID controllers and the decimal_t type.
+ * @brief       Configuration file for the calculation VM. Sets memory size, URL map size, stack size, available PID controllers, VM instances and the decimal_t type.
  *
  * @author      Mattes Besuden <besuden@uni-bremen.de>
  */
@@ -15,7 +15,10 @@
 #define CALCULATIONCONFIG_H_
 
 
+#ifdef __cplusplus
+//the remaining settings are also used by the C sources (gcoap)
 #include "fixedpoint.h"
+#endif
 
 ///Use fixedpoint math
 #define FIXEDTYPE
@@ -30,6 +33,51 @@
 ///Defines VM-Stack sze
 #define VM_STACK_SIZE			(20)
 
+///Number of 32Bit registers of every VM (register operands, see VM_REGISTER_DESTINATION and VM_REGISTER_OPERAND in Opcodes.h, at most 256)
+#define VM_REGISTERS			(16)
+
+///Use a cache for decoded instructions in the VM (comment out to decode every instruction on each execution)
+#define VM_DECODE_CACHE
+///Defines number of decoded instructions in the cache (must be a power of two)
+#define VM_DECODE_CACHE_SIZE	(32)
+
+///Optimize uploaded programs before they are started, the upload response reports the result (see Optimizer.h, comment out to execute uploads unchanged)
+#define VM_PEEPHOLE
+///Maximum number of rewrites (superinstructions, folded constants, removed dead code) of one run of the optimizer
+#define VM_OPTIMIZER_REWRITES	(32)
+
+#if defined(TESTING) || (defined(BOARD_NATIVE) && (defined(BENCHMARK) || defined(VM_HOST_TOOLCHAIN)))
+///Build the assembler and the compiler of the calculation language (see Assembler.h and Compiler.h), programs are translated on the host
+#define VM_TOOLCHAIN
+///Execute programs translated into native code ahead of time instead of interpreting them (see Translation.h and Translator.h)
+#define VM_TRANSLATIONS
+#endif
+
+///Maximum number of instructions the VM thread executes between checking its message queue
+#define VM_RUN_MAX_STEPS		(256)
+///Maximum time in µs the VM thread executes instructions between checking its message queue
+#define VM_RUN_MAX_US			(2000)
+///Number of instructions between checks of the time budget (must be a power of two)
+#define VM_RUN_TIME_CHECK_INTERVAL	(16)
+///Maximum number of instructions of a translated program between two snapshot windows (see Memory::beginBatch())
+#define VM_TRANSLATION_BATCH		(256)
+
+///VM dispatch engine: switch over the opcodes
+#define VM_DISPATCH_SWITCH		(0)
+///VM dispatch engine: table of handlers indexed by the opcode
+#define VM_DISPATCH_TABLE		(1)
+///VM dispatch engine: direct threaded dispatch with computed goto (GCC only)
+#define VM_DISPATCH_THREADED	(2)
+#ifndef VM_DISPATCH
+#ifdef __GNUC__
+///Defines the dispatch engine of the VM
+#define VM_DISPATCH				VM_DISPATCH_THREADED
+#else
+///Defines the dispatch engine of the VM
+#define VM_DISPATCH				VM_DISPATCH_SWITCH
+#endif
+#endif
+
 #ifdef TESTING
 ///Defines Memory size in Bytes for testing
 #define VM_MEMORY_SIZE			(1024)
@@ -43,6 +91,39 @@
 #endif
 #endif
 
+///Report memory and stack errors with sticky error flags instead of exceptions (allows building with -fno-exceptions, see NO_EXCEPTIONS in Makefile)
+//#define VM_NO_EXCEPTIONS
+
+///Separate code and data address spaces (Harvard mode): bytecode is stored in its own code segment, data addresses start at 0
+//#define VM_HARVARD
+#ifdef VM_HARVARD
+///Defines code segment size in Bytes
+#define VM_CODE_SIZE			(1024)
+#endif
+
+///Number of VM instances executed by the VM thread. Every instance has its own memory (VM_MEMORY_SIZE + URL maps, VM_CODE_SIZE in Harvard mode),
+///stack, decode cache and VM_PID_NUM_AVAILABLE PID controllers, RAM grows linearly with the number of instances (at most 255)
+#define VM_INSTANCES			(2)
+///Number of blocks of VM_MEMORY_MAP_BLOCK URL-Maps shared by the VM instances (at most 254). A block is assigned to an instance
+///when an id of its range is mapped and returns to the pool when the last URL-Map of the block is deleted
+#ifndef VM_MAP_POOL_BLOCKS
+#define VM_MAP_POOL_BLOCKS		(2 * VM_INSTANCES)
+#endif
+///Client URL-Maps push (POST, PUT) their value only if it changed since the last push. Changes of rational values up to
+///the deadband are not pushed (0 pushes every change)
+#ifndef VM_MAP_DEADBAND
+#define VM_MAP_DEADBAND			(0)
+#endif
+
+///Scheduler: runnable instances execute one batch (VM_RUN_MAX_STEPS, VM_RUN_MAX_US) in turn
+#define VM_SCHEDULER_ROUND_ROBIN	(0)
+///Scheduler: the runnable instance with the highest priority executes, instances with equal priority in turn
+#define VM_SCHEDULER_PRIORITY		(1)
+///Defines the scheduler of the VM instances
+#define VM_SCHEDULER			VM_SCHEDULER_ROUND_ROBIN
+///Priority of an instance until it is changed via CoAP (higher value is scheduled first)
+#define VM_PRIORITY_DEFAULT		(0)
+
 ///Thread IPC queue size
 #define RCV_QUEUE_SIZE			(8)
 
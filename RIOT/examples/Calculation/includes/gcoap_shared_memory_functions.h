@@ -8,20 +8,25 @@
 
 /**
  * @brief       Wrapper for coap server written in C. Provides functions to access the shared memory written in C++.
+ * 				Functions which access a memory take the number of the VM instance.
  *
  * @author      Mattes Besuden <besuden@uni-bremen.de>
  */
 #ifndef INCLUDES_GCOAP_SHARED_MEMORY_FUNCTIONS_H_
 #define INCLUDES_GCOAP_SHARED_MEMORY_FUNCTIONS_H_
 
+#include <stdbool.h>
 #include <kernel_types.h>
 #include "URL_Mapping.h"
+#include "calculationconfig.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-void gcoap_store(uint16_t address, uint8_t value);
+void gcoap_store(uint8_t instance, uint16_t address, uint8_t value);
+bool gcoap_storeCode(uint8_t instance, uint16_t address, const uint8_t* data, uint16_t len);
+void gcoap_code_written(uint8_t instance, uint16_t address, uint16_t len);
 //uint8_t gcoap_load(uint16_t address);
 //void gcoap_storeaddress(uint16_t address, uint16_t value);
 //uint16_t gcoap_loadaddress(uint16_t address);
@@ -33,32 +38,47 @@ void gcoap_store(uint16_t address, uint8_t value);
 //const url_map_t* gcoap_getMappings(void);
 //uint8_t gcoap_getMapSize(void);
 
-const unsigned char* gcoap_loadurl(uint16_t address);
+const unsigned char* gcoap_loadurl(uint8_t instance, uint16_t address);
+const unsigned char* gcoap_loadhost(uint8_t instance, const url_map_t* mapping);
+const unsigned char* gcoap_loadresource(uint8_t instance, const url_map_t* mapping);
 
 uint8_t gcoap_check_server_value(uint16_t content_type, uint8_t* payload, unsigned payload_len, size_t max_len);
 
-uint8_t gcoap_load_value(uint16_t content_type, uint8_t* payload, size_t max_len, uint8_t map_id);
-uint8_t gcoap_load_value_text(uint8_t* payload, size_t max_len, uint8_t map_id);
-uint8_t gcoap_load_value_octet(uint8_t* payload, size_t max_len, uint8_t map_id);
+uint8_t gcoap_load_value(uint8_t instance, uint16_t content_type, uint8_t* payload, size_t max_len, uint16_t map_id);
+uint8_t gcoap_load_value_text(uint8_t instance, uint8_t* payload, size_t max_len, uint16_t map_id);
+uint8_t gcoap_load_value_octet(uint8_t instance, uint8_t* payload, size_t max_len, uint16_t map_id);
+uint8_t gcoap_peek_value(uint8_t instance, uint16_t content_type, uint8_t* payload, size_t max_len, uint16_t map_id);
 
-int8_t gcoap_store_value(uint16_t content_type, uint8_t map_id, uint8_t* payload, unsigned payload_len);
-void gcoap_done(uint8_t id);
-void gcoap_error(uint8_t id, uint8_t errorcode);
+int8_t gcoap_store_value(uint8_t instance, uint16_t content_type, uint16_t map_id, uint8_t* payload, unsigned payload_len);
+void gcoap_done(uint8_t instance, uint16_t id);
+void gcoap_error(uint8_t instance, uint16_t id, uint8_t errorcode);
+bool gcoap_take_change(uint8_t instance, uint16_t id);
+void gcoap_resend(uint8_t instance, uint16_t id);
 
-const url_map_t* gcoap_get_mappings(void);
-uint8_t gcoap_get_map_size(void);
+url_map_t gcoap_get_mapping(uint8_t instance, uint16_t id);
+uint16_t gcoap_next_mapping(uint8_t instance, uint16_t id);
+uint16_t gcoap_next_client_mapping(uint8_t instance, uint16_t id);
+uint16_t gcoap_next_server_mapping(uint8_t instance, uint16_t id);
+uint16_t gcoap_get_map_count(uint8_t instance);
+uint16_t gcoap_get_map_size(void);
 
-void gcoap_get_resource(const url_map_t* mapping, char* buf);
-void gcoap_get_host(const url_map_t* mapping, char* buf);
+void gcoap_get_resource(uint8_t instance, const url_map_t* mapping, char* buf);
+void gcoap_get_host(uint8_t instance, const url_map_t* mapping, char* buf);
 uint8_t gcoap_fromHex(char first, char second);
 uint8_t ascii2hex(char inChar);
-const uint8_t* gcoap_dumpMemory(void);
-uint16_t gcoap_dumpSize(void);
+const uint8_t* gcoap_dumpMemory(uint8_t instance);
+bool gcoap_snapshotMemory(uint8_t instance, uint16_t address, uint8_t* buf, uint16_t len);
+bool gcoap_snapshotCode(uint8_t instance, uint16_t address, uint8_t* buf, uint16_t len);
+uint16_t gcoap_codeSize(uint8_t instance);
+uint16_t gcoap_codeCapacity(uint8_t instance);
+uint16_t gcoap_dumpSize(uint8_t instance);
 
-size_t gcoap_statusVM(uint8_t* buf, size_t buf_len, kernel_pid_t vm_thread_pid);
+size_t gcoap_statusVM(uint8_t instance, uint8_t* buf, size_t buf_len, kernel_pid_t vm_thread_pid);
+size_t gcoap_optimized(uint8_t instance, uint16_t before, uint16_t cycles, uint8_t* buf, size_t buf_len);
+size_t gcoap_optimizeVM(uint8_t instance, uint8_t* buf, size_t buf_len, kernel_pid_t vm_thread_pid);
 size_t gcoap_statusMemory(uint8_t* buf, size_t buf_len);
-size_t gcoap_statusMappings(uint8_t* buf, size_t buf_len);
-size_t gcoap_statusPID(uint8_t* buf, size_t buf_len);
+size_t gcoap_statusMappings(uint8_t instance, uint8_t* buf, size_t buf_len);
+size_t gcoap_statusPID(uint8_t instance, uint8_t* buf, size_t buf_len);
 
 #ifdef __cplusplus
 }
@@ -55,7 +55,7 @@ inline void add_global_address(void)
 	}
 }
 
-#ifndef TESTING
+#if !defined(TESTING) && !defined(BENCHMARK)
 /**
  * Entry point for calculation VM device. Starts VM and PID thread, initializes gcoap client and server.
  * @return exit code
@@ -89,7 +89,7 @@ int main(void)
 	//work is done
 	return 0;
 }
-#else
+#elif defined(TESTING)
 #include "Opcodes.h"
 #include "tests/Tests.h"
 /**
@@ -109,4 +109,27 @@ int main(void)
 	Memory::instance().clear();
 	exit(0);
 }
+#else
+#include "benchmarks/Benchmarks.h"
+/**
+ * Main function for benchmarks
+ * @return exit code
+ */
+int main(void)
+{
+	puts("Calculation VM Benchmarks");
+	printf("You are running RIOT on a(n) %s board.\n", RIOT_BOARD);
+	printf("This board features a(n) %s MCU.\n", RIOT_MCU);
+
+#ifdef BENCHMARK_OPCODES
+	run_opcode_benchmarks();
+#elif defined(BENCHMARK_MAPS)
+	run_map_benchmarks();
+#else
+	run_benchmarks();
+#endif
+	//clear Memory after benchmarks
+	Memory::instance().clear();
+	exit(0);
+}
 #endif
@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Tests for Assembler.h
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+#ifndef TESTS_TESTASSEMBLER_H_
+#define TESTS_TESTASSEMBLER_H_
+
+#include "Tests.h"
+#include "Assembler.h"
+
+#ifdef VM_TOOLCHAIN
+
+///Same program as heater_simulation_short in TestExamples.h
+static const uint8_t test_heater_simulation_short[] = {
+		VM_INSTRUCTION_URLMAP, 0x00 | VM_OPERAND_TYPE_DEC, VM_MAP_OPTION_RESOURCE_LITERAL | VM_MAP_OPTION_URL_LITERAL | VM_MAP_OPTION_DIRECTION_CLIENT | VM_MAP_OPTION_METHOD_GET | VM_MAP_OPTION_LIFETIME_EVER ,0x70 , 0x00, 0x00, 0x00, 'a', 'f', 'f', 'e', ':', ':', '1', 0x00, '/', 's', 'e', 'n', 's', 'o', 'r', 0x00,
+		VM_INSTRUCTION_URLMAP, 0x10 | VM_OPERAND_TYPE_DEC, VM_MAP_OPTION_RESOURCE_LITERAL | VM_MAP_OPTION_URL_ADDRESS | VM_MAP_OPTION_DIRECTION_CLIENT | VM_MAP_OPTION_METHOD_GET | VM_MAP_OPTION_LIFETIME_EVER ,0x74 , 0x00, 0x00, 0x00, 0x07, 0x00, '/', 's', 'e', 't', 'p', 'o', 'i', 'n', 't', 0x00,
+		VM_INSTRUCTION_URLMAP, 0x20 | VM_OPERAND_TYPE_DEC, VM_MAP_OPTION_RESOURCE_LITERAL | VM_MAP_OPTION_URL_ADDRESS | VM_MAP_OPTION_DIRECTION_CLIENT | VM_MAP_OPTION_METHOD_POST | VM_MAP_OPTION_LIFETIME_EVER ,0x78 , 0x00, 0x00, 0x00, 0x07, 0x00, '/', 'h', 'e', 'a', 't', 'e', 'r', 0x00,
+		VM_INSTRUCTION_PIDINIT, 0x00, 0x70, 0x00, 0x78, 0x00, 0x74, 0x00, 0x00, 0x14, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0xe8, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x64, 0x00, 0x00, 0x00,
+		VM_INSTRUCTION_PIDRUN, 0x00,
+		VM_INSTRUCTION_HALT
+};
+
+inline void test_Assembler_heater()
+{
+	const char* source =
+			"; heater simulation\n"
+			".equ temperature 0x70\n"
+			"sensor:	URLMAP.dec 0, client|get|ever, @temperature, 0, \"affe::1\", \"/sensor\"\n"
+			"		URLMAP.dec 1, client|get|ever, @0x74, 0, @sensor+7, \"/setpoint\"\n"
+			"		URLMAP.dec 2, client|post|ever, @0x78, 0, @sensor+7, \"/heater\"\n"
+			"		PIDINIT 0, @temperature, @0x78, @0x74, #20, #1, #1, #1000, #0, #100, #0\n"
+			"		pidrun 0\n"
+			"		HALT";
+	static uint8_t code[256];
+	static Assembler assembler(code, sizeof(code));
+	uint16_t size = assembler.assemble(source);
+	ASSERT(size == sizeof(test_heater_simulation_short), assembler.getError());
+	ASSERT(memcmp(code, test_heater_simulation_short, size) == 0, "heater simulation assembled wrong");
+}
+
+inline void test_Assembler_loop()
+{
+	const char* source =
+			".equ LIMIT 10\n"
+			".var counter u8\n"
+			".var sum u16 @0x200\n"
+			"	LOAD.u8 @counter, #0\n"
+			"	LOAD r1, #3\n"
+			"	LOAD r2, #0\n"
+			"loop:	ADD.u8 @counter, #1		; counter += 1\n"
+			"	ADD.u16 r2, r1\n"
+			"	COMPARE.u8 @counter, #LIMIT, loop, done, done\n"
+			"	JUMP error\n"
+			"done:	MUL r2, #2\n"
+			"	LOAD.u16 @sum, r2\n"
+			"	HALT\n"
+			"error:	RESET\n";
+	static uint8_t code[256];
+	static Assembler assembler(code, sizeof(code));
+	uint16_t size = assembler.assemble(source);
+	ASSERT(size == 57, assembler.getError());
+#ifdef VM_HARVARD
+	ASSERT(assembler.getAddress("counter") == 0, "variable not placed at the start of the data memory");
+#else
+	ASSERT(assembler.getAddress("counter") == size, "variable not placed behind the code");
+#endif
+	ASSERT(assembler.getAddress("loop") == 19 && assembler.getAddress("sum") == 0x200, "wrong symbols");
+
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	VM vm(mem, PID::instances());
+	vm.setProgram(code, size);
+	ASSERT(vm.verified(), "assembled program not verified");
+	vm.run(1000, 0);
+	ASSERT(vm.halted() && (vm.getStatuscode() & VM_ERROR_MASK) == 0, "assembled program did not halt");
+	ASSERT(mem->load(assembler.getAddress("counter")) == 10, "wrong counter");
+	ASSERT(mem->loadunsigned(0x200) == 60 && vm.getRegister(2) == 60, "wrong sum");
+	mem->clear();
+}
+
+inline void test_Assembler_errors()
+{
+	static uint8_t code[64];
+	static Assembler undefined(code, sizeof(code));
+	ASSERT(undefined.assemble("JUMP start\nHALT\nJUMP nowhere\n") == 0, "undefined label accepted");
+	ASSERT(strcmp(undefined.getError(), "undefined symbol start") == 0 && undefined.getLine() == 1, "wrong error for undefined label");
+
+	static Assembler range(code, sizeof(code));
+	ASSERT(range.assemble("LOAD.u16 @0x100, #1\nLOAD.u8 @0x100, #300\n") == 0 && range.getLine() == 2, "literal out of range accepted");
+
+	static Assembler operands(code, sizeof(code));
+	ASSERT(operands.assemble("ADD.u8 @0x100\n") == 0, "missing operand accepted");
+
+	static Assembler registers(code, sizeof(code));
+	ASSERT(registers.assemble("LOAD r99, #1\n") == 0, "invalid register accepted");
+
+	static Assembler mnemonic(code, sizeof(code));
+	ASSERT(mnemonic.assemble("  ; comment\nNOP\n") == 0 && mnemonic.getLine() == 2, "unknown instruction accepted");
+
+	static Assembler size(code, 4);
+	ASSERT(size.assemble("LOAD @0x100, #1\n") == 0, "program larger than the code buffer accepted");
+
+	static Assembler mapid(code, sizeof(code));
+	ASSERT(mapid.assemble("URLMAPDELETE 256\n") == 0 && strcmp(mapid.getError(), "invalid ID") == 0, "URL-Map id out of range accepted");
+
+	static Assembler pidid(code, sizeof(code));
+	ASSERT(pidid.assemble("PIDRUN 16\n") == 0 && strcmp(pidid.getError(), "invalid ID") == 0, "wide PID id accepted");
+
+	static Assembler wideid(code, sizeof(code));
+	ASSERT(wideid.assemble("URLMAPDELETE 200\nHALT\n") == 5 && code[1] == VM_OPTYPE_WIDE_ID && code[2] == 200 && code[3] == 0, "wide URL-Map id wrong");
+
+	static Assembler lastid(code, sizeof(code));
+	ASSERT(lastid.assemble("URLMAPDELETE 15\nHALT\n") == 5 && code[1] == VM_OPTYPE_WIDE_ID && code[2] == 15 && code[3] == 0, "URL-Map id 15 not wide");
+}
+
+inline void test_Assembler()
+{
+#ifndef TEST_ASSEMBLER_OFF
+	test_Assembler_heater();
+	test_Assembler_loop();
+	test_Assembler_errors();
+#else
+	TESTINFO("Test Assembler off");
+#endif
+}
+
+#else
+inline void test_Assembler()
+{
+	TESTINFO("Test Assembler off (no VM_TOOLCHAIN)");
+}
+#endif /* VM_TOOLCHAIN */
+
+#endif /* TESTS_TESTASSEMBLER_H_ */
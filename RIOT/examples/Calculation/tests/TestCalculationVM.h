@@ -29,10 +29,10 @@ inline void test_CalculationVM_setProgram()
 	VM vm(mem, pids);
 	uint8_t program[] = {0xff, 0xff, 0xff};
 	vm.setProgram(program, 3);
-	ASSERT(mem->load(0x0000) == 0xff, "setProgram address 0x0000 != 0xff");
-	ASSERT(mem->load(0x0001) == 0xff, "setProgram address 0x0001 != 0xff");
-	ASSERT(mem->load(0x0002) == 0xff, "setProgram address 0x0002 != 0xff");
-	ASSERT(mem->load(0x0003) == 0x00, "setProgram address 0x0003 != 0x00");
+	ASSERT(mem->dumpCode()[0x0000] == 0xff, "setProgram address 0x0000 != 0xff");
+	ASSERT(mem->dumpCode()[0x0001] == 0xff, "setProgram address 0x0001 != 0xff");
+	ASSERT(mem->dumpCode()[0x0002] == 0xff, "setProgram address 0x0002 != 0xff");
+	ASSERT(mem->dumpCode()[0x0003] == 0x00, "setProgram address 0x0003 != 0x00");
 	ASSERT(vm.getProgramcounter() == 0, "programcounter wrong");
 
 	ASSERT((vm.getStatuscode() & VM_ERROR_MASK) == 0, "VM shouldnt have an error");
@@ -256,6 +256,23 @@ inline void test_CalculationVM_MOD_unsigned()
 	ASSERT((vm.getStatuscode() & VM_ERROR_MASK) == 0, "VM shouldnt have an error");
 }
 
+inline void test_CalculationVM_MOD_unsigned_zero()
+{
+
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	VM vm(mem, pids);
+	mem->store(0x0010, 2);
+	uint8_t program[] = {VM_INSTRUCTION_MOD, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x10, 0x00, 0x00, VM_INSTRUCTION_HALT};
+	vm.setProgram(program, 6);
+	vm.executeStep();
+	ASSERT(mem->load(0x0010) == 2, "Mod zero unsigned wrong");
+	ASSERT(vm.halted(), "VM not in HALT");
+	ASSERT(vm.errorFlag() == true, "VM should have an error");
+
+	ASSERT(vm.getStatuscode() & VM_ERROR_DIVIDEZERO, "VM should have an errorcode ERROR_DEVIDEZERO");
+}
+
 inline void test_CalculationVM_MOD_decimal()
 {
 
@@ -562,6 +579,9 @@ inline void test_CalculationVM_JUMP()
 	VM vm(mem, pids);
 	uint8_t program[] = {VM_INSTRUCTION_JUMP, VM_LITERAL, 0x05, 0x00, VM_INSTRUCTION_HALT, VM_INSTRUCTION_JUMP, VM_ADDRESS, 0x0a, 0x00, VM_INSTRUCTION_HALT, 0x09, 0x00};
 	vm.setProgram(program, 12);
+#ifdef VM_HARVARD
+	mem->storeaddress(0x000a, 0x0009);//jump address is data
+#endif
 	vm.executeStep();//jumps to address 5
 	ASSERT(vm.getProgramcounter() == 5, "programcounter wrong");
 
@@ -608,6 +628,156 @@ inline void test_CalculationVM_COMPARE()
 	ASSERT((vm.getStatuscode() & VM_ERROR_MASK) == 0, "VM shouldnt have an error");
 }
 
+inline void test_CalculationVM_PUSH_POP()
+{
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	VM vm(mem, pids);
+	uint8_t program[] = {VM_INSTRUCTION_PUSH, VM_OPERAND_TYPE_UINT16 | VM_LITERAL, 0x34, 0x12,
+			VM_INSTRUCTION_PUSH, VM_OPERAND_TYPE_UINT8 | VM_ADDRESS, 0x00, 0x01,
+			VM_INSTRUCTION_POP, VM_OPERAND_TYPE_UINT32, 0x10, 0x01,
+			VM_INSTRUCTION_POP, VM_OPERAND_TYPE_UINT16, 0x14, 0x01, VM_INSTRUCTION_HALT};
+	mem->store(0x0100, 0xab);
+	vm.setProgram(program, sizeof(program));
+	vm.executeStep();
+	vm.executeStep();
+	ASSERT(vm.getOperandStack()->getDepth() == 2, "PUSH did not push");
+	ASSERT(vm.getProgramcounter() == 8, "programcounter wrong");
+	vm.executeStep();
+	ASSERT(mem->loadunsigned(0x0110) == 0xab, "POP stored wrong value (uint8 as uint32)");
+	vm.executeStep();
+	ASSERT(mem->loadaddress(0x0114) == 0x1234, "POP stored wrong value");
+	ASSERT(vm.getOperandStack()->getDepth() == 0, "POP did not pop");
+	ASSERT((vm.getStatuscode() & VM_ERROR_MASK) == 0, "VM shouldnt have an error");
+
+	uint8_t program2[] = {VM_INSTRUCTION_POP, VM_OPERAND_TYPE_UINT16, 0x14, 0x01, VM_INSTRUCTION_HALT};
+	vm.setProgram(program2, sizeof(program2));
+	vm.executeStep();
+	ASSERT((vm.getStatuscode() & VM_ERROR_MASK) == VM_ERROR_STACK, "stack underflow not detected");
+	ASSERT(vm.halted() && vm.errorFlag(), "VM should halt with an error");
+
+	uint8_t program3[] = {VM_INSTRUCTION_PUSH, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x01, VM_INSTRUCTION_JUMP, VM_LITERAL, 0x00, 0x00};
+	vm.setProgram(program3, sizeof(program3));
+	vm.run(2 * VM_STACK_SIZE + 2, 0);
+	ASSERT((vm.getStatuscode() & VM_ERROR_MASK) == VM_ERROR_STACK, "stack overflow not detected");
+	ASSERT(vm.getOperandStack()->getDepth() == VM_STACK_SIZE, "overflow changed the stack");
+}
+
+inline void test_CalculationVM_stack_arithmetic()
+{
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	VM vm(mem, pids);
+	//(7 + 5) * 3 - 6 / 2 = 33
+	uint8_t program[] = {VM_INSTRUCTION_PUSH, VM_OPERAND_TYPE_UINT32 | VM_LITERAL, 0x07, 0x00, 0x00, 0x00,
+			VM_INSTRUCTION_PUSH, VM_OPERAND_TYPE_UINT32 | VM_LITERAL, 0x05, 0x00, 0x00, 0x00,
+			VM_INSTRUCTION_SADD, VM_OPERAND_TYPE_UINT32,
+			VM_INSTRUCTION_PUSH, VM_OPERAND_TYPE_UINT32 | VM_LITERAL, 0x03, 0x00, 0x00, 0x00,
+			VM_INSTRUCTION_SMUL, VM_OPERAND_TYPE_UINT32,
+			VM_INSTRUCTION_PUSH, VM_OPERAND_TYPE_UINT32, 0x00, 0x01,
+			VM_INSTRUCTION_PUSH, VM_OPERAND_TYPE_UINT32 | VM_LITERAL, 0x02, 0x00, 0x00, 0x00,
+			VM_INSTRUCTION_SDIV, VM_OPERAND_TYPE_UINT32,
+			VM_INSTRUCTION_SSUB, VM_OPERAND_TYPE_UINT32,
+			VM_INSTRUCTION_POP, VM_OPERAND_TYPE_UINT32, 0x10, 0x01, VM_INSTRUCTION_HALT};
+	mem->storeunsigned(0x0100, 6);
+	vm.setProgram(program, sizeof(program));
+	vm.run(VM_RUN_MAX_STEPS, 0);
+	ASSERT(vm.halted() && !vm.errorFlag(), "VM should halt without an error");
+	ASSERT(mem->loadunsigned(0x0110) == 33, "wrong result of the stack arithmetic");
+	ASSERT(vm.getOperandStack()->getDepth() == 0, "stack not empty");
+
+	uint8_t program2[] = {VM_INSTRUCTION_PUSH, VM_OPERAND_TYPE_DEC, 0x00, 0x01,
+			VM_INSTRUCTION_PUSH, VM_OPERAND_TYPE_DEC, 0x04, 0x01,
+			VM_INSTRUCTION_SMUL, VM_OPERAND_TYPE_DEC,
+			VM_INSTRUCTION_POP, VM_OPERAND_TYPE_DEC, 0x10, 0x01, VM_INSTRUCTION_HALT};
+	mem->storerational(0x0100, (rational_t)1.5);
+	mem->storerational(0x0104, (rational_t)-2);
+	vm.setProgram(program2, sizeof(program2));
+	vm.run(VM_RUN_MAX_STEPS, 0);
+	ASSERT(mem->loadrational(0x0110) == (rational_t)-3, "wrong result of the decimal stack arithmetic");
+
+	uint8_t program3[] = {VM_INSTRUCTION_PUSH, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x01,
+			VM_INSTRUCTION_PUSH, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x00,
+			VM_INSTRUCTION_SDIV, VM_OPERAND_TYPE_UINT8, VM_INSTRUCTION_HALT};
+	vm.setProgram(program3, sizeof(program3));
+	vm.run(VM_RUN_MAX_STEPS, 0);
+	ASSERT((vm.getStatuscode() & VM_ERROR_MASK) == VM_ERROR_DIVIDEZERO, "division by zero not detected");
+
+	uint8_t program4[] = {VM_INSTRUCTION_PUSH, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x01,
+			VM_INSTRUCTION_SADD, VM_OPERAND_TYPE_UINT8, VM_INSTRUCTION_HALT};
+	vm.setProgram(program4, sizeof(program4));
+	vm.run(VM_RUN_MAX_STEPS, 0);
+	ASSERT((vm.getStatuscode() & VM_ERROR_MASK) == VM_ERROR_STACK, "stack underflow not detected");
+}
+
+inline void test_CalculationVM_SCOMPARE()
+{
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	VM vm(mem, pids);
+	uint8_t program[] = {VM_INSTRUCTION_PUSH, VM_OPERAND_TYPE_UINT16 | VM_LITERAL, 0x02, 0x00,
+			VM_INSTRUCTION_PUSH, VM_OPERAND_TYPE_UINT16, 0x00, 0x01,
+			VM_INSTRUCTION_SCOMPARE, VM_OPERAND_TYPE_UINT16, 0x10, 0x00, 0x11, 0x00, 0x12, 0x00,
+			VM_INSTRUCTION_HALT, VM_INSTRUCTION_HALT, VM_INSTRUCTION_HALT};
+	uint16_t values[] = {1, 2, 3};
+	uint16_t targets[] = {0x12, 0x11, 0x10};//a = 2 compared with b = 1, 2, 3
+	for(uint8_t i = 0; i < 3; i++)
+	{
+		mem->storeaddress(0x0100, values[i]);
+		vm.setProgram(program, sizeof(program));
+		vm.run(3, 0);
+		ASSERT(vm.getProgramcounter() == targets[i], "SCOMPARE, wrong jump address");
+		ASSERT(vm.getOperandStack()->getDepth() == 0, "SCOMPARE did not pop the values");
+	}
+	ASSERT((vm.getStatuscode() & VM_ERROR_MASK) == 0, "VM shouldnt have an error");
+#ifndef VM_HARVARD
+	ASSERT(vm.verify(), "program with SCOMPARE not verified");
+#endif
+}
+
+inline void test_CalculationVM_registers()
+{
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	VM vm(mem, pids);
+	uint8_t rd = VM_REGISTER_DESTINATION, ro = VM_REGISTER_OPERAND;
+	uint8_t program[] = {VM_INSTRUCTION_LOAD, (uint8_t) (VM_OPERAND_TYPE_UINT16 | VM_LITERAL | rd), 0x00, 0x05, 0x00,//r0 = 5
+			VM_INSTRUCTION_LOAD, (uint8_t) (VM_OPERAND_TYPE_UINT16 | rd | ro), 0x01, 0x00,//r1 = r0
+			VM_INSTRUCTION_ADD, (uint8_t) (VM_OPERAND_TYPE_UINT16 | rd | ro), 0x01, 0x00,//r1 += r0
+			VM_INSTRUCTION_ADD, (uint8_t) (VM_OPERAND_TYPE_UINT16 | ro), 0x00, 0x01, 0x01,//[0x0100] += r1
+			VM_INSTRUCTION_COMPARE, (uint8_t) (VM_OPERAND_TYPE_UINT16 | VM_LITERAL | rd), 0x01, 0x0a, 0x00, 0x1d, 0x00, 0x1e, 0x00, 0x1d, 0x00,//r1 == 10
+			VM_INSTRUCTION_HALT,
+			VM_INSTRUCTION_NOT, (uint8_t) (VM_OPERAND_TYPE_UINT16 | rd), 0x02,//r2 = ~r2
+			VM_INSTRUCTION_HALT};
+	mem->storeaddress(0x0100, 1);
+	vm.setProgram(program, sizeof(program));
+	vm.executeStep();
+	ASSERT(vm.getRegister(0) == 5, "LOAD of a literal into a register");
+	vm.executeStep();
+	ASSERT(vm.getRegister(1) == 5, "LOAD of a register into a register");
+	vm.executeStep();
+	ASSERT(vm.getRegister(1) == 10, "ADD of two registers");
+	vm.executeStep();
+	ASSERT(mem->loadaddress(0x0100) == 11, "ADD of a register to memory");
+	vm.executeStep();
+	ASSERT(vm.getProgramcounter() == 0x1e, "COMPARE of a register, wrong jump address");
+	vm.executeStep();
+	ASSERT(vm.getRegister(2) == 0xffff, "NOT of a register");
+	ASSERT((vm.getStatuscode() & VM_ERROR_MASK) == 0, "VM shouldnt have an error");
+#ifndef VM_HARVARD
+	ASSERT(vm.verify(), "program with registers not verified");
+#endif
+
+	uint8_t program2[] = {VM_INSTRUCTION_LOAD, (uint8_t) (VM_OPERAND_TYPE_UINT8 | VM_LITERAL | rd), VM_REGISTERS, 0x01};
+	vm.setProgram(program2, sizeof(program2));
+#ifndef VM_HARVARD
+	ASSERT(!vm.verify(), "program with a missing register verified");
+#endif
+	vm.executeStep();
+	ASSERT((vm.getStatuscode() & VM_ERROR_MASK) == VM_ERROR_UNSUPPORTED_OPERAND, "missing register not reported");
+	mem->clear();
+}
+
 inline void test_CalculationVM_CALL_RETURN()
 {
 	Memory* mem = &Memory::instance();
@@ -641,6 +811,25 @@ inline void test_CalculationVM_CALL_RETURN()
 	ASSERT((vm.getStatuscode() & VM_ERROR_MASK) == 0, "VM shouldnt have an error");
 }
 
+inline void test_CalculationVM_stack_error()
+{
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	VM vm(mem, pids);
+	uint8_t program[] = {VM_INSTRUCTION_CALL, 0x00, 0x00};//endless recursion
+	vm.setProgram(program, 3);
+	vm.run(VM_STACK_SIZE + 1, 0);
+	ASSERT(vm.halted(), "VM not in HALT after stack overflow");
+	ASSERT((vm.getStatuscode() & VM_ERROR_MASK) == VM_ERROR_STACK, "VM should have an errorcode ERROR_STACK (overflow)");
+	ASSERT(vm.getStack()->isFull(), "Stack should be full");
+
+	uint8_t program2[] = {VM_INSTRUCTION_RETURN};
+	vm.setProgram(program2, 1);
+	vm.run(1, 0);
+	ASSERT(vm.halted(), "VM not in HALT after stack underflow");
+	ASSERT((vm.getStatuscode() & VM_ERROR_MASK) == VM_ERROR_STACK, "VM should have an errorcode ERROR_STACK (underflow)");
+}
+
 inline void test_CalculationVM_TIME()
 {
 	Memory* mem = &Memory::instance();
@@ -677,6 +866,29 @@ inline void test_CalculationVM_COMPARETIME()
 	ASSERT((vm.getStatuscode() & VM_ERROR_MASK) == 0, "VM shouldnt have an error");
 }
 
+inline void test_CalculationVM_SLEEPUNTIL()
+{
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	VM vm(mem, pids);
+	uint8_t program[] = {VM_INSTRUCTION_TIME, 0x20, 0x00, VM_INSTRUCTION_SLEEPUNTIL, 0x20, 0x00, 0x0a, 0x00, 0x00, 0x00, VM_INSTRUCTION_HALT};
+	vm.setProgram(program, 11);
+	vm.run(VM_RUN_MAX_STEPS, 0);//TIME is a yield point
+	ASSERT(vm.run(VM_RUN_MAX_STEPS, 0) == 1, "SLEEPUNTIL should end the batch");
+	ASSERT(vm.waiting(), "VM should wait for 10ms");
+	ASSERT(vm.getProgramcounter() == 10, "programcounter wrong");
+	uint32_t remaining = 0;
+	ASSERT(vm.getWakeupTime(&remaining) && remaining > 0 && remaining <= 10000, "wrong wakeup time");
+	ASSERT(!vm.wakeable(), "VM should not be wakeable before the timeout");
+	ASSERT(vm.run(VM_RUN_MAX_STEPS, 0) == 0, "waiting VM executed instructions");
+	xtimer_usleep(11000);
+	ASSERT(vm.wakeable(), "VM should be wakeable after the timeout");
+	vm.run(VM_RUN_MAX_STEPS, 0);
+	ASSERT(!vm.waiting() && vm.halted(), "VM did not continue after the timeout");
+
+	ASSERT((vm.getStatuscode() & VM_ERROR_MASK) == 0, "VM shouldnt have an error");
+}
+
 inline void test_CalculationVM_PID_init()
 {
 
@@ -744,6 +956,35 @@ inline void test_CalculationVM_PID_clear()
 	ASSERT((vm.getStatuscode() & VM_ERROR_MASK) == 0, "VM shouldnt have an error");
 }
 
+inline void test_CalculationVM_PIDWAIT()
+{
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	VM vm(mem, pids);
+	uint8_t program[] = {VM_INSTRUCTION_PIDWAIT, 0x10, VM_INSTRUCTION_HALT};
+	vm.setProgram(program, 3);
+	vm.run(VM_RUN_MAX_STEPS, 0);
+	ASSERT(!vm.waiting(), "VM should not wait for a stopped PID");
+	vm.run(VM_RUN_MAX_STEPS, 0);
+	ASSERT(vm.halted(), "VM did not continue");
+
+	pids[1].init(mem, 0x0010, 0x0014, 0x0018, (rational_t)1, (rational_t)0, (rational_t)0, 100, PID_DIRECTION_DIRECT, (rational_t)0, (rational_t)255);
+	pids[1].setMode(PID_AUTOMATIC);
+	vm.setProgram(program, 3);
+	vm.run(VM_RUN_MAX_STEPS, 0);
+	ASSERT(vm.waiting() && !vm.wakeable(), "VM should wait for the PID");
+	ASSERT(pids[1].compute(), "PID did not compute");//first computation does not wait for the sample time
+	ASSERT(vm.wakeable(), "VM should be wakeable after the computation");
+	vm.run(VM_RUN_MAX_STEPS, 0);
+	ASSERT(vm.halted(), "VM did not continue after the computation");
+	pids[1].clear();
+
+	uint8_t program2[] = {VM_INSTRUCTION_PIDWAIT, VM_PID_NUM_AVAILABLE << 4, VM_INSTRUCTION_HALT};
+	vm.setProgram(program2, 3);
+	vm.run(VM_RUN_MAX_STEPS, 0);
+	ASSERT((vm.getStatuscode() & VM_ERROR_MASK) == VM_ERROR_ID_UNAVAILABLE, "unavailable PID id not detected");
+}
+
 inline void test_CalculationVM_URLMAP()
 {
 
@@ -755,9 +996,9 @@ inline void test_CalculationVM_URLMAP()
 	};
 	vm.setProgram(program, 36);
 	vm.executeStep();
-	const unsigned char* temp = mem->loadurl((mem->dumpMap())[0].url_address);
+	const unsigned char* temp = mem->loadcodestring(mem->getMap(0).url_address);
 	const char* address = "fd00::feaa:1234:123";
-	const unsigned char* temp2 = mem->loadurl((mem->dumpMap())[0].resource_address);
+	const unsigned char* temp2 = mem->loadcodestring(mem->getMap(0).resource_address);
 	const char* resource = "/sensor";
 	ASSERT(strcmp((const char*)temp, (const char*)address) == 0, "URL mapping wrong");
 	ASSERT(strcmp((const char*)temp2, (const char*)resource) == 0, "Resource mapping wrong");
@@ -795,7 +1036,7 @@ inline void test_CalculationVM_URLMAPCHECK()
 	vm.executeStep();
 	ASSERT(mem->load(0x0006) & VM_MAP_STATUS_DONE, "Mapcheck should be true");
 	ASSERT(vm.getProgramcounter() == 4, "programcounter wrong");
-	ASSERT(mem->dumpMap()[0].url_address == NO_MAPPING, "Map should be deleted after done when lifetime is once");
+	ASSERT(mem->getMap(0).url_address == NO_MAPPING, "Map should be deleted after done when lifetime is once");
 
 	ASSERT((vm.getStatuscode() & VM_ERROR_MASK) == 0, "VM shouldnt have an error");
 }
@@ -810,12 +1051,70 @@ inline void test_CalculationVM_URLMAPDELETE()
 	//we assume there is a mapping in memory
 	mem->map(0, VM_OPERAND_TYPE_UINT16, VM_MAP_OPTION_LIFETIME_ONCE | VM_MAP_OPTION_URL_LITERAL | VM_MAP_OPTION_DIRECTION_CLIENT | VM_MAP_OPTION_METHOD_GET, 0x0020, 0, 0x0030, 0x0032);//actually not working, but irrelevant for MAPCHECK
 	vm.executeStep();
-	ASSERT(mem->dumpMap()[0].url_address == NO_MAPPING, "Map should be deleted");
+	ASSERT(mem->getMap(0).url_address == NO_MAPPING, "Map should be deleted");
 	ASSERT(vm.getProgramcounter() == 2, "programcounter wrong");
 
 	ASSERT((vm.getStatuscode() & VM_ERROR_MASK) == 0, "VM shouldnt have an error");
 }
 
+inline void test_CalculationVM_URLMAP_wide()
+{
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	VM vm(mem, pids);
+	uint8_t program[] = {VM_INSTRUCTION_URLMAP, VM_OPTYPE_WIDE_ID | VM_OPERAND_TYPE_UINT32, 200, 0x00, VM_MAP_OPTION_METHOD_GET | VM_MAP_OPTION_DIRECTION_CLIENT,
+			0x30, 0x00, 0x00, 0x00, 0x40, 0x00, 0x50, 0x00,
+			VM_INSTRUCTION_URLMAPCHECK, VM_OPTYPE_WIDE_ID, 200, 0x00, 0x06, 0x00,
+			VM_INSTRUCTION_URLMAPDELETE, VM_OPTYPE_WIDE_ID, 200, 0x00,
+			VM_INSTRUCTION_URLMAP, VM_OPTYPE_WIDE_ID, VM_MEMORY_MAP_SIZE & 0xff, VM_MEMORY_MAP_SIZE >> 8, 0,
+			0x30, 0x00, 0x00, 0x00, 0x40, 0x00, 0x50, 0x00,
+			VM_INSTRUCTION_HALT
+	};
+	vm.setProgram(program, sizeof(program));
+	vm.executeStep();
+	ASSERT(mem->getMap(200).value_address == 0x0030 && mem->getMap(200).resource_address == 0x0050, "wide URL mapping wrong");
+	ASSERT(mem->getMap(200).optype == VM_OPERAND_TYPE_UINT32, "wide URL mapping type wrong");
+	ASSERT(vm.getProgramcounter() == 13, "programcounter wrong");
+	mem->store(0x0006, 0xff);
+	vm.executeStep();
+	ASSERT(mem->load(0x0006) == 0 && vm.getProgramcounter() == 19, "wide URL mapping check wrong");
+	vm.executeStep();
+	ASSERT(mem->getMap(200).status == VM_MAP_STATUS_NO_MAPPING && mem->getMapCount() == 0, "wide URL mapping not deleted");
+	ASSERT(vm.getProgramcounter() == 23, "programcounter wrong");
+	ASSERT((vm.getStatuscode() & VM_ERROR_MASK) == 0, "VM shouldnt have an error");
+	vm.executeStep();
+	ASSERT((vm.getStatuscode() & VM_ERROR_MASK) == VM_ERROR_ID_UNAVAILABLE, "unavailable URL-Map id not detected");
+	mem->clear();
+}
+
+inline void test_CalculationVM_URLMAPWAIT()
+{
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	VM vm(mem, pids);
+	uint8_t program[] = {VM_INSTRUCTION_URLMAPWAIT, 0x00, VM_INSTRUCTION_HALT};
+	vm.setProgram(program, 3);
+	vm.run(VM_RUN_MAX_STEPS, 0);
+	ASSERT(!vm.waiting(), "VM should not wait for a missing mapping");
+	vm.run(VM_RUN_MAX_STEPS, 0);
+	ASSERT(vm.halted(), "VM did not continue");
+
+	mem->map(0, VM_OPERAND_TYPE_UINT16, VM_MAP_OPTION_LIFETIME_ONCE | VM_MAP_OPTION_URL_LITERAL | VM_MAP_OPTION_DIRECTION_CLIENT | VM_MAP_OPTION_METHOD_GET, 0x0020, 0, 0x0030, 0x0032);
+	vm.setProgram(program, 3);
+	vm.run(VM_RUN_MAX_STEPS, 0);
+	ASSERT(vm.waiting() && !vm.wakeable(), "VM should wait for the mapping");
+	ASSERT(vm.run(VM_RUN_MAX_STEPS, 0) == 0, "waiting VM executed instructions");
+	uint32_t remaining;
+	ASSERT(!vm.getWakeupTime(&remaining), "VM should not wait for time");
+	mem->map_error(0, VM_MAP_STATUS_ERROR_TIMEOUT);
+	ASSERT(vm.wakeable(), "VM should be wakeable after the mapping failed");
+	vm.run(VM_RUN_MAX_STEPS, 0);
+	ASSERT(vm.halted(), "VM did not continue after the mapping failed");
+	ASSERT(mem->checkmap(0, false) & VM_MAP_STATUS_ERROR_TIMEOUT, "URLMAPWAIT changed the mapping");
+
+	ASSERT((vm.getStatuscode() & VM_ERROR_MASK) == 0, "VM shouldnt have an error");
+}
+
 inline void test_CalculationVM_HALT()
 {
 	//Although implicitlydone in all other test here is an explicit HALT instruction test
@@ -849,6 +1148,210 @@ inline void test_CalculationVM_RESET()
 	ASSERT(vm.getStatuscode() & VM_ERROR_RESET, "VM have a suicide error");
 }
 
+inline void test_CalculationVM_code_write()
+{
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	VM vm(mem, pids);
+	uint8_t program[] = {VM_INSTRUCTION_ADD, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x20, 0x00, 0x01, VM_INSTRUCTION_JUMP, VM_LITERAL, 0x00, 0x00, VM_INSTRUCTION_HALT};
+	vm.setProgram(program, 10);
+	for(uint8_t i = 0; i < 4; i++)//loop twice, instructions are decoded
+	{
+		vm.executeStep();
+	}
+	ASSERT(vm.getProgramcounter() == 0, "programcounter wrong");
+	ASSERT(mem->load(0x0020) == 2, "ADD wrong");
+
+	mem->store(0x0007, 0x09);//change jump address to HALT
+	vm.executeStep();
+	vm.executeStep();
+	ASSERT(vm.getProgramcounter() == 9, "changed jump address not executed");
+	vm.executeStep();
+	ASSERT(vm.halted(), "VM not in HALT");
+
+	uint8_t program2[] = {VM_INSTRUCTION_JUMP, VM_LITERAL, 0x04, 0x00,
+			VM_INSTRUCTION_LOAD, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x02, 0x00, 0x0d,//program changes its own jump address
+			VM_INSTRUCTION_JUMP, VM_LITERAL, 0x00, 0x00, VM_INSTRUCTION_HALT};
+	vm.setProgram(program2, 14);
+	for(uint8_t i = 0; i < 4; i++)
+	{
+		vm.executeStep();
+	}
+	ASSERT(vm.getProgramcounter() == 13, "jump address changed by program not executed");
+
+	ASSERT((vm.getStatuscode() & VM_ERROR_MASK) == 0, "VM shouldnt have an error");
+}
+
+#ifdef VM_HARVARD
+inline void test_CalculationVM_harvard()
+{
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	VM vm(mem, pids);
+	uint8_t program[] = {VM_INSTRUCTION_LOAD, VM_OPERAND_TYPE_UINT32 | VM_LITERAL, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff,//data starts at 0
+			VM_INSTRUCTION_ADD, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x04, 0x00, 0x01, VM_INSTRUCTION_HALT};
+	vm.setProgram(program, 14);
+	uint32_t codeversion = mem->getCodeVersion();
+	vm.run(10, 0);
+	ASSERT(vm.halted() && !vm.errorFlag(), "VM should be halted without error");
+	ASSERT(mem->loadunsigned(0x0000) == 0xffffffff, "data at address 0 wrong");
+	ASSERT(mem->load(0x0004) == 1, "ADD wrong");
+	ASSERT(mem->dumpCode()[0] == VM_INSTRUCTION_LOAD, "code overwritten by data");
+	ASSERT(mem->getCodeVersion() == codeversion, "data write changed the code version");
+
+	mem->clear();//data only
+	ASSERT(mem->dumpCode()[0] == VM_INSTRUCTION_LOAD, "code segment cleared with data");
+	vm.clear();
+	vm.run(10, 0);
+	ASSERT(mem->load(0x0004) == 1, "program not executed after data reset");
+
+	uint8_t program2[VM_CODE_SIZE + 1] = {VM_INSTRUCTION_HALT};
+	ASSERT(!mem->storeCode(0, program2, sizeof(program2)), "program larger than code segment stored");
+}
+#endif
+
+inline void test_CalculationVM_run()
+{
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	VM vm(mem, pids);
+	uint8_t program[] = {VM_INSTRUCTION_ADD, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x20, 0x00, 0x01, VM_INSTRUCTION_JUMP, VM_LITERAL, 0x00, 0x00};
+	vm.setProgram(program, 9);
+	ASSERT(vm.run(10, 0) == 10, "step budget not used");
+	ASSERT(mem->load(0x0020) == 5, "ADD wrong");
+	ASSERT(vm.getProgramcounter() == 0, "programcounter wrong");
+	ASSERT(!vm.halted(), "VM should not be in halt state");
+	ASSERT(vm.run(UINT32_MAX, 1000) > 0, "time budget not used");
+	ASSERT(!vm.halted(), "VM should not be in halt state");
+
+	uint8_t program2[] = {VM_INSTRUCTION_ADD, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x20, 0x00, 0x01,
+			VM_INSTRUCTION_TIME, 0x24, 0x00, VM_INSTRUCTION_HALT};
+	vm.setProgram(program2, 9);
+	ASSERT(vm.run(10, 0) == 2, "TIME should end the batch");
+	ASSERT(vm.getProgramcounter() == 8, "programcounter wrong");
+	ASSERT(vm.run(10, 0) == 1, "HALT should end the batch");
+	ASSERT(vm.halted(), "VM not in HALT");
+	ASSERT(vm.run(10, 0) == 0, "halted VM executed instructions");
+
+	uint8_t program3[] = {VM_INSTRUCTION_DIV, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x20, 0x00, 0x00, VM_INSTRUCTION_HALT};
+	vm.setProgram(program3, 6);
+	ASSERT(vm.run(10, 0) == 1, "error should end the batch");
+	ASSERT(vm.halted() && vm.errorFlag(), "VM should be halted with error");
+	ASSERT((vm.getStatuscode() & VM_ERROR_MASK) == VM_ERROR_DIVIDEZERO, "VM should have a divide by zero error");
+}
+
+inline void test_CalculationVM_program_image()
+{
+	static const uint8_t image[] = {VM_INSTRUCTION_ADD, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x40, 0x00, 0x01,
+			VM_INSTRUCTION_COMPARE, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x40, 0x00, 0x03, 0x00, 0x00, 0x10, 0x00, 0x10, 0x00,
+			VM_INSTRUCTION_MULTILOAD, VM_OPERAND_TYPE_UINT16 | VM_LITERAL, 0x42, 0x00, 0x02, 0x34, 0x12, 0x78, 0x56,
+			VM_INSTRUCTION_HALT};
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	VM vm(mem, pids);
+	ProgramImage program(image, sizeof(image));
+	vm.setProgramImage(program);
+	ASSERT(mem->getCodeImage() == image, "program image not set");
+	ASSERT(mem->getCodeSize() == sizeof(image), "code size of program image wrong");
+	ASSERT(vm.verified(), "program image should be verified");
+	vm.run(100, 0);
+	ASSERT(vm.halted() && !vm.errorFlag(), "VM should be halted without error");
+	ASSERT(mem->load(0x40) == 3, "ADD from program image wrong");
+	ASSERT(mem->loadaddress(0x42) == 0x1234 && mem->loadaddress(0x44) == 0x5678, "MULTILOAD from program image wrong");
+	for(uint16_t i = 0; i < sizeof(image); i++)
+	{
+		ASSERT(mem->load(i) == 0, "program image copied into memory");
+	}
+	ASSERT(mem->loadcodestring(0x10) == image + 0x10, "string literal not read from program image");
+
+	mem->clear();//data only
+	vm.setProgramImage(program);
+	vm.run(100, 0);
+	ASSERT(mem->load(0x40) == 3, "program image lost after clear");
+
+	uint8_t program2[] = {VM_INSTRUCTION_HALT};
+	vm.setProgram(program2, 1);
+	ASSERT(mem->getCodeImage() == 0, "program image not detached by setProgram");
+	ASSERT(mem->dumpCode()[0] == VM_INSTRUCTION_HALT, "setProgram did not store program");
+}
+
+inline void test_CalculationVM_setProgram_too_large()
+{
+	static uint8_t program[MEMORY_CODE_REGION + 1];
+	memset(program, VM_INSTRUCTION_HALT, sizeof(program));
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	VM vm(mem, pids);
+	uint8_t program2[] = {VM_INSTRUCTION_HALT};
+	ASSERT(vm.setProgram(program2, 1), "setProgram failed");
+	ASSERT(!vm.setProgram(program, sizeof(program)), "program larger than the code region stored");
+	ASSERT(mem->getCodeSize() == 1, "code size changed by a failed setProgram");
+	ASSERT(vm.halted() && vm.errorFlag(), "VM should be halted with error");
+	ASSERT((vm.getStatuscode() & VM_ERROR_MASK) == VM_ERROR_MEMORY_EXCEPTION, "VM should have a memory error");
+	mem->clear();
+}
+
+inline void test_CalculationVM_verify_large_image()
+{
+	static uint8_t image[MEMORY_CODE_REGION + 1024];//larger than the bitmap of the verifier
+	memset(image, VM_INSTRUCTION_HALT, sizeof(image));
+	image[sizeof(image) - 1] = 0xAA;//guard
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	VM vm(mem, pids);
+	vm.setProgramImage(image, sizeof(image));
+	ASSERT(mem->getCodeSize() == sizeof(image), "code size of large program image wrong");
+	ASSERT(!vm.verified(), "program image larger than the code region should not be verified");
+	vm.run(10, 0);
+	ASSERT(vm.halted() && !vm.errorFlag(), "large program image should halt without error");
+	ASSERT(image[sizeof(image) - 1] == 0xAA, "program image changed");
+	vm.setProgramImage(0, 0);
+	mem->clear();
+}
+
+inline void test_CalculationVM_verify()
+{
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	VM vm(mem, pids);
+	uint8_t program[] = {VM_INSTRUCTION_ADD, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x20, 0x00, 0x01,
+			VM_INSTRUCTION_COMPARE, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x20, 0x00, 0x03, 0x00, 0x00, 0x10, 0x00, 0x10, 0x00,
+			VM_INSTRUCTION_HALT};
+	vm.setProgram(program, 17);
+	ASSERT(vm.verified(), "program should be verified");
+	vm.run(10, 0);
+	ASSERT(vm.halted(), "VM not in HALT");
+	ASSERT(mem->load(0x0020) == 3, "verified program wrong");
+	ASSERT((vm.getStatuscode() & VM_ERROR_MASK) == 0, "VM shouldnt have an error");
+#ifndef VM_HARVARD
+	mem->store(0x0004, 0x02);//code changed
+	ASSERT(!vm.verified(), "changed program should not be verified");
+#endif
+
+	uint8_t program2[] = {VM_INSTRUCTION_ADD, VM_OPERAND_TYPE_UINT32 | VM_LITERAL, 0xfe, 0x03, 0x01, 0x00, 0x00, 0x00, VM_INSTRUCTION_HALT};
+	vm.setProgram(program2, 9);
+	ASSERT(!vm.verified(), "address out of range should not be verified");
+	vm.executeStep();
+	ASSERT(vm.halted() && vm.errorFlag(), "VM should be halted with error");
+	ASSERT((vm.getStatuscode() & VM_ERROR_MASK) == VM_ERROR_MEMORY_EXCEPTION, "VM should have a memory error");
+
+	uint8_t program3[] = {VM_INSTRUCTION_JUMP, VM_LITERAL, 0x01, 0x00, VM_INSTRUCTION_HALT};//jump into an instruction
+	vm.setProgram(program3, 5);
+	ASSERT(!vm.verified(), "jump into an instruction should not be verified");
+
+	uint8_t program4[] = {VM_INSTRUCTION_JUMP, VM_ADDRESS, 0x20, 0x00, VM_INSTRUCTION_HALT};//indirect jump
+	vm.setProgram(program4, 5);
+	ASSERT(!vm.verified(), "indirect jump should not be verified");
+
+	uint8_t program5[] = {VM_INSTRUCTION_ADD, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x20, 0x00, 0x01};//continues behind the code
+	vm.setProgram(program5, 5);
+	ASSERT(!vm.verified(), "program without end should not be verified");
+
+	uint8_t program6[] = {VM_INSTRUCTION_ADD, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x20, 0x00};//incomplete instruction
+	vm.setProgram(program6, 4);
+	ASSERT(!vm.verified(), "incomplete instruction should not be verified");
+}
+
 /**
  * @brief Runs all test functions specified. Acts as a test-suite.
  */
@@ -868,6 +1371,7 @@ inline void test_CalculationVM()
 	test_CalculationVM_DIV_unsigned_zero();
 	test_CalculationVM_DIV_decimal_zero();
 	test_CalculationVM_MOD_unsigned();
+	test_CalculationVM_MOD_unsigned_zero();
 	test_CalculationVM_MOD_decimal();
 
 	test_CalculationVM_AND();
@@ -886,23 +1390,44 @@ inline void test_CalculationVM()
 	test_CalculationVM_JUMP();
 	test_CalculationVM_COMPARE();
 
+	test_CalculationVM_PUSH_POP();
+	test_CalculationVM_stack_arithmetic();
+	test_CalculationVM_SCOMPARE();
+	test_CalculationVM_registers();
+
 	test_CalculationVM_CALL_RETURN();
+	test_CalculationVM_stack_error();
 
 	test_CalculationVM_TIME();
 	test_CalculationVM_COMPARETIME();
+	test_CalculationVM_SLEEPUNTIL();
 
 	test_CalculationVM_URLMAP();
 	test_CalculationVM_URLMAPCHECK();
 	test_CalculationVM_URLMAPDELETE();
+	test_CalculationVM_URLMAP_wide();
+	test_CalculationVM_URLMAPWAIT();
 
 	test_CalculationVM_PID_init();
 	test_CalculationVM_PID_run();//must be after pid init
 	test_CalculationVM_PID_stop();//mus be after pid run
 	test_CalculationVM_PID_clear();
+	test_CalculationVM_PIDWAIT();
 
 	test_CalculationVM_HALT();
 	test_CalculationVM_RESET();
 
+#ifdef VM_HARVARD
+	test_CalculationVM_harvard();
+#else
+	test_CalculationVM_code_write();
+#endif
+	test_CalculationVM_run();
+	test_CalculationVM_program_image();
+	test_CalculationVM_setProgram_too_large();
+	test_CalculationVM_verify();
+	test_CalculationVM_verify_large_image();
+
 #else
 	TESTINFO("Test CalculationVM off");
 #endif
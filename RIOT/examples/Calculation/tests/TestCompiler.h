@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Tests for Compiler.h
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+#ifndef TESTS_TESTCOMPILER_H_
+#define TESTS_TESTCOMPILER_H_
+
+#include "Tests.h"
+#include "Compiler.h"
+#include "TestAssembler.h"
+
+#ifdef VM_TOOLCHAIN
+
+/**
+ * Executes a compiled program until it halts.
+ * @param vm VM.
+ * @param code Bytecode.
+ * @param size Size of the bytecode.
+ * @return Executed instructions, 0 if the program failed or did not halt.
+ */
+inline uint32_t test_Compiler_run(VM* vm, uint8_t* code, uint16_t size)
+{
+	vm->setProgram(code, size);
+	uint32_t steps = 0;
+	for(uint16_t i = 0; i < 100 && !vm->halted(); i++)
+	{
+		steps += vm->run(1000, 0);
+	}
+	return vm->halted() && (vm->getStatuscode() & VM_ERROR_MASK) == 0 ? steps : 0;
+}
+
+inline void test_Compiler_gcd()
+{
+	//same calculation as test_print_ggt in TestExamples.h without time measurement (98 Bytes)
+	const char* source =
+			"var a = 1836311903;\n"
+			"var b = 1134903170;\n"
+			"while (a != b) {\n"
+			"	if (a > b) a -= b;\n"
+			"	else b -= a;\n"
+			"}\n"
+			"var result : u32 @0x200 = a;\n";
+	static uint8_t code[128];
+	static Compiler compiler(code, sizeof(code));
+	uint16_t size = compiler.compile(source);
+	ASSERT(size == 56, compiler.getError());
+	ASSERT(compiler.getType("a") == VM_OPERAND_TYPE_UINT32 && compiler.getType("b") == VM_OPERAND_TYPE_UINT32, "wrong inferred types");
+	ASSERT(compiler.getRegister("a") != COMPILER_NO_REGISTER && compiler.getRegister("b") != COMPILER_NO_REGISTER, "loop variables not in registers");
+	ASSERT(compiler.getAddress("result") == 0x200, "variable not at its address");
+
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	VM vm(mem, PID::instances());
+	ASSERT(test_Compiler_run(&vm, code, size) != 0, "GCD program failed");
+	ASSERT(vm.verified(), "compiled program not verified");
+	ASSERT(mem->loadunsigned(0x200) == 1, "wrong GCD");
+
+	static Compiler small(code, sizeof(code));
+	uint16_t smallsize = small.compile("var a = 1071; var b = 462;\nwhile (a != b) { if (a > b) a -= b; else b -= a; }\nvar result : u16 @0x200 = a;\n");
+	ASSERT(smallsize != 0 && smallsize < size, small.getError());
+	ASSERT(small.getType("a") == VM_OPERAND_TYPE_UINT16, "wrong inferred type");
+	mem->clear();
+	ASSERT(test_Compiler_run(&vm, code, smallsize) != 0 && mem->loadunsigned(0x200) == 21, "wrong GCD with 16Bit operands");
+	mem->clear();
+}
+
+inline void test_Compiler_expressions()
+{
+	const char* source =
+			"const K = 3 * 4 + 1;		// folded\n"
+			"var x = 200;\n"
+			"var y : u16 = 1000;\n"
+			"var d = 2.5;\n"
+			"var r1 : u16 @0x200 = (y + K) * (x / 50) / 2 % 7 ^ 0xff;\n"
+			"var r2 : u32 @0x204 = x + 100000;\n"
+			"var r3 : u8 @0x208 = y;				// truncated\n"
+			"var r4 : dec @0x20c = d * 4 - 0.5;\n"
+			"var r5 : u8 @0x210 = ~x & (x << 1 | 3);\n"
+			"var r6 : u16 @0x212 = 7;\n"
+			"r6 = 100 - r6 * 2;\n"
+			"var n = 0;\n"
+			"var sum : u32 @0x214 = 0;\n"
+			"while (n < 300) {\n"
+			"	n += 1;\n"
+			"	if (n % 3 == 0) { sum += n; }\n"
+			"	else if (n >= 290) sum += 1000;\n"
+			"}\n";
+	static uint8_t code[512];
+	Memory* mem = &Memory::instance();
+	VM vm(mem, PID::instances());
+	for(uint8_t registers = 0; registers <= VM_REGISTERS; registers += VM_REGISTERS)
+	{
+		//without registers all variables and intermediate results are stored in memory
+		static Compiler memoryonly(code, sizeof(code));
+		static Compiler allregisters(code, sizeof(code));
+		Compiler* compiler = registers ? &allregisters : &memoryonly;
+		compiler->setRegisters(registers);
+		uint16_t size = compiler->compile(source);
+		ASSERT(size != 0, compiler->getError());
+		ASSERT(compiler->getType("x") == VM_OPERAND_TYPE_UINT8 && compiler->getType("d") == VM_OPERAND_TYPE_DEC
+				&& compiler->getType("n") == VM_OPERAND_TYPE_UINT16, "wrong inferred types");
+		ASSERT((compiler->getRegister("n") == COMPILER_NO_REGISTER) == (registers == 0), "wrong register allocation");
+		mem->clear();
+		ASSERT(test_Compiler_run(&vm, code, size) != 0, "expression program failed");
+		ASSERT(mem->loadunsigned(0x200) == ((((1000 + 13) * (200 / 50) / 2) % 7) ^ 0xff), "wrong arithmetic");
+		ASSERT(mem->loadunsigned(0x204) == 100200, "wrong widening");
+		ASSERT(mem->load(0x208) == (1000 & 0xff), "wrong truncation");
+		ASSERT(static_cast<float>(mem->loadrational(0x20c)) == 9.5f, "wrong dec arithmetic");
+		ASSERT(mem->load(0x210) == (uint8_t) (~200 & ((200 << 1) | 3)), "wrong bit operations");
+		ASSERT(mem->load(0x212) == 86 && mem->load(0x213) == 0, "wrong operand order");
+		ASSERT(mem->loadunsigned(0x214) == 15150 + 7 * 1000, "wrong loop");
+	}
+	mem->clear();
+}
+
+inline void test_Compiler_heater()
+{
+	const char* source =
+			"var temperature : dec @0x70;\n"
+			"var setpoint : dec @0x74;\n"
+			"var heater : dec @0x78;\n"
+			"map temperature client get \"affe::1\" \"/sensor\";\n"
+			"map setpoint client get ever \"affe::1\" \"/setpoint\";\n"
+			"map heater client post \"affe::1\" \"/heater\";\n"
+			"pid(temperature, heater, setpoint, 20, 1, 1, 1000, 0, 100);\n";
+	static uint8_t code[256];
+	static Compiler compiler(code, sizeof(code));
+	uint16_t size = compiler.compile(source);
+	ASSERT(size != 0, compiler.getError());
+#ifndef VM_HARVARD
+	//same program as heater_simulation_short in TestExamples.h, the host is shared
+	ASSERT(size == sizeof(test_heater_simulation_short) && memcmp(code, test_heater_simulation_short, size) == 0,
+			"heater simulation compiled wrong");
+#endif
+}
+
+inline void test_Compiler_maps()
+{
+	char source[1024] = "var v : u32 @0x100;\n";
+	for(uint8_t i = 0; i < 16; i++)
+	{
+		strcat(source, "map v client get \"affe::1\" \"/a\";\n");
+	}
+	strcat(source, "map v client get \"beef::1\" \"/b\";\n"
+			"map v client get \"beef::1\" \"/c\";\n");
+	static uint8_t code[512];
+	static Compiler compiler(code, sizeof(code));
+	uint16_t size = compiler.compile(source);
+	ASSERT(size != 0, compiler.getError());
+	Memory* mem = &Memory::instance();
+	VM vm(mem, PID::instances());
+	mem->clear();
+	ASSERT(test_Compiler_run(&vm, code, size) != 0, "map program failed");
+	ASSERT(mem->getMapCount() == 18, "maps not created");
+	url_map_t wide = mem->getMap(17);//host shared with map 16, which has a wide id
+	const unsigned char* host = (wide.map_options & VM_MAP_OPTION_URL_MASK) == VM_MAP_OPTION_URL_LITERAL
+			? mem->loadcodestring(wide.url_address) : mem->loadurl(wide.url_address);
+	ASSERT(strcmp((const char*) host, "beef::1") == 0, "shared host of wide map id wrong");
+	mem->clear();
+}
+
+inline void test_Compiler_errors()
+{
+	static uint8_t code[64];
+	static Compiler undeclared(code, sizeof(code));
+	ASSERT(undeclared.compile("var x = 1;\n\nx = y + 1;\n") == 0 && undeclared.getLine() == 3, "undeclared variable accepted");
+	ASSERT(strcmp(undeclared.getError(), "undeclared variable: y") == 0, "wrong error for undeclared variable");
+
+	static Compiler mixed(code, sizeof(code));
+	ASSERT(mixed.compile("var i : u8 = 1;\nvar d : dec = 1.5;\ni = d;\n") == 0 && mixed.getLine() == 3, "dec and integer mixed");
+
+	static Compiler syntax(code, sizeof(code));
+	ASSERT(syntax.compile("var x = 1;\nwhile (x) { x = 0; }\n") == 0 && syntax.getLine() == 2, "condition without comparison accepted");
+
+	static Compiler constant(code, sizeof(code));
+	ASSERT(constant.compile("const C = 1;\nC = 2;\n") == 0, "constant assigned");
+
+	static Compiler large(code, sizeof(code));
+	ASSERT(large.compile("var x : u32 @0x100 = 1; x = 2; x = 3; x = 4; x = 5; x = 6; x = 7; x = 8; x = 9;\n") == 0, "program larger than the code buffer accepted");
+}
+
+inline void test_Compiler()
+{
+#ifndef TEST_COMPILER_OFF
+	test_Compiler_gcd();
+	test_Compiler_expressions();
+	test_Compiler_heater();
+	test_Compiler_maps();
+	test_Compiler_errors();
+#else
+	TESTINFO("Test Compiler off");
+#endif
+}
+
+#else
+inline void test_Compiler()
+{
+	TESTINFO("Test Compiler off (no VM_TOOLCHAIN)");
+}
+#endif /* VM_TOOLCHAIN */
+
+#endif /* TESTS_TESTCOMPILER_H_ */
@@ -124,13 +124,56 @@ inline void test_print_ggt()
 	ASSERT(Memory::instance().loadunsigned(0x0070) == 1, "gcd wrong should be 1");
 }
 
+/**
+ * Runs the GCD program of test_print_ggt from the code segment with its code size set, so it is verified and executed from
+ * the decode cache, and prints the run time of the dispatch engine the VM was built with (VM_DISPATCH).
+ */
+inline void test_ggt_dispatch()
+{
+	const uint8_t ggt_program[] = {
+			VM_INSTRUCTION_LOAD, 0x01, 0x70, 0x00, 0x5F, 0xE5, 0x73, 0x6D,
+			VM_INSTRUCTION_LOAD, 0x01, 0x74, 0x00, 0x82, 0x3F, 0xA5, 0x43,
+			VM_INSTRUCTION_TIME, 0x80, 0x00,
+			VM_INSTRUCTION_COMPARE, 0x01, 0x70, 0x00, 0x00, 0x00, 0x00, 0x00, 0x2B, 0x00, 0x21, 0x00, 0x2B, 0x00,
+			VM_INSTRUCTION_LOAD, 0x00, 0x70, 0x00, 0x74, 0x00,
+			VM_INSTRUCTION_JUMP, 0x01, 0x59, 0x00,
+			VM_INSTRUCTION_COMPARE, 0x01, 0x74, 0x00, 0x00, 0x00, 0x00, 0x00, 0x39, 0x00, 0x59, 0x00, 0x39, 0x00,
+			VM_INSTRUCTION_COMPARE, 0x00, 0x70, 0x00, 0x74, 0x00, 0x4F, 0x00, 0x4F, 0x00, 0x45, 0x00,
+			VM_INSTRUCTION_SUB, 0x00, 0x70, 0x00, 0x74, 0x00,
+			VM_INSTRUCTION_JUMP, 0x01, 0x2B, 0x00,
+			VM_INSTRUCTION_SUB, 0x00, 0x74, 0x00, 0x70, 0x00,
+			VM_INSTRUCTION_JUMP, 0x01, 0x2B, 0x00,
+			VM_INSTRUCTION_TIME, 0x84, 0x00,
+			VM_INSTRUCTION_SUB, 0x00, 0x84, 0x00, 0x80, 0x00,
+			VM_INSTRUCTION_HALT
+	};
+
+	Memory::instance().clear();
+	VM vm(&Memory::instance(), PID::instances());
+	Memory::instance().storeCode(0, ggt_program, sizeof(ggt_program));
+	Memory::instance().setCodeSize(sizeof(ggt_program));
+	vm.clear();//verify program
+	while(!vm.halted())
+	{
+		vm.executeStep();
+	}
+	printf("GCD Time (%s dispatch, %s): %" PRIu32 " us\n", VM::getDispatchEngine(), vm.verified() ? "verified" : "checked", Memory::instance().loadunsigned(0x0084));
+	ASSERT(vm.getProgramcounter() == 98, "programcounter wrong");
+	ASSERT(Memory::instance().loadunsigned(0x0070) == 1, "gcd wrong should be 1");
+}
+
 inline void test_examples(void)
 {
 #ifndef TEST_EXAMPLES_OFF
 	test_examples_while_loop();
 	test_examples_after_x_ms();
 	test_print_heater_simulation();
-	test_print_ggt();
+#ifndef VM_HARVARD
+	test_print_ggt();//stores the program into the data memory
+#else
+	TESTINFO("test_print_ggt off (Harvard, see test_ggt_dispatch)");
+#endif
+	test_ggt_dispatch();
 #else
 	TESTINFO("Test Examples off");
 #endif
@@ -22,40 +22,63 @@
 
 extern "C" {
 
-void gcoap_store(uint16_t address, uint8_t value);
-const unsigned char* gcoap_loadurl(uint16_t address);
+void gcoap_store(uint8_t instance, uint16_t address, uint8_t value);
+bool gcoap_storeCode(uint8_t instance, uint16_t address, const uint8_t* data, uint16_t len);
+uint16_t gcoap_codeCapacity(uint8_t instance);
+const unsigned char* gcoap_loadurl(uint8_t instance, uint16_t address);
 
 uint8_t gcoap_check_server_value(uint16_t content_type, uint8_t* payload, unsigned payload_len, size_t max_len);
 
-uint8_t gcoap_load_value(uint16_t content_type, uint8_t* payload, size_t max_len, uint8_t map_id);
-uint8_t gcoap_load_value_text(uint8_t* payload, size_t max_len, uint8_t map_id);
-uint8_t gcoap_load_value_octet(uint8_t* payload, size_t max_len, uint8_t map_id);
+uint8_t gcoap_load_value(uint8_t instance, uint16_t content_type, uint8_t* payload, size_t max_len, uint16_t map_id);
+uint8_t gcoap_load_value_text(uint8_t instance, uint8_t* payload, size_t max_len, uint16_t map_id);
+uint8_t gcoap_load_value_octet(uint8_t instance, uint8_t* payload, size_t max_len, uint16_t map_id);
+uint8_t gcoap_peek_value(uint8_t instance, uint16_t content_type, uint8_t* payload, size_t max_len, uint16_t map_id);
 
-void gcoap_store_value(uint16_t content_type, uint8_t map_id, uint8_t* payload, unsigned payload_len);
-void gcoap_done(uint8_t id);
-void gcoap_error(uint8_t id, uint8_t errorcode);
+int8_t gcoap_store_value(uint8_t instance, uint16_t content_type, uint16_t map_id, uint8_t* payload, unsigned payload_len);
+void gcoap_done(uint8_t instance, uint16_t id);
+void gcoap_error(uint8_t instance, uint16_t id, uint8_t errorcode);
+bool gcoap_take_change(uint8_t instance, uint16_t id);
+void gcoap_resend(uint8_t instance, uint16_t id);
 
-const url_map_t* gcoap_get_mappings(void);
-uint8_t gcoap_get_map_size(void);
+url_map_t gcoap_get_mapping(uint8_t instance, uint16_t id);
+uint16_t gcoap_next_mapping(uint8_t instance, uint16_t id);
+uint16_t gcoap_next_client_mapping(uint8_t instance, uint16_t id);
+uint16_t gcoap_next_server_mapping(uint8_t instance, uint16_t id);
+uint16_t gcoap_get_map_count(uint8_t instance);
+uint16_t gcoap_get_map_size(void);
 
 uint8_t gcoap_parse_resource_offset(const char* url);
 
-void gcoap_get_resource(const url_map_t* mapping, char* buf);
-void gcoap_get_host(const url_map_t* mapping, char* buf);
+void gcoap_get_resource(uint8_t instance, const url_map_t* mapping, char* buf);
+void gcoap_get_host(uint8_t instance, const url_map_t* mapping, char* buf);
 
-size_t gcoap_statusVM(uint8_t* buf, size_t buf_len, kernel_pid_t vm_thread_pid);
+size_t gcoap_statusVM(uint8_t instance, uint8_t* buf, size_t buf_len, kernel_pid_t vm_thread_pid);
 size_t gcoap_statusMemory(uint8_t* buf, size_t buf_len);
-size_t gcoap_statusMappings(uint8_t* buf, size_t buf_len);
-size_t gcoap_statusPID(uint8_t* buf, size_t buf_len);
+size_t gcoap_statusMappings(uint8_t instance, uint8_t* buf, size_t buf_len);
+size_t gcoap_statusPID(uint8_t instance, uint8_t* buf, size_t buf_len);
 }
 
 inline void test_gcoap_store(void)
 {
 	Memory::instance().clear();
-	gcoap_store(0x00, 0xff);
+	gcoap_store(0, 0x00, 0xff);
 	ASSERT(Memory::instance().load(0x00) == 0xff, "gcoap_store wrong");
 }
 
+inline void test_gcoap_codeCapacity(void)
+{
+	static uint8_t code[MEMORY_CODE_REGION + 1];
+	uint16_t capacity = gcoap_codeCapacity(0);
+#ifdef VM_HARVARD
+	ASSERT(capacity == VM_CODE_SIZE, "code capacity is not the code segment");
+#else
+	ASSERT(capacity == Memory::instance().getMemorySize(), "code capacity is not the memory");
+#endif
+	ASSERT(!gcoap_storeCode(0, 0, code, capacity + 1), "code larger than the capacity stored");
+	ASSERT(gcoap_storeCode(0, 0, code, capacity), "code of the capacity not stored");
+	Memory::instance().clear();
+}
+
 inline void test_gcoap_loadurl(void)
 {
 	char url[] = "dead::beef:1";
@@ -65,7 +88,7 @@ inline void test_gcoap_loadurl(void)
 		Memory::instance().store(i, url[i]);
 	}
 	Memory::instance().store(len, 0);
-	ASSERT(strcmp((const char*)gcoap_loadurl(0x00), "dead::beef:1") == 0, "loadurl wrong");
+	ASSERT(strcmp((const char*)gcoap_loadurl(0, 0x00), "dead::beef:1") == 0, "loadurl wrong");
 }
 
 inline void test_gcoap_check_server_value(void)
@@ -108,14 +131,14 @@ inline void test_gcoap_load_value(void)
 	uint16_t content_type_text = 0;//simulate coap pdu values for content format text
 	uint8_t payload[] = {'/', 't', 'e', 's', 't', 'v', 'a', 'l', 'u', 'e'};
 	unsigned payload_len = 10;
-	uint8_t newlen = gcoap_load_value(content_type_text, (uint8_t*)payload, (size_t)payload_len, 0);
+	uint8_t newlen = gcoap_load_value(0, content_type_text, (uint8_t*)payload, (size_t)payload_len, 0);
 	ASSERT(strcmp((const char*)payload, "1234") == 0, "check_server_value wrong (text)");
 	ASSERT(newlen == 4, "payload_len wrong (text)");
 
 	uint16_t content_type_octet = 42;//simulate coap pdu values
 	uint8_t payload2[] = {'/', 't', 'e', 's', 't', 'v', 'a', 'l', 'u', 'e'};
 	unsigned payload_len2 = 10;
-	newlen = gcoap_load_value(content_type_octet, (uint8_t*)payload2, (size_t)payload_len2, 0);
+	newlen = gcoap_load_value(0, content_type_octet, (uint8_t*)payload2, (size_t)payload_len2, 0);
 	ASSERT(payload2[0] == 0xd2 && payload2[1] == 0x04 && payload2[2] == 0x00 && payload2[3] == 0x00, "check_server_value wrong (octet)");
 	ASSERT(newlen == 4, "payload_len wrong (octet)");
 }
@@ -130,51 +153,133 @@ inline void test_gcoap_store_value(void)
 	uint8_t payload_text[] = {'1', '2', '3', '4'};
 	uint16_t content_type = 0;
 	unsigned payload_len = 4;
-	gcoap_store_value(content_type, 0, payload_text, payload_len);
+	gcoap_store_value(0, content_type, 0, payload_text, payload_len);
 	ASSERT(Memory::instance().loadunsigned(valueaddress) == 1234, "stored value wrong");
 
 	uint8_t payload_octet[] = {0xd2, 0x04, 0x10, 0x00};
 	content_type = 42;
 	payload_len = 4;
-	gcoap_store_value(content_type, 0, payload_octet, payload_len);
+	gcoap_store_value(0, content_type, 0, payload_octet, payload_len);
 	ASSERT(Memory::instance().loadunsigned(valueaddress) == 1049810, "stored value wrong");
 
 	uint8_t payload_text2[] = {'1', '2', '3', '.', '4'};
 	uint16_t content_type2 = 0;
 	unsigned payload_len2 = 5;
-	gcoap_store_value(content_type2, 1, payload_text2, payload_len2);
+	gcoap_store_value(0, content_type2, 1, payload_text2, payload_len2);
 	ASSERT(Memory::instance().loadrational(valueaddress2) == rational_t(123.4), "stored value wrong (decimal)");
 
 	uint8_t payload_octet2[] = {0x80, 0x16, 0x00, 0x00};//should be 22.5 in fixed8_t
 	content_type2 = 42;
 	payload_len2 = 4;
-	gcoap_store_value(content_type2, 1, payload_octet2, payload_len2);
+	gcoap_store_value(0, content_type2, 1, payload_octet2, payload_len2);
 	ASSERT(Memory::instance().loadrational(valueaddress2) == rational_t(22.5), "stored value wrong (decimal)");
 }
 
 inline void test_gcoap_done(void)
 {
 	Memory::instance().map(0, 0, VM_MAP_OPTION_LIFETIME_ONCE, 0, 0, 0, 0);
-	gcoap_done(0);
-	ASSERT(Memory::instance().dumpMap()[0].status & VM_MAP_STATUS_DONE, "Map not marked done");
+	gcoap_done(0, 0);
+	ASSERT(Memory::instance().getMap(0).status & VM_MAP_STATUS_DONE, "Map not marked done");
 	Memory::instance().checkmap(0);
-	ASSERT(Memory::instance().dumpMap()[0].value_address == NO_MAPPING, "Map should be deleted due to VM_MAP_LIFETIME_ONCE")
+	ASSERT(Memory::instance().getMap(0).value_address == NO_MAPPING, "Map should be deleted due to VM_MAP_LIFETIME_ONCE")
 }
 
 inline void test_gcoap_error(void)
 {
 	Memory::instance().map(0, 0, VM_MAP_OPTION_LIFETIME_ONCE, 0, 0, 0, 0);
-	gcoap_error(0, VM_MAP_STATUS_ERROR_404);
-	ASSERT(Memory::instance().dumpMap()[0].status > 1, "Map should have an error");
-	ASSERT(Memory::instance().dumpMap()[0].status & VM_MAP_STATUS_ERROR_404, "Map should have error 404");
+	gcoap_error(0, 0, VM_MAP_STATUS_ERROR_404);
+	ASSERT(Memory::instance().getMap(0).status > 1, "Map should have an error");
+	ASSERT(Memory::instance().getMap(0).status & VM_MAP_STATUS_ERROR_404, "Map should have error 404");
 	Memory::instance().checkmap(0);
-	ASSERT(Memory::instance().dumpMap()[0].value_address != NO_MAPPING, "Map should not be deleted due to error");
+	ASSERT(Memory::instance().getMap(0).value_address != NO_MAPPING, "Map should not be deleted due to error");
 }
 
 
 inline void test_gcoap_get_mappings(void)
 {
-	ASSERT(gcoap_get_mappings() == Memory::instance().dumpMap(), "not the mappings we are looking for");
+	Memory::instance().clear();
+	Memory::instance().map(20, VM_OPERAND_TYPE_UINT32, VM_MAP_OPTION_LIFETIME_EVER, 0x0040, 0, 0, 0);
+	ASSERT(gcoap_get_map_count(0) == 1, "wrong number of mappings");
+	ASSERT(gcoap_next_mapping(0, 0) == 20, "used mapping not found");
+	ASSERT(gcoap_next_mapping(0, 21) == MEMORY_NO_MAP, "unused mapping found");
+	ASSERT(gcoap_get_mapping(0, 20).value_address == 0x0040, "not the mapping we are looking for");
+	ASSERT(gcoap_get_mapping(0, 0).status == VM_MAP_STATUS_NO_MAPPING, "unused mapping not marked");
+	Memory::instance().map(40, VM_OPERAND_TYPE_UINT32, VM_MAP_OPTION_DIRECTION_CLIENT, 0x0044, 0, 0, 0);
+	ASSERT(gcoap_next_client_mapping(0, 0) == 40, "server mapping returned as client mapping");
+	ASSERT(gcoap_next_server_mapping(0, 0) == 20, "server mapping not found");
+	ASSERT(gcoap_next_server_mapping(0, 21) == MEMORY_NO_MAP, "client mapping returned as server mapping");
+	Memory::instance().clear();
+}
+
+inline void test_gcoap_server_change(void)
+{
+	char resource[] = "/observed";
+	uint16_t baseaddress = 0x0012;
+	for(uint8_t i = 0; i <= strlen(resource); i++)
+	{
+		Memory::instance().store(baseaddress + i, resource[i]);
+	}
+	Memory::instance().map(3, VM_OPERAND_TYPE_UINT32, VM_MAP_OPTION_LIFETIME_EVER, 0x0000, 0, baseaddress - 2, baseaddress);
+	ASSERT(gcoap_take_change(0, 3), "new server mapping not notified");
+	ASSERT(!gcoap_take_change(0, 3), "unchanged server mapping notified");
+	Memory::instance().storeunsigned(0x0000, 5);
+	ASSERT(gcoap_take_change(0, 3), "changed server mapping not notified");
+	Memory::instance().storeunsigned(0x0000, 5);
+	ASSERT(!gcoap_take_change(0, 3), "server mapping notified for an equal value");
+	Memory::instance().clear();
+}
+
+inline void test_gcoap_notify_once(void)
+{
+	char resource[] = "/once";
+	uint16_t baseaddress = 0x0012;
+	for(uint8_t i = 0; i <= strlen(resource); i++)
+	{
+		Memory::instance().store(baseaddress + i, resource[i]);
+	}
+	Memory::instance().map(4, VM_OPERAND_TYPE_UINT32, VM_MAP_OPTION_LIFETIME_ONCE | VM_MAP_OPTION_DIRECTION_SERVER, 0x0000, 0, baseaddress - 2, baseaddress);
+	Memory::instance().storeunsigned(0x0000, 42);
+	uint8_t payload[12];
+	ASSERT(gcoap_take_change(0, 4), "new server mapping not notified");//notify cycle of gcoap_s_notify()
+	ASSERT(gcoap_peek_value(0, 0, payload, sizeof(payload), 4) == 2 && memcmp(payload, "42", 2) == 0, "notified value wrong");
+	ASSERT(gcoap_peek_value(0, 42, payload, sizeof(payload), 4) == sizeof(uint32_t), "notified value wrong (octet)");
+	ASSERT(gcoap_get_mapping(0, 4).status != VM_MAP_STATUS_NO_MAPPING, "ONCE server mapping deleted by the notification");
+	ASSERT(gcoap_check_server_value(0, (uint8_t*)resource, strlen(resource), sizeof(resource)) == 2, "ONCE server mapping not requested after the notification");
+	ASSERT(gcoap_get_mapping(0, 4).status == VM_MAP_STATUS_NO_MAPPING, "ONCE server mapping not deleted by the request");
+	Memory::instance().clear();
+}
+
+inline void test_gcoap_take_change(void)
+{
+	Memory::instance().map(40, VM_OPERAND_TYPE_UINT32, VM_MAP_OPTION_DIRECTION_CLIENT | VM_MAP_OPTION_METHOD_PUT, 0x0044, 0, 0, 0);
+	ASSERT(gcoap_take_change(0, 40), "new mapping not pushed");
+	ASSERT(!gcoap_take_change(0, 40), "unchanged mapping pushed");
+	Memory::instance().storeunsigned(0x0044, 1);
+	ASSERT(gcoap_take_change(0, 40), "changed mapping not pushed");
+	gcoap_resend(0, 40);
+	ASSERT(gcoap_take_change(0, 40), "failed push not repeated");
+	ASSERT(!gcoap_take_change(1, 40), "mapping of the other instance pushed");
+	Memory::instance().clear();
+}
+
+inline void test_gcoap_value_out_of_range(void)
+{
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	uint16_t address = mem->getMemorySize() - 2;//uint32_t value does not fit
+	mem->map(41, VM_OPERAND_TYPE_UINT32, VM_MAP_OPTION_LIFETIME_EVER | VM_MAP_OPTION_DIRECTION_CLIENT | VM_MAP_OPTION_METHOD_PUT, address, 0, 0, 0);
+	uint8_t payload[8] = {'1', '2', 0};
+	ASSERT(gcoap_load_value(0, 0, payload, sizeof(payload), 41) == 0, "value out of range loaded (text)");
+	ASSERT(gcoap_load_value(0, 42, payload, sizeof(payload), 41) == 0, "value out of range loaded (octet)");
+	ASSERT(gcoap_store_value(0, 0, 41, payload, 3) == -1, "value out of range stored (text)");
+	ASSERT(gcoap_store_value(0, 42, 41, payload, 4) == -1, "value out of range stored (octet)");
+	ASSERT(gcoap_store_value(0, 42, 42, payload, 4) == -1, "value of unused mapping stored");
+	ASSERT(!gcoap_take_change(0, mem->getMapSize()), "change of invalid map id taken");
+	gcoap_done(0, mem->getMapSize());
+	gcoap_error(0, mem->getMapSize(), VM_MAP_STATUS_ERROR_SERVER);
+	gcoap_resend(0, mem->getMapSize());
+	ASSERT(!mem->accessError(), "gcoap access set the access error of the memory");
+	mem->clear();
 }
 
 inline void test_gcoap_get_map_size(void)
@@ -193,7 +298,8 @@ inline void test_gcoap_get_ressource(void)
 	}
 	Memory::instance().map(0, 0, VM_MAP_OPTION_LIFETIME_EVER, 0x0000, 0, baseaddress, baseaddress + strlen(url) + 1);//create a URL Map
 	char resourcebuffer[20];
-	gcoap_get_resource(Memory::instance().dumpMap(), resourcebuffer);
+	url_map_t mapping = Memory::instance().getMap(0);
+	gcoap_get_resource(0, &mapping, resourcebuffer);
 	ASSERT(strcmp(resourcebuffer, "/testvalue") == 0, "wrong resource");
 }
 
@@ -208,10 +314,51 @@ inline void test_gcoap_get_host(void)
 	}
 	Memory::instance().map(0, 0, VM_MAP_OPTION_LIFETIME_EVER, 0x0000, 0, baseaddress, baseaddress + strlen(url) + 1);//create a URL Map
 	char hostbuffer[20];
-	gcoap_get_host(Memory::instance().dumpMap(), hostbuffer);
+	url_map_t mapping = Memory::instance().getMap(0);
+	gcoap_get_host(0, &mapping, hostbuffer);
 	ASSERT(strcmp(hostbuffer, "dead::beef:1") == 0, "wrong host");
 }
 
+inline void test_gcoap_instances(void)
+{
+	if(VM_INSTANCES < 2)
+	{
+		TESTINFO("needs more than one VM instance");
+		return;
+	}
+	Memory* mem0 = &Memory::instance(0);
+	Memory* mem1 = &Memory::instance(1);
+	mem0->clear();
+	mem1->clear();
+	ASSERT(mem0 != mem1, "VM instances share a memory");
+
+	gcoap_store(1, 0x00, 0xaa);
+	ASSERT(mem1->load(0x00) == 0xaa && mem0->load(0x00) == 0, "gcoap_store wrote into the wrong instance");
+
+	char resource[] = "/instancevalue";
+	uint16_t baseaddress = 0x0012;
+	for(uint8_t i = 0; i <= strlen(resource); i++)
+	{
+		mem1->store(baseaddress + i, resource[i]);
+	}
+	mem1->map(0, 0, VM_MAP_OPTION_LIFETIME_EVER, 0x0004, 0, baseaddress - 2, baseaddress);
+	mem1->storeunsigned(0x0004, 4321);
+	uint8_t payload[14];
+	memcpy(payload, resource, sizeof(payload));
+	uint8_t newlen = gcoap_check_server_value(0, payload, sizeof(payload), sizeof(payload));
+	ASSERT(newlen == 4 && strncmp((const char*)payload, "4321", 4) == 0, "mapping of instance 1 not found");
+
+	uint8_t value[] = "7";
+	gcoap_store_value(1, 0, 0, value, 1);
+	ASSERT(mem1->loadunsigned(0x0004) == 7, "gcoap_store_value wrote into the wrong instance");
+	ASSERT(mem0->loadunsigned(0x0004) == 0, "gcoap_store_value wrote into instance 0");
+	gcoap_done(1, 0);
+	ASSERT(mem1->getMap(0).status & VM_MAP_STATUS_DONE, "Map of instance 1 not marked done");
+	ASSERT(!(mem0->getMap(0).status & VM_MAP_STATUS_DONE), "Map of instance 0 marked done");
+	mem0->clear();
+	mem1->clear();
+}
+
 inline void test_gcoap_statusVM(void)
 {
 	TESTINFO("needs vm thread to run");
@@ -224,23 +371,32 @@ inline void test_gcoap_statusMemory(void)
 
 inline void test_gcoap_statusMappings(void)
 {
+	Memory::instance().clear();
+	Memory::instance().map(1, 0, VM_MAP_OPTION_LIFETIME_EVER, 0x0040, 0, 0, 0);
+	Memory::instance().map(200, 0, VM_MAP_OPTION_LIFETIME_EVER, 0x0044, 0, 0, 0);
 	uint8_t buf[17];
-	size_t written = gcoap_statusMappings(buf, 17);
-	ASSERT(written == VM_MEMORY_MAP_SIZE + 1, "Not all bytes written");
+	size_t written = gcoap_statusMappings(0, buf, 17);
+	ASSERT(written == 2 + 2 * 3, "Not all bytes written");
+	uint16_t value;
+	memcpy(&value, buf, sizeof(uint16_t));
+	ASSERT(value == 2, "wrong number of mappings");
+	memcpy(&value, buf + 5, sizeof(uint16_t));
+	ASSERT(value == 200 && buf[7] == 0, "wrong id or status");
 
 	uint8_t buf2[4];
-	written = gcoap_statusMappings(buf2, 4);
-	ASSERT(written == sizeof(buf2), "Something went wrong");
+	written = gcoap_statusMappings(0, buf2, 4);
+	ASSERT(written == 2, "Something went wrong");
+	Memory::instance().clear();
 }
 
 inline void test_gcoap_statusPID(void)
 {
 	uint8_t buf[4];
-	size_t written = gcoap_statusPID(buf, 4);
+	size_t written = gcoap_statusPID(0, buf, 4);
 	ASSERT(written == VM_PID_NUM_AVAILABLE + 1, "Not all bytes written");
 
 	uint8_t buf2[1];
-	written = gcoap_statusPID(buf, 1);
+	written = gcoap_statusPID(0, buf, 1);
 	ASSERT(written == sizeof(buf2), "Something went wrong");
 }
 
@@ -252,6 +408,7 @@ inline void test_Gcoap_shared()
 #ifndef TEST_Gcoap_shared_OFF
 	test_gcoap_store();
 
+	test_gcoap_codeCapacity();
 	test_gcoap_loadurl();
 
 	test_gcoap_check_server_value();
@@ -263,11 +420,17 @@ inline void test_Gcoap_shared()
 	test_gcoap_error();
 
 	test_gcoap_get_mappings();
+	test_gcoap_take_change();
+	test_gcoap_server_change();
+	test_gcoap_notify_once();
+	test_gcoap_value_out_of_range();
 	test_gcoap_get_map_size();
 
 	test_gcoap_get_ressource();
 	test_gcoap_get_host();
 
+	test_gcoap_instances();
+
 	test_gcoap_statusVM();
 	test_gcoap_statusMemory();
 	test_gcoap_statusMappings();
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Tests for InstructionCache.h
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+#ifndef TESTS_TESTINSTRUCTIONCACHE_H_
+#define TESTS_TESTINSTRUCTIONCACHE_H_
+
+#include "Tests.h"
+#include "InstructionCache.h"
+
+inline void test_InstructionCache_insert_lookup()
+{
+	InstructionCache cache;
+	vm_instruction_t in;
+	in.pc = 0x0010;
+	in.next = 0x0015;
+	in.opcode = VM_INSTRUCTION_ADD;
+	ASSERT(cache.lookup(0x0010) == 0, "Empty cache should not contain instructions");
+	cache.insert(&in);
+	vm_instruction_t* cached = cache.lookup(0x0010);
+	ASSERT(cached != 0, "Instruction not cached");
+	ASSERT(cached != 0 && cached->next == 0x0015 && cached->opcode == VM_INSTRUCTION_ADD, "Cached instruction wrong");
+	ASSERT(cache.lookup(0x0011) == 0, "Lookup of wrong address");
+}
+
+inline void test_InstructionCache_replace()
+{
+	InstructionCache cache;
+	vm_instruction_t in;
+	in.pc = 0x0001;
+	cache.insert(&in);
+	in.pc = 0x0001 + cache.getCacheSize() * 32;//same index
+	cache.insert(&in);
+	ASSERT(cache.lookup(0x0001) == 0, "Replaced instruction still cached");
+	ASSERT(cache.lookup(in.pc) != 0, "Instruction not cached");
+}
+
+inline void test_InstructionCache_invalidate()
+{
+	InstructionCache cache;
+	vm_instruction_t in;
+	for(uint16_t i = 0; i < cache.getCacheSize(); i++)
+	{
+		in.pc = i;
+		cache.insert(&in);
+	}
+	cache.invalidate(5);
+	ASSERT(cache.isValid(5), "Cache should be valid for code version 5");
+	ASSERT(!cache.isValid(6), "Cache should not be valid for code version 6");
+	for(uint16_t i = 0; i < cache.getCacheSize(); i++)
+	{
+		ASSERT(cache.lookup(i) == 0, "Instruction still cached after invalidate");
+	}
+}
+
+/**
+ * @brief Runs all test functions specified. Acts as a test-suite.
+ */
+inline void test_InstructionCache()
+{
+#ifndef TEST_INSTRUCTIONCACHE_OFF
+	test_InstructionCache_insert_lookup();
+	test_InstructionCache_replace();
+	test_InstructionCache_invalidate();
+#else
+	TESTINFO("Test InstructionCache off");
+#endif
+}
+
+#endif /* TESTS_TESTINSTRUCTIONCACHE_H_ */
@@ -77,6 +77,24 @@ inline void test_Memory_copy()
 	ASSERT(Memory::instance().load(0x0021) == 255, "Memory copy wrong value");
 }
 
+inline void test_Memory_storeBlock()
+{
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	uint8_t block[] = {0x01, 0x02, 0x03, 0x04, 0x05};
+	mem->setCodeSize(0x10);
+	uint32_t codeversion = mem->getCodeVersion();
+	mem->storeBlock(0x0020, block, sizeof(block));
+	ASSERT(memcmp(mem->dump() + 0x0020, block, sizeof(block)) == 0, "Memory storeBlock wrong");
+	ASSERT(mem->getCodeVersion() == codeversion, "Memory storeBlock behind code changed code version");
+#ifndef VM_HARVARD
+	mem->storeBlock(0x0000, block, sizeof(block));
+	ASSERT(mem->getCodeVersion() != codeversion, "Memory storeBlock into code did not change code version");
+#endif
+	mem->setCodeSize(0);
+	mem->clear();
+}
+
 inline void test_Memory_clear()
 {
 
@@ -89,9 +107,179 @@ inline void test_Memory_clear()
 	ASSERT(Memory::instance().load(0x0001) == 0x00, "Memory not cleared");
 }
 
-inline void test_Memory_access_violation()
+inline void test_Memory_shared()
+{
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	ASSERT(!mem->isshared(0x0040, sizeof(rational_t)), "Memory value shared after clear");
+	mem->share(0x0042, sizeof(rational_t));
+	ASSERT(mem->isshared(0x0040, 1), "Memory shared word not marked");
+	ASSERT(mem->isshared(0x0047, 1), "Memory shared word not marked");
+	ASSERT(mem->isshared(0x003e, sizeof(uint32_t)), "Memory value overlapping a shared word not shared");
+	ASSERT(!mem->isshared(0x0048, sizeof(uint32_t)), "Memory value shared");
+
+	mem->storerational(0x0042, (rational_t)12.5);
+	ASSERT(mem->loadrational(0x0042) == (rational_t)12.5, "Memory shared storedecimal != loaddecimal");
+	mem->storeunchecked<uint32_t>(0x0044, 0x12345678);
+	ASSERT(mem->loadunchecked<uint32_t>(0x0044) == 0x12345678, "Memory shared storeunchecked != loadunchecked");
+	mem->copy(0x0044, 4, 0x0010);
+	ASSERT(mem->loadunsigned(0x0010) == 0x12345678, "Memory copy from shared value wrong");
+
+	mem->share(mem->getMemorySize() - 2, 8);//clipped at the end of the memory
+	ASSERT(mem->isshared(mem->getMemorySize() - 1, 1), "Memory last word not shared");
+	mem->clear();
+	ASSERT(!mem->isshared(0x0040, sizeof(rational_t)), "Memory value shared after clear");
+}
+
+inline void test_Memory_map_index()
+{
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	const char resources[] = "/a\0/b\0/sensor\0/sensor";
+	mem->storeBlock(0x0100, (const uint8_t*) resources, sizeof(resources));
+	for(uint16_t id = 0; id < MEMORY_MAP_CAPACITY; id++)
+	{
+		mem->map(id, 0, VM_MAP_OPTION_LIFETIME_EVER, 4 * id, 0, NO_MAPPING, NO_MAPPING);
+	}
+	for(uint16_t id = 0; id < MEMORY_MAP_CAPACITY; id++)
+	{
+		ASSERT(mem->getMapForAddress(4 * id) == id, "Memory map index wrong address");
+	}
+	ASSERT(mem->getMapForAddress(2) == MEMORY_NO_MAP, "Memory map index unmapped address found");
+	ASSERT(mem->findResource((const uint8_t*) "/a", 2) == MEMORY_NO_MAP, "Memory map index mapping without resource found");
+	mem->map(0, 0, VM_MAP_OPTION_LIFETIME_EVER, 0x0200, 0, NO_MAPPING, 0x0100);
+	mem->map(1, 0, VM_MAP_OPTION_LIFETIME_EVER, 0x0204, 0, NO_MAPPING, 0x0103);
+	mem->map(2, 0, VM_MAP_OPTION_LIFETIME_EVER, 0x0208, 0, NO_MAPPING, 0x0106);
+	mem->map(3, 0, VM_MAP_OPTION_LIFETIME_EVER, 0x0208, 0, NO_MAPPING, 0x010e);
+	ASSERT(mem->findResource((const uint8_t*) "/a", 2) == 0, "Memory map index resource not found");
+	ASSERT(mem->findResource((const uint8_t*) "/b", 2) == 1, "Memory map index resource not found");
+	ASSERT(mem->findResource((const uint8_t*) "/sensor", 7) == 2, "Memory map index lowest id of equal resources not found");
+	ASSERT(mem->findResource((const uint8_t*) "/sens", 5) == MEMORY_NO_MAP, "Memory map index prefix found");
+	ASSERT(mem->findResource((const uint8_t*) "/c", 2) == MEMORY_NO_MAP, "Memory map index unmapped resource found");
+	ASSERT(mem->getMapForAddress(0x0208) == 2, "Memory map index lowest id of equal addresses not found");
+	mem->unmap(2);
+	ASSERT(mem->findResource((const uint8_t*) "/sensor", 7) == 3, "Memory map index resource of unmapped id found");
+	ASSERT(mem->getMapForAddress(0x0208) == 3, "Memory map index address of unmapped id found");
+	mem->unmap(3);
+	ASSERT(mem->findResource((const uint8_t*) "/sensor", 7) == MEMORY_NO_MAP, "Memory map index unmapped resource found");
+	ASSERT(mem->getMapForAddress(0x0208) == MEMORY_NO_MAP, "Memory map index unmapped address found");
+	mem->clear();
+	ASSERT(mem->findResource((const uint8_t*) "/a", 2) == MEMORY_NO_MAP, "Memory map index resource found after clear");
+	ASSERT(mem->getMapForAddress(0x0204) == MEMORY_NO_MAP, "Memory map index address found after clear");
+}
+
+inline void test_Memory_snapshot()
 {
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	mem->storeunsigned(0x0010, 0xdeadbeef);
+	mem->share(0x0014, sizeof(rational_t));
+	mem->storerational(0x0014, (rational_t)3.5);
+	uint8_t buffer[8];
+	ASSERT(mem->snapshot(0x0010, buffer, 8), "Memory snapshot failed");
+	ASSERT(memcmp(buffer, mem->dump() + 0x0010, 8) == 0, "Memory snapshot wrong");
+	ASSERT(!mem->snapshot(mem->getMemorySize() - 4, buffer, 8), "Memory snapshot out of range");
+
+	mem->map(0, VM_OPERAND_TYPE_UINT32, 0, 0x0010, 0, 0x0020, 0x0030);
+	ASSERT(mem->getMap(0).value_address == 0x0010, "Memory map snapshot wrong");
+	ASSERT(mem->getMap(1).value_address == NO_MAPPING, "Memory map snapshot wrong");
+	mem->clear();
+}
 
+inline void test_Memory_map_pool()
+{
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	ASSERT(mem->getMapSize() == VM_MEMORY_MAP_SIZE, "Memory map ids wrong");
+	ASSERT(mem->map(200, VM_OPERAND_TYPE_UINT32, VM_MAP_OPTION_LIFETIME_EVER, 0x0010, 0, NO_MAPPING, NO_MAPPING), "Memory map wide id failed");
+	ASSERT(mem->getMap(200).value_address == 0x0010, "Memory map wide id wrong");
+	ASSERT(mem->getMapCount() == 1, "Memory map count wrong");
+	ASSERT(mem->nextMap(0) == 200, "Memory next map not found");
+	ASSERT(mem->nextMap(201) == MEMORY_NO_MAP, "Memory next map unused id found");
+	mem->map(203, VM_OPERAND_TYPE_UINT32, VM_MAP_OPTION_DIRECTION_CLIENT, 0x0014, 0, NO_MAPPING, NO_MAPPING);
+	ASSERT(mem->nextMap(201) == 203 && mem->nextMap(204) == MEMORY_NO_MAP, "Memory next map in block wrong");
+	ASSERT(mem->nextMap(0, VM_MAP_OPTION_DIRECTION_MASK, VM_MAP_OPTION_DIRECTION_CLIENT) == 203, "Memory next client map wrong");
+	mem->unmap(203);
+	mem->unmap(200);
+	ASSERT(mem->getMapCount() == 0 && mem->nextMap(0) == MEMORY_NO_MAP, "Memory map not deleted");
+	uint16_t mapped = 0;
+	for(uint16_t id = 0; id < mem->getMapSize(); id += MEMORY_MAP_BLOCK)//every id needs its own block
+	{
+		mapped += mem->map(id, 0, VM_MAP_OPTION_LIFETIME_EVER, id, 0, NO_MAPPING, NO_MAPPING);
+	}
+	ASSERT(mapped == MEMORY_MAP_CAPACITY / MEMORY_MAP_BLOCK, "Memory map pool size wrong");
+	if(mapped < mem->getMapSize() / MEMORY_MAP_BLOCK)
+	{
+		uint16_t last = (mem->getMapSize() / MEMORY_MAP_BLOCK - 1) * MEMORY_MAP_BLOCK;
+		ASSERT(!mem->map(last, 0, VM_MAP_OPTION_LIFETIME_EVER, 0, 0, NO_MAPPING, NO_MAPPING), "Memory map pool not exhausted");
+		ASSERT(mem->map(1, 0, VM_MAP_OPTION_LIFETIME_EVER, 0, 0, NO_MAPPING, NO_MAPPING), "Memory map in allocated block failed");
+		mem->unmap(0);
+		ASSERT(!mem->map(last, 0, VM_MAP_OPTION_LIFETIME_EVER, 0, 0, NO_MAPPING, NO_MAPPING), "Memory map block released with used mappings");
+		mem->unmap(1);
+		ASSERT(mem->map(last, 0, VM_MAP_OPTION_LIFETIME_EVER, 0, 0, NO_MAPPING, NO_MAPPING), "Memory map block not released");
+	}
+	mem->clear();
+	ASSERT(mem->getMapCount() == 0 && mem->map(200, 0, VM_MAP_OPTION_LIFETIME_EVER, 0, 0, NO_MAPPING, NO_MAPPING), "Memory map pool not released by clear");
+	mem->clear();
+}
+
+inline void test_Memory_map_changes()
+{
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	uint8_t options = VM_MAP_OPTION_DIRECTION_CLIENT | VM_MAP_OPTION_METHOD_POST | VM_MAP_OPTION_LIFETIME_EVER;
+	mem->storeunsigned(0x0020, 7);
+	mem->map(3, VM_OPERAND_TYPE_UINT32, options, 0x0020, 0, 0, 0);
+	ASSERT(mem->mapChanged(3), "Memory mapped value not pushed after map");
+	ASSERT(!mem->mapChanged(3), "Memory mapped value pushed twice");
+	mem->storeunsigned(0x0020, 7);
+	ASSERT(!mem->mapChanged(3), "Memory unchanged value pushed");
+	mem->storeunsigned(0x0020, 8);
+	ASSERT(mem->mapChanged(3), "Memory changed value not pushed");
+	mem->store(0x0023, 1);
+	ASSERT(mem->mapChanged(3), "Memory partly written value not pushed");
+	mem->storeunsigned(0x0024, 9);
+	mem->store(0x001f, 9);
+	ASSERT(!mem->mapChanged(3), "Memory write next to the value marked changed");
+	mem->map_resend(3);
+	ASSERT(mem->mapChanged(3), "Memory value not pushed again after resend");
+	mem->storerational(0x0030, rational_t(1.5));
+	mem->map(4, VM_OPERAND_TYPE_DEC, options, 0x0030, 0, 0, 0);
+	ASSERT(mem->mapChanged(4), "Memory mapped rational not pushed after map");
+	mem->storerational(0x0030, rational_t(1.5) + rational_t(VM_MAP_DEADBAND));
+	ASSERT(!mem->mapChanged(4), "Memory change in deadband pushed");
+	mem->storerational(0x0030, rational_t(2.75) + rational_t(VM_MAP_DEADBAND));
+	ASSERT(mem->mapChanged(4), "Memory rational change not pushed");
+	mem->unmap(3);
+	mem->storeunsigned(0x0020, 10);
+	ASSERT(!mem->mapChanged(3), "Memory unmapped value pushed");
+	mem->clear();
+}
+
+inline void test_Memory_map_changes_same_word()
+{
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	mem->map(5, VM_OPERAND_TYPE_UINT16, VM_MAP_OPTION_DIRECTION_CLIENT | VM_MAP_OPTION_METHOD_PUT, 0x0040, 0, 0, 0);
+	mem->map(6, VM_OPERAND_TYPE_UINT16, VM_MAP_OPTION_DIRECTION_CLIENT | VM_MAP_OPTION_METHOD_PUT, 0x0042, 0, 0, 0);
+	ASSERT(mem->mapChanged(5) && mem->mapChanged(6), "Memory mapped values not pushed after map");
+	mem->storeaddress(0x0042, 7);//same shared word as the value of map 5
+	ASSERT(!mem->mapChanged(5), "Memory unchanged value of the same word pushed");
+	ASSERT(mem->mapChanged(6), "Memory change lost after the word was taken by another URL-Map");
+	ASSERT(!mem->mapChanged(6), "Memory changed value pushed twice");
+	mem->clear();
+}
+
+inline void test_Memory_access_violation()
+{
+#ifdef VM_NO_EXCEPTIONS
+	Memory::instance().clearAccessError();
+	Memory::instance().load(Memory::instance().getMemorySize());
+	ASSERT(Memory::instance().accessError(), "Memory acces violation no error flag");
+	Memory::instance().clearAccessError();
+	Memory::instance().load(0);
+	ASSERT(!Memory::instance().accessError(), "Memory access error flag set on valid access");
+#else
 	try
 	{
 		Memory::instance().load(Memory::instance().getMemorySize());
@@ -101,6 +289,39 @@ inline void test_Memory_access_violation()
 		return;
 	}
 	ASSERTFALSE("Memory acces violation no exception");
+#endif
+}
+
+inline void test_Memory_copy_out_of_range()
+{
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	uint16_t end = mem->getMemorySize() - 4;
+	mem->share(end, sizeof(uint32_t));//shared path checks len bytes of the shared map
+	mem->storeunsigned(end, 0xdeadbeef);
+#ifdef VM_NO_EXCEPTIONS
+	mem->copy(0x0010, 200, end);
+	ASSERT(mem->accessError(), "Memory copy past the end no error flag");
+	mem->clearAccessError();
+	mem->copy(end, 200, 0x0010);
+	ASSERT(mem->accessError(), "Memory copy from past the end no error flag");
+	mem->clearAccessError();
+#else
+	bool thrown = false;
+	try
+	{
+		mem->copy(0x0010, 200, end);
+	}
+	catch(std::exception& e)
+	{
+		thrown = true;
+	}
+	ASSERT(thrown, "Memory copy past the end no exception");
+#endif
+	ASSERT(mem->loadunsigned(end) == 0xdeadbeef, "Memory copy past the end changed memory");
+	mem->copy(end, 4, 0x0010);
+	ASSERT(mem->loadunsigned(0x0010) == 0xdeadbeef, "Memory copy up to the end wrong value");
+	mem->clear();
 }
 
 //inline void test_Memory_readonly_dump()
@@ -131,7 +352,15 @@ inline void test_Memory()
 	test_Memory_storeunsigned_loadunsigned();
 	test_Memory_storedecimal_loaddecimal();
 	test_Memory_copy();
+	test_Memory_copy_out_of_range();
 	test_Memory_clear();
+	test_Memory_storeBlock();
+	test_Memory_shared();
+	test_Memory_snapshot();
+	test_Memory_map_index();
+	test_Memory_map_pool();
+	test_Memory_map_changes();
+	test_Memory_map_changes_same_word();
 	test_Memory_access_violation();
 #else
 	TESTINFO("Test Memory off");
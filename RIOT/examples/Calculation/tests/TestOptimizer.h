@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Tests for Optimizer.h
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+#ifndef TESTS_TESTOPTIMIZER_H_
+#define TESTS_TESTOPTIMIZER_H_
+
+#include "Tests.h"
+#include "Optimizer.h"
+#include "Scheduler.h"
+
+extern "C" size_t gcoap_optimized(uint8_t instance, uint16_t before, uint16_t cycles, uint8_t* buf, size_t buf_len);
+
+inline void test_Optimizer_ADDCOMPARE()
+{
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	VM vm(mem, PID::instances());
+	uint8_t program[] = {VM_INSTRUCTION_LOAD, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x00, 0x01, 0x00,//counter = 0
+			VM_INSTRUCTION_ADD, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x00, 0x01, 0x01,//counter += 1
+			VM_INSTRUCTION_COMPARE, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x00, 0x01, 0x0a, 0x05, 0x00, 0x15, 0x00, 0x15, 0x00,//while counter < 10
+			VM_INSTRUCTION_HALT};
+	vm.setProgram(program, sizeof(program));
+	uint32_t steps = vm.run(1000, 0);
+	ASSERT(steps == 22 && mem->load(0x0100) == 10, "loop without superinstruction wrong");
+
+	Optimizer optimizer(&vm);
+	ASSERT(optimizer.fuse() == 1, "ADD and COMPARE not fused");
+	ASSERT(mem->getCodeSize() == sizeof(program) - 4, "superinstruction should save 4 Bytes");
+	ASSERT(mem->loadcode(0x05) == VM_INSTRUCTION_ADDCOMPARE && mem->loadcode(0x11) == VM_INSTRUCTION_HALT, "wrong rewritten program");
+	ASSERT(optimizer.fuse() == 0, "superinstruction fused again");
+
+	mem->store(0x0100, 0);
+	vm.clear();
+	ASSERT(vm.verified(), "rewritten program not verified");
+	steps = vm.run(1000, 0);
+	ASSERT(steps == 12 && mem->load(0x0100) == 10, "loop with superinstruction wrong");
+	ASSERT(vm.getProgramcounter() == 0x11 && (vm.getStatuscode() & VM_ERROR_MASK) == 0, "loop with superinstruction did not halt");
+	mem->clear();
+}
+
+inline void test_Optimizer_TIMECOMPARE_URLMAPCOMPARE()
+{
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	VM vm(mem, PID::instances());
+	uint8_t program[] = {VM_INSTRUCTION_TIME, 0x00, 0x01,
+			VM_INSTRUCTION_COMPARETIME, 0x04, 0x01, 0x00, 0x00, 0x00, 0x00, 0x0e, 0x00, 0x00, 0x00,//timeout 0ms elapsed
+			VM_INSTRUCTION_URLMAPCHECK, 0x10, 0x08, 0x01,
+			VM_INSTRUCTION_COMPARE, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x08, 0x01, 0x01, 0x1d, 0x00, 0x1e, 0x00, 0x1f, 0x00,//status of map 1 compared with 1
+			VM_INSTRUCTION_HALT, VM_INSTRUCTION_HALT, VM_INSTRUCTION_HALT};
+	vm.setProgram(program, sizeof(program));
+	while(!vm.halted())
+	{
+		vm.run(1000, 0);
+	}
+	uint16_t programcounter = vm.getProgramcounter();
+	ASSERT(programcounter == 0x1d && mem->loadunsigned(0x0100) != 0, "program without superinstructions wrong");
+
+	Optimizer optimizer(&vm);
+	ASSERT(optimizer.fuse() == 2, "TIME, COMPARETIME and URLMAPCHECK, COMPARE not fused");
+	ASSERT(mem->getCodeSize() == sizeof(program) - 5, "superinstructions should save 5 Bytes");
+	ASSERT(mem->loadcode(0x00) == VM_INSTRUCTION_TIMECOMPARE && mem->loadcode(0x0d) == VM_INSTRUCTION_URLMAPCOMPARE, "wrong rewritten program");
+
+	mem->storeunsigned(0x0100, 0);
+	mem->store(0x0108, 0xff);
+	vm.clear();
+	uint32_t steps = 0;
+	while(!vm.halted())
+	{
+		steps += vm.run(1000, 0);
+	}
+	ASSERT(steps == 3, "superinstructions not executed");
+	ASSERT(vm.getProgramcounter() == programcounter - 5, "superinstructions branched wrong");
+	ASSERT(mem->loadunsigned(0x0100) != 0 && mem->load(0x0108) == 0, "superinstructions did not store time and status");
+	mem->clear();
+}
+
+inline void test_Optimizer_URLMAPCOMPARE_wide()
+{
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	VM vm(mem, PID::instances());
+	uint8_t program[] = {VM_INSTRUCTION_URLMAPCHECK, VM_OPTYPE_WIDE_ID, 200, 0x00, 0x08, 0x01,
+			VM_INSTRUCTION_COMPARE, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x08, 0x01, 0x01, 0x11, 0x00, 0x12, 0x00, 0x13, 0x00,//status of map 200 compared with 1
+			VM_INSTRUCTION_HALT, VM_INSTRUCTION_HALT, VM_INSTRUCTION_HALT};
+	mem->map(200, VM_OPERAND_TYPE_UINT32, VM_MAP_OPTION_LIFETIME_EVER, 0x0010, 0, NO_MAPPING, NO_MAPPING);
+	vm.setProgram(program, sizeof(program));
+	Optimizer optimizer(&vm);
+	ASSERT(optimizer.fuse() == 1, "URLMAPCHECK with wide id and COMPARE not fused");
+	ASSERT(mem->getCodeSize() == sizeof(program) - 4, "superinstruction should save 4 Bytes");
+	ASSERT(VM_OPTYPE_IS_WIDE_ID(mem->loadcode(0x01)) && mem->loadcodeaddress(0x02) == 200, "wide id not kept");
+	ASSERT((mem->loadcode(0x01) & VM_OPTYPE_MASK) == VM_OPERAND_TYPE_UINT8, "compare type of the superinstruction wrong");
+	mem->store(0x0108, 0xff);
+	vm.clear();
+	while(!vm.halted())
+	{
+		vm.run(1000, 0);
+	}
+	ASSERT(vm.getProgramcounter() == 0x11 - 4 && mem->load(0x0108) == 0, "superinstruction with wide id wrong");
+	mem->clear();
+}
+
+inline void test_Optimizer_passes()
+{
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	VM vm(mem, PID::instances());
+	uint8_t program[] = {VM_INSTRUCTION_LOAD, VM_OPERAND_TYPE_UINT16 | VM_LITERAL, 0x00, 0x01, 0x03, 0x00,
+			VM_INSTRUCTION_ADD, VM_OPERAND_TYPE_UINT16 | VM_LITERAL, 0x00, 0x01, 0x05, 0x00,
+			VM_INSTRUCTION_SUB, VM_OPERAND_TYPE_UINT16 | VM_LITERAL, 0x00, 0x01, 0x01, 0x00,//folded into LOAD 7
+			VM_INSTRUCTION_LOAD, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x02, 0x01, 0xc8,
+			VM_INSTRUCTION_DIV, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x02, 0x01, 0x08,//RSHIFT 3
+			VM_INSTRUCTION_MUL, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x02, 0x01, 0x02,//LSHIFT 1
+			VM_INSTRUCTION_JUMP, VM_LITERAL, 0x26, 0x00,//threaded to 0x2a
+			VM_INSTRUCTION_HALT,//dead
+			VM_INSTRUCTION_JUMP, VM_LITERAL, 0x2a, 0x00,//dead after threading
+			VM_INSTRUCTION_LOAD, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x03, 0x01, 0x35,
+			VM_INSTRUCTION_MOD, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x03, 0x01, 0x10,//AND 0x0f
+			VM_INSTRUCTION_HALT};
+	vm.setProgram(program, sizeof(program));
+	uint32_t steps = vm.run(1000, 0);
+	ASSERT(steps == 11 && mem->loadaddress(0x0100) == 7 && mem->load(0x0102) == 50 && mem->load(0x0103) == 5, "program without optimization wrong");
+
+	mem->storeaddress(0x0100, 0);
+	mem->store(0x0102, 0);
+	mem->store(0x0103, 0);
+	Optimizer optimizer(&vm);
+	ASSERT(optimizer.optimize(OPTIMIZER_PASSES_ALL) == 6, "3 reduced instructions, 1 threaded jump, 1 folded chain and 1 dead code block expected");
+	ASSERT(optimizer.getSaved() == 17 && mem->getCodeSize() == sizeof(program) - 17, "folding and dead code removal should save 17 Bytes");
+	ASSERT(optimizer.getCycles() == OPTIMIZER_MUL_CYCLES + 2 * OPTIMIZER_DIV_CYCLES + 3 * OPTIMIZER_DISPATCH_CYCLES, "wrong estimated cycles");
+	ASSERT(mem->loadcode(0x00) == VM_INSTRUCTION_LOAD && mem->loadcodeaddress(0x04) == 7, "LOAD chain not folded");
+	ASSERT(mem->loadcode(0x0b) == VM_INSTRUCTION_RSHIFT && mem->loadcode(0x0f) == 3, "DIV not reduced");
+	ASSERT(mem->loadcode(0x10) == VM_INSTRUCTION_LSHIFT && mem->loadcode(0x14) == 1, "MUL not reduced");
+	ASSERT(mem->loadcode(0x15) == VM_INSTRUCTION_JUMP && mem->loadcodeaddress(0x17) == 0x19, "JUMP not threaded and relocated");
+	ASSERT(mem->loadcode(0x1e) == VM_INSTRUCTION_AND && mem->loadcode(0x22) == 0x0f, "MOD not reduced");
+
+	vm.clear();
+	ASSERT(vm.verified(), "optimized program not verified");
+	steps = vm.run(1000, 0);
+	ASSERT(steps == 8 && mem->loadaddress(0x0100) == 7 && mem->load(0x0102) == 50 && mem->load(0x0103) == 5, "optimized program wrong");
+	ASSERT(optimizer.optimize(OPTIMIZER_PASSES_ALL) == 0, "optimized program changed again");
+	mem->clear();
+}
+
+inline void test_Optimizer_upload_response()
+{
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	VM vm(mem, PID::instances());
+	uint8_t program[] = {VM_INSTRUCTION_LOAD, VM_OPERAND_TYPE_UINT16 | VM_LITERAL, 0x00, 0x01, 0x03, 0x00,
+			VM_INSTRUCTION_ADD, VM_OPERAND_TYPE_UINT16 | VM_LITERAL, 0x00, 0x01, 0x05, 0x00,//folded into LOAD 8
+			VM_INSTRUCTION_HALT};
+	vm.setProgram(program, sizeof(program));
+	uint16_t before = mem->getCodeSize();
+	Optimizer optimizer(&vm);
+	ASSERT(optimizer.optimize(OPTIMIZER_PASSES_ALL) > 0 && optimizer.getSaved() > 0, "program not shrunk");
+	uint16_t result[3];
+	ASSERT(gcoap_optimized(0, before, optimizer.getCycles(), (uint8_t*) result, sizeof(result) - 1) == 0, "result written into a too small buffer");
+	ASSERT(gcoap_optimized(0, before, optimizer.getCycles(), (uint8_t*) result, sizeof(result)) == sizeof(result), "result not written");
+	ASSERT(result[0] == sizeof(program), "code size before the optimization wrong");
+	ASSERT(result[1] == sizeof(program) - optimizer.getSaved() && result[1] == mem->getCodeSize(), "code size after the optimization wrong");
+	ASSERT(result[2] == optimizer.getCycles(), "estimated cycles wrong");
+	mem->clear();
+}
+
+inline void test_Optimizer_unchanged()
+{
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	VM vm(mem, PID::instances());
+	uint8_t program[] = {VM_INSTRUCTION_JUMP, VM_LITERAL, 0x09, 0x00,
+			VM_INSTRUCTION_ADD, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x00, 0x01, 0x01,
+			VM_INSTRUCTION_COMPARE, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x00, 0x01, 0x03, 0x04, 0x00, 0x14, 0x00, 0x14, 0x00,//jump target
+			VM_INSTRUCTION_HALT};
+	vm.setProgram(program, sizeof(program));
+	Optimizer optimizer(&vm);
+	ASSERT(optimizer.fuse() == 0 && mem->getCodeSize() == sizeof(program), "pair fused although COMPARE is a jump target");
+
+#ifndef VM_HARVARD
+	uint8_t program2[] = {VM_INSTRUCTION_ADD, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x00, 0x01, 0x01,
+			VM_INSTRUCTION_COMPARE, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x00, 0x01, 0x03, 0x00, 0x00, 0x10, 0x00, 0x10, 0x00,
+			VM_INSTRUCTION_LOAD, VM_OPERAND_TYPE_UINT8, 0x04, 0x01, 0x10, 0x00,//reads its own opcode from the code region
+			VM_INSTRUCTION_HALT};
+	vm.setProgram(program2, sizeof(program2));
+	ASSERT(optimizer.fuse() == 0 && mem->getCodeSize() == sizeof(program2), "code moved although it is read as data");
+#endif
+
+	Scheduler scheduler;
+	uint8_t program3[] = {VM_INSTRUCTION_TIME, 0x00, 0x01,
+			VM_INSTRUCTION_COMPARETIME, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x0e, 0x00, 0x00, 0x00,
+			VM_INSTRUCTION_HALT};
+	Memory::instance(0).clear();
+	scheduler.getVM(0)->setProgram(program3, sizeof(program3));
+	scheduler.restart(0);
+	uint16_t saved = 0;
+	uint32_t cycles = 0;
+	ASSERT(scheduler.optimize(0, &saved, &cycles) == 0, "program of a running instance optimized");
+	scheduler.stop(0);
+	ASSERT(scheduler.optimize(0, &saved, &cycles) == 1 && Memory::instance(0).getCodeSize() == sizeof(program3) - 1, "program of a stopped instance not optimized");
+	ASSERT(saved == 1 && cycles == OPTIMIZER_DISPATCH_CYCLES, "wrong optimization result of the scheduler");
+	Memory::instance(0).clear();
+}
+
+/**
+ * @brief Runs all test functions specified. Acts as a test-suite.
+ */
+inline void test_Optimizer()
+{
+#ifndef TEST_OPTIMIZER_OFF
+	test_Optimizer_ADDCOMPARE();
+	test_Optimizer_TIMECOMPARE_URLMAPCOMPARE();
+	test_Optimizer_URLMAPCOMPARE_wide();
+	test_Optimizer_passes();
+	test_Optimizer_upload_response();
+	test_Optimizer_unchanged();
+#else
+	TESTINFO("Test Optimizer off");
+#endif
+}
+
+#endif /* TESTS_TESTOPTIMIZER_H_ */
@@ -29,6 +29,17 @@ inline void test_PID_init()
 	ASSERT(pid.getUpperLimit() == (rational_t)255, "wrong upper Limit");
 }
 
+inline void test_PID_init_out_of_range()
+{
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	PID pid;
+	ASSERT(!pid.init(mem, 0, mem->getMemorySize() - 2, 8, (rational_t)1, (rational_t)0, (rational_t)0, 100, PID_DIRECTION_DIRECT, (rational_t)0, (rational_t)255), "PID initialized with output out of range");
+	ASSERT(!pid.isInitialized(), "PID is initialized");
+	ASSERT(!mem->accessError(), "Rejected PID set the access error of the memory");
+	ASSERT(pid.init(mem, 0, mem->getMemorySize() - sizeof(rational_t), 8, (rational_t)1, (rational_t)0, (rational_t)0, 100, PID_DIRECTION_DIRECT, (rational_t)0, (rational_t)255), "PID with output at the end of the memory not initialized");
+}
+
 inline void test_PID_compute()
 {
 	TESTINFO("Testing PID, this may take a while...\n");
@@ -76,6 +87,7 @@ inline void test_PID()
 //#define TEST_PID_OFF
 #ifndef TEST_PID_OFF
 	test_PID_init();
+	test_PID_init_out_of_range();
 	test_PID_compute();
 	test_PID_MANUAL_mode();
 #else
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Tests for Scheduler.h
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+#ifndef TESTS_TESTSCHEDULER_H_
+#define TESTS_TESTSCHEDULER_H_
+
+#include "Tests.h"
+#include "Scheduler.h"
+
+inline void test_Scheduler_instances()
+{
+	Scheduler scheduler;
+	ASSERT(scheduler.getInstanceCount() == VM_INSTANCES, "wrong number of instances");
+	ASSERT(scheduler.idle(), "new instances should not run");
+	ASSERT(scheduler.schedule() == VM_NO_INSTANCE, "idle scheduler executed an instance");
+	for(uint8_t i = 0; i < VM_INSTANCES; i++)
+	{
+		ASSERT(scheduler.getVM(i)->getMemory() == &Memory::instance(i), "instance does not use its memory");
+		for(uint8_t j = 0; j < i; j++)
+		{
+			ASSERT(scheduler.getVM(i)->getStack() != scheduler.getVM(j)->getStack(), "instances share a stack");
+		}
+	}
+	ASSERT(!scheduler.run(VM_INSTANCES), "run of a missing instance");
+	ASSERT(!scheduler.restart(VM_INSTANCES), "restart of a missing instance");
+	ASSERT(!scheduler.setPriority(VM_INSTANCES, 1), "priority of a missing instance");
+}
+
+inline void test_Scheduler_round_robin()
+{
+	if(VM_INSTANCES < 2)
+	{
+		TESTINFO("needs more than one VM instance");
+		return;
+	}
+	Scheduler scheduler;
+	uint8_t program[] = {VM_INSTRUCTION_ADD, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x20, 0x00, 0x01, VM_INSTRUCTION_JUMP, VM_LITERAL, 0x00, 0x00};
+	for(uint8_t i = 0; i < 2; i++)
+	{
+		Memory::instance(i).clear();
+		scheduler.getVM(i)->setProgram(program, sizeof(program));
+		scheduler.restart(i);
+	}
+#if VM_SCHEDULER == VM_SCHEDULER_ROUND_ROBIN
+	ASSERT(scheduler.schedule() == 0, "instance 0 not executed first");
+	ASSERT(Memory::instance(0).load(0x0020) != 0, "instance 0 not executed");
+	ASSERT(Memory::instance(1).load(0x0020) == 0, "instance 1 executed with instance 0");
+	ASSERT(scheduler.schedule() == 1, "instance 1 not executed in turn");
+	ASSERT(Memory::instance(1).load(0x0020) != 0, "instance 1 not executed");
+	ASSERT(scheduler.schedule() == 0, "instance 0 not executed in turn");
+
+	scheduler.stop(0);
+	ASSERT(scheduler.schedule() == 1 && scheduler.schedule() == 1, "only instance 1 should run");
+#else
+	TESTINFO("round robin scheduler not selected");
+#endif
+
+	uint8_t program2[] = {VM_INSTRUCTION_HALT};
+	scheduler.getVM(1)->setProgram(program2, sizeof(program2));
+	scheduler.stop(0);
+	scheduler.restart(1);
+	ASSERT(scheduler.schedule() == 1, "instance 1 not executed");
+	ASSERT(!scheduler.isRunning(1), "halted instance still scheduled");
+	ASSERT(scheduler.idle(), "scheduler should be idle");
+	Memory::instance(0).clear();
+	Memory::instance(1).clear();
+}
+
+inline void test_Scheduler_priority()
+{
+	if(VM_INSTANCES < 2)
+	{
+		TESTINFO("needs more than one VM instance");
+		return;
+	}
+	Scheduler scheduler;
+	ASSERT(scheduler.getPriority(0) == VM_PRIORITY_DEFAULT, "wrong default priority");
+	scheduler.setPriority(1, VM_PRIORITY_DEFAULT + 1);
+	ASSERT(scheduler.getPriority(1) == VM_PRIORITY_DEFAULT + 1, "priority not set");
+#if VM_SCHEDULER == VM_SCHEDULER_PRIORITY
+	uint8_t program[] = {VM_INSTRUCTION_ADD, VM_OPERAND_TYPE_UINT8 | VM_LITERAL, 0x20, 0x00, 0x01, VM_INSTRUCTION_JUMP, VM_LITERAL, 0x00, 0x00};
+	for(uint8_t i = 0; i < 2; i++)
+	{
+		Memory::instance(i).clear();
+		scheduler.getVM(i)->setProgram(program, sizeof(program));
+		scheduler.restart(i);
+	}
+	ASSERT(scheduler.schedule() == 1 && scheduler.schedule() == 1, "higher priority not executed first");
+	ASSERT(Memory::instance(0).load(0x0020) == 0, "lower priority executed");
+	scheduler.stop(1);
+	ASSERT(scheduler.schedule() == 0, "lower priority not executed while higher priority is stopped");
+	Memory::instance(0).clear();
+	Memory::instance(1).clear();
+#else
+	TESTINFO("priority scheduler not selected");
+#endif
+}
+
+inline void test_Scheduler_waiting()
+{
+	Scheduler scheduler;
+	uint8_t program[] = {VM_INSTRUCTION_TIME, 0x20, 0x00, VM_INSTRUCTION_SLEEPUNTIL, 0x20, 0x00, 0x0a, 0x00, 0x00, 0x00,//sleep 10ms
+			VM_INSTRUCTION_URLMAPWAIT, 0x00, VM_INSTRUCTION_HALT};
+	Memory::instance(0).clear();
+	scheduler.getVM(0)->setProgram(program, sizeof(program));
+	scheduler.restart(0);
+	uint32_t remaining;
+	ASSERT(!scheduler.getWakeupTime(&remaining), "no instance waits for time");
+	ASSERT(scheduler.schedule() == 0 && scheduler.schedule() == 0, "instance 0 not executed");
+	ASSERT(scheduler.isRunning(0) && !scheduler.isRunnable(0), "sleeping instance should not be runnable");
+	ASSERT(scheduler.idle(), "scheduler should be idle while the instance sleeps");
+	ASSERT(scheduler.schedule() == VM_NO_INSTANCE, "sleeping instance executed");
+	ASSERT(scheduler.getWakeupTime(&remaining) && remaining > 0 && remaining <= 10000, "wrong wakeup time");
+
+	xtimer_usleep(11000);
+	Memory::instance(0).map(0, VM_OPERAND_TYPE_UINT16, VM_MAP_OPTION_LIFETIME_ONCE | VM_MAP_OPTION_URL_LITERAL | VM_MAP_OPTION_DIRECTION_CLIENT | VM_MAP_OPTION_METHOD_GET, 0x0030, 0, 0x0040, 0x0042);
+	ASSERT(!scheduler.idle(), "instance should be runnable after the sleep");
+	ASSERT(scheduler.schedule() == 0, "instance 0 not executed after the sleep");
+	ASSERT(scheduler.idle() && !scheduler.getWakeupTime(&remaining), "instance should wait for the mapping");
+
+	Scheduler::arm(KERNEL_PID_UNDEF);
+	Memory::instance(0).map_done(0);
+	Scheduler::notify();
+	Scheduler::disarm();
+	ASSERT(scheduler.schedule() == 0, "instance 0 not executed after the mapping");
+	ASSERT(!scheduler.isRunning(0), "halted instance still scheduled");
+	Memory::instance(0).clear();
+}
+
+/**
+ * @brief Runs all test functions specified. Acts as a test-suite.
+ */
+inline void test_Scheduler()
+{
+#ifndef TEST_SCHEDULER_OFF
+	test_Scheduler_instances();
+	test_Scheduler_round_robin();
+	test_Scheduler_priority();
+	test_Scheduler_waiting();
+#else
+	TESTINFO("Test Scheduler off");
+#endif
+}
+
+#endif /* TESTS_TESTSCHEDULER_H_ */
@@ -16,6 +16,7 @@
 
 #include "Tests.h"
 #include "Stack.h"
+#include "OperandStack.h"
 
 inline void test_Stack_push()
 {
@@ -47,6 +48,11 @@ inline void test_Stack_overflow()
 	{
 		stack.push(i);
 	}
+#ifdef VM_NO_EXCEPTIONS
+	stack.push(0x1234);
+	ASSERT(stack.error(), "No Overflow error flag");
+	ASSERT(stack.peek() == stack.getStackSize() - 1, "Overflow changed the stack");
+#else
 	try
 	{
 		stack.push(0x1234);
@@ -56,11 +62,18 @@ inline void test_Stack_overflow()
 		return;
 	}
 	ASSERTFALSE("No Overflow exception");
+#endif
 }
 
 inline void test_Stack_underflow()
 {
 	Stack stack;
+#ifdef VM_NO_EXCEPTIONS
+	stack.pop();
+	ASSERT(stack.error(), "No underflow error flag");
+	stack.clearError();
+	ASSERT(!stack.error(), "Underflow error flag not cleared");
+#else
 	try
 	{
 		stack.pop();
@@ -70,6 +83,7 @@ inline void test_Stack_underflow()
 		return;
 	}
 	ASSERTFALSE("No underflow exception");
+#endif
 }
 
 inline void test_Stack_full()
@@ -112,6 +126,25 @@ inline void test_Stack_clear()
 	}
 }
 
+inline void test_OperandStack()
+{
+	OperandStack stack;
+	ASSERT(stack.getStackSize() == VM_STACK_SIZE, "wrong operand stack size");
+	ASSERT(stack.holds(0) && !stack.holds(1), "operand stack should be empty");
+	ASSERT(stack.hasSpace(stack.getStackSize()) && !stack.hasSpace(stack.getStackSize() + 1), "wrong space of an empty operand stack");
+	for(uint8_t i = 0; i < stack.getStackSize(); i++)
+	{
+		stack.push(0x12345600 | i);
+	}
+	ASSERT(!stack.hasSpace(1), "operand stack should be full");
+	ASSERT(stack.getDepth() == stack.getStackSize(), "wrong depth");
+	ASSERT(stack.pop() == (0x12345600u | (stack.getStackSize() - 1)), "pop() error");
+	stack.top() = 0xdeadbeef;
+	ASSERT(stack.dump()[stack.getStackSize() - 2] == 0xdeadbeef, "top() does not change the value in place");
+	stack.clear();
+	ASSERT(stack.getDepth() == 0 && stack.dump()[0] == 0, "operand stack not cleared");
+}
+
 inline void test_Stack()
 {
 #ifndef TEST_STACK_OFF
@@ -123,6 +156,7 @@ inline void test_Stack()
 	test_Stack_full();
 	test_Stack_empty();
 	test_Stack_clear();
+	test_OperandStack();
 
 #else
 	TESTINFO("Test Stack off");
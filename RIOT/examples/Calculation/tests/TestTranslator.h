@@ -0,0 +1,359 @@
+/*
+ * Copyright (C) 2017 Mattes Besuden
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser
+ * General Public License v2.1. See the file LICENSE in the top level
+ * directory for more details.
+ */
+
+/**
+ * @brief       Tests for Translator.h and Translation.h. Translations.cpp holds the translations of the programs of
+ * 				test_Translator_load(), it is the source returned by test_Translator_source().
+ *
+ * @author      Mattes Besuden <besuden@uni-bremen.de>
+ */
+#ifndef TESTS_TESTTRANSLATOR_H_
+#define TESTS_TESTTRANSLATOR_H_
+
+#include "Tests.h"
+#include "Translator.h"
+#include "Compiler.h"
+
+#if defined(VM_TOOLCHAIN) && defined(VM_TRANSLATIONS)
+
+///Same program as test_print_ggt in TestExamples.h
+static const uint8_t test_translator_ggt[] = {
+		VM_INSTRUCTION_LOAD, 0x01, 0x70, 0x00, 0x5F, 0xE5, 0x73, 0x6D,
+		VM_INSTRUCTION_LOAD, 0x01, 0x74, 0x00, 0x82, 0x3F, 0xA5, 0x43,
+		VM_INSTRUCTION_TIME, 0x80, 0x00,
+		VM_INSTRUCTION_COMPARE, 0x01, 0x70, 0x00, 0x00, 0x00, 0x00, 0x00, 0x2B, 0x00, 0x21, 0x00, 0x2B, 0x00,
+		VM_INSTRUCTION_LOAD, 0x00, 0x70, 0x00, 0x74, 0x00,
+		VM_INSTRUCTION_JUMP, 0x01, 0x59, 0x00,
+		VM_INSTRUCTION_COMPARE, 0x01, 0x74, 0x00, 0x00, 0x00, 0x00, 0x00, 0x39, 0x00, 0x59, 0x00, 0x39, 0x00,
+		VM_INSTRUCTION_COMPARE, 0x00, 0x70, 0x00, 0x74, 0x00, 0x4F, 0x00, 0x4F, 0x00, 0x45, 0x00,
+		VM_INSTRUCTION_SUB, 0x00, 0x70, 0x00, 0x74, 0x00,
+		VM_INSTRUCTION_JUMP, 0x01, 0x2B, 0x00,
+		VM_INSTRUCTION_SUB, 0x00, 0x74, 0x00, 0x70, 0x00,
+		VM_INSTRUCTION_JUMP, 0x01, 0x2B, 0x00,
+		VM_INSTRUCTION_TIME, 0x84, 0x00,
+		VM_INSTRUCTION_SUB, 0x00, 0x84, 0x00, 0x80, 0x00,
+		VM_INSTRUCTION_HALT
+};
+
+///Operand types, registers and memory, division and modulo, dec arithmetic
+static const char* test_translator_expressions =
+		"var x = 200;\n"
+		"var y : u16 = 1000;\n"
+		"var d = 2.5;\n"
+		"var e : dec @0x20c = 0;\n"
+		"var r1 : u16 @0x200 = (y + 13) * (x / 50) / 2 % 7 ^ 0xff;\n"
+		"var r2 : u32 @0x204 = x + 100000;\n"
+		"var r3 : u8 @0x208 = y;\n"
+		"var r5 : u8 @0x210 = ~x & (x << 1 | 3);\n"
+		"var n = 0;\n"
+		"var sum : u32 @0x214 = 0;\n"
+		"while (n < 300) {\n"
+		"	n += 1;\n"
+		"	if (n % 3 == 0) { sum += n >> 1; }\n"
+		"	else if (n >= 290) sum += 1000;\n"
+		"	e = e + d / 4 - 0.5;\n"
+		"}\n";
+
+///TIME (yield point) and interpreted CALL and RETURN between translated instructions, division by zero
+static const char* test_translator_divide =
+		".var value u16 @0x200\n"
+		".var time u32 @0x220\n"
+		"	LOAD.u16 @value, #0x1234\n"
+		"	NOT.u16 @value\n"
+		"	XOR.u16 @value, #0x00ff\n"
+		"	LOAD.u16 r1, @value\n"
+		"	TIME @time\n"
+		"	CALL shift\n"
+		"	LOAD.u8 r2, #0\n"
+		"	MOD.u16 r1, #0x100\n"
+		"	DIV.u16 r1, r2\n"
+		"	HALT\n"
+		"shift:	RSHIFT.u16 r1, #4\n"
+		"	RETURN\n";
+
+///Stores to a mapped (shared) value, to an unshared value and to an unshared value which is also read with another type
+static const char* test_translator_shared =
+		".var value u32 @0x230\n"
+		".var count u32 @0x240\n"
+		".var total u32 @0x250\n"
+		".var low u16 @0x250\n"
+		"	URLMAP.u32 0, client|get|ever, @value, 0, \"affe::1\", \"/sensor\"\n"
+		"loop:	ADD.u32 @value, #3\n"
+		"	ADD.u32 @count, #1\n"
+		"	ADD.u32 @total, #0x10001\n"
+		"	COMPARE.u32 @count, #10, loop, done, done\n"
+		"done:	LOAD.u16 r1, @low\n"
+		"	URLMAPDELETE 0\n"
+		"	HALT\n";
+
+/**
+ * Loads a translated program of the tests.
+ * @param vm VM to load the program into.
+ * @param index Index of the program.
+ * @return Name of the program, NULL if there is no program with the index.
+ */
+inline const char* test_Translator_load(VM* vm, uint8_t index)
+{
+	static uint8_t expressions[512];
+	static Compiler compiler(expressions, sizeof(expressions));
+	static uint16_t expressionssize = compiler.compile(test_translator_expressions);
+	static uint8_t divide[64];
+	static Assembler assembler(divide, sizeof(divide));
+	static uint16_t dividesize = assembler.assemble(test_translator_divide);
+	static uint8_t shared[128];
+	static Assembler sharedassembler(shared, sizeof(shared));
+	static uint16_t sharedsize = sharedassembler.assemble(test_translator_shared);
+	switch(index)
+	{
+	case 0:
+		vm->setProgram(const_cast<uint8_t*>(test_translator_ggt), sizeof(test_translator_ggt));
+		return "ggt";
+	case 1:
+		vm->setProgram(expressions, expressionssize);
+		return "expressions";
+	case 2:
+		vm->setProgram(divide, dividesize);
+		return "divide";
+	case 3:
+		vm->setProgram(shared, sharedsize);
+		return "shared";
+	default:
+		return 0;
+	}
+}
+
+/**
+ * Translates the programs of test_Translator_load(), the source is Translations.cpp (without the license header).
+ * @param source Buffer for the source.
+ * @param size Size of the buffer.
+ * @return Length of the source, 0 on errors.
+ */
+inline uint32_t test_Translator_source(char* source, uint32_t size)
+{
+	Memory* mem = &Memory::instance();
+	VM vm(mem, PID::instances());
+	Translator translator(source, size);
+	const char* name;
+	for(uint8_t i = 0; (name = test_Translator_load(&vm, i)); i++)
+	{
+		translator.translate(&vm, name);
+	}
+	mem->clear();
+	return translator.finish();
+}
+
+/**
+ * @param address Address of the memory.
+ * @return True if TIME writes the address in a program of test_Translator_load().
+ */
+inline bool test_Translator_time(uint16_t address)
+{
+	return (address >= 0x80 && address < 0x88) || (address >= 0x220 && address < 0x224);
+}
+
+inline void test_Translator_source()
+{
+	static char source[32768];
+	uint32_t length = test_Translator_source(source, sizeof(source));
+	ASSERT(length != 0, "programs not translated");
+	ASSERT(strstr(source, "L0013:\tVM_TRANSLATED_BLOCK(0x0013, 1);\n\t//0x0013 COMPARE\n\tVM_TRANSLATED_STATUS(0x0013, VM_INSTRUCTION_COMPARE);\n"
+			"\tVM_TRANSLATED_BRANCH((translatedcompare<uint32_t, TranslatedCell<0>, TranslatedLiteral<0x00000000u> >(state, cells)), L002b, L0021, L002b);\n"),
+			"COMPARE translated wrong");
+	ASSERT(strstr(source, "L0045:\tVM_TRANSLATED_BLOCK(0x0045, 2);\n") && !strstr(source, "case 0x004b:"), "SUB and JUMP not one block");
+	ASSERT(strstr(source, "\ttranslatedtime<TranslatedCell<2> >(state, cells);\n\tVM_TRANSLATED_EXIT(0x0013);\n"), "TIME not translated");
+	ASSERT(strstr(source, "\ttranslatedfetch<uint32_t, 0x0070>(state, cells[0]);\n") && strstr(source, "leave:\n"
+			"\ttranslatedwriteback<uint32_t, 0x0070>(state, cells[0]);\n"), "unshared value not kept in a cell");
+	ASSERT(strstr(source, ");\t//CALL\n") && strstr(source, ");\t//RETURN\n"), "CALL and RETURN not left to the interpreter");
+	ASSERT(strstr(source, "translatedkernel<uint32_t, OpAdd, TranslatedMemory<0x0230>, TranslatedLiteral<0x00000003u> >(state, cells);\n")
+			&& strstr(source, "translatedkernel<uint32_t, OpAdd, TranslatedCell<0>, TranslatedLiteral<0x00000001u> >(state, cells);\n"),
+			"mapped value not accessed with sequence lock");
+	ASSERT(strstr(source, "translatedkernel<uint32_t, OpAdd, TranslatedUnshared<0x0250>, TranslatedLiteral<0x00010001u> >(state, cells);\n")
+			&& strstr(source, "translatedkernel<uint16_t, OpLoad, TranslatedRegister<1>, TranslatedUnshared<0x0250> >(state, cells);\n"),
+			"value accessed with two types kept in a cell");
+	ASSERT(strstr(source, "const uint8_t vm_translationcount = 4;\n"), "table of the translations wrong");
+
+	Memory* mem = &Memory::instance();
+	VM vm(mem, PID::instances());
+	test_Translator_load(&vm, 0);
+	char small[256];
+	Translator full(small, sizeof(small));
+	ASSERT(!full.translate(&vm, "ggt") && strcmp(full.getError(), "source buffer too small") == 0, "source buffer overflow");
+	char buffer[8192];
+	Translator ggt(buffer, sizeof(buffer));
+	ASSERT(!ggt.translate(&vm, "1ggt") && strcmp(ggt.getError(), "invalid name") == 0, "invalid name accepted");
+	Translator names(buffer, sizeof(buffer));
+	ASSERT(names.translate(&vm, "ggt") && names.getInstructions() == 15 && names.getInterpreted() == 0, names.getError());
+	ASSERT(!names.translate(&vm, "ggt"), "name used twice");
+
+	uint8_t indirect[] = {VM_INSTRUCTION_JUMP, 0x00, 0x04, 0x00, 0x05, 0x00, VM_INSTRUCTION_HALT};
+	vm.setProgram(indirect, sizeof(indirect));
+	Translator unverified(buffer, sizeof(buffer));
+	ASSERT(!unverified.translate(&vm, "indirect") && !vm.translated(), "unverified program translated");
+	mem->clear();
+}
+
+/**
+ * Executes each program translated and interpreted with the same step budgets, the VMs must not differ after any batch.
+ */
+inline void test_Translator_equal()
+{
+	static const uint32_t budgets[] = {1, 7, 1000};
+	Memory* translatedmemory = &Memory::instance(0);
+	Memory* interpretedmemory = &Memory::instance(1);
+	VM translated(translatedmemory, PID::instances());
+	VM interpreted(interpretedmemory, PID::instances());
+	interpreted.setTranslation(false);
+	const char* name;
+	for(uint8_t program = 0; (name = test_Translator_load(&translated, program)); program++)
+	{
+		for(uint8_t budget = 0; budget < sizeof(budgets) / sizeof(budgets[0]); budget++)
+		{
+			translatedmemory->clear();
+			interpretedmemory->clear();
+			test_Translator_load(&translated, program);
+			test_Translator_load(&interpreted, program);
+			if(!translated.translated())
+			{
+				ASSERTFALSE("translation out of date, replace Translations.cpp by test_Translator_source()");
+				printf("program: %s\n", name);
+				return;
+			}
+			ASSERT(!interpreted.translated(), "translation used although disabled");
+			bool equal = true;
+			for(uint16_t batch = 0; batch < 5000 && equal && !(translated.halted() && interpreted.halted()); batch++)
+			{
+				equal = translated.run(budgets[budget], 0) == interpreted.run(budgets[budget], 0)
+						&& translated.getProgramcounter() == interpreted.getProgramcounter()
+						&& translated.getFlags() == interpreted.getFlags()
+						&& translated.getStatuscode() == interpreted.getStatuscode();
+				for(uint8_t i = 0; i < VM_REGISTERS && equal; i++)
+				{
+					equal = translated.getRegister(i) == interpreted.getRegister(i);
+				}
+			}
+			ASSERT(equal && translated.halted(), "translated program differs from the interpreter");
+			const uint8_t* translateddump = translatedmemory->dump();
+			const uint8_t* interpreteddump = interpretedmemory->dump();
+			for(uint16_t address = 0; address < translatedmemory->getMemorySize() && equal; address++)
+			{
+				equal = test_Translator_time(address) || translateddump[address] == interpreteddump[address];
+			}
+			ASSERT(equal, "translated program wrote different memory");
+		}
+	}
+	translatedmemory->clear();
+	interpretedmemory->clear();
+}
+
+inline void test_Translator_results()
+{
+	Memory* mem = &Memory::instance();
+	mem->clear();
+	VM vm(mem, PID::instances());
+	test_Translator_load(&vm, 1);
+	ASSERT(vm.translated(), "expressions not translated");
+	while(!vm.halted())
+	{
+		vm.run(1000, 0);
+	}
+	ASSERT((vm.getStatuscode() & VM_ERROR_MASK) == 0, "expressions failed");
+	ASSERT(mem->loadunsigned(0x200) == ((((1000 + 13) * (200 / 50) / 2) % 7) ^ 0xff), "wrong arithmetic");
+	ASSERT(mem->loadunsigned(0x204) == 100200 && mem->load(0x208) == (1000 & 0xff), "wrong conversion");
+	ASSERT(static_cast<float>(mem->loadrational(0x20c)) == 37.5f, "wrong dec arithmetic");
+	ASSERT(mem->loadunsigned(0x214) == (15150 - 50) / 2 + 7 * 1000, "wrong loop");
+
+	mem->clear();
+	test_Translator_load(&vm, 2);
+	vm.run(1000, 0);
+	ASSERT(!vm.halted() && vm.getProgramcounter() == 24, "TIME not a yield point");
+	vm.run(1000, 0);
+	ASSERT(vm.halted() && (vm.getStatuscode() & VM_ERROR_MASK) == VM_ERROR_DIVIDEZERO && (vm.getFlags() & VM_FLAG_DIVIDEZERO), "division by zero not detected");
+	ASSERT(vm.translated(), "translation left");
+
+	//writing into the code region (or a new program) leaves the translation
+	mem->clear();
+	test_Translator_load(&vm, 0);
+	ASSERT(vm.translated(), "ggt not translated");
+	uint8_t halt = VM_INSTRUCTION_HALT;
+	mem->storeCode(sizeof(test_translator_ggt) - 1, &halt, sizeof(halt));
+	ASSERT(!vm.translated(), "translation used after the code was changed");
+	while(!vm.halted())
+	{
+		vm.run(1000, 0);
+	}
+	ASSERT(mem->loadunsigned(0x70) == 1, "wrong GCD after the code was changed");
+
+	//values shared before the program was loaded are not accessed without sequence lock
+	mem->clear();
+	mem->share(0x74, sizeof(uint32_t));
+	test_Translator_load(&vm, 0);
+	ASSERT(vm.verified() && !vm.translated(), "translation used although an unshared value is shared");
+	mem->clear();
+	test_Translator_load(&vm, 3);
+	ASSERT(vm.translated(), "program with a mapped value not translated");
+	while(!vm.halted())
+	{
+		vm.run(1000, 0);
+	}
+	ASSERT(mem->loadunsigned(0x230) == 30 && mem->loadunsigned(0x240) == 10, "wrong stores to the mapped value");
+	ASSERT(mem->loadunsigned(0x250) == 0xa000a && vm.getRegister(1) == 10, "wrong value read with another type");
+	mem->clear();
+}
+
+/**
+ * GCD of test_print_ggt interpreted and translated.
+ */
+inline void test_Translator_benchmark()
+{
+	Memory* mem = &Memory::instance();
+	VM vm(mem, PID::instances());
+	uint32_t time[2] = {0, 0};
+	for(uint8_t mode = 0; mode < 2; mode++)
+	{
+		vm.setTranslation(mode == 1);
+		mem->clear();
+		test_Translator_load(&vm, 0);
+		ASSERT(vm.translated() == (mode == 1), "wrong execution mode");
+		for(uint16_t i = 0; i < 1000; i++)
+		{
+			vm.clear();
+			uint32_t start = xtimer_now();
+			while(!vm.halted())
+			{
+				vm.run(VM_RUN_MAX_STEPS, 0);
+			}
+			time[mode] += xtimer_now() - start;
+		}
+		ASSERT(mem->loadunsigned(0x70) == 1, "gcd wrong should be 1");
+	}
+	printf("GCD Time x1000 (%s dispatch): interpreted %" PRIu32 " us, translated %" PRIu32 " us\n", VM::getDispatchEngine(), time[0], time[1]);
+	ASSERT(time[1] < time[0], "translation slower than the interpreter");
+	vm.setTranslation(true);
+	mem->clear();
+}
+
+inline void test_Translator()
+{
+#ifndef TEST_TRANSLATOR_OFF
+	test_Translator_source();
+	test_Translator_equal();
+	test_Translator_results();
+	test_Translator_benchmark();
+#else
+	TESTINFO("Test Translator off");
+#endif
+}
+
+#else
+inline void test_Translator()
+{
+	TESTINFO("Test Translator off (no VM_TOOLCHAIN or VM_TRANSLATIONS)");
+}
+#endif
+
+#endif /* TESTS_TESTTRANSLATOR_H_ */
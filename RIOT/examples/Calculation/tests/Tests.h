@@ -90,6 +90,12 @@ inline void inc(void)
 #include "TestCalculationVM.h"
 #include "TestMemory.h"
 #include "TestStack.h"
+#include "TestInstructionCache.h"
+#include "TestScheduler.h"
+#include "TestOptimizer.h"
+#include "TestAssembler.h"
+#include "TestCompiler.h"
+#include "TestTranslator.h"
 #include "TestPID.h"
 #include "TestGcoapSharedMemoryFunctions.h"
 #include "TestExamples.h"
@@ -105,6 +111,12 @@ inline void run_tests()
 	test_CalculationVM();
 	test_Memory();
 	test_Stack();
+	test_InstructionCache();
+	test_Scheduler();
+	test_Optimizer();
+	test_Assembler();
+	test_Compiler();
+	test_Translator();
 	test_PID();
 	test_Gcoap_shared();
 	test_examples();
@@ -11,20 +11,55 @@
 #include "xtimer.h"
 #include "mango.h"
 
+/* syscall of the ggt program which reports the result (top of the stack) */
+#define GGT_SYSCALL_RESULT 0x0000
+
 static uint32_t after = 0;
 static uint32_t before = 0;
-static uint8_t memory[128];
+/* heap of the VM (VM state, stack and modules), mango_initialize needs 4 byte alignment */
+static uint32_t memory[64];
 
-static const uint8_t ggt_name[4] = { 0x67, 0x67, 0x74, 0x00, };
-static const uint8_t ggt_code[36] = { 0xFF, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x02,
-	    0x04, 0x01, 0x00, 0x00, 0x1E, 0x00, 0x66, 0x00,
-	    0x33, 0xF4, 0x01, 0x00, 0x00, 0x1E, 0x01, 0x68,
-	    0x00, 0x20, 0xF1, 0x00, 0x00, 0x00, 0x00, 0x01,
-	0x1C, 0x08, 0x00, 0x02, };
+static const uint8_t ggt_name[12] = { 0x67, 0x67, 0x74, 0x00, };
+/* gcd(1836311903, 1134903170) by subtraction like examples/ggt, locals: a, b */
+static const uint8_t ggt_code[79] = {
+	0xFF, 0x00, 0x02, 0x00,			/* magic, executable, no imports */
+	0x00, 0x00, 0x00, 0x02,			/* initializer: nop nop nop halt */
+	0x04, 0x02, 0x00, 0x02,			/* function (8): safe critical (syscall), max stack 2, 0 arguments, 2 locals */
+	0x33, 0x5F, 0xE5, 0x73, 0x6D,	/* ldc.x32 1836311903 */
+	0x13, 0x01,						/* stloc.x32 a */
+	0x33, 0x82, 0x3F, 0xA5, 0x43,	/* ldc.x32 1134903170 */
+	0x13, 0x02,						/* stloc.x32 b */
+	0x10, 0x00,						/* ldloc.x32 a */
+	0x22, 0x06,						/* brtrue.s loop */
+	0x10, 0x01,						/* ldloc.x32 b */
+	0x13, 0x01,						/* stloc.x32 a */
+	0x20, 0x1D,						/* br.s done */
+	0x10, 0x01,						/* loop: ldloc.x32 b */
+	0x21, 0x19,						/* brfalse.s done */
+	0x10, 0x00,						/* ldloc.x32 a */
+	0x10, 0x02,						/* ldloc.x32 b */
+	0x52,							/* cgt.i32.un */
+	0x21, 0x09,						/* brfalse.s else */
+	0x10, 0x00,						/* ldloc.x32 a */
+	0x10, 0x02,						/* ldloc.x32 b */
+	0x41,							/* sub.i32 */
+	0x13, 0x01,						/* stloc.x32 a */
+	0x20, 0xEC,						/* br.s loop */
+	0x10, 0x01,						/* else: ldloc.x32 b */
+	0x10, 0x01,						/* ldloc.x32 a */
+	0x41,							/* sub.i32 */
+	0x13, 0x02,						/* stloc.x32 b */
+	0x20, 0xE3,						/* br.s loop */
+	0x10, 0x00,						/* done: ldloc.x32 a */
+	0x1E, 0x01, 0x00, 0x00,			/* syscall GGT_SYSCALL_RESULT (pops a) */
+	0x18,							/* ret */
+	0x00, 0x00, 0x01,				/* app info: no features, 1 module */
+	0x1C, 0x08, 0x00, 0x02,			/* entry point: call.s 8, halt */
+};
 
-int32_t compute(void) {
+int32_t compute(uint32_t *result) {
 
-	mango_vm* vm = mango_initialize(memory, sizeof(memory), 32, NULL);
+	mango_vm* vm = mango_initialize(memory, sizeof(memory), 64, NULL);
 	if (!vm) {
 		return -5;
 	}
@@ -36,31 +71,34 @@ int32_t compute(void) {
 	}
 
 
-	int32_t result = -2;
+	int32_t return_val = -2;
 	before = xtimer_now();
-	while (1) {
+	while (return_val == -2) {
 		switch (mango_execute(vm)) {
 		default:
-			result = -1; break;
+			return_val = -1; break;
 		case MANGO_E_SUCCESS:
-			result = 0; break;
+			return_val = 0; break;
 		case MANGO_E_SYSCALL:
-			result = -3; break;
+			if (mango_syscall(vm) != GGT_SYSCALL_RESULT) {
+				return_val = -3; break;
+			}
+			*result = *(uint32_t *)mango_stack_top(vm);
+			mango_stack_free(vm, sizeof(uint32_t));
+			break;
 		}
 	}
 	after = xtimer_now();
-	return result;
+	return return_val;
 }
 
 int main(void) {
 	xtimer_init();
 	printf("starting ggt_Mango computation\n");
-	printf("%s", (unsigned char *)ggt_name);
-
-	int32_t return_val = 0;
-	return_val = compute();
+	printf("%s\n", (const char *)ggt_name);
 
-	uint32_t result = memory[0];
+	uint32_t result = 0;
+	int32_t return_val = compute(&result);
 
 	printf("Ggt_Mango computation DONE\n");
 	printf("return_val: %"PRId32", result: %"PRIu32" took %"PRIu32" µs\n", return_val, result, (after - before));
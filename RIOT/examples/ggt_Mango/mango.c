@@ -697,6 +697,13 @@ mango_result mango_execute(mango_vm *vm) {
 
 uint16_t mango_syscall(const mango_vm *vm) { return vm ? vm->syscall : 0; }
 
+#ifdef MANGO_COUNT_INSTRUCTIONS
+uint32_t mango_instructions;
+#define COUNT() mango_instructions++
+#else
+#define COUNT() (void)0
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 
 #pragma GCC diagnostic push
@@ -712,6 +719,7 @@ uint16_t mango_syscall(const mango_vm *vm) { return vm ? vm->syscall : 0; }
 #define NEXT                                                                   \
   do {                                                                         \
     printf("* %s\n", opcodes[*ip]);                                            \
+    COUNT();                                                                   \
     goto *dispatch_table[*ip];                                                 \
   } while (0)
 #else
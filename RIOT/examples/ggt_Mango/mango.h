@@ -139,6 +139,12 @@ MANGO_API mango_result mango_execute(mango_vm *vm);
 
 MANGO_API uint16_t mango_syscall(const mango_vm *vm);
 
+#ifdef MANGO_COUNT_INSTRUCTIONS
+// Number of executed instructions, counted if built with
+// MANGO_COUNT_INSTRUCTIONS (benchmarks)
+extern uint32_t mango_instructions;
+#endif
+
 ////////////////////////////////////////////////////////////////////////////////
 
 #undef MANGO_API
@@ -59,6 +59,30 @@
  * described above. In fact, the gcoap_response() function is inline, and uses
  * those two functions.
  *
+ * A resource path ending with `*` matches every request path which starts
+ * with the part before the `*`. A resource with the full path is preferred.
+ *
+ * ### Observe ###
+ *
+ * gcoap supports the server side of Observe (RFC 7641) for GET requests. A
+ * GET request with the Observe option 0 (register) which is answered with a
+ * success code registers the client for the request path, the response
+ * carries the Observe option. A request with the Observe option 1
+ * (deregister) or a reset message in reply to a notification removes the
+ * registration. A path has at most one observer, a registration of another
+ * client is answered without the Observe option (no registration). At most
+ * GCOAP_OBS_REGISTRATIONS_MAX paths are observed.
+ *
+ * To notify the observer about a change of the resource:
+ *
+ * -# Call gcoap_obs_init() with the path. It returns GCOAP_OBS_INIT_UNUSED if
+ *    the path is not observed, stop in that case.
+ * -# Write the payload, starting at the updated _payload_ pointer.
+ * -# Call gcoap_finish() and pass the result to gcoap_obs_send().
+ *
+ * A notification with an error code ends the observation. Notifications are
+ * non-confirmable.
+ *
  * ## Client Operation ##
  *
  * gcoap uses RIOT's asynchronous messaging facility to send and receive
@@ -139,6 +163,7 @@
 #include "net/gnrc/ipv6.h"
 #include "net/gnrc/udp.h"
 #include "nanocoap.h"
+#include "mutex.h"
 #include "xtimer.h"
 
 #ifdef __cplusplus
@@ -208,6 +233,40 @@ extern "C" {
 /** @brief Identifies a gcoap-specific timeout IPC message */
 #define GCOAP_NETAPI_MSG_TYPE_TIMEOUT    (0x1501)
 
+/** @brief Maximum number of observed paths; use 2 if not defined */
+#ifndef GCOAP_OBS_REGISTRATIONS_MAX
+#define GCOAP_OBS_REGISTRATIONS_MAX     (2)
+#endif
+
+/** @brief Option number of Observe, RFC 7641 */
+#ifndef COAP_OPT_OBSERVE
+#define COAP_OPT_OBSERVE        (6)
+#endif
+
+/**
+ * @name Values of the Observe option in a request
+ * @{
+ */
+#define GCOAP_OBS_REGISTER      (0)  /**< Register the client */
+#define GCOAP_OBS_DEREGISTER    (1)  /**< Remove the registration */
+/** @} */
+
+/**
+ * @brief Maximum length in bytes of the Observe option in a notification
+ *
+ * One byte for delta and length, three bytes for the value.
+ */
+#define GCOAP_OBS_OPTION_MAXLEN (4)
+
+/**
+ * @name Return values for gcoap_obs_init()
+ * @{
+ */
+#define GCOAP_OBS_INIT_OK       (0)  /**< Notification initialized */
+#define GCOAP_OBS_INIT_ERR      (-1) /**< Header could not be written */
+#define GCOAP_OBS_INIT_UNUSED   (-2) /**< Path is not observed */
+/** @} */
+
 /**
  * @brief  A modular collection of resources for a server
  */
@@ -238,6 +297,21 @@ typedef struct {
     msg_t timeout_msg;                  /**< For response timer */
 } gcoap_request_memo_t;
 
+/**
+ * @brief  Registration of an observer for a resource path
+ */
+typedef struct {
+    ipv6_addr_t addr;                   /**< Address of the observer */
+    uint16_t port;                      /**< Port of the observer; 0 if this memo
+                                             is unused */
+    char path[NANOCOAP_URL_MAX];        /**< Observed path */
+    uint8_t token[GCOAP_TOKENLEN_MAX];  /**< Token of the registration */
+    unsigned token_len;                 /**< Length of the token */
+    uint32_t sequence;                  /**< Observe value of the last message,
+                                             24 bits */
+    uint16_t last_message_id;           /**< ID of the last notification */
+} gcoap_observe_memo_t;
+
 /**
  * @brief  Container for the state of gcoap itself
  */
@@ -249,6 +323,11 @@ typedef struct {
                                             byte of an entry is zero, the entry
                                             is available */
     uint16_t last_message_id;          /**< Last message ID used */
+    gcoap_observe_memo_t observe_memos[GCOAP_OBS_REGISTRATIONS_MAX];
+                                       /**< Observe registrations */
+    mutex_t observe_lock;              /**< Protects the Observe registrations,
+                                            notifications are sent by other
+                                            threads */
 } gcoap_state_t;
 
 /**
@@ -379,6 +458,39 @@ static inline ssize_t gcoap_response(coap_pkt_t *pdu, uint8_t *buf, size_t len,
  */
 void gcoap_op_state(uint8_t *open_reqs);
 
+/**
+ * @brief  Initializes a notification for the observer of a path.
+ *
+ * The notification is a non-confirmable 2.05 (Content) response with the
+ * token of the registration. Use gcoap_resp_init() on the notification to
+ * send another response code.
+ *
+ * @param[out] pdu Notification metadata
+ * @param[out] buf Buffer containing the PDU
+ * @param[in] len Length of the buffer
+ * @param[in] path Observed path
+ *
+ * @return GCOAP_OBS_INIT_OK on success
+ * @return GCOAP_OBS_INIT_ERR on error
+ * @return GCOAP_OBS_INIT_UNUSED if the path is not observed
+ */
+int gcoap_obs_init(coap_pkt_t *pdu, uint8_t *buf, size_t len, const char *path);
+
+/**
+ * @brief  Sends a notification to the observer of a path.
+ *
+ * Adds the Observe option to the finished PDU. A notification with an error
+ * code removes the registration.
+ *
+ * @param[in] buf Buffer containing the PDU (see gcoap_obs_init())
+ * @param[in] len Length of the PDU
+ * @param[in] path Observed path
+ *
+ * @return length of the packet
+ * @return 0 if cannot send or the path is not observed
+ */
+size_t gcoap_obs_send(const uint8_t *buf, size_t len, const char *path);
+
 #ifdef __cplusplus
 }
 #endif
@@ -19,6 +19,7 @@
  */
 
 #include <errno.h>
+#include "irq.h"
 #include "net/gnrc/coap.h"
 #include "random.h"
 #include "thread.h"
@@ -46,6 +47,16 @@ static size_t _send_buf( uint8_t *buf, size_t len, ipv6_addr_t *src, uint16_t po
 static void _expire_request(gcoap_request_memo_t *memo);
 static void _find_req_memo(gcoap_request_memo_t **memo_ptr, coap_pkt_t *pdu,
                                                             uint8_t *buf, size_t len);
+static int _read_ext(uint8_t **pos, uint8_t *end, unsigned *value);
+static int _get_observe(coap_pkt_t *pdu, uint8_t *end, uint32_t *value);
+static gcoap_observe_memo_t *_find_obs_memo(const char *path);
+static int _obs_register(coap_pkt_t *pdu, ipv6_addr_t *src, uint16_t port,
+                                                           uint32_t *sequence);
+static void _obs_deregister(coap_pkt_t *pdu, ipv6_addr_t *src, uint16_t port);
+static void _obs_reset(coap_pkt_t *pdu, ipv6_addr_t *src, uint16_t port);
+static size_t _send_observe(const uint8_t *buf, size_t len, uint32_t sequence,
+                                               ipv6_addr_t *addr, uint16_t port);
+static uint16_t _next_message_id(void);
 
 /* Internal variables */
 const coap_resource_t _default_resources[] = {
@@ -61,6 +72,7 @@ static gcoap_listener_t _default_listener = {
 static gcoap_state_t _coap_state = {
     .netreg_port = GNRC_NETREG_ENTRY_INIT_PID(0, KERNEL_PID_UNDEF),
     .listeners   = &_default_listener,
+    .observe_lock = MUTEX_INIT,
 };
 
 static kernel_pid_t _pid = KERNEL_PID_UNDEF;
@@ -139,17 +151,47 @@ static void _receive(gnrc_pktsnip_t *pkt, ipv6_addr_t *src, uint16_t port)
         goto exit;
     }
 
+    /* reset of a notification */
+    if (((pdu.hdr->ver_t_tkl & 0x30) >> 4) == COAP_TYPE_RST) {
+        _obs_reset(&pdu, src, port);
+    }
     /* incoming request */
-    if (coap_get_code_class(&pdu) == COAP_CLASS_REQ) {
+    else if (coap_get_code_class(&pdu) == COAP_CLASS_REQ) {
+        uint32_t observe = 0;
+        int observe_req = 0;
+        int observe_res = -1;
+        uint32_t sequence = 0;
+
         if (pkt->size > sizeof(buf)) {
             DEBUG("gcoap: request too big: %u\n", pkt->size);
             pdu_len = gcoap_response(&pdu, buf, sizeof(buf),
                                            COAP_CODE_REQUEST_ENTITY_TOO_LARGE);
         } else {
+            /* read before the response overwrites the request */
+            observe_req = coap_method2flag(coap_get_code_detail(&pdu)) == COAP_GET
+                            && _get_observe(&pdu, buf + pkt_size, &observe) == 0;
             pdu_len = _handle_req(&pdu, buf, sizeof(buf));
         }
+        /* the response keeps the token of the request */
+        if (observe_req && pdu_len > 0) {
+            if (observe == GCOAP_OBS_REGISTER
+                    && coap_get_code_class(&pdu) == COAP_CLASS_SUCCESS) {
+                observe_res = _obs_register(&pdu, src, port, &sequence);
+            }
+            else if (observe == GCOAP_OBS_DEREGISTER) {
+                _obs_deregister(&pdu, src, port);
+            }
+        }
         if (pdu_len > 0) {
-            _send_buf(buf, pdu_len, src, port);
+            if (observe_res == 0
+                    && _send_observe(buf, pdu_len, sequence, src, port) == 0) {
+                /* the client never sees the registration acknowledged */
+                _obs_deregister(&pdu, src, port);
+                observe_res = -1;
+            }
+            if (observe_res != 0) {
+                _send_buf(buf, pdu_len, src, port);
+            }
         }
     }
     /* incoming response */
@@ -181,7 +223,10 @@ static size_t _handle_req(coap_pkt_t *pdu, uint8_t *buf, size_t len)
 
     /* Find path for CoAP msg among listener resources and execute callback. */
     gcoap_listener_t *listener = _coap_state.listeners;
-    while (listener) {
+    coap_resource_t *match = NULL;
+    /* first resource with a matching prefix, used if no path matches */
+    coap_resource_t *prefix_match = NULL;
+    while (listener && !match) {
         coap_resource_t *resource = listener->resources;
         for (size_t i = 0; i < listener->resources_len; i++) {
             if (i) {
@@ -191,6 +236,15 @@ static size_t _handle_req(coap_pkt_t *pdu, uint8_t *buf, size_t len)
                 continue;
             }
 
+            size_t path_len = strlen(resource->path);
+            if (path_len && resource->path[path_len - 1] == '*') {
+                if (!prefix_match && strncmp((char *)&pdu->url[0], resource->path,
+                                                             path_len - 1) == 0) {
+                    prefix_match = resource;
+                }
+                continue;
+            }
+
             int res = strcmp((char *)&pdu->url[0], resource->path);
             if (res > 0) {
                 continue;
@@ -200,16 +254,23 @@ static size_t _handle_req(coap_pkt_t *pdu, uint8_t *buf, size_t len)
                 break;
             }
             else {
-                ssize_t pdu_len = resource->handler(pdu, buf, len);
-                if (pdu_len < 0) {
-                    pdu_len = gcoap_response(pdu, buf, len,
-                                             COAP_CODE_INTERNAL_SERVER_ERROR);
-                }
-                return pdu_len;
+                match = resource;
+                break;
             }
         }
         listener = listener->next;
     }
+    if (!match) {
+        match = prefix_match;
+    }
+    if (match) {
+        ssize_t pdu_len = match->handler(pdu, buf, len);
+        if (pdu_len < 0) {
+            pdu_len = gcoap_response(pdu, buf, len,
+                                     COAP_CODE_INTERNAL_SERVER_ERROR);
+        }
+        return pdu_len;
+    }
     /* resource not found */
     return gcoap_response(pdu, buf, len, COAP_CODE_PATH_NOT_FOUND);
 }
@@ -300,6 +361,260 @@ static void _expire_request(gcoap_request_memo_t *memo)
     }
 }
 
+/*
+ * Reads an extended option delta or length.
+ *
+ * Returns 0 on success, -1 if the option is malformed.
+ */
+static int _read_ext(uint8_t **pos, uint8_t *end, unsigned *value)
+{
+    if (*value == 13) {
+        if (*pos + 1 > end) {
+            return -1;
+        }
+        *value = 13 + (*pos)[0];
+        *pos += 1;
+    }
+    else if (*value == 14) {
+        if (*pos + 2 > end) {
+            return -1;
+        }
+        *value = 269 + (((*pos)[0] << 8) | (*pos)[1]);
+        *pos += 2;
+    }
+    else if (*value == 15) {
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Reads the Observe option of a request. The options start after the token
+ * and end at the payload marker or the end of the packet.
+ *
+ * end End of the packet
+ *
+ * Returns 0 if the option was found, -1 otherwise.
+ */
+static int _get_observe(coap_pkt_t *pdu, uint8_t *end, uint32_t *value)
+{
+    uint8_t *pos = (uint8_t *)pdu->hdr + coap_get_total_hdr_len(pdu);
+    unsigned optnum = 0;
+
+    while (pos < end && *pos != GCOAP_PAYLOAD_MARKER) {
+        unsigned delta  = *pos >> 4;
+        unsigned optlen = *pos & 0x0F;
+        pos++;
+        if (_read_ext(&pos, end, &delta) < 0 || _read_ext(&pos, end, &optlen) < 0
+                || pos + optlen > end) {
+            return -1;
+        }
+        optnum += delta;
+        if (optnum == COAP_OPT_OBSERVE) {
+            if (optlen > 3) {
+                return -1;
+            }
+            *value = 0;
+            for (unsigned i = 0; i < optlen; i++) {
+                *value = (*value << 8) | pos[i];
+            }
+            return 0;
+        }
+        else if (optnum > COAP_OPT_OBSERVE) {
+            break;
+        }
+        pos += optlen;
+    }
+    return -1;
+}
+
+/*
+ * Finds the Observe registration of a path. Caller must hold observe_lock.
+ *
+ * Returns the memo, or NULL if the path is not observed.
+ */
+static gcoap_observe_memo_t *_find_obs_memo(const char *path)
+{
+    for (int i = 0; i < GCOAP_OBS_REGISTRATIONS_MAX; i++) {
+        gcoap_observe_memo_t *memo = &_coap_state.observe_memos[i];
+        if (memo->port && strncmp(memo->path, path, NANOCOAP_URL_MAX) == 0) {
+            return memo;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Registers the sender of a GET request as observer of the request path. A
+ * registration of the same client is updated with the token of the request.
+ *
+ * sequence Observe value of the response
+ *
+ * Returns 0 on success, -1 if the path is observed by another client or all
+ * memos are used.
+ */
+static int _obs_register(coap_pkt_t *pdu, ipv6_addr_t *src, uint16_t port,
+                                                           uint32_t *sequence)
+{
+    gcoap_observe_memo_t *memo = NULL;
+    unsigned token_len = coap_get_token_len(pdu);
+
+    if (token_len > GCOAP_TOKENLEN_MAX) {
+        return -1;
+    }
+    mutex_lock(&_coap_state.observe_lock);
+    gcoap_observe_memo_t *observed = _find_obs_memo((char *)&pdu->url[0]);
+    if (observed) {
+        if (observed->port == port && ipv6_addr_equal(&observed->addr, src)) {
+            memo = observed;
+        }
+    }
+    else {
+        for (int i = 0; i < GCOAP_OBS_REGISTRATIONS_MAX; i++) {
+            if (!_coap_state.observe_memos[i].port) {
+                memo = &_coap_state.observe_memos[i];
+                break;
+            }
+        }
+    }
+    if (memo) {
+        memo->addr = *src;
+        memo->port = port;
+        strncpy(memo->path, (char *)&pdu->url[0], NANOCOAP_URL_MAX - 1);
+        memo->path[NANOCOAP_URL_MAX - 1] = '\0';
+        memcpy(memo->token, pdu->token, token_len);
+        memo->token_len = token_len;
+        /* Observe values only grow, also across registrations */
+        memo->sequence = (memo->sequence + 1) & 0xFFFFFF;
+        *sequence = memo->sequence;
+    }
+    mutex_unlock(&_coap_state.observe_lock);
+    return memo ? 0 : -1;
+}
+
+/* Removes the registration of the sender of a request for the request path. */
+static void _obs_deregister(coap_pkt_t *pdu, ipv6_addr_t *src, uint16_t port)
+{
+    mutex_lock(&_coap_state.observe_lock);
+    gcoap_observe_memo_t *memo = _find_obs_memo((char *)&pdu->url[0]);
+    if (memo && memo->port == port && ipv6_addr_equal(&memo->addr, src)) {
+        memo->port = 0;
+    }
+    mutex_unlock(&_coap_state.observe_lock);
+}
+
+/* Removes the registration of the observer which reset a notification. */
+static void _obs_reset(coap_pkt_t *pdu, ipv6_addr_t *src, uint16_t port)
+{
+    uint16_t message_id = NTOHS(pdu->hdr->id);
+
+    mutex_lock(&_coap_state.observe_lock);
+    for (int i = 0; i < GCOAP_OBS_REGISTRATIONS_MAX; i++) {
+        gcoap_observe_memo_t *memo = &_coap_state.observe_memos[i];
+        if (memo->port == port && memo->last_message_id == message_id
+                && ipv6_addr_equal(&memo->addr, src)) {
+            DEBUG("gcoap: observer of %s reset notification\n", memo->path);
+            memo->port = 0;
+        }
+    }
+    mutex_unlock(&_coap_state.observe_lock);
+}
+
+/*
+ * Sends a finished response PDU with the Observe option. The option is
+ * inserted at its position in the sorted options, so the delta of the
+ * following option is written again.
+ *
+ * @return Length of the packet
+ * @return 0 if cannot send, or if the options of the PDU cannot be parsed
+ */
+static size_t _send_observe(const uint8_t *buf, size_t len, uint32_t sequence,
+                                               ipv6_addr_t *addr, uint16_t port)
+{
+    /* Observe option and the header of the following option */
+    uint8_t options[GCOAP_OBS_OPTION_MAXLEN + 3];
+    size_t options_len = 0;
+    size_t hdr_len = sizeof(coap_hdr_t) + (buf[0] & 0x0F);
+    uint8_t *end = (uint8_t *)buf + len;
+
+    if (len < hdr_len) {
+        return 0;
+    }
+    /* find the first option with a higher number than Observe */
+    uint8_t *next = (uint8_t *)buf + hdr_len;
+    unsigned optnum = 0;
+    while (next < end && *next != GCOAP_PAYLOAD_MARKER) {
+        uint8_t *pos    = next + 1;
+        unsigned delta  = *next >> 4;
+        unsigned optlen = *next & 0x0F;
+        if (_read_ext(&pos, end, &delta) < 0 || _read_ext(&pos, end, &optlen) < 0
+                || pos + optlen > end || optnum + delta == COAP_OPT_OBSERVE) {
+            DEBUG("gcoap: cannot add Observe option\n");
+            return 0;
+        }
+        if (optnum + delta > COAP_OPT_OBSERVE) {
+            break;
+        }
+        optnum += delta;
+        next    = pos + optlen;
+    }
+
+    unsigned value_len = (sequence > 0xFFFF) ? 3 : (sequence > 0xFF) ? 2
+                                                 : (sequence ? 1 : 0);
+    options[options_len++] = ((COAP_OPT_OBSERVE - optnum) << 4) | value_len;
+    for (unsigned i = value_len; i > 0; i--) {
+        options[options_len++] = (sequence >> (8 * (i - 1))) & 0xFF;
+    }
+
+    const uint8_t *rest = next;
+    if (next < end && *next != GCOAP_PAYLOAD_MARKER) {
+        uint8_t *pos   = next + 1;
+        unsigned delta = *next >> 4;
+        _read_ext(&pos, end, &delta);
+        delta -= COAP_OPT_OBSERVE - optnum;
+        if (delta < 13) {
+            options[options_len++] = (delta << 4) | (*next & 0x0F);
+        }
+        else if (delta < 269) {
+            options[options_len++] = (13 << 4) | (*next & 0x0F);
+            options[options_len++] = delta - 13;
+        }
+        else {
+            options[options_len++] = (14 << 4) | (*next & 0x0F);
+            options[options_len++] = (delta - 269) >> 8;
+            options[options_len++] = (delta - 269) & 0xFF;
+        }
+        rest = pos;
+    }
+    /* header, token and the options in front of Observe */
+    size_t front_len = next - buf;
+    size_t rest_len  = end - rest;
+
+    gnrc_pktsnip_t *snip = gnrc_pktbuf_add(NULL, NULL, front_len + options_len + rest_len,
+                                                              GNRC_NETTYPE_UNDEF);
+    if (!snip) {
+        return 0;
+    }
+    uint8_t *data = snip->data;
+    memcpy(data, buf, front_len);
+    memcpy(data + front_len, options, options_len);
+    memcpy(data + front_len + options_len, rest, rest_len);
+
+    return _send(snip, addr, port);
+}
+
+/*
+ * Returns the ID for a new message. Requests and notifications are built by
+ * different threads, so the ID is incremented with interrupts disabled.
+ */
+static uint16_t _next_message_id(void)
+{
+    unsigned state = irq_disable();
+    uint16_t id = ++_coap_state.last_message_id;
+    irq_restore(state);
+    return id;
+}
+
 /* Registers receive/send port with GNRC registry. */
 static int _register_port(gnrc_netreg_entry_t *netreg_port, uint16_t port)
 {
@@ -501,7 +816,7 @@ int gcoap_req_init(coap_pkt_t *pdu, uint8_t *buf, size_t len, unsigned code,
     }
     hdrlen = coap_build_hdr(pdu->hdr, COAP_TYPE_NON, &token[0], GCOAP_TOKENLEN,
                                                      code,
-                                                   ++_coap_state.last_message_id);
+                                                   _next_message_id());
 
     if (hdrlen > 0) {
         /* Reserve some space between the header and payload to write options later */
@@ -594,4 +909,66 @@ void gcoap_op_state(uint8_t *open_reqs)
     *open_reqs = count;
 }
 
+int gcoap_obs_init(coap_pkt_t *pdu, uint8_t *buf, size_t len, const char *path)
+{
+    ssize_t hdrlen;
+
+    mutex_lock(&_coap_state.observe_lock);
+    gcoap_observe_memo_t *memo = _find_obs_memo(path);
+    if (!memo) {
+        mutex_unlock(&_coap_state.observe_lock);
+        return GCOAP_OBS_INIT_UNUSED;
+    }
+    pdu->hdr = (coap_hdr_t *)buf;
+    hdrlen = coap_build_hdr(pdu->hdr, COAP_TYPE_NON, &memo->token[0],
+                            memo->token_len, COAP_CODE_CONTENT,
+                            _next_message_id());
+    mutex_unlock(&_coap_state.observe_lock);
+
+    if (hdrlen > 0) {
+        pdu->token = coap_get_token_len(pdu) ? &pdu->hdr->data[0] : NULL;
+        /* Reserve some space between the header and payload to write options later */
+        pdu->payload      = buf + hdrlen + GCOAP_RESP_OPTIONS_BUF;
+        /* Payload length really zero at this point, but we set this to the available
+         * length in the buffer. Allows us to reconstruct buffer length later. */
+        pdu->payload_len  = len - (pdu->payload - buf);
+        pdu->content_type = COAP_FORMAT_NONE;
+        return GCOAP_OBS_INIT_OK;
+    }
+    else {
+        return GCOAP_OBS_INIT_ERR;
+    }
+}
+
+size_t gcoap_obs_send(const uint8_t *buf, size_t len, const char *path)
+{
+    coap_pkt_t pdu = { .hdr = (coap_hdr_t *)buf };
+
+    if (len < sizeof(coap_hdr_t)) {
+        return 0;
+    }
+    mutex_lock(&_coap_state.observe_lock);
+    gcoap_observe_memo_t *memo = _find_obs_memo(path);
+    if (!memo) {
+        mutex_unlock(&_coap_state.observe_lock);
+        return 0;
+    }
+    ipv6_addr_t addr = memo->addr;
+    uint16_t port    = memo->port;
+    memo->sequence   = (memo->sequence + 1) & 0xFFFFFF;
+    uint32_t sequence = memo->sequence;
+    memo->last_message_id = NTOHS(pdu.hdr->id);
+    int success = coap_get_code_class(&pdu) == COAP_CLASS_SUCCESS;
+    if (!success) {
+        /* an error ends the observation */
+        memo->port = 0;
+    }
+    mutex_unlock(&_coap_state.observe_lock);
+
+    if (!success) {
+        return _send_buf((uint8_t *)buf, len, &addr, port);
+    }
+    return _send_observe(buf, len, sequence, &addr, port);
+}
+
 /** @} */